@@ -20,6 +20,7 @@
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/NeighborUpdater.h"
 #include "fboss/agent/TxPacket.h"
+#include "fboss/agent/packet/HdrViews.h"
 #include "fboss/agent/packet/PktUtil.h"
 #include "fboss/agent/state/ArpEntry.h"
 #include "fboss/agent/state/ArpTable.h"
@@ -30,6 +31,7 @@
 #include "fboss/agent/state/VlanMap.h"
 #include "fboss/agent/state/Vlan.h"
 
+using folly::IOBuf;
 using folly::IPAddressV4;
 using folly::MacAddress;
 using folly::io::Cursor;
@@ -37,16 +39,6 @@ using folly::io::RWPrivateCursor;
 using std::unique_ptr;
 using std::shared_ptr;
 
-enum : uint16_t {
-  ARP_HTYPE_ETHERNET = 1,
-  ARP_PTYPE_IPV4 = 0x0800,
-};
-
-enum : uint8_t {
-  ARP_HLEN_ETHERNET = 6,
-  ARP_PLEN_IPV4 = 4,
-};
-
 namespace facebook { namespace fboss {
 
 ArpHandler::ArpHandler(SwSwitch* sw)
@@ -60,24 +52,9 @@ void ArpHandler::handlePacket(unique_ptr<RxPacket> pkt,
   PortID port = pkt->getSrcPort();
   auto stats = sw_->stats();
   stats->port(port)->arpPkt();
-  // Read htype, ptype, hlen, and plen
-  auto htype = cursor.readBE<uint16_t>();
-  if (htype != ARP_HTYPE_ETHERNET) {
-    stats->port(port)->arpUnsupported();
-    return;
-  }
-  auto ptype = cursor.readBE<uint16_t>();
-  if (ptype != ARP_PTYPE_IPV4) {
-    stats->port(port)->arpUnsupported();
-    return;
-  }
-  auto hlen = cursor.readBE<uint8_t>();
-  if (hlen != ARP_HLEN_ETHERNET) {
-    stats->port(port)->arpUnsupported();
-    return;
-  }
-  auto plen = cursor.readBE<uint8_t>();
-  if (plen != ARP_PLEN_IPV4) {
+  // The addresses are only decoded once we know the packet is one we handle
+  ArpHdrView arp(cursor);
+  if (!arp.isEthernetIPv4()) {
     stats->port(port)->arpUnsupported();
     return;
   }
@@ -92,19 +69,16 @@ void ArpHandler::handlePacket(unique_ptr<RxPacket> pkt,
     return;
   }
 
-  // Parse the remaining data in the packet
-  auto readOp = cursor.readBE<uint16_t>();
-  auto senderMac = PktUtil::readMac(&cursor);
-  auto senderIP = PktUtil::readIPv4(&cursor);
-  auto targetMac = PktUtil::readMac(&cursor);
-  auto targetIP = PktUtil::readIPv4(&cursor);
-
+  auto readOp = arp.oper();
   if (readOp != ARP_OP_REQUEST && readOp != ARP_OP_REPLY) {
     stats->port(port)->arpBadOp();
     return;
   }
 
   auto op = ArpOpCode(readOp);
+  auto senderMac = arp.sha();
+  auto senderIP = arp.spa();
+  auto targetIP = arp.tpa();
 
   auto updater = sw_->getNeighborUpdater();
   // Check to see if this IP address is in our ARP response table.
@@ -127,60 +101,83 @@ void ArpHandler::handlePacket(unique_ptr<RxPacket> pkt,
   if (op == ARP_OP_REQUEST) {
     stats->port(port)->arpRequestRx();
     sendArpReply(pkt->getSrcVlan(), pkt->getSrcPort(),
-                 entry.value().mac, targetIP,
+                 vlan->getArpResponseTable(), entry.value().mac, targetIP,
                  senderMac, senderIP);
     return;
   } else {
     stats->port(port)->arpReplyRx();
     return;
   }
+}
 
-  (void)targetMac; // unused
+// TODO: We need a more robust mechanism for setting up the ethernet
+// header in the response.  The HwSwitch should probably be responsible for
+// setting it up, and determinine whether or not a VLAN tag needs to be
+// present.
+//
+// The minimum packet length is 64.  We use 68 here on the assumption that
+// the packet will go out untagged, which will remove 4 bytes.
+constexpr uint32_t kArpPktLen = 68;
+// Offsets of the fields in a reply that depend on the requester
+constexpr uint32_t kArpDstMacOffset = 0;
+constexpr uint32_t kArpTargetMacOffset = 36;
+constexpr uint32_t kArpTargetIPOffset = 42;
+
+static void writeArpPacket(RWPrivateCursor* cursor,
+                           VlanID vlan,
+                           ArpOpCode op,
+                           MacAddress senderMac,
+                           IPAddressV4 senderIP,
+                           MacAddress targetMac,
+                           IPAddressV4 targetIP) {
+  TxPacket::writeEthHeader(cursor, targetMac, senderMac, vlan,
+                           ArpHandler::ETHERTYPE_ARP);
+  cursor->writeBE<uint16_t>(ARP_HTYPE_ETHERNET);
+  cursor->writeBE<uint16_t>(ARP_PTYPE_IPV4);
+  cursor->writeBE<uint8_t>(ARP_HLEN_ETHERNET);
+  cursor->writeBE<uint8_t>(ARP_PLEN_IPV4);
+  cursor->writeBE<uint16_t>(op);
+  cursor->push(senderMac.bytes(), MacAddress::SIZE);
+  cursor->write<uint32_t>(senderIP.toLong());
+  cursor->push(((op == ARP_OP_REQUEST)
+               ? MacAddress::ZERO.bytes() : targetMac.bytes()),
+              MacAddress::SIZE);
+  cursor->write<uint32_t>(targetIP.toLong());
+  // Fill the padding with 0s
+  memset(cursor->writableData(), 0, cursor->length());
 }
 
-static void sendArp(SwSwitch *sw,
-                    VlanID vlan,
-                    ArpOpCode op,
-                    MacAddress senderMac,
-                    IPAddressV4 senderIP,
-                    MacAddress targetMac,
-                    IPAddressV4 targetIP) {
+static unique_ptr<TxPacket> makeArpPacket(SwSwitch *sw,
+                                          VlanID vlan,
+                                          ArpOpCode op,
+                                          MacAddress senderMac,
+                                          IPAddressV4 senderIP,
+                                          MacAddress targetMac,
+                                          IPAddressV4 targetIP) {
   VLOG(3) << "sending ARP " << ((op == ARP_OP_REQUEST) ? "request" : "reply")
           << " on vlan " << vlan
           << " to " << targetIP.str() << " (" << targetMac << "): "
           << senderIP.str() << " is " << senderMac;
 
-  // TODO: We need a more robust mechanism for setting up the ethernet
-  // header in the response.  The HwSwitch should probably be responsible for
-  // setting it up, and determinine whether or not a VLAN tag needs to be
-  // present.
-  //
-  // The minimum packet length is 64.  We use 68 here on the assumption that
-  // the packet will go out untagged, which will remove 4 bytes.
-  uint32_t pktLen = 68;
-  auto pkt = sw->allocatePacket(pktLen);
+  auto pkt = sw->allocatePacket(kArpPktLen);
   RWPrivateCursor cursor(pkt->buf());
+  writeArpPacket(&cursor, vlan, op, senderMac, senderIP, targetMac, targetIP);
+  return pkt;
+}
 
-  pkt->writeEthHeader(&cursor, targetMac, senderMac, vlan,
-                      ArpHandler::ETHERTYPE_ARP);
-  cursor.writeBE<uint16_t>(ARP_HTYPE_ETHERNET);
-  cursor.writeBE<uint16_t>(ARP_PTYPE_IPV4);
-  cursor.writeBE<uint8_t>(ARP_HLEN_ETHERNET);
-  cursor.writeBE<uint8_t>(ARP_PLEN_IPV4);
-  cursor.writeBE<uint16_t>(op);
-  cursor.push(senderMac.bytes(), MacAddress::SIZE);
-  cursor.write<uint32_t>(senderIP.toLong());
-  cursor.push(((op == ARP_OP_REQUEST)
-               ? MacAddress::ZERO.bytes() : targetMac.bytes()),
-              MacAddress::SIZE);
-  cursor.write<uint32_t>(targetIP.toLong());
-  // Fill the padding with 0s
-  memset(cursor.writableData(), 0, cursor.length());
-
-  sw->sendPacketSwitched(std::move(pkt));
+static void sendArp(SwSwitch *sw,
+                    VlanID vlan,
+                    ArpOpCode op,
+                    MacAddress senderMac,
+                    IPAddressV4 senderIP,
+                    MacAddress targetMac,
+                    IPAddressV4 targetIP) {
+  sw->sendPacketSwitched(makeArpPacket(sw, vlan, op, senderMac, senderIP,
+                                       targetMac, targetIP));
 }
 
 void ArpHandler::floodGratuituousArp() {
+  HwSwitch::TxPackets pkts;
   for (const auto& intf: *sw_->getState()->getInterfaces()) {
     for (const auto& addrEntry: intf->getAddresses()) {
       if (!addrEntry.first.isV4()) {
@@ -189,21 +186,43 @@ void ArpHandler::floodGratuituousArp() {
       auto v4Addr = addrEntry.first.asV4();
       // Gratuitous arps have both source and destination IPs set to
       // originator's address
-      sendArp(sw_, intf->getVlanID(), ARP_OP_REQUEST, intf->getMac(), v4Addr,
-          MacAddress::BROADCAST, v4Addr);
+      pkts.push_back(makeArpPacket(sw_, intf->getVlanID(), ARP_OP_REQUEST,
+                                   intf->getMac(), v4Addr,
+                                   MacAddress::BROADCAST, v4Addr));
     }
   }
-
+  sw_->sendPacketsSwitched(std::move(pkts));
 }
 
-void ArpHandler::sendArpReply(VlanID vlan,
-                              PortID port,
-                              MacAddress senderMac,
-                              IPAddressV4 senderIP,
-                              MacAddress targetMac,
-                              IPAddressV4 targetIP) {
+void ArpHandler::sendArpReply(
+    VlanID vlan,
+    PortID port,
+    const shared_ptr<ArpResponseTable>& responseTable,
+    MacAddress senderMac,
+    IPAddressV4 senderIP,
+    MacAddress targetMac,
+    IPAddressV4 targetIP) {
   sw_->stats()->port(port)->arpReplyTx();
-  sendArp(sw_, vlan, ARP_OP_REPLY, senderMac, senderIP, targetMac, targetIP);
+  VLOG(3) << "sending ARP reply on vlan " << vlan
+          << " to " << targetIP.str() << " (" << targetMac << "): "
+          << senderIP.str() << " is " << senderMac;
+
+  auto pkt = sw_->allocatePacket(kArpPktLen);
+  auto buf = pkt->buf();
+  DCHECK_EQ(buf->length(), kArpPktLen);
+  auto data = buf->writableData();
+  replyTemplates_.copyTemplate(
+      vlan, responseTable, senderIP, data, kArpPktLen, [&](uint8_t* out) {
+        IOBuf tmpl(IOBuf::WRAP_BUFFER, out, kArpPktLen);
+        RWPrivateCursor cursor(&tmpl);
+        writeArpPacket(&cursor, vlan, ARP_OP_REPLY, senderMac, senderIP,
+                       MacAddress::ZERO, IPAddressV4());
+      });
+  memcpy(data + kArpDstMacOffset, targetMac.bytes(), MacAddress::SIZE);
+  memcpy(data + kArpTargetMacOffset, targetMac.bytes(), MacAddress::SIZE);
+  memcpy(data + kArpTargetIPOffset, targetIP.bytes(),
+         IPAddressV4::byteCount());
+  sw_->sendPacketSwitched(std::move(pkt));
 }
 
 void ArpHandler::sendArpRequest(SwSwitch* sw,
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include "fboss/agent/NeighborReplyTemplates.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/state/NeighborEntry.h"
 #include "fboss/agent/state/Interface.h"
@@ -25,6 +26,7 @@ class Cursor;
 
 namespace facebook { namespace fboss {
 
+class ArpResponseTable;
 class RxPacket;
 class SwSwitch;
 class SwitchState;
@@ -73,12 +75,14 @@ class ArpHandler {
   ArpHandler& operator=(ArpHandler const &) = delete;
 
   void sendArpReply(VlanID vlan, PortID port,
+                    const std::shared_ptr<ArpResponseTable>& responseTable,
                     folly::MacAddress senderMac,
                     folly::IPAddressV4 senderIP,
                     folly::MacAddress targetMac,
                     folly::IPAddressV4 targetIP);
 
   SwSwitch* sw_{nullptr};
+  NeighborReplyTemplates<ArpResponseTable> replyTemplates_;
 };
 
 }} // facebook::fboss
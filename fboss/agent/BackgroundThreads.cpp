@@ -0,0 +1,241 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/BackgroundThreads.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <folly/Conv.h>
+#include <folly/Memory.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+#include "fboss/agent/FbossError.h"
+
+DEFINE_string(background_threads, "",
+              "Comma separated list of background threads to run in addition "
+              "to the shared fbossBgThread.  Each entry is a '+' separated "
+              "list of the subsystems (neighbor, lldp, route_adv, tun, "
+              "route_index) that share the thread, optionally followed by "
+              "':cpus=<n>[-<m>]' to pin the thread to those CPUs, and "
+              "':prio=<n>' to run it at SCHED_FIFO priority n.  An entry "
+              "named 'default' sets the options of the shared thread.  For "
+              "example: "
+              "'lldp+route_adv:prio=10,tun:cpus=3,default:cpus=0-1'");
+
+using folly::StringPiece;
+using std::string;
+using std::vector;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+const char* const kSharedThreadName = "fbossBgThread";
+const char* const kDedicatedThreadPrefix = "fbossBg.";
+
+const BackgroundSubsystem kAllSubsystems[] = {
+  BackgroundSubsystem::NEIGHBOR,
+  BackgroundSubsystem::LLDP,
+  BackgroundSubsystem::ROUTE_ADV,
+  BackgroundSubsystem::TUN,
+  BackgroundSubsystem::ROUTE_INDEX,
+};
+static_assert(sizeof(kAllSubsystems) / sizeof(kAllSubsystems[0]) ==
+              BackgroundThreads::kNumSubsystems,
+              "kAllSubsystems is missing a subsystem");
+
+BackgroundSubsystem parseSubsystem(StringPiece name) {
+  for (auto subsystem : kAllSubsystems) {
+    if (name == BackgroundThreads::subsystemName(subsystem)) {
+      return subsystem;
+    }
+  }
+  throw FbossError("unknown background subsystem \"", name, "\"");
+}
+
+void parseOption(StringPiece option, BackgroundThreads::ThreadSpec* spec) {
+  StringPiece key;
+  StringPiece value;
+  if (!folly::split('=', option, key, value)) {
+    throw FbossError("invalid background thread option \"", option, "\"");
+  }
+  if (key == "cpus") {
+    StringPiece first;
+    StringPiece last;
+    int firstCpu;
+    int lastCpu;
+    if (folly::split('-', value, first, last)) {
+      firstCpu = folly::to<int>(first);
+      lastCpu = folly::to<int>(last);
+    } else {
+      firstCpu = lastCpu = folly::to<int>(value);
+    }
+    if (firstCpu < 0 || lastCpu < firstCpu || lastCpu >= CPU_SETSIZE) {
+      throw FbossError("invalid CPU range \"", value, "\"");
+    }
+    for (int cpu = firstCpu; cpu <= lastCpu; ++cpu) {
+      spec->cpus.push_back(cpu);
+    }
+  } else if (key == "prio") {
+    spec->priority = folly::to<int>(value);
+    if (spec->priority < sched_get_priority_min(SCHED_FIFO) ||
+        spec->priority > sched_get_priority_max(SCHED_FIFO)) {
+      throw FbossError("invalid SCHED_FIFO priority ", spec->priority);
+    }
+  } else {
+    throw FbossError("unknown background thread option \"", key, "\"");
+  }
+}
+
+} // unnamed namespace
+
+const char* BackgroundThreads::subsystemName(BackgroundSubsystem subsystem) {
+  switch (subsystem) {
+    case BackgroundSubsystem::NEIGHBOR:
+      return "neighbor";
+    case BackgroundSubsystem::LLDP:
+      return "lldp";
+    case BackgroundSubsystem::ROUTE_ADV:
+      return "route_adv";
+    case BackgroundSubsystem::TUN:
+      return "tun";
+    case BackgroundSubsystem::ROUTE_INDEX:
+      return "route_index";
+  }
+  return "unknown";
+}
+
+vector<BackgroundThreads::ThreadSpec> BackgroundThreads::parse(
+    StringPiece specStr) {
+  vector<ThreadSpec> specs(1);
+  specs.front().name = kSharedThreadName;
+  bool sawDefault = false;
+  bool assigned[kNumSubsystems] = {};
+
+  vector<StringPiece> entries;
+  folly::split(',', specStr, entries, true);
+  for (auto entry : entries) {
+    vector<StringPiece> parts;
+    folly::split(':', entry, parts);
+    ThreadSpec* spec;
+    if (parts[0] == "default") {
+      if (sawDefault) {
+        throw FbossError("background thread \"default\" given twice");
+      }
+      sawDefault = true;
+      spec = &specs.front();
+    } else {
+      specs.emplace_back();
+      spec = &specs.back();
+      vector<StringPiece> names;
+      folly::split('+', parts[0], names);
+      for (auto name : names) {
+        auto subsystem = parseSubsystem(name);
+        auto& seen = assigned[static_cast<size_t>(subsystem)];
+        if (seen) {
+          throw FbossError("background subsystem \"", name,
+                           "\" is assigned to more than one thread");
+        }
+        seen = true;
+        spec->subsystems.push_back(subsystem);
+      }
+      spec->name = folly::to<string>(kDedicatedThreadPrefix, parts[0]);
+    }
+    for (size_t i = 1; i < parts.size(); ++i) {
+      parseOption(parts[i], spec);
+    }
+  }
+
+  for (auto subsystem : kAllSubsystems) {
+    if (!assigned[static_cast<size_t>(subsystem)]) {
+      specs.front().subsystems.push_back(subsystem);
+    }
+  }
+  return specs;
+}
+
+BackgroundThreads::BackgroundThreads(StringPiece spec) {
+  for (auto& threadSpec : parse(spec)) {
+    threads_.push_back(folly::make_unique<Thread>(std::move(threadSpec)));
+    auto thread = threads_.back().get();
+    for (auto subsystem : thread->spec.subsystems) {
+      subsystemThreads_[static_cast<size_t>(subsystem)] = thread;
+    }
+  }
+}
+
+BackgroundThreads::~BackgroundThreads() {
+  stop();
+}
+
+vector<BackgroundThreads::ThreadSpec>
+BackgroundThreads::getThreadSpecs() const {
+  vector<ThreadSpec> specs;
+  for (const auto& thread : threads_) {
+    specs.push_back(thread->spec);
+  }
+  return specs;
+}
+
+void BackgroundThreads::start(RunLoopFn runLoop) {
+  for (auto& thread : threads_) {
+    auto threadPtr = thread.get();
+    thread->thread = folly::make_unique<std::thread>([threadPtr, runLoop] {
+      applySchedParams(threadPtr->spec);
+      runLoop(threadPtr->spec.name, &threadPtr->evb);
+    });
+  }
+}
+
+void BackgroundThreads::stop() {
+  // Terminate the loops from inside, so that any events already scheduled
+  // via runInEventBaseThread() get to run first.
+  for (auto& thread : threads_) {
+    if (thread->thread) {
+      auto evb = &thread->evb;
+      evb->runInEventBaseThread([evb] { evb->terminateLoopSoon(); });
+    }
+  }
+  for (auto& thread : threads_) {
+    if (thread->thread) {
+      thread->thread->join();
+      thread->thread.reset();
+    }
+  }
+}
+
+void BackgroundThreads::applySchedParams(const ThreadSpec& spec) {
+  // Failing to apply these is not fatal, e.g. when running without
+  // CAP_SYS_NICE, as the thread still works, just not as well isolated.
+  if (!spec.cpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (auto cpu : spec.cpus) {
+      CPU_SET(cpu, &cpus);
+    }
+    auto rv = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (rv != 0) {
+      LOG(ERROR) << "failed to set the CPU affinity of " << spec.name
+                 << ": " << folly::errnoStr(rv);
+    }
+  }
+  if (spec.priority > 0) {
+    sched_param param;
+    param.sched_priority = spec.priority;
+    auto rv = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rv != 0) {
+      LOG(ERROR) << "failed to set the priority of " << spec.name
+                 << ": " << folly::errnoStr(rv);
+    }
+  }
+}
+
+}} // facebook::fboss
@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/io/async/EventBase.h>
+#include <gflags/gflags.h>
+
+DECLARE_string(background_threads);
+
+namespace facebook { namespace fboss {
+
+/*
+ * The subsystems that do their work on a background event loop rather than
+ * in the update thread.
+ */
+enum class BackgroundSubsystem : uint8_t {
+  // The ARP and NDP caches, and probing of unresolved nexthops
+  NEIGHBOR,
+  LLDP,
+  // IPv6 router advertisements
+  ROUTE_ADV,
+  // TunManager, and reading packets from the tun interfaces
+  TUN,
+  // Building the LPM indexes of published RIBs
+  ROUTE_INDEX,
+};
+
+/*
+ * BackgroundThreads runs the event loops that the background subsystems use.
+ *
+ * By default every subsystem shares a single thread, fbossBgThread.  The
+ * --background_threads flag can move subsystems to threads of their own, so
+ * that, say, a burst of packets from the host does not delay the LLDP and
+ * neighbor timers, and can pin any of the threads to CPUs, or give them a
+ * real time priority.
+ *
+ * The EventBases exist from construction, so subsystems can be set up before
+ * the threads are started.
+ */
+class BackgroundThreads {
+ public:
+  enum : size_t { kNumSubsystems = 5 };
+
+  struct ThreadSpec {
+    std::string name;
+    std::vector<BackgroundSubsystem> subsystems;
+    // The CPUs to pin the thread to, or empty to not pin it
+    std::vector<int> cpus;
+    // The SCHED_FIFO priority to run the thread at, or 0 to leave it at the
+    // default scheduling policy
+    int priority{0};
+  };
+
+  /*
+   * Parse a --background_threads spec.  The first ThreadSpec returned is
+   * always the shared thread, with the subsystems that are not given a thread
+   * of their own.  Throws FbossError if the spec is invalid.
+   */
+  static std::vector<ThreadSpec> parse(folly::StringPiece spec);
+
+  static const char* subsystemName(BackgroundSubsystem subsystem);
+
+  explicit BackgroundThreads(folly::StringPiece spec);
+  ~BackgroundThreads();
+
+  /*
+   * Get the EventBase of the shared thread.
+   */
+  folly::EventBase* getEventBase() {
+    return &threads_.front()->evb;
+  }
+
+  /*
+   * Get the EventBase that subsystem runs on.
+   */
+  folly::EventBase* getEventBase(BackgroundSubsystem subsystem) {
+    return &subsystemThreads_[static_cast<size_t>(subsystem)]->evb;
+  }
+
+  std::vector<ThreadSpec> getThreadSpecs() const;
+
+  typedef std::function<void(folly::StringPiece name,
+                             folly::EventBase* evb)> RunLoopFn;
+
+  /*
+   * Start the threads.  Each of them applies its CPU affinity and priority,
+   * then calls runLoop(), which must run the loop until it is terminated.
+   */
+  void start(RunLoopFn runLoop);
+
+  /*
+   * Stop the loops, after they have run everything already scheduled on
+   * them, and wait for the threads to exit.
+   */
+  void stop();
+
+ private:
+  struct Thread {
+    explicit Thread(ThreadSpec spec)
+      : spec(std::move(spec)) {}
+
+    ThreadSpec spec;
+    folly::EventBase evb;
+    std::unique_ptr<std::thread> thread;
+  };
+
+  // Forbidden copy constructor and assignment operator
+  BackgroundThreads(BackgroundThreads const &) = delete;
+  BackgroundThreads& operator=(BackgroundThreads const &) = delete;
+
+  static void applySchedParams(const ThreadSpec& spec);
+
+  // The shared thread comes first
+  std::vector<std::unique_ptr<Thread>> threads_;
+  std::array<Thread*, kNumSubsystems> subsystemThreads_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,216 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ControlPlanePolicer.h"
+
+#include <algorithm>
+
+#include "fboss/agent/ArpHandler.h"
+#include "fboss/agent/DHCPv4Handler.h"
+#include "fboss/agent/IPv4Handler.h"
+#include "fboss/agent/IPv6Handler.h"
+#include "fboss/agent/LldpManager.h"
+#include "fboss/agent/packet/DHCPv6Packet.h"
+#include "fboss/agent/packet/ICMPHdr.h"
+#include "fboss/agent/packet/IPProto.h"
+
+DEFINE_bool(cp_policer, false,
+            "Police trapped packets per (port, packet class) before "
+            "handing them to the protocol handlers");
+DEFINE_int32(cp_policer_routing_pps, 20000,
+             "Per port rate limit for trapped BGP, OSPF and BFD packets. "
+             "This is well above the other classes, so that only a flood "
+             "of routing protocol traffic is cut off. 0 means unlimited");
+DEFINE_int32(cp_policer_neighbor_pps, 2000,
+             "Per port rate limit for trapped ARP and NDP packets. "
+             "0 means unlimited");
+DEFINE_int32(cp_policer_lldp_pps, 100,
+             "Per port rate limit for trapped LLDP packets. "
+             "0 means unlimited");
+DEFINE_int32(cp_policer_dhcp_pps, 500,
+             "Per port rate limit for trapped DHCP packets. "
+             "0 means unlimited");
+DEFINE_int32(cp_policer_other_pps, 2000,
+             "Per port rate limit for trapped packets not in any other "
+             "class. 0 means unlimited");
+DEFINE_int32(cp_policer_burst_ms, 250,
+             "Size of each policer bucket, in milliseconds worth of packets "
+             "at its rate");
+
+using folly::io::Cursor;
+
+namespace {
+
+using namespace facebook::fboss;
+
+constexpr uint16_t kBgpPort = 179;
+constexpr uint16_t kBfdControlPort = 3784;
+constexpr uint16_t kBfdEchoPort = 3785;
+
+CpuPktClass classifyL4(uint8_t proto, Cursor cursor, bool isV6) {
+  switch (proto) {
+  case IP_PROTO_OSPF:
+    return CpuPktClass::ROUTING;
+  case IP_PROTO_TCP: {
+    auto srcPort = cursor.readBE<uint16_t>();
+    auto dstPort = cursor.readBE<uint16_t>();
+    if (srcPort == kBgpPort || dstPort == kBgpPort) {
+      return CpuPktClass::ROUTING;
+    }
+    return CpuPktClass::OTHER;
+  }
+  case IP_PROTO_UDP: {
+    auto srcPort = cursor.readBE<uint16_t>();
+    auto dstPort = cursor.readBE<uint16_t>();
+    if (dstPort == kBfdControlPort || dstPort == kBfdEchoPort) {
+      return CpuPktClass::ROUTING;
+    }
+    if (isV6) {
+      if (dstPort == DHCPv6Packet::DHCP6_CLIENT_UDPPORT ||
+          dstPort == DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT) {
+        return CpuPktClass::DHCP;
+      }
+    } else if (srcPort == DHCPv4Handler::kBootPCPort ||
+               srcPort == DHCPv4Handler::kBootPSPort ||
+               dstPort == DHCPv4Handler::kBootPCPort ||
+               dstPort == DHCPv4Handler::kBootPSPort) {
+      return CpuPktClass::DHCP;
+    }
+    return CpuPktClass::OTHER;
+  }
+  case IP_PROTO_IPV6_ICMP: {
+    auto type = cursor.read<uint8_t>();
+    if (type >= ICMPV6_TYPE_NDP_ROUTER_SOLICITATION &&
+        type <= ICMPV6_TYPE_NDP_REDIRECT_MESSAGE) {
+      return CpuPktClass::NEIGHBOR;
+    }
+    return CpuPktClass::OTHER;
+  }
+  default:
+    return CpuPktClass::OTHER;
+  }
+}
+
+CpuPktClass classifyIPv4(Cursor cursor) {
+  auto verIhl = cursor.read<uint8_t>();
+  auto ihl = (verIhl & 0x0f) * 4;
+  cursor.skip(5);
+  auto fragOffset = cursor.readBE<uint16_t>() & 0x1fff;
+  cursor.skip(1);
+  auto proto = cursor.read<uint8_t>();
+  if (fragOffset != 0) {
+    // Only the first fragment carries the L4 header
+    return CpuPktClass::OTHER;
+  }
+  // 10 bytes read so far
+  cursor.skip(ihl - 10);
+  return classifyL4(proto, cursor, false);
+}
+
+CpuPktClass classifyIPv6(Cursor cursor) {
+  // Extension headers are not walked; packets using them fall into OTHER
+  cursor.skip(6);
+  auto nextHeader = cursor.read<uint8_t>();
+  cursor.skip(33);
+  return classifyL4(nextHeader, cursor, true);
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+ControlPlanePolicer::ControlPlanePolicer()
+  : clock_([] { return std::chrono::steady_clock::now(); }) {
+  setRate(CpuPktClass::ROUTING, FLAGS_cp_policer_routing_pps);
+  setRate(CpuPktClass::NEIGHBOR, FLAGS_cp_policer_neighbor_pps);
+  setRate(CpuPktClass::LLDP, FLAGS_cp_policer_lldp_pps);
+  setRate(CpuPktClass::DHCP, FLAGS_cp_policer_dhcp_pps);
+  setRate(CpuPktClass::OTHER, FLAGS_cp_policer_other_pps);
+}
+
+void ControlPlanePolicer::setRate(CpuPktClass cls, uint32_t pps) {
+  auto& rate = rates_[static_cast<size_t>(cls)];
+  rate.pps = pps;
+  rate.burst = std::max(
+      double(pps) * std::max(FLAGS_cp_policer_burst_ms, 0) / 1000, 1.0);
+}
+
+void ControlPlanePolicer::setClock(Clock clock) {
+  clock_ = std::move(clock);
+}
+
+CpuPktClass ControlPlanePolicer::classify(uint16_t ethertype,
+                                          Cursor cursor) {
+  try {
+    switch (ethertype) {
+    case ArpHandler::ETHERTYPE_ARP:
+      return CpuPktClass::NEIGHBOR;
+    case LldpManager::ETHERTYPE_LLDP:
+      return CpuPktClass::LLDP;
+    case IPv4Handler::ETHERTYPE_IPV4:
+      return classifyIPv4(cursor);
+    case IPv6Handler::ETHERTYPE_IPV6:
+      return classifyIPv6(cursor);
+    default:
+      return CpuPktClass::OTHER;
+    }
+  } catch (const std::out_of_range& ex) {
+    // Truncated packet; the handler will count it as bad
+    return CpuPktClass::OTHER;
+  }
+}
+
+bool ControlPlanePolicer::admit(PortID port, CpuPktClass cls,
+                                TimePoint now) {
+  const auto& rate = rates_[static_cast<size_t>(cls)];
+  if (rate.pps == 0) {
+    return true;
+  }
+
+  size_t idx = static_cast<size_t>(port) * kNumClasses +
+    static_cast<size_t>(cls);
+  folly::SpinLockGuard guard(lock_);
+  if (idx >= buckets_.size()) {
+    buckets_.resize(idx + kNumClasses);
+  }
+  auto& bucket = buckets_[idx];
+  if (!bucket.initialized) {
+    bucket.tokens = rate.burst;
+    bucket.lastRefill = now;
+    bucket.initialized = true;
+  } else if (now > bucket.lastRefill) {
+    std::chrono::duration<double> elapsed = now - bucket.lastRefill;
+    bucket.tokens = std::min(rate.burst,
+                             bucket.tokens + elapsed.count() * rate.pps);
+    bucket.lastRefill = now;
+  }
+  if (bucket.tokens < 1) {
+    return false;
+  }
+  bucket.tokens -= 1;
+  return true;
+}
+
+const char* ControlPlanePolicer::className(CpuPktClass cls) {
+  switch (cls) {
+  case CpuPktClass::ROUTING:
+    return "routing";
+  case CpuPktClass::NEIGHBOR:
+    return "neighbor";
+  case CpuPktClass::LLDP:
+    return "lldp";
+  case CpuPktClass::DHCP:
+    return "dhcp";
+  case CpuPktClass::OTHER:
+    return "other";
+  }
+  return "unknown";
+}
+
+}} // facebook::fboss
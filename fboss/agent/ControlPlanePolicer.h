@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <folly/SpinLock.h>
+#include <folly/io/Cursor.h>
+#include <gflags/gflags.h>
+
+#include "fboss/agent/types.h"
+
+DECLARE_bool(cp_policer);
+
+namespace facebook { namespace fboss {
+
+/*
+ * The classes that trapped packets are sorted into for policing.
+ */
+enum class CpuPktClass : uint8_t {
+  // BGP, OSPF and BFD.  Policed at a much higher rate than the others.
+  ROUTING,
+  // ARP and NDP
+  NEIGHBOR,
+  LLDP,
+  // DHCPv4 and DHCPv6
+  DHCP,
+  // Everything else
+  OTHER,
+};
+
+/*
+ * ControlPlanePolicer is a software token bucket policer for trapped
+ * packets, run by SwSwitch before a packet is handed to the protocol
+ * handlers.
+ *
+ * The ASIC rate limits what it sends to the CPU, but only coarsely: a single
+ * host flooding ARP on one port can use up the whole budget and starve the
+ * routing protocol traffic that arrives alongside it.  The policer keeps one
+ * bucket for every (ingress port, packet class) pair, so a storm of one kind
+ * on one port only ever eats into its own allowance.  Routing protocol
+ * traffic gets a much larger allowance than the other classes, which only
+ * a flood will use up.
+ *
+ * Rates are set with the --cp_policer_*_pps flags, and each bucket holds
+ * --cp_policer_burst_ms worth of packets.  The policer is only used when
+ * --cp_policer is set.
+ */
+class ControlPlanePolicer {
+ public:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+  typedef std::function<TimePoint()> Clock;
+
+  enum : size_t {
+    kNumClasses = static_cast<size_t>(CpuPktClass::OTHER) + 1,
+  };
+
+  // Reads the rates from the command line flags
+  ControlPlanePolicer();
+
+  /*
+   * Set the rate for a class, in packets per second.  0 means unlimited.
+   * Only intended to be called before the policer is in use.
+   */
+  void setRate(CpuPktClass cls, uint32_t pps);
+
+  /*
+   * Set the clock that admit() reads when it is not given the time, which
+   * is steady_clock::now() by default.  Tests use this to deliver packets at
+   * fixed times.  Only intended to be called before the policer is in use.
+   */
+  void setClock(Clock clock);
+
+  /*
+   * Classify a packet.  The cursor must point just past the ethertype (and
+   * VLAN tag, if any).
+   */
+  static CpuPktClass classify(uint16_t ethertype, folly::io::Cursor cursor);
+
+  /*
+   * Returns true if a packet of the given class received on the given port
+   * should be processed, and false if it should be dropped.
+   */
+  bool admit(PortID port, CpuPktClass cls) {
+    return admit(port, cls, clock_());
+  }
+  bool admit(PortID port, CpuPktClass cls, TimePoint now);
+
+  static const char* className(CpuPktClass cls);
+
+ private:
+  struct Bucket {
+    double tokens{0};
+    TimePoint lastRefill;
+    bool initialized{false};
+  };
+  struct Rate {
+    // Tokens added per second; 0 means unlimited
+    double pps{0};
+    // Maximum number of tokens in the bucket
+    double burst{0};
+  };
+
+  // Forbidden copy constructor and assignment operator
+  ControlPlanePolicer(ControlPlanePolicer const &) = delete;
+  ControlPlanePolicer& operator=(ControlPlanePolicer const &) = delete;
+
+  Rate rates_[kNumClasses];
+  Clock clock_;
+
+  folly::SpinLock lock_;
+  // Indexed by port * kNumClasses + class, grown as new ports show up
+  std::vector<Bucket> buckets_;
+};
+
+}} // facebook::fboss
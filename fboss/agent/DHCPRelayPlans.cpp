@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/DHCPRelayPlans.h"
+
+#include <algorithm>
+
+#include <boost/container/flat_set.hpp>
+
+#include "fboss/agent/DHCPv4Handler.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/VlanMap.h"
+
+using folly::IPAddressV4;
+using std::shared_ptr;
+
+namespace facebook { namespace fboss {
+
+shared_ptr<const DHCPRelayPlans::Plans> DHCPRelayPlans::get(
+    const shared_ptr<SwitchState>& state) {
+  const auto& vlans = state->getVlans();
+  const auto& interfaces = state->getInterfaces();
+  {
+    folly::SpinLockGuard guard(lock_);
+    if (vlans_ == vlans && interfaces_ == interfaces) {
+      return plans_;
+    }
+  }
+
+  // Build outside the lock, so that packets relayed for an older state are
+  // not held up.  If two threads race here, the loser's plans are simply
+  // rebuilt on the next call.
+  auto plans = build(*vlans, *interfaces);
+  shared_ptr<VlanMap> oldVlans;
+  shared_ptr<InterfaceMap> oldInterfaces;
+  shared_ptr<const Plans> oldPlans;
+  {
+    folly::SpinLockGuard guard(lock_);
+    oldVlans = std::move(vlans_);
+    oldInterfaces = std::move(interfaces_);
+    oldPlans = std::move(plans_);
+    vlans_ = vlans;
+    interfaces_ = interfaces;
+    plans_ = plans;
+  }
+  // The old maps and plans are released here, outside the lock
+  return plans;
+}
+
+shared_ptr<const DHCPRelayPlans::Plans> DHCPRelayPlans::build(
+    const VlanMap& vlans, const InterfaceMap& interfaces) {
+  auto plans = std::make_shared<Plans>();
+  for (const auto& vlan : vlans) {
+    auto& plan = plans->vlans[vlan->getID()];
+    plan.v4Server = vlan->getDhcpV4Relay();
+    plan.v4Overrides = vlan->getDhcpV4RelayOverrides();
+    plan.v6Server = vlan->getDhcpV6Relay();
+    plan.v6Overrides = vlan->getDhcpV6RelayOverrides();
+  }
+
+  boost::container::flat_set<VlanID> seenVlans;
+  for (const auto& intf : interfaces) {
+    // Relayed requests are sourced from the first interface in their VLAN,
+    // as InterfaceMap::getInterfaceInVlanIf() would find it
+    auto it = plans->vlans.find(intf->getVlanID());
+    bool firstInVlan = seenVlans.insert(intf->getVlanID()).second;
+    for (const auto& address : intf->getAddresses()) {
+      const auto& ip = address.first;
+      if (ip.isV4()) {
+        if (firstInVlan && it != plans->vlans.end() &&
+            it->second.v4SwitchIp.isZero()) {
+          it->second.v4SwitchIp = ip.asV4();
+        }
+        // Like InterfaceMap::getInterfaceIf(), the first match wins
+        if (intf->getRouterID() == RouterID(0)) {
+          plans->v4Interfaces.emplace(ip.asV4(), intf->getVlanID());
+        }
+      } else {
+        if (firstInVlan && it != plans->vlans.end() &&
+            it->second.v6SwitchIp.isZero()) {
+          it->second.v6SwitchIp = ip.asV6();
+        }
+        if (intf->getRouterID() == RouterID(0)) {
+          plans->v6Interfaces.emplace(ip.asV6(), intf->getVlanID());
+        }
+      }
+    }
+  }
+
+  for (auto& entry : plans->vlans) {
+    auto& plan = entry.second;
+    if (plan.v4SwitchIp.isZero()) {
+      continue;
+    }
+    auto& option = plan.v4AgentOption;
+    option[0] = DHCPv4Handler::DHCP_AGENT_OPTIONS;
+    option[1] = option.size() - 2;
+    option[2] = DHCPv4Handler::AGENT_CIRCUIT_ID;
+    option[3] = IPAddressV4::byteCount();
+    std::copy(plan.v4SwitchIp.bytes(),
+              plan.v4SwitchIp.bytes() + IPAddressV4::byteCount(),
+              option.begin() + 4);
+  }
+  return plans;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include <boost/container/flat_map.hpp>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/MacAddress.h>
+#include <folly/SpinLock.h>
+
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/types.h"
+
+namespace facebook { namespace fboss {
+
+class InterfaceMap;
+class SwitchState;
+class VlanMap;
+
+/*
+ * Everything the DHCP handlers need to know about a VLAN and its interface
+ * to relay a packet, resolved from the SwitchState ahead of time.
+ *
+ * Plans are built from the VLAN and interface maps of a SwitchState, and are
+ * kept until a state update replaces either of them.  Relaying a packet then
+ * only takes a couple of flat_map lookups, rather than walking the interfaces
+ * and copying the relay override maps for every packet.
+ */
+class DHCPRelayPlans {
+ public:
+  struct VlanPlan {
+    folly::IPAddressV4 v4Server;
+    DhcpV4OverrideMap v4Overrides;
+    // The first IPv4 address of the VLAN's interface, or zero if it has none
+    folly::IPAddressV4 v4SwitchIp;
+    // The relay agent information option added to requests, with v4SwitchIp
+    // as the circuit ID
+    std::array<uint8_t, 8> v4AgentOption{{}};
+
+    folly::IPAddressV6 v6Server;
+    DhcpV6OverrideMap v6Overrides;
+    // The first IPv6 address of the VLAN's interface, or zero if it has none
+    folly::IPAddressV6 v6SwitchIp;
+
+    /*
+     * The server to relay requests from the given client to, which is zero
+     * if none is configured.
+     */
+    folly::IPAddressV4 getV4Server(folly::MacAddress client) const {
+      auto it = v4Overrides.find(client);
+      return it == v4Overrides.end() ? v4Server : it->second;
+    }
+    folly::IPAddressV6 getV6Server(folly::MacAddress client) const {
+      auto it = v6Overrides.find(client);
+      return it == v6Overrides.end() ? v6Server : it->second;
+    }
+  };
+
+  struct Plans {
+    boost::container::flat_map<VlanID, VlanPlan> vlans;
+    // The VLAN of the router 0 interface owning each address.  Servers send
+    // their replies to these addresses.
+    boost::container::flat_map<folly::IPAddressV4, VlanID> v4Interfaces;
+    boost::container::flat_map<folly::IPAddressV6, VlanID> v6Interfaces;
+
+    const VlanPlan* getVlanIf(VlanID vlan) const {
+      auto it = vlans.find(vlan);
+      return it == vlans.end() ? nullptr : &it->second;
+    }
+  };
+
+  /*
+   * Get the plans for the given state, building them if its VLANs or
+   * interfaces have changed since the last call.
+   *
+   * This may be called from any thread.
+   */
+  std::shared_ptr<const Plans> get(const std::shared_ptr<SwitchState>& state);
+
+  static std::shared_ptr<const Plans> build(const VlanMap& vlans,
+                                            const InterfaceMap& interfaces);
+
+ private:
+  folly::SpinLock lock_;
+  // Held so that the pointer comparisons in get() cannot be fooled by new
+  // maps allocated at the addresses of freed ones
+  std::shared_ptr<VlanMap> vlans_;
+  std::shared_ptr<InterfaceMap> interfaces_;
+  std::shared_ptr<const Plans> plans_;
+};
+
+}} // facebook::fboss
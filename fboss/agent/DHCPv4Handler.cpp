@@ -9,21 +9,20 @@
  */
 #include "DHCPv4Handler.h"
 #include <arpa/inet.h>
+#include <algorithm>
+#include <cstring>
 #include <string>
+#include <vector>
 #include <folly/io/IOBuf.h>
 #include <folly/io/Cursor.h>
 #include <folly/IPAddress.h>
 #include "FbossError.h"
+#include "fboss/agent/DHCPRelayPlans.h"
 #include "fboss/agent/packet/DHCPv4Packet.h"
 #include "fboss/agent/packet/IPv4Hdr.h"
 #include "fboss/agent/packet/IPProto.h"
-#include "fboss/agent/packet/EthHdr.h"
 #include "fboss/agent/packet/Ethertype.h"
-#include "fboss/agent/state/Interface.h"
-#include "fboss/agent/state/InterfaceMap.h"
-#include "fboss/agent/state/SwitchState.h"
-#include "fboss/agent/state/Vlan.h"
-#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/packet/PktUtil.h"
 #include "Platform.h"
 #include "RxPacket.h"
 #include "SwSwitch.h"
@@ -33,6 +32,7 @@
 
 using std::string;
 using std::unique_ptr;
+using folly::ByteRange;
 using folly::IPAddress;
 using folly::IPAddressV4;
 using folly::MacAddress;
@@ -41,8 +41,6 @@ using folly::IOBuf;
 using folly::io::RWPrivateCursor;
 using namespace facebook::fboss;
 
-typedef EthHdr::VlanTags_t VlanTags_t;
-
 namespace {
 IPv4Hdr makeIpv4Header(IPAddressV4 srcIp, IPAddressV4 dstIp, uint8_t ttl,
     uint16_t length) {
@@ -66,27 +64,31 @@ IPv4Hdr makeIpv4Header(IPAddressV4 srcIp, IPAddressV4 dstIp, uint8_t ttl,
   return ipHdr;
 }
 
-EthHdr makeEthHdr(MacAddress srcMac, MacAddress dstMac, VlanID vlan) {
-  VlanTags_t vlanTags;
-  vlanTags.push_back(VlanTag(vlan, ETHERTYPE_VLAN));
-  return EthHdr(dstMac, srcMac, vlanTags, ETHERTYPE_IPV4);
-}
+/*
+ * Send a DHCP packet of dhcpLength bytes, which writeDhcp(out) writes
+ * straight into the packet buffer after the headers.
+ */
+template <typename WriteFn>
+void sendDHCPPacket(SwSwitch* sw, MacAddress dstMac, MacAddress srcMac,
+    VlanID vlan, IPAddressV4 srcIp, IPAddressV4 dstIp, uint8_t ttl,
+    uint16_t srcPort, uint16_t dstPort, uint32_t dhcpLength,
+    WriteFn writeDhcp) {
+  auto ipHdr = makeIpv4Header(srcIp, dstIp, ttl,
+      IPv4Hdr::minSize() + UDPHeader::size() + dhcpLength);
+  UDPHeader udpHdr(srcPort, dstPort, UDPHeader::size() + dhcpLength);
 
-void sendDHCPPacket(SwSwitch* sw, const EthHdr& ethHdr, const IPv4Hdr& ipHdr,
-    const UDPHeader& udpHdr, const DHCPv4Packet& dhcpPacket) {
   // Allocate packet
-  auto txPacket = sw->allocatePacket(
+  uint32_t headersLength =
       18 + // ethernet header
       ipHdr.size() +
-      udpHdr.size() +
-      dhcpPacket.size());
-  const auto& vlanTags = ethHdr.getVlanTags();
-  CHECK(!vlanTags.empty());
+      udpHdr.size();
+  auto txPacket = sw->allocatePacket(headersLength + dhcpLength);
+  auto buf = txPacket->buf();
+  DCHECK_EQ(buf->length(), headersLength + dhcpLength);
 
-  RWPrivateCursor rwCursor(txPacket->buf());
+  RWPrivateCursor rwCursor(buf);
   // Write data to packet buffer
-  txPacket->writeEthHeader(&rwCursor, ethHdr.getDstMac(), ethHdr.getSrcMac(),
-                      VlanID(vlanTags[0].vid()), ethHdr.getEtherType());
+  txPacket->writeEthHeader(&rwCursor, dstMac, srcMac, vlan, ETHERTYPE_IPV4);
   ipHdr.write(&rwCursor);
   rwCursor.writeBE<uint16_t>(udpHdr.srcPort);
   rwCursor.writeBE<uint16_t>(udpHdr.dstPort);
@@ -95,33 +97,45 @@ void sendDHCPPacket(SwSwitch* sw, const EthHdr& ethHdr, const IPv4Hdr& ipHdr,
   rwCursor.skip(2);
   folly::io::Cursor payloadStart(rwCursor);
 
-  dhcpPacket.write(&rwCursor);
+  writeDhcp(buf->writableData() + headersLength);
   uint16_t csum = udpHdr.computeChecksum(ipHdr, payloadStart);
   csumCursor.writeBE<uint16_t>(csum);
 
   VLOG (4) << " Sent dhcp packet :"
-    << " Eth header : " << ethHdr
+    << " VLAN : " << vlan
     << " IPv4 Header : "<< ipHdr
     << " UDP Header : " << udpHdr;
   // Send packet
   sw->sendPacketSwitched(std::move(txPacket));
 }
 
-int processOption(const DHCPv4Packet::Options& optionsIn, int optIndex,
-    DHCPv4Packet& dhcpPacketOut, bool toAppend) {
-
-  uint8_t op = optionsIn[optIndex];
-  uint8_t optLen = DHCPv4Packet::isOptionWithoutLength(op) ?
-      0 : optionsIn[optIndex + 1];
-  const uint8_t* optBytes = optLen == 0 ? nullptr :
-    &optionsIn[optIndex + 2];
-  if (toAppend) {
-    dhcpPacketOut.appendOption(op, optLen, optBytes);
+/*
+ * Call optionFn(option, length) for each option of the DHCP packet in dhcp,
+ * up to and including the END option, with length covering the option's
+ * code and length bytes as well as its data.
+ *
+ * Returns false if an option runs past the end of the packet.
+ */
+template <typename OptionFn>
+bool forEachOption(ByteRange dhcp, OptionFn optionFn) {
+  size_t optIndex = DHCPv4Packet::kOptionsOffset;
+  while (optIndex < dhcp.size()) {
+    const uint8_t* option = dhcp.data() + optIndex;
+    size_t length = 1;
+    if (!DHCPv4Packet::isOptionWithoutLength(option[0])) {
+      if (optIndex + 2 > dhcp.size() ||
+          optIndex + 2 + option[1] > dhcp.size()) {
+        return false;
+      }
+      length = 2 + option[1];
+    }
+    optionFn(option, length);
+    if (option[0] == DHCPv4Handler::END) {
+      break;
+    }
+    optIndex += length;
   }
-  return optLen == 0 ?
-      1 :          // option byte
-      2 + optLen;  // Option byte + len + option data
-
+  return true;
 }
 
 }
@@ -149,89 +163,112 @@ void DHCPv4Handler::handlePacket(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
     return;
   }
 
-  // Parse dhcp packet
-  DHCPv4Packet dhcpPkt;
-  try {
-    dhcpPkt.parse(&cursor);
-  } catch (const FbossError& err) {
-     sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
-     throw; // Rethrow
+  // Relaying only touches a few fields and the options, so the packet is
+  // handled as raw bytes rather than parsed into a DHCPv4Packet
+  std::vector<uint8_t> storage;
+  auto dhcp = PktUtil::contiguousRemainder(cursor, &storage);
+  if (dhcp.size() < DHCPv4Packet::minSize()) {
+    sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
+    throw FbossError("Too small packet, "
+        "expected minimum ", DHCPv4Packet::minSize(), " bytes");
   }
-  if (dhcpPkt.hasDhcpCookie()) {
-    switch(dhcpPkt.op) {
-      case BOOTREQUEST:
-        VLOG(4) << " Got boot request ";
-        processRequest(sw, std::move(pkt), srcMac, ipHdr, dhcpPkt);
-        break;
-      case BOOTREPLY:
-        VLOG(4) << " Got boot reply";
-        processReply(sw, std::move(pkt), ipHdr, dhcpPkt);
-        break;
-      default:
-        VLOG(4)<<" Unknown DHCP Packet type "<<(uint)dhcpPkt.op;
-        sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
-        break;
-    }
-  } else {
+  if (memcmp(dhcp.data() + DHCPv4Packet::kCookieOffset,
+             DHCPv4Packet::kOptionsCookie, DHCPv4Packet::kOptionsCookieSize)) {
     // Got a bootp packet do nothing. Should never
     // really happen since DHCP obsoleted BOOT protocol
     // and we run only DHCP. Drop the packet
     VLOG (4) << " Dropped bootp packet ";
+    return;
   }
 
+  auto op = dhcp[DHCPv4Packet::kOpOffset];
+  switch(op) {
+    case BOOTREQUEST:
+      VLOG(4) << " Got boot request ";
+      processRequest(sw, std::move(pkt), srcMac, ipHdr, dhcp);
+      break;
+    case BOOTREPLY:
+      VLOG(4) << " Got boot reply";
+      processReply(sw, std::move(pkt), ipHdr, dhcp);
+      break;
+    default:
+      VLOG(4)<<" Unknown DHCP Packet type "<<(uint)op;
+      sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
+      break;
+  }
 }
 
 
 void DHCPv4Handler::processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
-    MacAddress srcMac, const IPv4Hdr& origIPHdr,
-    const DHCPv4Packet& dhcpPacket) {
-  auto dhcpPacketOut(dhcpPacket);
-  auto vlan = sw->getState()->getVlans()->getVlanIf(pkt->getSrcVlan());
-  if (!vlan) {
+    MacAddress srcMac, const IPv4Hdr& origIPHdr, ByteRange dhcp) {
+  auto plans = sw->getDhcpRelayPlans()->get(sw->getState());
+  auto vlanPlan = plans->getVlanIf(pkt->getSrcVlan());
+  if (!vlanPlan) {
     sw->stats()->dhcpV4DropPkt();
     VLOG(4) << " VLAN  "<< pkt->getSrcVlan() << " is no longer present "
       << " dropped dhcp packet received on a port in this VLAN";
     return;
   }
-  auto dhcpServer = vlan->getDhcpV4Relay();
 
   VLOG(4) << "srcMac: " << srcMac.toString();
-  // look in the override map, and use relevant destination
-  auto dhcpOverrideMap = vlan->getDhcpV4RelayOverrides();
-  if (dhcpOverrideMap.find(srcMac) != dhcpOverrideMap.end()) {
-    dhcpServer = dhcpOverrideMap[srcMac];
-    VLOG(4) << "dhcpServer: " << dhcpServer;
-  }
+  // use the override for this client, if there is one
+  auto dhcpServer = vlanPlan->getV4Server(srcMac);
+  VLOG(4) << "dhcpServer: " << dhcpServer;
 
   if (dhcpServer.isZero()) {
     sw->stats()->dhcpV4DropPkt();
-    VLOG(4) << " No relay configured for VLAN : "<< vlan->getID()
+    VLOG(4) << " No relay configured for VLAN : "<< pkt->getSrcVlan()
       << " dropped dhcp packet ";
     return;
   }
 
-  IPAddressV4 switchIp;
-  auto vlanInterface = sw->getState()->getInterfaces()->getInterfaceInVlanIf(
-      pkt->getSrcVlan());
-  auto& addresses = vlanInterface->getAddresses();
-  for (auto address: addresses) {
-    if (address.first.isV4()) {
-      switchIp = address.first.asV4();
-      break;
-    }
-  }
-
+  auto switchIp = vlanPlan->v4SwitchIp;
   if (switchIp.isZero()) {
     sw->stats()->dhcpV4DropPkt();
     LOG(ERROR) << "Could not find a SVI interface on vlan : "
       << pkt->getSrcVlan()<< "DHCP packet dropped ";
     return;
   }
-
   VLOG(4) << " Got switch ip : " << switchIp;
-  // Prepare DHCP packet to relay
-  if (!addAgentOptions(sw, pkt->getSrcPort(), switchIp, dhcpPacket,
-        dhcpPacketOut)) {
+
+  // The agent option goes in place of the END option, or after the last
+  // option if there is none
+  bool isDHCP = false;
+  bool hasAgentOption = false;
+  uint16_t maxMsgSize = 0;
+  size_t optionsEnd = dhcp.size();
+  bool wellFormed = forEachOption(dhcp,
+      [&](const uint8_t* option, size_t length) {
+    switch(option[0]) {
+      case DHCP_MESSAGE_TYPE:
+        isDHCP = true;
+        break;
+      case DHCP_MAX_MESSAGE_SIZE:
+        if (length >= 4) {
+          maxMsgSize = (option[2] << 8) | option[3];
+        }
+        break;
+      case DHCP_AGENT_OPTIONS:
+        if (isDHCP) {
+          hasAgentOption = true;
+        }
+        break;
+      case END:
+        optionsEnd = option - dhcp.data();
+        break;
+    }
+  });
+  if (hasAgentOption) {
+    // FIXME We should really forward this along unchanged.
+    // see t3862629 for details.
+    LOG (INFO) <<" Agent options already present dropping DHCP packet";
+  }
+  const auto& agentOption = vlanPlan->v4AgentOption;
+  // Options, agent option and END, padded to the minimum length
+  size_t length = std::max<size_t>(DHCPv4Packet::kMinSize,
+      optionsEnd + agentOption.size() + 1);
+  if (!wellFormed || !isDHCP || hasAgentOption ||
+      (maxMsgSize && length > maxMsgSize)) {
     sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
     VLOG(4) << "Bad DHCP packet, error adding agent options."
       << " DHCP packet dropped";
@@ -242,154 +279,99 @@ void DHCPv4Handler::processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
   // where not incrementing this on the DHCP request causes
   // the server to drop our request.
   const int kMaxHops = 255;
-  if (dhcpPacketOut.hops < kMaxHops) {
-    dhcpPacketOut.hops++;
-  } else {
+  uint8_t hops = dhcp[DHCPv4Packet::kHopsOffset];
+  if (hops >= kMaxHops) {
     VLOG(4) << "Max hops exceeded for dhcp packet";
     sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
     return;
   }
-  dhcpPacketOut.giaddr = switchIp;
   // Look up cpu mac from platform
   MacAddress cpuMac = sw->getPlatform()->getLocalMac();
 
-  // Prepare the packet to be sent out
-  EthHdr ethHdr = makeEthHdr(cpuMac, cpuMac, pkt->getSrcVlan());
-  auto ipHdr = makeIpv4Header(switchIp, dhcpServer, origIPHdr.ttl - 1,
-      IPv4Hdr::minSize() + UDPHeader::size() + dhcpPacketOut.size());
-  UDPHeader udpHdr(kBootPSPort, kBootPSPort,
-      UDPHeader::size() + dhcpPacketOut.size());
-  // Send packet
-  sendDHCPPacket(sw, ethHdr, ipHdr, udpHdr, dhcpPacketOut);
+  // Copy the request into the packet to be sent out, with the relay fields
+  // and agent option filled in
+  sendDHCPPacket(sw, cpuMac, cpuMac, pkt->getSrcVlan(), switchIp,
+      dhcpServer, origIPHdr.ttl - 1, kBootPSPort, kBootPSPort, length,
+      [&](uint8_t* out) {
+    memcpy(out, dhcp.data(), optionsEnd);
+    out[DHCPv4Packet::kHopsOffset] = hops + 1;
+    memcpy(out + DHCPv4Packet::kGiaddrOffset, switchIp.bytes(),
+           IPAddressV4::byteCount());
+    auto next = out + optionsEnd;
+    memcpy(next, agentOption.data(), agentOption.size());
+    next += agentOption.size();
+    *next++ = END;
+    memset(next, PAD, out + length - next);
+  });
 }
 
 void DHCPv4Handler::processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
-      const IPv4Hdr& origIPHdr, const DHCPv4Packet& dhcpPacket) {
-  auto dhcpPacketOut(dhcpPacket);
-  if (!stripAgentOptions(sw, pkt->getSrcPort(), dhcpPacket, dhcpPacketOut)) {
+      const IPv4Hdr& origIPHdr, ByteRange dhcp) {
+  // Agent options after the message type are stripped from the reply, and
+  // all the other options up to and including END are kept
+  bool isDHCP = false;
+  size_t optionsLength = 0;
+  bool wellFormed = forEachOption(dhcp,
+      [&](const uint8_t* option, size_t length) {
+    if (option[0] == DHCP_MESSAGE_TYPE) {
+      isDHCP = true;
+    } else if (option[0] == DHCP_AGENT_OPTIONS && isDHCP) {
+      return;
+    }
+    optionsLength += length;
+  });
+  if (!wellFormed || !isDHCP) {
     sw->stats()->port(pkt->getSrcPort())->dhcpV4BadPkt();
     VLOG(4) << "Bad DHCP packet, error stripping agent options."
       << " DHCP packet dropped";
     return;
   }
   IPAddressV4 clientIP = IPAddressV4::fromLong(INADDR_BROADCAST);
-  if (!(dhcpPacket.flags & DHCPv4Packet::kFlagBroadcast)) {
-    clientIP = dhcpPacket.yiaddr;
+  uint16_t flags = (dhcp[DHCPv4Packet::kFlagsOffset] << 8) |
+    dhcp[DHCPv4Packet::kFlagsOffset + 1];
+  if (!(flags & DHCPv4Packet::kFlagBroadcast)) {
+    clientIP = IPAddressV4::fromBinary(ByteRange(
+        dhcp.data() + DHCPv4Packet::kYiaddrOffset, IPAddressV4::byteCount()));
   }
   auto switchIp = origIPHdr.dstAddr;
   MacAddress cpuMac = sw->getPlatform()->getLocalMac();
   // Extract client MAC address from dhcp reply
-  uint8_t chaddr[MacAddress::SIZE];
-  memcpy(chaddr, dhcpPacketOut.chaddr.data(), MacAddress::SIZE);
-  MacAddress dstMac = MacAddress::fromBinary(
-    folly::ByteRange(chaddr, MacAddress::SIZE));
-
-  // Clear out the relay address field
-  dhcpPacketOut.giaddr = IPAddressV4();
+  MacAddress dstMac = MacAddress::fromBinary(ByteRange(
+      dhcp.data() + DHCPv4Packet::kChaddrOffset, MacAddress::SIZE));
 
   // TODO we should add router id information to the packet
   // to get the VRF of the interface that this packet came
   // in on. Assuming 0 for now since we have only one VRF
-  auto intf = sw->getState()->getInterfaces()->getInterface(RouterID(0),
-      IPAddress(switchIp));
-  if (!intf) {
+  auto plans = sw->getDhcpRelayPlans()->get(sw->getState());
+  auto intf = plans->v4Interfaces.find(switchIp);
+  if (intf == plans->v4Interfaces.end()) {
     sw->stats()->port(pkt->getSrcPort())->dhcpV4DropPkt();
     LOG (INFO) << "Could not lookup interface for : " << switchIp
       << "DHCP packet dropped ";
     return;
   }
 
-  // Prepare the packet to be sent out
-  EthHdr ethHdr = makeEthHdr(cpuMac, dstMac, intf->getVlanID());
-  auto ipHdr = makeIpv4Header(switchIp, clientIP, origIPHdr.ttl - 1,
-      IPv4Hdr::minSize() + UDPHeader::size() + dhcpPacketOut.size());
-  UDPHeader udpHdr(kBootPSPort, kBootPCPort,
-      UDPHeader::size() + dhcpPacketOut.size());
-
-  sendDHCPPacket(sw, ethHdr, ipHdr, udpHdr, dhcpPacketOut);
-}
-
-
-bool DHCPv4Handler::addAgentOptions(SwSwitch* sw, PortID port,
-    IPAddressV4 relayAddr, const DHCPv4Packet& dhcpPacketIn,
-    DHCPv4Packet& dhcpPacketOut) {
-  dhcpPacketOut.clearOptions();
-  const auto& optionsIn = dhcpPacketIn.options;
-  auto optIndex = 0;
-  bool isDHCP = false;
-  bool done = false;
-  uint16_t maxMsgSize = 0;
-  while (optIndex < optionsIn.size() && !done) {
-    bool appendOption = true;
-    switch(optionsIn[optIndex]) {
-      case DHCP_MESSAGE_TYPE:
-        isDHCP = true;
-        break;
-      case DHCP_MAX_MESSAGE_SIZE:
-        maxMsgSize = ntohs(optionsIn[optIndex + 2]);
-        break;
-      case DHCP_AGENT_OPTIONS:
-        if (isDHCP) {
-          // FIXME We should really forward this along unchanged.
-          // see t3862629 for details.
-          LOG (INFO) <<" Agent options already present dropping DHCP packet";
-          return false; //Options already present discard packet
-        }
-        break;
-      case END:
-        done = true;
-        appendOption = false;
-        break;
-    }
-    optIndex += processOption(optionsIn, optIndex, dhcpPacketOut,
-        appendOption);
-  }
-  if (isDHCP) {
-    //Append agent option
-    uint8_t optlen = 2 + relayAddr.byteCount();
-    uint8_t subOptArray[optlen];
-    subOptArray[0] = AGENT_CIRCUIT_ID;
-    subOptArray[1] = relayAddr.byteCount();
-    memcpy(subOptArray + 2, relayAddr.bytes(), relayAddr.byteCount());
-    dhcpPacketOut.appendOption(DHCP_AGENT_OPTIONS, optlen, subOptArray);
-  }
-  dhcpPacketOut.appendOption(END, 0, nullptr);
-  dhcpPacketOut.padToMinLength();
-  if (isDHCP && maxMsgSize && dhcpPacketOut.size() > maxMsgSize) {
-    return false;
-  }
-
-  return isDHCP;
-}
-
-bool DHCPv4Handler::stripAgentOptions(SwSwitch* sw, PortID port,
-    const DHCPv4Packet& dhcpPacketIn, DHCPv4Packet& dhcpPacketOut) {
-  dhcpPacketOut.clearOptions();
-  const auto& optionsIn = dhcpPacketIn.options;
-  auto optIndex = 0;
-  bool isDHCP = false;
-  bool done = false;
-  while (optIndex < optionsIn.size() && !done) {
-    bool appendOption = true;
-    switch(optionsIn[optIndex]) {
-      case DHCP_MESSAGE_TYPE:
-        isDHCP = true;
-        break;
-      case DHCP_AGENT_OPTIONS:
-        if (isDHCP) {
-          appendOption = false;
-        }
-        break;
-      case END:
-        done = true;
-        appendOption = true;
-        break;
-    }
-    optIndex += processOption(optionsIn, optIndex, dhcpPacketOut,
-        appendOption);
-  }
-  dhcpPacketOut.padToMinLength();
-  return isDHCP;
+  size_t length = std::max<size_t>(DHCPv4Packet::kMinSize,
+      DHCPv4Packet::kOptionsOffset + optionsLength);
+  sendDHCPPacket(sw, dstMac, cpuMac, intf->second, switchIp, clientIP,
+      origIPHdr.ttl - 1, kBootPSPort, kBootPCPort, length,
+      [&](uint8_t* out) {
+    memcpy(out, dhcp.data(), DHCPv4Packet::kOptionsOffset);
+    // Clear out the relay address field
+    memset(out + DHCPv4Packet::kGiaddrOffset, 0, IPAddressV4::byteCount());
+    auto next = out + DHCPv4Packet::kOptionsOffset;
+    bool sawMessageType = false;
+    forEachOption(dhcp, [&](const uint8_t* option, size_t optLength) {
+      if (option[0] == DHCP_MESSAGE_TYPE) {
+        sawMessageType = true;
+      } else if (option[0] == DHCP_AGENT_OPTIONS && sawMessageType) {
+        return;
+      }
+      memcpy(next, option, optLength);
+      next += optLength;
+    });
+    memset(next, PAD, out + length - next);
+  });
 }
 
 }} //facebook::fboss
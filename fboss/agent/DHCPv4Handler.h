@@ -13,13 +13,13 @@
 #include <folly/io/Cursor.h>
 #include <folly/IPAddressV4.h>
 #include <folly/MacAddress.h>
+#include <folly/Range.h>
 #include "fboss/agent/types.h"
 
 namespace facebook { namespace fboss {
 class SwSwitch;
 class RxPacket;
 class UDPHeader;
-class DHCPv4Packet;
 class TxPacket;
 class IPv4Hdr;
 
@@ -43,15 +43,16 @@ class DHCPv4Handler {
       folly::MacAddress dstMac,
       const IPv4Hdr& ipHdr, const UDPHeader& udpHdr, folly::io::Cursor cursor);
  private:
+  /*
+   * Requests and replies are relayed straight from the received bytes in
+   * dhcp, copying them into the outgoing packet once with the relay fields
+   * patched in, instead of parsing them into a DHCPv4Packet and serializing
+   * that again.  dhcp is at least DHCPv4Packet::minSize() bytes, with the
+   * DHCP cookie.
+   */
   static void processRequest(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
-      folly::MacAddress srcMac, const IPv4Hdr& ipHdr,
-      const DHCPv4Packet& dhcpPacket);
+      folly::MacAddress srcMac, const IPv4Hdr& ipHdr, folly::ByteRange dhcp);
   static void processReply(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
-      const IPv4Hdr& ipHdr, const DHCPv4Packet& dhcpPacket);
-  static bool addAgentOptions(SwSwitch* sw, PortID port,
-      folly::IPAddressV4 relayAddr,
-      const DHCPv4Packet& dhcpPacketIn, DHCPv4Packet& dhcpPacketOut);
-  static bool stripAgentOptions(SwSwitch* sw, PortID port,
-      const DHCPv4Packet& dhcpPacketIn, DHCPv4Packet& dhcpPacketOut);
+      const IPv4Hdr& ipHdr, folly::ByteRange dhcp);
 };
 }} // facebook::fboss
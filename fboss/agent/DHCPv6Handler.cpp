@@ -10,30 +10,28 @@
 #include "DHCPv6Handler.h"
 #include <arpa/inet.h>
 #include <string>
+#include <vector>
 #include <folly/io/IOBuf.h>
 #include <folly/io/Cursor.h>
 #include <folly/IPAddressV6.h>
 #include "FbossError.h"
+#include "fboss/agent/DHCPRelayPlans.h"
 #include "fboss/agent/packet/DHCPv6Packet.h"
 #include "fboss/agent/packet/IPv6Hdr.h"
 #include "fboss/agent/packet/IPProto.h"
 #include "fboss/agent/packet/EthHdr.h"
 #include "fboss/agent/packet/Ethertype.h"
-#include "fboss/agent/state/Interface.h"
-#include "fboss/agent/state/InterfaceMap.h"
-#include "fboss/agent/state/SwitchState.h"
-#include "fboss/agent/state/Vlan.h"
-#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/packet/PktUtil.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/UDPHeader.h"
-#include "fboss/agent/Utils.h"
 
 using std::string;
 using std::unique_ptr;
+using folly::ByteRange;
 using folly::IPAddress;
 using folly::IPAddressV6;
 using folly::MacAddress;
@@ -114,75 +112,77 @@ void DHCPv6Handler::handlePacket(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
     MacAddress srcMac, MacAddress dstMac, const IPv6Hdr& ipHdr,
     const UDPHeader& udpHdr, Cursor cursor) {
   sw->stats()->port(pkt->getSrcPort())->dhcpV6Pkt();
-  // Parse dhcp packet
-  DHCPv6Packet dhcp6Pkt;
-  try {
-    dhcp6Pkt.parse(&cursor);
-  } catch (const FbossError& err) {
-     sw->stats()->port(pkt->getSrcPort())->dhcpV6BadPkt();
-     throw; // Rethrow
+  // Relaying never needs the options of the message itself, so the packet
+  // is handled as raw bytes rather than parsed into a DHCPv6Packet
+  std::vector<uint8_t> storage;
+  auto dhcp = PktUtil::contiguousRemainder(cursor, &storage);
+  uint8_t type = dhcp.empty() ? 0 : dhcp[0];
+  bool isRelay = type == DHCPv6_RELAY_FORWARD || type == DHCPv6_RELAY_REPLY;
+  size_t minLength = isRelay ?
+    DHCPv6Packet::RELAY_HEADER_BYTES : DHCPv6Packet::HEADER_BYTES;
+  if (dhcp.size() < minLength) {
+    sw->stats()->port(pkt->getSrcPort())->dhcpV6BadPkt();
+    throw FbossError("DHCPv6 packet parse error: too small packet");
   }
-  if (dhcp6Pkt.type == DHCPv6_RELAY_FORWARD) {
-    VLOG(4) << "Received DHCPv6 relay forward packet: " << dhcp6Pkt.toString();
+  if (type == DHCPv6_RELAY_FORWARD) {
+    VLOG(4) << "Received DHCPv6 relay forward packet of length "
+            << dhcp.size();
     processDHCPv6RelayForward(sw, std::move(pkt), srcMac, dstMac,
-                             ipHdr, dhcp6Pkt);
-  } else if (dhcp6Pkt.type == DHCPv6_RELAY_REPLY) {
-    VLOG(4) << "Received DHCPv6 relay reply packet: " << dhcp6Pkt.toString();
+                             ipHdr, dhcp);
+  } else if (type == DHCPv6_RELAY_REPLY) {
+    VLOG(4) << "Received DHCPv6 relay reply packet of length " << dhcp.size();
     processDHCPv6RelayReply(sw, std::move(pkt), srcMac, dstMac,
-                             ipHdr, dhcp6Pkt);
+                             ipHdr, dhcp);
   } else {
-    VLOG(4) << "Received DHCPv6 packet: " << dhcp6Pkt.toString();
-    processDHCPv6Packet(sw, std::move(pkt), srcMac, dstMac, ipHdr, dhcp6Pkt);
+    VLOG(4) << "Received DHCPv6 packet of type " << (int)type
+            << " and length " << dhcp.size();
+    processDHCPv6Packet(sw, std::move(pkt), srcMac, dstMac, ipHdr, dhcp);
   }
 }
 
 void DHCPv6Handler::processDHCPv6Packet(SwSwitch* sw,
     std::unique_ptr<RxPacket> pkt, MacAddress srcMac, MacAddress dstMac,
-    const IPv6Hdr& ipHdr, const DHCPv6Packet& dhcpPacket) {
+    const IPv6Hdr& ipHdr, ByteRange dhcp) {
   auto vlanId = pkt->getSrcVlan();
-  auto states = sw->getState();
-  auto vlan = states->getVlans()->getVlanIf(vlanId);
-  if (!vlan) {
+  auto plans = sw->getDhcpRelayPlans()->get(sw->getState());
+  auto vlanPlan = plans->getVlanIf(vlanId);
+  if (!vlanPlan) {
     sw->stats()->dhcpV6DropPkt();
     VLOG(2) << "VLAN " << vlanId << " is no longer present"
             << "DHCPv6Packet dropped.";
     return;
   }
 
-  auto dhcp6ServerIp = vlan->getDhcpV6Relay();
-
   // look in the override map, and use relevant destination
   VLOG(4) << "srcMac: " << srcMac.toString();
-  auto dhcpOverrideMap = vlan->getDhcpV6RelayOverrides();
-  for (auto o : dhcpOverrideMap) {
-    if (MacAddress(o.first) == srcMac) {
-      dhcp6ServerIp = o.second;
-      VLOG(4) << "dhcp6ServerIp: " << dhcp6ServerIp;
-      break;
-    }
-  }
+  auto dhcp6ServerIp = vlanPlan->getV6Server(srcMac);
+  VLOG(4) << "dhcp6ServerIp: " << dhcp6ServerIp;
 
   if (dhcp6ServerIp.isZero()) {
-    VLOG(4) << "No DHCPv6 relay configured for Vlan " << vlan->getID()
+    VLOG(4) << "No DHCPv6 relay configured for Vlan " << vlanId
             << " dropped DHCPv6 packet";
     sw->stats()->dhcpV6DropPkt();
     return;
   }
 
-  IPAddressV6 switchIp = getSwitchVlanIPv6(states, vlanId);
+  IPAddressV6 switchIp = vlanPlan->v6SwitchIp;
+  if (switchIp.isZero()) {
+    sw->stats()->dhcpV6DropPkt();
+    LOG(ERROR) << "Cannot find IPv6 address for vlan " << vlanId
+               << " DHCPv6 packet dropped";
+    return;
+  }
   // link address set to unspecified
-  IPAddressV6 la("::");
+  IPAddressV6 la;
   // ip src -> peer-address
   IPAddressV6 pa = ipHdr.srcAddr;
-  DHCPv6Packet relayFwdPkt(DHCPv6_RELAY_FORWARD, 0, la, pa);
-
-  // use the client src mac address as the interface id
-  relayFwdPkt.addInterfaceIDOption(srcMac);
-  // add relay message option
-  relayFwdPkt.addRelayMessageOption(dhcpPacket);
 
-  if (relayFwdPkt.computePacketLength() >
-      DHCPv6Packet::MAX_DHCPV6_MSG_LENGTH) {
+  // The relay forward message carries the client src mac address as the
+  // interface id, and the client's message, unchanged, as the relay message
+  uint32_t relayFwdLength = DHCPv6Packet::RELAY_HEADER_BYTES +
+    DHCPv6Packet::OPTION_HEADER_BYTES + MacAddress::SIZE +
+    DHCPv6Packet::OPTION_HEADER_BYTES + dhcp.size();
+  if (relayFwdLength > DHCPv6Packet::MAX_DHCPV6_MSG_LENGTH) {
     VLOG(2) << "DHCPv6 relay forward message exceeds max length, drop it.";
     sw->stats()->port(pkt->getSrcPort())->dhcpV6BadPkt();
     return;
@@ -192,48 +192,61 @@ void DHCPv6Handler::processDHCPv6Packet(SwSwitch* sw,
   // vlanIp -> ip src, ipHdr.dst -> ip dst, srcMac -> mac src, dstMac -> mac dst
   MacAddress cpuMac = sw->getPlatform()->getLocalMac();
   auto serializeBody = [&](RWPrivateCursor* sendCursor) {
-    relayFwdPkt.write(sendCursor);
+    sendCursor->write<uint8_t>(DHCPv6_RELAY_FORWARD);
+    sendCursor->write<uint8_t>(0); // hop count
+    sendCursor->push(la.bytes(), DHCPv6Packet::LINKADDR_BYTES);
+    sendCursor->push(pa.bytes(), DHCPv6Packet::PEERADDR_BYTES);
+    sendCursor->writeBE<uint16_t>(DHCPv6_OPTION_INTERFACE_ID);
+    sendCursor->writeBE<uint16_t>(MacAddress::SIZE);
+    sendCursor->push(srcMac.bytes(), MacAddress::SIZE);
+    sendCursor->writeBE<uint16_t>(DHCPv6_OPTION_RELAY_MSG);
+    sendCursor->writeBE<uint16_t>(dhcp.size());
+    sendCursor->push(dhcp.data(), dhcp.size());
   };
 
   sendDHCPv6Packet(sw, cpuMac, cpuMac, vlanId, dhcp6ServerIp, switchIp,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
-      relayFwdPkt.computePacketLength(), serializeBody);
+      relayFwdLength, serializeBody);
 }
 
 void DHCPv6Handler::processDHCPv6RelayForward(SwSwitch* sw,
     std::unique_ptr<RxPacket> pkt, MacAddress srcMac, MacAddress dstMac,
-    const IPv6Hdr& ipHdr, DHCPv6Packet& dhcpPacket) {
+    const IPv6Hdr& ipHdr, ByteRange dhcp) {
   /**
    * NOTE: relay forward packet handling is not tested thoroughly since we
    * don't have other relay agents running in the cluster;
    */
   // relay forward from other agent
-  if (dhcpPacket.hopCount >= MAX_RELAY_HOPCOUNT) {
+  uint8_t hopCount = dhcp[DHCPv6Packet::HOPCOUNT_OFFSET];
+  if (hopCount >= MAX_RELAY_HOPCOUNT) {
     VLOG(2) << "Received DHCPv6 relay foward packet with max relay hopcount";
     sw->stats()->port(pkt->getSrcPort())->dhcpV6BadPkt();
     return;
   }
   // increment the hopcount and forward it
-  dhcpPacket.hopCount ++;
   auto vlan = pkt->getSrcVlan();
   auto serializeBody = [&](RWPrivateCursor* sendCursor) {
-    dhcpPacket.write(sendCursor);
+    sendCursor->push(dhcp.data(), DHCPv6Packet::HOPCOUNT_OFFSET);
+    sendCursor->write<uint8_t>(hopCount + 1);
+    auto rest = dhcp.subpiece(DHCPv6Packet::HOPCOUNT_OFFSET +
+                              DHCPv6Packet::HOPCOUNT_BYTES);
+    sendCursor->push(rest.data(), rest.size());
   };
   sendDHCPv6Packet(sw, dstMac, srcMac, vlan, ipHdr.dstAddr,
       ipHdr.srcAddr, DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
-      dhcpPacket.computePacketLength(), serializeBody);
+      dhcp.size(), serializeBody);
 }
 
 void DHCPv6Handler::processDHCPv6RelayReply(SwSwitch* sw,
     std::unique_ptr<RxPacket> pkt, MacAddress srcMac, MacAddress dstMac,
-    const IPv6Hdr& ipHdr, DHCPv6Packet& dhcpPacket) {
+    const IPv6Hdr& ipHdr, ByteRange dhcp) {
 
   IPAddressV6 switchIp = ipHdr.dstAddr;
-  auto intf = sw->getState()->getInterfaces()->getInterface(RouterID(0),
-      switchIp);
-  if (!intf) {
+  auto plans = sw->getDhcpRelayPlans()->get(sw->getState());
+  auto intf = plans->v6Interfaces.find(switchIp);
+  if (intf == plans->v6Interfaces.end()) {
     sw->stats()->port(pkt->getSrcPort())->dhcpV6DropPkt();
     VLOG(2) << "Could not look up interface for " << switchIp
             << "DHCPv6 packet dropped";
@@ -242,26 +255,36 @@ void DHCPv6Handler::processDHCPv6RelayReply(SwSwitch* sw,
 
   // relay reply from the server
   MacAddress destMac;
-  const uint8_t* relayData;
+  const uint8_t* relayData = nullptr;
   uint16_t relayLen = 0;
-  std::unordered_set<uint16_t> selector = { DHCPv6_OPTION_INTERFACE_ID,
-    DHCPv6_OPTION_RELAY_MSG };
-  auto dhcpOptions = dhcpPacket.extractOptions(selector);
-  for(int i = 0; i < dhcpOptions.size(); i++) {
-    if (dhcpOptions[i].op == DHCPv6_OPTION_INTERFACE_ID) {
-      DCHECK(dhcpOptions[i].len == MacAddress::SIZE);
+  size_t optIndex = DHCPv6Packet::RELAY_HEADER_BYTES;
+  while (optIndex + DHCPv6Packet::OPTION_HEADER_BYTES <= dhcp.size()) {
+    const uint8_t* option = dhcp.data() + optIndex;
+    uint16_t op = (option[0] << 8) | option[1];
+    uint16_t len = (option[2] << 8) | option[3];
+    optIndex += DHCPv6Packet::OPTION_HEADER_BYTES;
+    if (optIndex + len > dhcp.size()) {
+      // Truncated option
+      break;
+    }
+    const uint8_t* data = dhcp.data() + optIndex;
+    if (op == DHCPv6_OPTION_INTERFACE_ID && len == MacAddress::SIZE) {
       destMac = MacAddress::fromBinary(
-          folly::ByteRange(dhcpOptions[i].data, MacAddress::SIZE));
-    } else if (dhcpOptions[i].op == DHCPv6_OPTION_RELAY_MSG) {
-      relayData = dhcpOptions[i].data;
-      relayLen = dhcpOptions[i].len;
+          folly::ByteRange(data, MacAddress::SIZE));
+    } else if (op == DHCPv6_OPTION_RELAY_MSG) {
+      relayData = data;
+      relayLen = len;
     }
+    optIndex += len;
   }
   if (destMac == MacAddress::ZERO || relayLen == 0) {
     sw->stats()->port(pkt->getSrcPort())->dhcpV6DropPkt();
     VLOG(2) << "Bad dhcp relay reply message: malformed options";
     return;
   }
+  IPAddressV6 peerAddr = IPAddressV6::fromBinary(ByteRange(
+      dhcp.data() + DHCPv6Packet::PEERADDR_OFFSET,
+      DHCPv6Packet::PEERADDR_BYTES));
   /**
    * srcMac -> cpu mac, intf id -> dst mac
    * switch ip -> ip src, peerAddr -> ip dst,
@@ -272,8 +295,8 @@ void DHCPv6Handler::processDHCPv6RelayReply(SwSwitch* sw,
   auto serializeBody = [&](RWPrivateCursor* sendCursor) {
     sendCursor->push(relayData, relayLen);
   };
-  sendDHCPv6Packet(sw, destMac, cpuMac, intf->getVlanID(),
-      dhcpPacket.peerAddr, switchIp, DHCPv6Packet::DHCP6_CLIENT_UDPPORT,
+  sendDHCPv6Packet(sw, destMac, cpuMac, intf->second,
+      peerAddr, switchIp, DHCPv6Packet::DHCP6_CLIENT_UDPPORT,
       DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
       relayLen, serializeBody);
 }
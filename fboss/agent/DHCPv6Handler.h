@@ -13,6 +13,7 @@
 #include <folly/io/Cursor.h>
 #include <folly/IPAddressV6.h>
 #include <folly/MacAddress.h>
+#include <folly/Range.h>
 #include "fboss/agent/packet/DHCPv6Packet.h"
 #include "fboss/agent/types.h"
 
@@ -36,13 +37,19 @@ class DHCPv6Handler {
       const IPv6Hdr& ipHdr, const UDPHeader& udpHdr, folly::io::Cursor cursor);
 
  private:
+  /*
+   * These relay the received message in dhcp as raw bytes, copying it once
+   * into the packet sent out, rather than parsing it into a DHCPv6Packet and
+   * serializing that again.
+   */
+
   /**
    * process DHCPv6 packet from client and send relay forward
    */
   static void processDHCPv6Packet(SwSwitch* sw, std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac,
       folly::MacAddress dstMac,
-      const IPv6Hdr& ipHdr, const DHCPv6Packet& dhcpPacket);
+      const IPv6Hdr& ipHdr, folly::ByteRange dhcp);
 
   /**
    * process relay reply from server or relay forward message from other agents
@@ -51,13 +58,13 @@ class DHCPv6Handler {
       std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac,
       folly::MacAddress dstMac,
-      const IPv6Hdr& ipHdr, DHCPv6Packet& dhcpPacket);
+      const IPv6Hdr& ipHdr, folly::ByteRange dhcp);
 
   static void processDHCPv6RelayReply(SwSwitch* sw,
       std::unique_ptr<RxPacket> pkt,
       folly::MacAddress srcMac,
       folly::MacAddress dstMac,
-      const IPv6Hdr& ipHdr, DHCPv6Packet& dhcpPacket);
+      const IPv6Hdr& ipHdr, folly::ByteRange dhcp);
 
 };
 
@@ -9,6 +9,35 @@
  */
 #include "fboss/agent/HwSwitch.h"
 
+#include "fboss/agent/RxPacket.h"
+#include "fboss/agent/TxPacket.h"
+
 namespace facebook { namespace fboss {
 
+void HwSwitch::Callback::packetsReceived(RxPackets pkts) noexcept {
+  for (auto& pkt : pkts) {
+    packetReceived(std::move(pkt));
+  }
+}
+
+size_t HwSwitch::sendPacketsSwitched(TxPackets pkts) noexcept {
+  size_t numSent = 0;
+  for (auto& pkt : pkts) {
+    if (sendPacketSwitched(std::move(pkt))) {
+      ++numSent;
+    }
+  }
+  return numSent;
+}
+
+size_t HwSwitch::sendPacketsOutOfPorts(PortTxPackets pkts) noexcept {
+  size_t numSent = 0;
+  for (auto& pktAndPort : pkts) {
+    if (sendPacketOutOfPort(std::move(pktAndPort.first), pktAndPort.second)) {
+      ++numSent;
+    }
+  }
+  return numSent;
+}
+
 }} // facebook::fboss
@@ -19,9 +19,11 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
+struct PortStatsSnapshot;
 class SwitchState;
 class SwitchStats;
 class StateDelta;
@@ -56,6 +58,11 @@ class TxPacket;
  */
 class HwSwitch {
  public:
+  typedef std::vector<std::unique_ptr<RxPacket>> RxPackets;
+  typedef std::vector<std::unique_ptr<TxPacket>> TxPackets;
+  typedef std::vector<std::pair<std::unique_ptr<TxPacket>, PortID>>
+    PortTxPackets;
+
   class Callback {
    public:
     virtual ~Callback() {}
@@ -66,6 +73,14 @@ class HwSwitch {
      */
     virtual void packetReceived(std::unique_ptr<RxPacket> pkt) noexcept = 0;
 
+    /*
+     * packetsReceived() may be invoked instead of packetReceived() when the
+     * HwSwitch has a burst of trapped packets to hand over at once.  The
+     * packets are processed in order.  The default implementation just calls
+     * packetReceived() for each of them.
+     */
+    virtual void packetsReceived(RxPackets pkts) noexcept;
+
     /*
      * linkStateChanged() is invoked by the HwSwitch whenever the link
      * status changes on a port.
@@ -138,11 +153,33 @@ class HwSwitch {
   virtual bool sendPacketOutOfPort(std::unique_ptr<TxPacket> pkt,
                                    PortID portID) noexcept = 0;
 
+  /*
+   * Batched versions of sendPacketSwitched() and sendPacketOutOfPort().
+   *
+   * These behave as if each packet had been passed to the single packet
+   * version in order, but let implementations amortize the per send cost
+   * across a burst.  The default implementations just loop.
+   *
+   * @return The number of packets successfully sent to HW.
+   */
+  virtual size_t sendPacketsSwitched(TxPackets pkts) noexcept;
+  virtual size_t sendPacketsOutOfPorts(PortTxPackets pkts) noexcept;
+
   /*
    * Allows hardware-specific code to record switch statistics.
    */
   virtual void updateStats(SwitchStats* switchStats) = 0;
 
+  /*
+   * Get the port counters read by the latest updateStats() call, or null if
+   * this implementation does not collect them.  This may be called from any
+   * thread, and does not touch the hardware.
+   */
+  virtual std::shared_ptr<const PortStatsSnapshot>
+  getPortStatsSnapshot() const {
+    return nullptr;
+  }
+
   /*
    * Returns a hardware-specific sampler based on a namespace string and list of
    * counters within that namespace.  This assumes that a single sampler
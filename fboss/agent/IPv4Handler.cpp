@@ -37,6 +37,7 @@
 #include "fboss/agent/DHCPv4Handler.h"
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/UDPHeader.h"
+#include "fboss/agent/packet/HdrViews.h"
 #include "fboss/agent/packet/IPv4Hdr.h"
 #include "fboss/agent/packet/ICMPHdr.h"
 #include "fboss/agent/Utils.h"
@@ -120,10 +121,12 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
 
   const uint32_t l3Len = pkt->getLength() - (cursor - Cursor(pkt->buf()));
   stats->port(port)->ipv4Rx();
-  IPv4Hdr v4Hdr(cursor);
-  VLOG(4) << "Rx IPv4 packet (" << l3Len << " bytes) " << v4Hdr.srcAddr.str()
-          << " --> " << v4Hdr.dstAddr.str()
-          << " proto: 0x" << std::hex << static_cast<int>(v4Hdr.protocol);
+  // Most packets are decided on from a field or two, so only decode the
+  // rest of the header if we end up needing it
+  IPv4HdrView v4Hdr(cursor);
+  VLOG(4) << "Rx IPv4 packet (" << l3Len << " bytes) " << v4Hdr.srcAddr().str()
+          << " --> " << v4Hdr.dstAddr().str()
+          << " proto: 0x" << std::hex << static_cast<int>(v4Hdr.protocol());
 
   // retrieve the current switch state
   auto state = sw_->getState();
@@ -135,20 +138,20 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
     return;
   }
 
-  if (v4Hdr.protocol == IPPROTO_UDP) {
+  if (v4Hdr.protocol() == IPPROTO_UDP) {
     Cursor udpCursor(cursor);
     UDPHeader udpHdr;
     udpHdr.parse(sw_, port, &udpCursor);
     VLOG(4) << "UDP packet, Source port :" << udpHdr.srcPort
         << " destination port: " << udpHdr.dstPort;
     if (DHCPv4Handler::isDHCPv4Packet(udpHdr)) {
-      DHCPv4Handler::handlePacket(sw_, std::move(pkt), src, dst, v4Hdr,
-          udpHdr, udpCursor);
+      DHCPv4Handler::handlePacket(sw_, std::move(pkt), src, dst,
+          v4Hdr.toHdr(), udpHdr, udpCursor);
       return;
     }
   }
 
-  auto dstIP = v4Hdr.dstAddr;
+  auto dstIP = v4Hdr.dstAddr();
   // Handle packets destined for us
   // TODO: assume vrf 0 now
   if (state->getInterfaces()->getInterfaceIf(RouterID(0), IPAddress(dstIP))) {
@@ -169,13 +172,14 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
   }
 
   // if packet is not for us, check the ttl exceed
-  if (v4Hdr.ttl <= 1) {
+  if (v4Hdr.ttl() <= 1) {
     VLOG(4) << "Rx IPv4 Packet with TTL expired";
     stats->port(port)->pktDropped();
     stats->port(port)->ipv4TtlExceeded();
     // Look up cpu mac from platform
     MacAddress cpuMac = sw_->getPlatform()->getLocalMac();
-    sendICMPTimeExceeded(pkt->getSrcVlan(), cpuMac, cpuMac, v4Hdr, cursor);
+    auto fullHdr = v4Hdr.toHdr();
+    sendICMPTimeExceeded(pkt->getSrcVlan(), cpuMac, cpuMac, fullHdr, cursor);
     return;
   }
 
@@ -19,6 +19,8 @@
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/DHCPv6Handler.h"
+#include "fboss/agent/packet/EthHdr.h"
+#include "fboss/agent/packet/HdrViews.h"
 #include "fboss/agent/packet/IPv6Hdr.h"
 #include "fboss/agent/packet/ICMPHdr.h"
 #include "fboss/agent/packet/PktUtil.h"
@@ -38,6 +40,7 @@
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/UDPHeader.h"
 
+using folly::IOBuf;
 using folly::IPAddressV6;
 using folly::MacAddress;
 using folly::io::Cursor;
@@ -47,6 +50,28 @@ using std::shared_ptr;
 
 namespace facebook { namespace fboss {
 
+template<typename BodyFn>
+void writeICMPv6Pkt(RWPrivateCursor* cursor,
+                    folly::MacAddress dstMac,
+                    folly::MacAddress srcMac,
+                    VlanID vlan,
+                    const folly::IPAddressV6& dstIP,
+                    const folly::IPAddressV6& srcIP,
+                    ICMPv6Type icmp6Type,
+                    ICMPv6Code icmp6Code,
+                    uint32_t bodyLength,
+                    BodyFn serializeBody) {
+  IPv6Hdr ipv6(srcIP, dstIP);
+  ipv6.trafficClass = 0xe0; // CS7 precedence (network control)
+  ipv6.payloadLength = ICMPHdr::SIZE + bodyLength;
+  ipv6.nextHeader = IP_PROTO_IPV6_ICMP;
+  ipv6.hopLimit = 255;
+
+  ICMPHdr icmp6(icmp6Type, icmp6Code, 0);
+  icmp6.serializeFullPacket(cursor, dstMac, srcMac, vlan,
+                               ipv6, bodyLength, serializeBody);
+}
+
 template<typename BodyFn>
 std::unique_ptr<TxPacket> createICMPv6Pkt(SwSwitch* sw,
                                           folly::MacAddress dstMac,
@@ -58,22 +83,44 @@ std::unique_ptr<TxPacket> createICMPv6Pkt(SwSwitch* sw,
                                           ICMPv6Code icmp6Code,
                                           uint32_t bodyLength,
                                           BodyFn serializeBody) {
-  IPv6Hdr ipv6(srcIP, dstIP);
-  ipv6.trafficClass = 0xe0; // CS7 precedence (network control)
-  ipv6.payloadLength = ICMPHdr::SIZE + bodyLength;
-  ipv6.nextHeader = IP_PROTO_IPV6_ICMP;
-  ipv6.hopLimit = 255;
-
-  ICMPHdr icmp6(icmp6Type, icmp6Code, 0);
-
-  uint32_t pktLen = icmp6.computeTotalLengthV6(bodyLength);
+  uint32_t pktLen = ICMPHdr::computeTotalLengthV6(bodyLength);
   auto pkt = sw->allocatePacket(pktLen);
   RWPrivateCursor cursor(pkt->buf());
-  icmp6.serializeFullPacket(&cursor, dstMac, srcMac, vlan,
-                               ipv6, bodyLength, serializeBody);
+  writeICMPv6Pkt(&cursor, dstMac, srcMac, vlan, dstIP, srcIP,
+                 icmp6Type, icmp6Code, bodyLength, serializeBody);
   return pkt;
 }
 
+// Neighbor advertisement flags
+constexpr uint32_t kNaRouterOverride = 0xa0000000;
+constexpr uint32_t kNaSolicited = 0x40000000;
+constexpr uint32_t kNaBodyLength = 4 + 16 + 8;
+// Offsets of the fields in a solicited advertisement that depend on the
+// requester
+constexpr uint32_t kNaDstMacOffset = 0;
+constexpr uint32_t kNaDstIPOffset = EthHdr::SIZE + 24;
+constexpr uint32_t kNaChecksumOffset = EthHdr::SIZE + IPv6Hdr::SIZE + 2;
+
+static void writeNeighborAdvertisement(RWPrivateCursor* cursor,
+                                       VlanID vlan,
+                                       MacAddress srcMac,
+                                       const IPAddressV6& srcIP,
+                                       MacAddress dstMac,
+                                       const IPAddressV6& dstIP,
+                                       uint32_t flags) {
+  auto serializeBody = [&](RWPrivateCursor* body) {
+    body->writeBE<uint32_t>(flags);
+    body->push(srcIP.bytes(), IPAddressV6::byteCount());
+    body->write<uint8_t>(NDPOptionType::TARGET_LL_ADDRESS);
+    body->write<uint8_t>(NDPOptionLength::TARGET_LL_ADDRESS_IEEE802);
+    body->push(srcMac.bytes(), MacAddress::SIZE);
+  };
+  writeICMPv6Pkt(cursor, dstMac, srcMac, vlan, dstIP, srcIP,
+                 ICMPV6_TYPE_NDP_NEIGHBOR_ADVERTISEMENT,
+                 ICMPV6_CODE_NDP_MESSAGE_CODE,
+                 kNaBodyLength, serializeBody);
+}
+
 struct IPv6Handler::ICMPHeaders {
   folly::MacAddress dst;
   folly::MacAddress src;
@@ -129,15 +176,16 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
                                MacAddress src,
                                Cursor cursor) {
   const uint32_t l3Len = pkt->getLength() - (cursor - Cursor(pkt->buf()));
-  IPv6Hdr ipv6(cursor);  // note: advances our cursor object
+  // Only decode the rest of the header if we end up needing it
+  IPv6HdrView ipv6(cursor);  // note: advances our cursor object
   VLOG(4) << "IPv6 (" << l3Len << " bytes)"
     " port: " << pkt->getSrcPort() <<
     " vlan: " << pkt->getSrcVlan() <<
-    " src: " << ipv6.srcAddr.str() <<
+    " src: " << ipv6.srcAddr().str() <<
     " (" << src << ")" <<
-    " dst: " << ipv6.dstAddr.str() <<
+    " dst: " << ipv6.dstAddr().str() <<
     " (" << dst << ")" <<
-    " nextHeader: " << static_cast<int>(ipv6.nextHeader);
+    " nextHeader: " << static_cast<int>(ipv6.nextHeader());
 
   // retrieve the current switch state
   auto state = sw_->getState();
@@ -145,26 +193,27 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
 
   // NOTE: DHCPv6 solicit pacekt from client has hoplimit set to 1,
   // we need to handle it before send the ICMPv6 TTL exceeded
-  if (ipv6.nextHeader == IP_PROTO_UDP) {
+  if (ipv6.nextHeader() == IP_PROTO_UDP) {
     UDPHeader udpHdr;
     Cursor udpCursor(cursor);
     udpHdr.parse(sw_, port, &udpCursor);
     VLOG(4) << "DHCP UDP packet, source port :" << udpHdr.srcPort
         << " destination port: " << udpHdr.dstPort;
     if (DHCPv6Handler::isForDHCPv6RelayOrServer(udpHdr)) {
-      DHCPv6Handler::handlePacket(sw_, std::move(pkt), src, dst, ipv6,
-          udpHdr, udpCursor);
+      DHCPv6Handler::handlePacket(sw_, std::move(pkt), src, dst,
+          ipv6.toHdr(), udpHdr, udpCursor);
       return;
     }
   }
 
-  if (ipv6.hopLimit <= 1) {
+  if (ipv6.hopLimit() <= 1) {
     VLOG(4) << "Rx IPv6 Packet with hop limit exceeded";
     sw_->stats()->port(port)->pktDropped();
     sw_->stats()->port(port)->ipv6HopExceeded();
     // Look up cpu mac from platform
     MacAddress cpuMac = sw_->getPlatform()->getLocalMac();
-    sendICMPv6TimeExceeded(pkt->getSrcVlan(), cpuMac, cpuMac, ipv6, cursor);
+    auto v6Hdr = ipv6.toHdr();
+    sendICMPv6TimeExceeded(pkt->getSrcVlan(), cpuMac, cpuMac, v6Hdr, cursor);
     return;
   }
 
@@ -178,8 +227,8 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
   // process it.  Otherwise, we need to route it.  If we don't have L2
   // forwarding info, then we need to resolve the next hop MAC.
 
-  if (ipv6.nextHeader == IP_PROTO_IPV6_ICMP) {
-    pkt = handleICMPv6Packet(std::move(pkt), dst, src, ipv6, cursor);
+  if (ipv6.nextHeader() == IP_PROTO_IPV6_ICMP) {
+    pkt = handleICMPv6Packet(std::move(pkt), dst, src, ipv6.toHdr(), cursor);
     if (pkt == nullptr) {
       // packet has been handled
       return;
@@ -192,7 +241,7 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
   //    address that is supposed to be generated by default, we do not handle
   //    it now.
   auto intf = state->getInterfaces()->getInterfaceIf(
-      RouterID(0), folly::IPAddress(ipv6.dstAddr));
+      RouterID(0), folly::IPAddress(ipv6.dstAddr()));
   if (intf) {
     // packets destined for us
     // Anything not handled by the controller, we will forward it to the host,
@@ -209,7 +258,7 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
   // For now, assume we need to resolve the IP for this packet.
   // TODO: Add rate limiting so we don't generate too many requests for the
   // same IP.  Following the rules in RFC 4861 should be sufficient.
-  sendNeighborSolicitations(ipv6.dstAddr);
+  sendNeighborSolicitations(ipv6.dstAddr());
   // We drop the packet while waiting on a response.
   sw_->portStats(pkt)->pktDropped();
 }
@@ -379,9 +428,10 @@ void IPv6Handler::handleNeighborSolicitation(unique_ptr<RxPacket> pkt,
   // whether our IP is tentative or not.
 
   // Send the response
-  sendNeighborAdvertisement(pkt->getSrcVlan(),
-                            entry.value().mac, targetIP,
-                            hdr.src, hdr.ipv6->srcAddr);
+  sendSolicitedNeighborAdvertisement(pkt->getSrcVlan(),
+                                     vlan->getNdpResponseTable(),
+                                     entry.value().mac, targetIP,
+                                     hdr.src, hdr.ipv6->srcAddr);
 }
 
 void IPv6Handler::handleNeighborAdvertisement(unique_ptr<RxPacket> pkt,
@@ -614,15 +664,18 @@ void IPv6Handler::sendNeighborSolicitations(
 }
 
 void IPv6Handler::floodNeighborAdvertisements() {
+  HwSwitch::TxPackets pkts;
   for (const auto& intf: *sw_->getState()->getInterfaces()) {
     for (const auto& addrEntry: intf->getAddresses()) {
       if (!addrEntry.first.isV6()) {
         continue;
       }
-      sendNeighborAdvertisement(intf->getVlanID(), intf->getMac(),
-          addrEntry.first.asV6(), MacAddress::BROADCAST, IPAddressV6());
+      pkts.push_back(makeNeighborAdvertisement(intf->getVlanID(),
+          intf->getMac(), addrEntry.first.asV6(), MacAddress::BROADCAST,
+          IPAddressV6()));
     }
   }
+  sw_->sendPacketsSwitched(std::move(pkts));
 }
 
 void IPv6Handler::sendNeighborAdvertisement(VlanID vlan,
@@ -630,31 +683,74 @@ void IPv6Handler::sendNeighborAdvertisement(VlanID vlan,
                                             IPAddressV6 srcIP,
                                             MacAddress dstMac,
                                             IPAddressV6 dstIP) {
+  sw_->sendPacketSwitched(
+      makeNeighborAdvertisement(vlan, srcMac, srcIP, dstMac, dstIP));
+}
+
+unique_ptr<TxPacket> IPv6Handler::makeNeighborAdvertisement(
+    VlanID vlan,
+    MacAddress srcMac,
+    IPAddressV6 srcIP,
+    MacAddress dstMac,
+    IPAddressV6 dstIP) {
   VLOG(3) << "sending neighbor advertisement to " << dstIP.str()
     << " (" << dstMac << "): for " <<  srcIP << " (" << srcMac << ")";
 
-  uint32_t flags = 0xa0000000; // router, override
+  uint32_t flags = kNaRouterOverride;
   if (dstIP.isZero()) {
     // TODO: add a constructor that doesn't require string processing
     dstIP = IPAddressV6("ff01::1");
   } else {
-    // Set the solicited flag
-    flags |= 0x40000000;
+    flags |= kNaSolicited;
   }
 
-  uint32_t bodyLength = 4 + 16 + 8;
-  auto serializeBody = [&](RWPrivateCursor* cursor) {
-    cursor->writeBE<uint32_t>(flags);
-    cursor->push(srcIP.bytes(), IPAddressV6::byteCount());
-    cursor->write<uint8_t>(NDPOptionType::TARGET_LL_ADDRESS);
-    cursor->write<uint8_t>(NDPOptionLength::TARGET_LL_ADDRESS_IEEE802);
-    cursor->push(srcMac.bytes(), MacAddress::SIZE);
-  };
+  auto pkt = sw_->allocatePacket(ICMPHdr::computeTotalLengthV6(kNaBodyLength));
+  RWPrivateCursor cursor(pkt->buf());
+  writeNeighborAdvertisement(&cursor, vlan, srcMac, srcIP, dstMac, dstIP,
+                             flags);
+  return pkt;
+}
 
-  auto pkt = createICMPv6Pkt(sw_, dstMac, srcMac, vlan, dstIP, srcIP,
-                             ICMPV6_TYPE_NDP_NEIGHBOR_ADVERTISEMENT,
-                             ICMPV6_CODE_NDP_MESSAGE_CODE,
-                             bodyLength, serializeBody);
+void IPv6Handler::sendSolicitedNeighborAdvertisement(
+    VlanID vlan,
+    const shared_ptr<NdpResponseTable>& responseTable,
+    MacAddress srcMac,
+    IPAddressV6 srcIP,
+    MacAddress dstMac,
+    IPAddressV6 dstIP) {
+  if (dstIP.isZero()) {
+    // The solicitation came from an address being verified with duplicate
+    // address detection; the reply goes to all nodes instead.
+    sendNeighborAdvertisement(vlan, srcMac, srcIP, dstMac, dstIP);
+    return;
+  }
+  VLOG(3) << "sending neighbor advertisement to " << dstIP.str()
+    << " (" << dstMac << "): for " <<  srcIP << " (" << srcMac << ")";
+
+  // The template is addressed to :: and 00:00:00:00:00:00, so its checksum
+  // only needs the destination address folded in.
+  const uint32_t pktLen = ICMPHdr::computeTotalLengthV6(kNaBodyLength);
+  const IPAddressV6 zeroIP;
+  auto pkt = sw_->allocatePacket(pktLen);
+  auto buf = pkt->buf();
+  DCHECK_EQ(buf->length(), pktLen);
+  auto data = buf->writableData();
+  naTemplates_.copyTemplate(
+      vlan, responseTable, srcIP, data, pktLen, [&](uint8_t* out) {
+        IOBuf tmpl(IOBuf::WRAP_BUFFER, out, pktLen);
+        RWPrivateCursor cursor(&tmpl);
+        writeNeighborAdvertisement(&cursor, vlan, srcMac, srcIP,
+                                   MacAddress::ZERO, zeroIP,
+                                   kNaRouterOverride | kNaSolicited);
+      });
+
+  memcpy(data + kNaDstMacOffset, dstMac.bytes(), MacAddress::SIZE);
+  memcpy(data + kNaDstIPOffset, dstIP.bytes(), IPAddressV6::byteCount());
+  uint16_t csum = (data[kNaChecksumOffset] << 8) | data[kNaChecksumOffset + 1];
+  csum = PktUtil::updateChecksum(csum, zeroIP.bytes(), dstIP.bytes(),
+                                 IPAddressV6::byteCount());
+  data[kNaChecksumOffset] = csum >> 8;
+  data[kNaChecksumOffset + 1] = csum & 0xff;
   sw_->sendPacketSwitched(std::move(pkt));
 }
 
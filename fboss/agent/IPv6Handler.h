@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include "fboss/agent/NeighborReplyTemplates.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/ndp/IPv6RouteAdvertiser.h"
 #include "fboss/agent/StateObserver.h"
@@ -25,9 +26,11 @@ namespace facebook { namespace fboss {
 
 class IPv6Hdr;
 class Interface;
+class NdpResponseTable;
 class RxPacket;
 class StateDelta;
 class SwitchState;
+class TxPacket;
 class Vlan;
 
 class IPv6Handler : public AutoRegisterStateObserver {
@@ -38,6 +41,10 @@ class IPv6Handler : public AutoRegisterStateObserver {
   explicit IPv6Handler(SwSwitch* sw);
 
   void stateUpdated(const StateDelta& delta) override;
+  bool requiresUpdateThread() const override {
+    // routeAdvertisers_ is only touched from stateUpdated()
+    return false;
+  }
 
   void handlePacket(std::unique_ptr<RxPacket> pkt,
                     folly::MacAddress dst,
@@ -119,8 +126,26 @@ class IPv6Handler : public AutoRegisterStateObserver {
                                  folly::IPAddressV6 srcIP,
                                  folly::MacAddress dstMac,
                                  folly::IPAddressV6 dstIP);
+  /*
+   * Reply to a neighbor solicitation, using a cached template for the
+   * response table entry being advertised.
+   */
+  void sendSolicitedNeighborAdvertisement(
+      VlanID vlan,
+      const std::shared_ptr<NdpResponseTable>& responseTable,
+      folly::MacAddress srcMac,
+      folly::IPAddressV6 srcIP,
+      folly::MacAddress dstMac,
+      folly::IPAddressV6 dstIP);
+  std::unique_ptr<TxPacket> makeNeighborAdvertisement(
+      VlanID vlan,
+      folly::MacAddress srcMac,
+      folly::IPAddressV6 srcIP,
+      folly::MacAddress dstMac,
+      folly::IPAddressV6 dstIP);
   SwSwitch* sw_{nullptr};
   RAMap routeAdvertisers_;
+  NeighborReplyTemplates<NdpResponseTable> naTemplates_;
 };
 
 }} // facebook::fboss
@@ -12,11 +12,15 @@
 
 #include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
 #include <folly/MacAddress.h>
 #include <folly/Range.h>
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/TxPacket.h"
+#include "fboss/agent/packet/EthHdr.h"
+#include <algorithm>
 #include <unistd.h>
 
 using folly::MacAddress;
@@ -25,26 +29,43 @@ using folly::ByteRange;
 using folly::StringPiece;
 using std::shared_ptr;
 
+namespace {
+
+std::string getHostname() {
+  const size_t kMaxLen = 64;
+  char hostname[kMaxLen];
+
+  if (0 == gethostname(hostname, kMaxLen)) {
+    // make sure it is null terminated
+    hostname[kMaxLen - 1] = '\0';
+  } else {
+    hostname[0] = '\0';
+  }
+  return hostname;
+}
+
+} // unnamed namespace
 
 namespace facebook { namespace fboss {
 
 const MacAddress LldpManager::LLDP_DEST_MAC("01:80:c2:00:00:0e");
 
 LldpManager::LldpManager(SwSwitch* sw)
-  : folly::AsyncTimeout(sw->getBackgroundEVB()),
+  : folly::AsyncTimeout(sw->getBackgroundEVB(BackgroundSubsystem::LLDP)),
     sw_(sw),
     interval_(LLDP_INTERVAL) {}
 
 LldpManager::~LldpManager() {}
 
 void LldpManager::start() {
-  sw_->getBackgroundEVB()->runInEventBaseThread([this] {
+  auto evb = sw_->getBackgroundEVB(BackgroundSubsystem::LLDP);
+  evb->runInEventBaseThread([this] {
     this->timeoutExpired();
   });
 }
 
 void LldpManager::stop() {
-  auto f = via(sw_->getBackgroundEVB())
+  auto f = via(sw_->getBackgroundEVB(BackgroundSubsystem::LLDP))
     .then([this] { this->cancelTimeout(); });
   f.get();
 }
@@ -80,16 +101,76 @@ void LldpManager::timeoutExpired() noexcept {
 }
 
 void LldpManager::sendLldpOnAllPorts(bool checkPortStatusFlag) {
-  // send lldp frames through all the ports here.
+  auto start = std::chrono::steady_clock::now();
   std::shared_ptr<SwitchState> state = sw_->getState();
+  auto framesBuilt = updateFrames(state);
+
+  // send lldp frames through all the ports here, as a single batch.
+  HwSwitch::PortTxPackets pkts;
+  pkts.reserve(frames_.size());
+  for (const auto& entry : frames_) {
+    auto portID = entry.first;
+    const auto& port = entry.second.port;
+    // The HwSwitch answers isPortUp() from its cached link state, so this
+    // is cheap even with many ports
+    if (checkPortStatusFlag &&
+        (port->getState() != cfg::PortState::UP ||
+         !sw_->getHw()->isPortUp(portID))) {
+      VLOG(5) << "Skipping LLDP send as this port is disabled " << portID;
+      continue;
+    }
+    const auto& frame = entry.second.frame;
+    auto pkt = sw_->allocatePacket(frame.size());
+    memcpy(pkt->buf()->writableData(), frame.data(), frame.size());
+    pkts.emplace_back(std::move(pkt), portID);
+  }
+  auto numPkts = pkts.size();
+  if (!pkts.empty()) {
+    // these LLDP packets HAVE to exit out of the ports specified here.
+    sw_->sendPacketsOutOfPorts(std::move(pkts));
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  sw_->stats()->lldpTx(
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start),
+      framesBuilt);
+  VLOG(4) << "sent LLDP on " << numPkts << " ports, rebuilt " << framesBuilt
+          << " frames";
+}
+
+uint32_t LldpManager::updateFrames(const shared_ptr<SwitchState>& state) {
+  MacAddress cpuMac = sw_->getPlatform()->getLocalMac();
+  auto hostname = getHostname();
+  if (cpuMac != framesMac_ || hostname != framesHostname_) {
+    // Every frame carries these, so none of the old ones can be reused
+    frames_.clear();
+    framesMac_ = cpuMac;
+    framesHostname_ = hostname;
+  }
+
+  // Ports that no longer exist are dropped by building a new map
+  PortFrames frames;
+  frames.reserve(state->getPorts()->size());
+  uint32_t built = 0;
   for (const auto& port : *state->getPorts()) {
-    if (checkPortStatusFlag == false || sw_->isPortUp(port->getID())) {
-      sendLldpInfo(sw_, state, port);
-    } else {
-      VLOG(5) << "Skipping LLDP send as this port is disabled " <<
-        port->getID();
+    auto it = frames_.find(port->getID());
+    if (it != frames_.end()) {
+      const auto& oldPort = it->second.port;
+      if (oldPort == port ||
+          (oldPort->getName() == port->getName() &&
+           oldPort->getIngressVlan() == port->getIngressVlan())) {
+        it->second.port = port;
+        frames.emplace_hint(frames.end(), port->getID(),
+                            std::move(it->second));
+        continue;
+      }
     }
+    PortFrame portFrame{port, buildFrame(cpuMac, hostname, *port)};
+    frames.emplace_hint(frames.end(), port->getID(), std::move(portFrame));
+    ++built;
   }
+  frames_.swap(frames);
+  return built;
 }
 
 uint16_t tlvHeader(uint16_t type, uint16_t length) {
@@ -128,28 +209,22 @@ void writeTlv(uint16_t type, const ByteRange& value,
   cursor->push(value.data(), value.size());
 }
 
-void LldpManager::sendLldpInfo(SwSwitch* sw,
-                               const std::shared_ptr<SwitchState>& swState,
-                               const std::shared_ptr<Port>& port) {
-  MacAddress cpuMac = sw->getPlatform()->getLocalMac();
-  const size_t kMaxLen = 64;
-  char hostname[kMaxLen];
-
-  if (0 == gethostname(hostname, kMaxLen)) {
-    // make sure it is null terminated
-    hostname[kMaxLen - 1] = '\0';
-  } else {
-    hostname[0] = '\0';
-  }
-
+std::vector<uint8_t> LldpManager::buildFrame(MacAddress cpuMac,
+                                              const std::string& hostname,
+                                              const Port& port) {
   // The minimum packet length is 64.We use 68 on the assumption that
-  // the packet will go out untagged, which will remove 4 bytes.
-  uint32_t frameLen = 98;
-  auto pkt = sw->allocatePacket(frameLen);
-  PortID thisPortID = port->getID();
-  RWPrivateCursor cursor(pkt->buf());
-  pkt->writeEthHeader(&cursor, LLDP_DEST_MAC,
-                      cpuMac, port->getIngressVlan(), ETHERTYPE_LLDP);
+  // the packet will go out untagged, which will remove 4 bytes.  Long port
+  // and host names may need more.
+  uint32_t frameLen = EthHdr::SIZE + 2 + CHASSIS_TLV_LENGTH +
+    2 + 1 + port.getName().size() + 2 + TTL_TLV_LENGTH +
+    2 + hostname.size() + 2 + strlen("FBOSS") +
+    2 + SYSTEM_CAPABILITY_TLV_LENGTH + 2;
+  frameLen = std::max<uint32_t>(frameLen, 98);
+  std::vector<uint8_t> frame(frameLen, 0);
+  folly::IOBuf buf(folly::IOBuf::WRAP_BUFFER, frame.data(), frame.size());
+  RWPrivateCursor cursor(&buf);
+  TxPacket::writeEthHeader(&cursor, LLDP_DEST_MAC,
+                           cpuMac, port.getIngressVlan(), ETHERTYPE_LLDP);
   // now write chassis ID TLV
   writeTlv(CHASSIS_TLV_TYPE, CHASSIS_TLV_SUB_TYPE_MAC,
            ByteRange(cpuMac.bytes(), 6), &cursor);
@@ -159,14 +234,14 @@ void LldpManager::sendLldpInfo(SwSwitch* sw,
    * ByteRange.
    */
   writeTlv(PORT_TLV_TYPE, PORT_TLV_SUB_TYPE_INTERFACE,
-           StringPiece(port->getName()), &cursor);
+           StringPiece(port.getName()), &cursor);
 
   // now write TTL TLV
   writeTlv(TTL_TLV_TYPE, (uint16_t) TTL_TLV_VALUE, &cursor);
 
   // now write optional TLVs
   // system name TLV
-  if (strlen(hostname) > 0) {
+  if (!hostname.empty()) {
     writeTlv(SYSTEM_NAME_TLV_TYPE,
              StringPiece(hostname), &cursor);
   }
@@ -182,15 +257,13 @@ void LldpManager::sendLldpInfo(SwSwitch* sw,
   // now write PDU End TLV
   writeTl(PDU_END_TLV_TYPE, PDU_END_TLV_LENGTH, &cursor);
 
-  // Fill the padding with 0s
-  memset(cursor.writableData(), 0, cursor.length());
-  // this LLDP packet HAS to exit out of the port specified here.
-  sw->sendPacketOutOfPort(std::move(pkt), thisPortID);
-  VLOG(4) << "sent LLDP "
-    << " on port " << port->getID()
+  // The rest of the frame is already zero padding
+  VLOG(4) << "built LLDP frame"
+    << " for port " << port.getID()
     << " with CPU MAC " << cpuMac.toString()
-    << " port id " << port->getName()
-    << " and vlan " << port->getIngressVlan();
+    << " port id " << port.getName()
+    << " and vlan " << port.getIngressVlan();
+  return frame;
 }
 
 }} // facebook::fboss
@@ -9,9 +9,11 @@
  */
 // Copyright 2014-present Facebook. All Rights Reserved.
 #pragma once
+#include <boost/container/flat_map.hpp>
 #include <folly/io/async/AsyncTimeout.h>
 #include <unordered_map>
 #include <memory>
+#include <vector>
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/lldp/LinkNeighborDB.h"
 #include "fboss/agent/state/Port.h"
@@ -81,7 +83,12 @@ class LldpManager : private folly::AsyncTimeout {
                     folly::MacAddress src,
                     folly::io::Cursor cursor);
 
-  // This function is internal.  It is only public for use in unit tests.
+  /*
+   * Send an LLDP frame out of every port, or only the ports whose link is up
+   * if checkPortStatusFlag is set.
+   *
+   * This function is internal.  It is only public for use in unit tests.
+   */
   void sendLldpOnAllPorts(bool checkPortStatusFlag);
 
   LinkNeighborDB* getDB() {
@@ -89,13 +96,40 @@ class LldpManager : private folly::AsyncTimeout {
   }
 
  private:
+  /*
+   * The LLDP frame we send out of a port.
+   *
+   * Its contents only depend on the port's name and ingress VLAN, our MAC
+   * and the hostname, so it is built once and copied into a new packet on
+   * every interval.
+   */
+  struct PortFrame {
+    // The port the frame was built for
+    std::shared_ptr<Port> port;
+    std::vector<uint8_t> frame;
+  };
+  typedef boost::container::flat_map<PortID, PortFrame> PortFrames;
+
   void timeoutExpired() noexcept override;
-  void sendLldpInfo(SwSwitch* sw, const std::shared_ptr<SwitchState>& swState,
-                    const std::shared_ptr<Port>& port);
+
+  /*
+   * Bring frames_ up to date with the ports in state, rebuilding only the
+   * frames whose contents changed.  Returns the number of frames built.
+   */
+  uint32_t updateFrames(const std::shared_ptr<SwitchState>& state);
+  static std::vector<uint8_t> buildFrame(folly::MacAddress cpuMac,
+                                         const std::string& hostname,
+                                         const Port& port);
 
   SwSwitch* sw_{nullptr};
   std::chrono::milliseconds interval_;
   LinkNeighborDB db_;
+
+  // The frames are only touched by sendLldpOnAllPorts(), which runs in the
+  // background thread
+  PortFrames frames_;
+  folly::MacAddress framesMac_;
+  std::string framesHostname_;
 };
 
 }} // facebook::fboss
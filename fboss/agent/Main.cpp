@@ -18,6 +18,7 @@
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/ThriftHandler.h"
+#include "fboss/agent/state/NodeAllocator.h"
 #include "common/stats/ServiceData.h"
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/AsyncSignalHandler.h>
@@ -25,6 +26,7 @@
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 #include <folly/SocketAddress.h>
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <csignal>
@@ -69,12 +71,39 @@ using facebook::fboss::ThriftHandler;
 
 namespace facebook { namespace fboss {
 
+const auto kUpdateStatsInterval = std::chrono::seconds(1);
+
 /*
  * This function is executed periodically by the UpdateStats thread.
  * It calls the hardware-specific function of the same name.
  */
 void updateStats(SwSwitch *swSwitch) {
+  // The FunctionScheduler is not an event loop, so measure its lag here:
+  // anything beyond the interval since the last call is how late it ran us.
+  static ThreadMonitor::Clock::time_point lastRun;
+  auto threadMonitor = swSwitch->getThreadMonitor();
+  threadMonitor->registerThreadOnce("UpdateStatsThread");
+  auto now = ThreadMonitor::Clock::now();
+  if (lastRun != ThreadMonitor::Clock::time_point()) {
+    auto late = std::chrono::duration_cast<std::chrono::microseconds>(
+        now - lastRun - kUpdateStatsInterval);
+    threadMonitor->recordLag(std::max(late, std::chrono::microseconds(0)));
+  }
+  lastRun = now;
+
   swSwitch->getHw()->updateStats(swSwitch->stats());
+
+  auto poolStats = NodePool::getStats();
+  fbData->setCounter("state_node_pool.allocations", poolStats.allocations);
+  fbData->setCounter("state_node_pool.deallocations",
+                     poolStats.deallocations);
+  fbData->setCounter("state_node_pool.unpooled_allocations",
+                     poolStats.unpooledAllocations);
+  fbData->setCounter("state_node_pool.bytes_in_use", poolStats.bytesInUse);
+  fbData->setCounter("state_node_pool.bytes_reserved",
+                     poolStats.bytesReserved);
+
+  threadMonitor->sample();
 }
 
 class Initializer {
@@ -144,9 +173,8 @@ class Initializer {
     fs_ = new FunctionScheduler();
     fs_->setThreadName("UpdateStatsThread");
     std::function<void()> callback(std::bind(updateStats, sw_));
-    auto timeInterval = std::chrono::seconds(1);
     const string& nameID = "updateStats";
-    fs_->addFunction(callback, timeInterval, nameID);
+    fs_->addFunction(callback, kUpdateStatsInterval, nameID);
     // Schedule function to signal to SwSwitch that all
     // initial programming is now complete. We typically
     // do that at the end of syncFib call from BGP but
@@ -256,6 +284,9 @@ int fbossMain(int argc, char** argv, PlatformInitFn initPlatform) {
   // would read EOF immediately and exit.
   freopen("/dev/null", "r", stdin);
 
+  // Pick the SwitchState node allocator before the first state is built
+  NodePool::init();
+
   // Now that we have parsed the command line flags, create the Platform object
   unique_ptr<Platform> platform = initPlatform();
 
@@ -310,6 +341,7 @@ int fbossMain(int argc, char** argv, PlatformInitFn initPlatform) {
   LOG(INFO) << "serving on localhost on port " << FLAGS_port;
 
   // Run the EventBase main loop
+  sw.getThreadMonitor()->registerThread("fbossMainThread", &eventBase);
   eventBase.loopForever();
 
   return 0;
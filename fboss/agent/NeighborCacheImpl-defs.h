@@ -155,12 +155,13 @@ NeighborCacheImpl<NTable>::~NeighborCacheImpl() {
     auto entry = item.second;
 
     std::function<void()> stopEntry = [this, entry]() {
-      Entry::destroy(std::move(entry), sw_->getBackgroundEVB());
+      Entry::destroy(std::move(entry),
+                     sw_->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR));
     };
 
     // Run the stop function in the background thread to
     // ensure it can be safely run
-    auto f = via(sw_->getBackgroundEVB())
+    auto f = via(sw_->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR))
       .then(stopEntry)
       .onError([=](const std::exception& e) {
           LOG(FATAL) << "failed to stop NeighborCacheEntry w/ addr " << addr;
@@ -220,7 +221,7 @@ NeighborCacheEntry<NTable>* NeighborCacheImpl<NTable>::setEntryInternal(
     entry->updateState(state);
     return changed ? entry : nullptr;
   } else if (add) {
-    auto evb = sw_->getBackgroundEVB();
+    auto evb = sw_->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR);
     auto to_store = std::make_shared<Entry>(fields, evb, cache_, state);
     entry = to_store.get();
     setCacheEntry(std::move(to_store));
@@ -282,7 +283,8 @@ bool NeighborCacheImpl<NTable>::removeEntry(AddressType ip) {
   // likely have the cache level lock here and the background thread could be
   // waiting for the lock. To avoid this deadlock scenario, we keep the entry
   // around in a shared_ptr for a bit longer and then destroy it later.
-  Entry::destroy(std::move(it->second), sw_->getBackgroundEVB());
+  Entry::destroy(std::move(it->second),
+                 sw_->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR));
 
   entries_.erase(it);
 
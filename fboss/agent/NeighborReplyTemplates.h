@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <boost/container/flat_map.hpp>
+#include <folly/SpinLock.h>
+#include <glog/logging.h>
+
+#include "fboss/agent/types.h"
+
+namespace facebook { namespace fboss {
+
+/*
+ * Cache of pre-built ARP reply / neighbor advertisement packets.
+ *
+ * Everything in a reply except the requester's addresses (and, for NDP, the
+ * checksum) is determined by the response table entry we are answering for:
+ * our MAC, our IP and the VLAN.  The handlers build the reply for an entry
+ * once, with the requester fields zeroed, and then answer each request by
+ * copying that template into the packet and patching in the requester.
+ *
+ * Templates are tied to the response table they were built from.  When a
+ * state update replaces the response table of a VLAN, all templates for that
+ * VLAN are dropped and rebuilt on demand.
+ */
+template <typename ResponseTableT>
+class NeighborReplyTemplates {
+ public:
+  typedef typename ResponseTableT::AddressType AddressType;
+
+  /*
+   * Copy the reply template for ip on vlan into out, which must have room for
+   * length bytes.
+   *
+   * If there is no template for ip in the current response table yet,
+   * buildFn(out) is called to write a fresh one into out, which is then
+   * saved for later requests.
+   */
+  template <typename BuildFn>
+  void copyTemplate(VlanID vlan,
+                    const std::shared_ptr<ResponseTableT>& table,
+                    const AddressType& ip,
+                    uint8_t* out,
+                    uint32_t length,
+                    BuildFn buildFn) {
+    folly::SpinLockGuard guard(lock_);
+    auto& vlanTemplates = vlans_[vlan];
+    if (vlanTemplates.table != table) {
+      vlanTemplates.table = table;
+      vlanTemplates.templates.clear();
+    }
+    auto& tmpl = vlanTemplates.templates[ip];
+    if (tmpl.empty()) {
+      buildFn(out);
+      tmpl.assign(out, out + length);
+      return;
+    }
+    DCHECK_EQ(tmpl.size(), length);
+    memcpy(out, tmpl.data(), length);
+  }
+
+ private:
+  struct VlanTemplates {
+    // Held so that the pointer comparison above cannot be fooled by a new
+    // table allocated at the address of a freed one
+    std::shared_ptr<ResponseTableT> table;
+    boost::container::flat_map<AddressType, std::vector<uint8_t>> templates;
+  };
+
+  folly::SpinLock lock_;
+  boost::container::flat_map<VlanID, VlanTemplates> vlans_;
+};
+
+}} // facebook::fboss
@@ -43,7 +43,7 @@ namespace facebook { namespace fboss {
 class UnresolvedNhopsProber : private folly::AsyncTimeout {
  public:
   explicit UnresolvedNhopsProber(SwSwitch *sw) :
-    AsyncTimeout(sw->getBackgroundEVB()),
+    AsyncTimeout(sw->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR)),
     sw_(sw),
     // Probe every 5 secs (make it faster ?)
     interval_(5) {}
@@ -122,7 +122,8 @@ NeighborUpdater::NeighborUpdater(SwSwitch* sw)
       sw_(sw),
       unresolvedNhopsProber_(new UnresolvedNhopsProber(sw)) {
 
-  bool ret = sw_->getBackgroundEVB()->runInEventBaseThread(
+  auto evb = sw_->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR);
+  bool ret = evb->runInEventBaseThread(
     UnresolvedNhopsProber::start, unresolvedNhopsProber_);
   if (!ret) {
     delete unresolvedNhopsProber_;
@@ -136,7 +137,7 @@ NeighborUpdater::~NeighborUpdater() {
     UnresolvedNhopsProber::stop(unresolvedNhopsProber_);
   };
 
-  Future<Unit> f = via(sw_->getBackgroundEVB())
+  Future<Unit> f = via(sw_->getBackgroundEVB(BackgroundSubsystem::NEIGHBOR))
     .then(stopProber)
     .onError([=] (const std::exception& e) {
           LOG (FATAL) << "Failed to stop unresolved next hops prober ";
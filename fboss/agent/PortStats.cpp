@@ -32,6 +32,9 @@ void PortStats::pktError() {
 void PortStats::pktUnhandled() {
   switchStats_->pktUnhandled();
 }
+void PortStats::pktPoliced(CpuPktClass cls) {
+  switchStats_->pktPoliced(cls);
+}
 void PortStats::pktToHost(uint32_t bytes) {
   switchStats_->pktToHost(bytes);
 }
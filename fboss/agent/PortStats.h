@@ -14,6 +14,7 @@
 namespace facebook { namespace fboss {
 
 class SwitchStats;
+enum class CpuPktClass : uint8_t;
 
 class PortStats {
  public:
@@ -24,6 +25,7 @@ class PortStats {
   void pktBogus();
   void pktError();
   void pktUnhandled();
+  void pktPoliced(CpuPktClass cls);
   void pktToHost(uint32_t bytes); // number of packets forward to host
 
   void arpPkt();
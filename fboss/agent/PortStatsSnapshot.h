@@ -0,0 +1,78 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <boost/container/flat_map.hpp>
+
+#include "fboss/agent/types.h"
+
+namespace facebook { namespace fboss {
+
+/*
+ * The hardware counters of every port, as read by one stats collection
+ * cycle.
+ *
+ * A snapshot is never modified once it has been published, so readers such
+ * as the thrift handlers can keep using one without any locking while the
+ * next cycle builds its replacement.
+ */
+struct PortStatsSnapshot {
+  enum Counter : uint8_t {
+    IN_BYTES,
+    IN_UNICAST_PKTS,
+    IN_MULTICAST_PKTS,
+    IN_BROADCAST_PKTS,
+    IN_DISCARDS,
+    IN_ERRORS,
+    OUT_BYTES,
+    OUT_UNICAST_PKTS,
+    OUT_MULTICAST_PKTS,
+    OUT_BROADCAST_PKTS,
+    OUT_DISCARDS,
+    OUT_ERRORS,
+    NUM_COUNTERS,
+  };
+  enum : size_t { kNumPktLengthBuckets = 10 };
+
+  struct Port {
+    // Counts since the agent started.  A hardware counter that goes
+    // backwards, e.g. because it was cleared, is treated as having been reset
+    // to zero.
+    std::array<uint64_t, NUM_COUNTERS> counts{{}};
+    // Per second rates over the time since the previous read of this port
+    std::array<double, NUM_COUNTERS> rates{{}};
+    // The raw hardware packet length counters, smallest bucket first
+    std::array<uint64_t, kNumPktLengthBuckets> inPktLengths{{}};
+    std::array<uint64_t, kNumPktLengthBuckets> outPktLengths{{}};
+    // Packets waiting to be transmitted, or -1 if it could not be read
+    int64_t queueLength{-1};
+    // False if reading the counters failed in this cycle, in which case the
+    // counts are the last ones successfully read, and the rates are 0
+    bool fresh{false};
+  };
+  typedef boost::container::flat_map<PortID, Port> PortMap;
+
+  const Port* getPortIf(PortID port) const {
+    auto it = ports.find(port);
+    return it == ports.end() ? nullptr : &it->second;
+  }
+
+  // When the cycle started, in the system time that ServiceData expects
+  std::chrono::seconds timestamp{0};
+  // How long the cycle took
+  std::chrono::microseconds collectionTime{0};
+  // Incremented by every cycle
+  uint64_t generation{0};
+  PortMap ports;
+};
+
+}} // facebook::fboss
@@ -11,6 +11,7 @@
 
 #include <boost/assign.hpp>
 #include <string>
+#include <vector>
 #include <limits>
 #include <iomanip>
 #include "fboss/agent/FbossError.h"
@@ -477,16 +478,24 @@ void QsfpModule::updateQsfpData() {
        *       is enough after we initially determine that somethings there?
        */
 
-      // If we have flat memory, we don't have to set the page
+      // Read the upper pages in one transaction, so the module only has to
+      // be selected once.  If we have flat memory, we don't have to set the
+      // page.
+      typedef TransceiverI2CApi::Op Op;
+      uint8_t page0 = 0;
+      uint8_t page3 = 3;
+      std::vector<Op> ops;
       if (!flatMem_) {
-        uint8_t page = 0;
-        qsfpImpl_->writeTransceiver(0x50, 127, sizeof(page), &page);
+        ops.push_back(Op::write(0x50, 127, sizeof(page0), &page0));
       }
-      qsfpImpl_->readTransceiver(0x50, 128, sizeof(qsfpPage0_), qsfpPage0_);
+      ops.push_back(Op::read(0x50, 128, sizeof(qsfpPage0_), qsfpPage0_));
       if (!flatMem_) {
-        uint8_t page = 3;
-        qsfpImpl_->writeTransceiver(0x50, 127, sizeof(page), &page);
-        qsfpImpl_->readTransceiver(0x50, 128, sizeof(qsfpPage3_), qsfpPage3_);
+        ops.push_back(Op::write(0x50, 127, sizeof(page3), &page3));
+        ops.push_back(Op::read(0x50, 128, sizeof(qsfpPage3_), qsfpPage3_));
+      }
+      if (!qsfpImpl_->transceiverTransaction(ops)) {
+        // The pages may be partly read, so don't trust any of them
+        throw FbossError("failed to read QSFP upper pages");
       }
     } catch (const std::exception& ex) {
       dirty_ = true;
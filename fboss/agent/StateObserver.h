@@ -18,6 +18,20 @@ class StateObserver : public boost::noncopyable {
  public:
   virtual ~StateObserver() {}
   virtual void stateUpdated(const StateDelta& delta) = 0;
+
+  /*
+   * Whether stateUpdated() must be called from the update thread.
+   *
+   * Observers returning false may instead be notified from one of the
+   * state observer threads, concurrently with other observers. Either way
+   * an observer sees updates one at a time and in order, since all
+   * observers are done with an update before the next one is applied.
+   * Observers that touch data shared with other observers or that rely on
+   * running in the update thread must keep the default.
+   */
+  virtual bool requiresUpdateThread() const {
+    return true;
+  }
 };
 
 class AutoRegisterStateObserver : public StateObserver {
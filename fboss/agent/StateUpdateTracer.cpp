@@ -0,0 +1,128 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/StateUpdateTracer.h"
+
+#include <folly/String.h>
+
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/RouteDelta.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/VlanMapDelta.h"
+
+DEFINE_int32(state_update_trace_size, 0,
+             "Number of recent state updates to keep traces of, for "
+             "getStateUpdateTrace().  0 disables tracing.");
+
+using folly::dynamic;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace facebook { namespace fboss {
+
+StateUpdateTracer::StateUpdateTracer(size_t capacity)
+  : capacity_(capacity),
+    epoch_(Clock::now()) {
+  traces_.reserve(capacity_);
+}
+
+void StateUpdateTracer::record(Trace trace) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (traces_.size() < capacity_) {
+    traces_.push_back(std::move(trace));
+    return;
+  }
+  traces_[next_] = std::move(trace);
+  next_ = (next_ + 1) % capacity_;
+}
+
+size_t StateUpdateTracer::size() const {
+  std::lock_guard<std::mutex> guard(lock_);
+  return traces_.size();
+}
+
+const char* StateUpdateTracer::phaseName(StateUpdatePhase phase) {
+  switch (phase) {
+    case StateUpdatePhase::QUEUED:
+      return "queued";
+    case StateUpdatePhase::UPDATE_FN:
+      return "update_fn";
+    case StateUpdatePhase::PUBLISH:
+      return "publish";
+    case StateUpdatePhase::DELTA:
+      return "delta";
+    case StateUpdatePhase::HW_UPDATE:
+      return "hw_update";
+    case StateUpdatePhase::OBSERVERS:
+      return "observers";
+    case StateUpdatePhase::OBSERVER:
+      return "observer";
+  }
+  return "unknown";
+}
+
+void StateUpdateTracer::countChanges(const StateDelta& delta, Trace* trace) {
+  for (const auto& rtDelta : delta.getRouteTablesDelta()) {
+    for (const auto& routeDelta : rtDelta.getRoutesV4Delta()) {
+      ++trace->routesChanged;
+    }
+    for (const auto& routeDelta : rtDelta.getRoutesV6Delta()) {
+      ++trace->routesChanged;
+    }
+  }
+  for (const auto& vlanDelta : delta.getVlansDelta()) {
+    for (const auto& arpDelta : vlanDelta.getArpDelta()) {
+      ++trace->neighborsChanged;
+    }
+    for (const auto& ndpDelta : vlanDelta.getNdpDelta()) {
+      ++trace->neighborsChanged;
+    }
+  }
+}
+
+dynamic StateUpdateTracer::toChromeTrace() const {
+  auto relativeUs = [&](Clock::time_point t) {
+    return duration_cast<microseconds>(t - epoch_).count();
+  };
+
+  dynamic events = dynamic::array;
+  std::lock_guard<std::mutex> guard(lock_);
+  for (size_t i = 0; i < traces_.size(); ++i) {
+    const auto& trace = traces_[(next_ + i) % traces_.size()];
+    dynamic updates = dynamic::array;
+    for (const auto& name : trace.updates) {
+      updates.push_back(name);
+    }
+    auto updateName = folly::join(",", trace.updates);
+    for (const auto& span : trace.spans) {
+      // Complete ("X") events, see the Trace Event Format documentation
+      dynamic args = dynamic::object
+        ("updates", updates)
+        ("old_generation", trace.oldGeneration)
+        ("new_generation", trace.newGeneration)
+        ("routes_changed", trace.routesChanged)
+        ("neighbors_changed", trace.neighborsChanged);
+      dynamic event = dynamic::object
+        ("name", span.name.empty() ? updateName : span.name)
+        ("cat", phaseName(span.phase))
+        ("ph", "X")
+        ("ts", relativeUs(span.start))
+        ("dur", duration_cast<microseconds>(span.end - span.start).count())
+        ("pid", 0)
+        ("tid", span.thread)
+        ("args", std::move(args));
+      events.push_back(std::move(event));
+    }
+  }
+  return dynamic::object("traceEvents", std::move(events))
+    ("displayTimeUnit", "ms");
+}
+
+}} // facebook::fboss
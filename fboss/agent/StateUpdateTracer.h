@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/dynamic.h>
+#include <gflags/gflags.h>
+
+DECLARE_int32(state_update_trace_size);
+
+namespace facebook { namespace fboss {
+
+class StateDelta;
+
+/*
+ * The phases of applying a state update, in the order they happen.
+ */
+enum class StateUpdatePhase : uint8_t {
+  // Waiting in SwSwitch::pendingUpdates_ for the update thread
+  QUEUED,
+  // Running the StateUpdate's applyUpdate() function
+  UPDATE_FN,
+  // Publishing the new state
+  PUBLISH,
+  // Walking the StateDelta to count the changed routes and neighbors.
+  // Only measured when tracing is enabled.
+  DELTA,
+  // HwSwitch::stateChanged()
+  HW_UPDATE,
+  // Notifying all of the StateObservers
+  OBSERVERS,
+  // Notifying a single StateObserver.  Only traced; per observer
+  // histograms are kept by SwitchStats::stateObserverUpdate().
+  OBSERVER,
+};
+
+/*
+ * StateUpdateTracer keeps a ring buffer of the most recent state updates
+ * applied by SwSwitch, with a span for each phase of each update, and can
+ * dump it in the Chrome trace event format (load it in chrome://tracing).
+ *
+ * SwSwitch always records the time spent in each phase in the per-phase
+ * histograms in SwitchStats; the tracer is only used when
+ * --state_update_trace_size is non-zero.
+ */
+class StateUpdateTracer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  enum : size_t {
+    kNumPhases = static_cast<size_t>(StateUpdatePhase::OBSERVER) + 1,
+  };
+
+  struct Span {
+    Span(StateUpdatePhase phase, std::string name, uint32_t thread,
+         Clock::time_point start, Clock::time_point end)
+      : phase(phase),
+        name(std::move(name)),
+        thread(thread),
+        start(start),
+        end(end) {}
+
+    StateUpdatePhase phase;
+    // The StateUpdate or StateObserver name, if any
+    std::string name;
+    // 0 for the update thread, or 1 + the index of the observer thread
+    uint32_t thread;
+    Clock::time_point start;
+    Clock::time_point end;
+  };
+
+  /*
+   * All of the spans of one batch of StateUpdates, which SwSwitch applies
+   * to the hardware as a single delta.
+   */
+  struct Trace {
+    std::vector<std::string> updates;
+    uint64_t oldGeneration{0};
+    uint64_t newGeneration{0};
+    uint64_t routesChanged{0};
+    uint64_t neighborsChanged{0};
+    std::vector<Span> spans;
+  };
+
+  explicit StateUpdateTracer(size_t capacity);
+
+  /*
+   * Add a completed trace, replacing the oldest one if the buffer is full.
+   */
+  void record(Trace trace);
+
+  /*
+   * Return the buffered traces as a Chrome trace, oldest first.
+   */
+  folly::dynamic toChromeTrace() const;
+
+  size_t size() const;
+
+  static const char* phaseName(StateUpdatePhase phase);
+
+  /*
+   * Count the routes and neighbor entries changed by a delta.
+   */
+  static void countChanges(const StateDelta& delta, Trace* trace);
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  StateUpdateTracer(StateUpdateTracer const &) = delete;
+  StateUpdateTracer& operator=(StateUpdateTracer const &) = delete;
+
+  const size_t capacity_;
+  // All trace timestamps are relative to this
+  const Clock::time_point epoch_;
+
+  mutable std::mutex lock_;
+  std::vector<Trace> traces_;
+  // Index of the oldest trace once traces_ is full
+  size_t next_{0};
+};
+
+}} // facebook::fboss
@@ -11,6 +11,8 @@
 
 #include "fboss/agent/ArpHandler.h"
 #include "fboss/agent/Constants.h"
+#include "fboss/agent/ControlPlanePolicer.h"
+#include "fboss/agent/DHCPRelayPlans.h"
 #include "fboss/agent/IPv4Handler.h"
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/NeighborUpdater.h"
@@ -27,6 +29,9 @@
 #include "fboss/agent/capture/PktCaptureManager.h"
 #include "fboss/agent/packet/EthHdr.h"
 #include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
 #include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/StateUpdateHelpers.h"
 #include "fboss/agent/state/SwitchState.h"
@@ -35,6 +40,7 @@
 #include "fboss/agent/TransceiverImpl.h"
 #include "fboss/agent/ApplyThriftConfig.h"
 #include "fboss/agent/SfpModule.h"
+#include "fboss/agent/StateObserver.h"
 #include "fboss/agent/LldpManager.h"
 #include "common/stats/ServiceData.h"
 #include <folly/FileUtil.h>
@@ -43,6 +49,7 @@
 #include <folly/Demangle.h>
 #include <chrono>
 #include <condition_variable>
+#include <iterator>
 #include <glog/logging.h>
 
 using folly::EventBase;
@@ -57,8 +64,14 @@ using std::shared_ptr;
 using std::string;
 using std::unique_lock;
 using std::unique_ptr;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
 
 DEFINE_string(config, "", "The path to the local JSON configuration file");
+DEFINE_int32(state_observer_threads, 2,
+             "Number of threads used to notify state observers that do not "
+             "need to run in the update thread. 0 notifies all observers "
+             "from the update thread");
 
 namespace {
 constexpr auto kSwSwitch = "swSwitch";
@@ -122,6 +135,7 @@ SwSwitch::SwSwitch(std::unique_ptr<Platform> platform)
     arp_(new ArpHandler(this)),
     ipv4_(new IPv4Handler(this)),
     ipv6_(new IPv6Handler(this)),
+    dhcpRelayPlans_(new DHCPRelayPlans()),
     nUpdater_(new NeighborUpdater(this)),
     pcapMgr_(new PktCaptureManager(this)),
     transceiverMap_(new TransceiverMap()) {
@@ -129,6 +143,13 @@ SwSwitch::SwSwitch(std::unique_ptr<Platform> platform)
   // don't exist already.
   utilCreateDir(platform_->getVolatileStateDir());
   utilCreateDir(platform_->getPersistentStateDir());
+  if (FLAGS_cp_policer) {
+    cpPolicer_ = make_unique<ControlPlanePolicer>();
+  }
+  if (FLAGS_state_update_trace_size > 0) {
+    updateTracer_ = make_unique<StateUpdateTracer>(
+        FLAGS_state_update_trace_size);
+  }
 }
 
 SwSwitch::~SwSwitch() {
@@ -307,7 +328,8 @@ void SwSwitch::init(SwitchFlags flags) {
   });
 
   if (flags & SwitchFlags::ENABLE_TUN) {
-    tunMgr_ = folly::make_unique<TunManager>(this, &backgroundEventBase_);
+    tunMgr_ = folly::make_unique<TunManager>(
+        this, getBackgroundEVB(BackgroundSubsystem::TUN));
     tunMgr_->startProbe();
   }
 
@@ -399,27 +421,102 @@ void SwSwitch::addStateObserver(StateObserver* observer, const string& name) {
   stateObservers_.emplace(observer, name);
 }
 
-void SwSwitch::notifyStateObservers(const StateDelta& delta) {
+void SwSwitch::notifyStateObservers(const StateDelta& delta,
+                                    StateUpdateTracer::Trace* trace) {
   CHECK(updateEventBase_.inRunningEventBaseThread());
   if (isExiting()) {
     // Make sure the SwSwitch is not already being destroyed
     return;
   }
   updatePortStatusCounters(delta);
-  for (auto observerName : stateObservers_) {
-    try {
-      auto observer = observerName.first;
-      observer->stateUpdated(delta);
-    } catch (const std::exception& ex) {
-    // TODO: Figure out the best way to handle errors here.
-      LOG(FATAL) << "error notifying " << observerName.second << " of update: "
-                 << folly::exceptionStr(ex);
+
+  // Kick off the observers that can run concurrently first, so they overlap
+  // with the ones we have to notify from this thread.  The delta only
+  // refers to published, immutable states so sharing it is safe.
+  std::mutex doneMutex;
+  std::condition_variable doneCV;
+  size_t pending = 0;
+  size_t nextThread = 0;
+  // When tracing, each observer fills in its own preallocated span, so the
+  // observer threads never touch the trace itself.
+  std::vector<StateUpdateTracer::Span> spans;
+  auto observerSpan = [&](const std::string& name, uint32_t thread)
+      -> StateUpdateTracer::Span* {
+    if (!trace) {
+      return nullptr;
     }
+    auto now = StateUpdateTracer::Clock::now();
+    spans.emplace_back(StateUpdatePhase::OBSERVER, name, thread, now, now);
+    return &spans.back();
+  };
+  if (trace) {
+    spans.reserve(stateObservers_.size());
+  }
+  for (const auto& observerName : stateObservers_) {
+    auto observer = observerName.first;
+    if (observerEventBases_.empty() || observer->requiresUpdateThread()) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> guard(doneMutex);
+      ++pending;
+    }
+    auto threadIndex = nextThread++ % observerEventBases_.size();
+    auto evb = observerEventBases_[threadIndex].get();
+    auto span = observerSpan(observerName.second, 1 + threadIndex);
+    evb->runInEventBaseThread([&, observer, span]() {
+        notifyStateObserver(observer, observerName.second, delta, span);
+        std::lock_guard<std::mutex> guard(doneMutex);
+        if (--pending == 0) {
+          doneCV.notify_one();
+        }
+    });
+  }
+
+  for (const auto& observerName : stateObservers_) {
+    auto observer = observerName.first;
+    if (observerEventBases_.empty() || observer->requiresUpdateThread()) {
+      notifyStateObserver(observer, observerName.second, delta,
+                          observerSpan(observerName.second, 0));
+    }
+  }
+
+  // Wait for everyone to be done, so that each observer sees updates one at
+  // a time, and in order.
+  {
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCV.wait(lock, [&] { return pending == 0; });
+  }
+
+  if (trace) {
+    std::move(spans.begin(), spans.end(), std::back_inserter(trace->spans));
+  }
+}
+
+void SwSwitch::notifyStateObserver(StateObserver* observer,
+                                   const std::string& name,
+                                   const StateDelta& delta,
+                                   StateUpdateTracer::Span* span) {
+  auto start = std::chrono::steady_clock::now();
+  try {
+    observer->stateUpdated(delta);
+  } catch (const std::exception& ex) {
+    // TODO: Figure out the best way to handle errors here.
+    LOG(FATAL) << "error notifying " << name << " of update: "
+               << folly::exceptionStr(ex);
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (span) {
+    span->start = start;
+    span->end = end;
   }
+  stats()->stateObserverUpdate(name,
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start));
 }
 
 void SwSwitch::updateState(unique_ptr<StateUpdate> update) {
   // Put the update function on the queue.
+  update->queuedTime_ = std::chrono::steady_clock::now();
   {
     folly::SpinLockGuard guard(pendingUpdatesLock_);
     pendingUpdates_.push_back(*update.release());
@@ -475,6 +572,11 @@ void SwSwitch::handlePendingUpdates() {
   // not initialized yet
   DCHECK(isInitialized());
 
+  std::unique_ptr<StateUpdateTracer::Trace> trace;
+  if (updateTracer_) {
+    trace = make_unique<StateUpdateTracer::Trace>();
+  }
+
   // Call all of the update functions to prepare the new SwitchState
   auto origState = getState();
   auto state = origState;
@@ -483,6 +585,16 @@ void SwSwitch::handlePendingUpdates() {
     StateUpdate* update = &(*iter);
     ++iter;
 
+    auto fnStart = std::chrono::steady_clock::now();
+    stats()->stateUpdatePhase(StateUpdatePhase::QUEUED,
+        duration_cast<microseconds>(fnStart - update->queuedTime_));
+    if (trace) {
+      trace->updates.push_back(update->getName());
+      trace->spans.emplace_back(StateUpdatePhase::QUEUED,
+                                update->getName(), 0,
+                                update->queuedTime_, fnStart);
+    }
+
     shared_ptr<SwitchState> newState;
     LOG(INFO) << "preparing state update " << update->getName();
     try {
@@ -494,6 +606,13 @@ void SwSwitch::handlePendingUpdates() {
       update->onError(ex);
       delete update;
     }
+    auto fnEnd = std::chrono::steady_clock::now();
+    stats()->stateUpdatePhase(StateUpdatePhase::UPDATE_FN,
+        duration_cast<microseconds>(fnEnd - fnStart));
+    if (trace) {
+      trace->spans.emplace_back(StateUpdatePhase::UPDATE_FN,
+                                trace->updates.back(), 0, fnStart, fnEnd);
+    }
     if (newState) {
       // Call publish after applying each StateUpdate.  This guarantees that
       // the next StateUpdate function will have clone the SwitchState before
@@ -502,12 +621,22 @@ void SwSwitch::handlePendingUpdates() {
       // state, leaving it in an invalid state.
       newState->publish();
       state = newState;
+      auto publishEnd = std::chrono::steady_clock::now();
+      stats()->stateUpdatePhase(StateUpdatePhase::PUBLISH,
+          duration_cast<microseconds>(publishEnd - fnEnd));
+      if (trace) {
+        trace->spans.emplace_back(StateUpdatePhase::PUBLISH,
+                                  trace->updates.back(), 0, fnEnd, publishEnd);
+      }
     }
   }
 
   // Now apply the update and notify subscribers
   if (state != origState) {
-    applyUpdate(origState, state);
+    applyUpdate(origState, state, trace.get());
+    if (trace) {
+      updateTracer_->record(std::move(*trace));
+    }
   }
 
   // Notify all of the updates of success, and delete them
@@ -569,14 +698,86 @@ int SwSwitch::getHighresSamplers(HighresSamplerList* samplers,
 
 void SwSwitch::setStateInternal(std::shared_ptr<SwitchState> newState) {
   // This is one of the only two places that should ever directly access
-  // stateDontUseDirectly_.  (getState() being the other one.)
+  // stateDontUseDirectly_.  (refreshLocalState() being the other one.)
   CHECK(newState->isPublished());
-  folly::SpinLockGuard guard(stateLock_);
-  stateDontUseDirectly_.swap(newState);
+  {
+    folly::SpinLockGuard guard(stateLock_);
+    stateDontUseDirectly_.swap(newState);
+    // Sequentially consistent, to order it against the reading flags
+    // checked by dropStaleLocalStates()
+    stateVersion_.fetch_add(1);
+  }
+  dropStaleLocalStates();
+  if (FLAGS_rib_lpm_index) {
+    scheduleLpmIndexBuild();
+  }
+}
+
+void SwSwitch::scheduleLpmIndexBuild() {
+  if (lpmIndexBuildPending_.exchange(true)) {
+    return;
+  }
+  auto evb = getBackgroundEVB(BackgroundSubsystem::ROUTE_INDEX);
+  evb->runInEventBaseThread([this] {
+    // Clear the flag before reading the state, so that any later update
+    // schedules another build
+    lpmIndexBuildPending_.store(false);
+    auto state = getState();
+    for (const auto& table : *state->getRouteTables()) {
+      table->getRibV4()->buildLpmIndex();
+      table->getRibV6()->buildLpmIndex();
+    }
+  });
+}
+
+void SwSwitch::dropStaleLocalStates() {
+  // States are released after all the locks have been dropped, since freeing
+  // one can take a while
+  std::vector<shared_ptr<SwitchState>> stale;
+  auto version = stateVersion_.load();
+  for (auto& local : localState_.accessAllThreads()) {
+    folly::SpinLockGuard guard(local.lock);
+    if (local.version.load(std::memory_order_relaxed) == version ||
+        !local.state || local.reading.load()) {
+      continue;
+    }
+    local.version.store(0, std::memory_order_relaxed);
+    stale.push_back(std::move(local.state));
+  }
+}
+
+shared_ptr<SwitchState> SwSwitch::refreshLocalState(LocalState* local) const {
+  shared_ptr<SwitchState> state;
+  uint64_t version;
+  {
+    // This is the only other place that reads stateDontUseDirectly_.
+    folly::SpinLockGuard guard(stateLock_);
+    state = stateDontUseDirectly_;
+    version = stateVersion_.load(std::memory_order_relaxed);
+  }
+  // Hold our reference to the state through a control block owned by this
+  // thread, and hand out aliases of it.  Readers then only ever touch the
+  // shared reference count here, once per state change.
+  auto holder = std::make_shared<shared_ptr<SwitchState>>(std::move(state));
+  shared_ptr<SwitchState> result(holder, holder->get());
+  shared_ptr<SwitchState> old;
+  {
+    folly::SpinLockGuard guard(local->lock);
+    old = std::move(local->state);
+    local->version.store(0, std::memory_order_relaxed);
+    // If a newer state was published meanwhile, dropStaleLocalStates() may
+    // already have visited this thread, so don't cache this one
+    if (version == stateVersion_.load()) {
+      local->state = result;
+      local->version.store(version, std::memory_order_release);
+    }
+  }
+  return result;
 }
 
 void SwSwitch::applyUpdate(const shared_ptr<SwitchState>& oldState,
-                           const shared_ptr<SwitchState>& newState) {
+                           const shared_ptr<SwitchState>& newState,
+                           StateUpdateTracer::Trace* trace) {
   DCHECK_EQ(oldState, getState());
   auto start = std::chrono::steady_clock::now();
   LOG(INFO) << "Updating state: old_gen=" << oldState->getGeneration() <<
@@ -593,6 +794,19 @@ void SwSwitch::applyUpdate(const shared_ptr<SwitchState>& oldState,
   // Publish the configuration as our active state.
   setStateInternal(newState);
 
+  // Walking the delta isn't free, so only do it when someone will look
+  if (trace) {
+    trace->oldGeneration = oldState->getGeneration();
+    trace->newGeneration = newState->getGeneration();
+    auto deltaStart = std::chrono::steady_clock::now();
+    StateUpdateTracer::countChanges(delta, trace);
+    auto deltaEnd = std::chrono::steady_clock::now();
+    stats()->stateUpdatePhase(StateUpdatePhase::DELTA,
+        duration_cast<microseconds>(deltaEnd - deltaStart));
+    trace->spans.emplace_back(StateUpdatePhase::DELTA, "", 0,
+                              deltaStart, deltaEnd);
+  }
+
   // Inform the HwSwitch of the change.
   //
   // Note that at this point we have already updated the state pointer and
@@ -605,6 +819,7 @@ void SwSwitch::applyUpdate(const shared_ptr<SwitchState>& oldState,
   // take a non-trivial amount of time, and blocking other users seems
   // undesirable.  So far I don't think this brief discrepancy should cause
   // major issues.
+  auto hwStart = std::chrono::steady_clock::now();
   try {
     hw_->stateChanged(delta);
   } catch (const std::exception& ex) {
@@ -617,10 +832,21 @@ void SwSwitch::applyUpdate(const shared_ptr<SwitchState>& oldState,
       folly::exceptionStr(ex);
   }
 
+  auto hwEnd = std::chrono::steady_clock::now();
+  stats()->stateUpdatePhase(StateUpdatePhase::HW_UPDATE,
+      duration_cast<microseconds>(hwEnd - hwStart));
+
   // Notifies all observers of the current state update.
-  notifyStateObservers(delta);
+  notifyStateObservers(delta, trace);
 
   auto end = std::chrono::steady_clock::now();
+  stats()->stateUpdatePhase(StateUpdatePhase::OBSERVERS,
+      duration_cast<microseconds>(end - hwEnd));
+  if (trace) {
+    trace->spans.emplace_back(StateUpdatePhase::HW_UPDATE, "", 0,
+                              hwStart, hwEnd);
+    trace->spans.emplace_back(StateUpdatePhase::OBSERVERS, "", 0, hwEnd, end);
+  }
   auto duration =
     std::chrono::duration_cast<std::chrono::microseconds>(end - start);
   stats()->stateUpdate(duration);
@@ -749,6 +975,7 @@ void SwSwitch::setPortStatusCounter(PortID port, bool up) {
 }
 
 void SwSwitch::packetReceived(std::unique_ptr<RxPacket> pkt) noexcept {
+  threadMonitor_.registerThreadOnce("hwRxThread");
   PortID port = pkt->getSrcPort();
   try {
     handlePacket(std::move(pkt));
@@ -761,6 +988,29 @@ void SwSwitch::packetReceived(std::unique_ptr<RxPacket> pkt) noexcept {
   }
 }
 
+void SwSwitch::packetsReceived(HwSwitch::RxPackets pkts) noexcept {
+  threadMonitor_.registerThreadOnce("hwRxThread");
+  // See handlePacket()
+  if (!isFullyInitialized()) {
+    return;
+  }
+  auto switchStats = stats();
+  for (const auto& pkt : pkts) {
+    switchStats->port(pkt->getSrcPort())->trappedPkt();
+    pcapMgr_->packetReceived(pkt.get());
+  }
+  for (auto& pkt : pkts) {
+    PortID port = pkt->getSrcPort();
+    try {
+      dispatchPacket(std::move(pkt), switchStats);
+    } catch (const std::exception& ex) {
+      switchStats->port(port)->pktError();
+      LOG(ERROR) << "error processing trapped packet: " <<
+        folly::exceptionStr(ex);
+    }
+  }
+}
+
 void SwSwitch::packetReceivedThrowExceptionOnError(
     std::unique_ptr<RxPacket> pkt) {
   handlePacket(std::move(pkt));
@@ -773,16 +1023,22 @@ void SwSwitch::handlePacket(std::unique_ptr<RxPacket> pkt) {
   if (!isFullyInitialized()) {
     return;
   }
-  PortID port = pkt->getSrcPort();
-  stats()->port(port)->trappedPkt();
+  auto switchStats = stats();
+  switchStats->port(pkt->getSrcPort())->trappedPkt();
 
   pcapMgr_->packetReceived(pkt.get());
+  dispatchPacket(std::move(pkt), switchStats);
+}
+
+void SwSwitch::dispatchPacket(std::unique_ptr<RxPacket> pkt,
+                              SwitchStats* switchStats) {
+  PortID port = pkt->getSrcPort();
 
   // The minimum required frame length for ethernet is 64 bytes.
   // Abort processing early if the packet is too short.
   auto len = pkt->getLength();
   if (len < 64) {
-    stats()->port(port)->pktBogus();
+    switchStats->port(port)->pktBogus();
     return;
   }
 
@@ -797,6 +1053,14 @@ void SwSwitch::handlePacket(std::unique_ptr<RxPacket> pkt) {
     ethertype = c.readBE<uint16_t>();
   }
 
+  if (cpPolicer_) {
+    auto cls = ControlPlanePolicer::classify(ethertype, c);
+    if (!cpPolicer_->admit(port, cls)) {
+      switchStats->port(port)->pktPoliced(cls);
+      return;
+    }
+  }
+
   VLOG(5) << "trapped packet: src_port=" << pkt->getSrcPort() <<
     " vlan=" << pkt->getSrcVlan() <<
     " length=" << len <<
@@ -827,10 +1091,11 @@ void SwSwitch::handlePacket(std::unique_ptr<RxPacket> pkt) {
 
   // If we are still here, we don't know what to do with this packet.
   // Increment a counter and just drop the packet on the floor.
-  stats()->port(port)->pktUnhandled();
+  switchStats->port(port)->pktUnhandled();
 }
 
 void SwSwitch::linkStateChanged(PortID port, bool up) noexcept {
+  threadMonitor_.registerThreadOnce("hwLinkscanThread");
 
   LOG(INFO) << "link state changed: " << port << " enabled = " << up;
   logLinkStateEvent(port, up);
@@ -854,8 +1119,17 @@ void SwSwitch::linkStateChanged(PortID port, bool up) noexcept {
 }
 
 void SwSwitch::startThreads() {
-  backgroundThread_.reset(new std::thread([=] {
-      this->threadLoop("fbossBgThread", &backgroundEventBase_); }));
+  // The observer threads have to be up before the update thread starts
+  // notifying observers.
+  for (int i = 0; i < FLAGS_state_observer_threads; ++i) {
+    auto evb = folly::make_unique<EventBase>();
+    auto evbPtr = evb.get();
+    observerEventBases_.push_back(std::move(evb));
+    observerThreads_.emplace_back(new std::thread([=] {
+        this->threadLoop("fbossObserverThread", evbPtr); }));
+  }
+  bgThreads_.start([=](StringPiece name, EventBase* evb) {
+      this->threadLoop(name, evb); });
   updateThread_.reset(new std::thread([=] {
       this->threadLoop("fbossUpdateThread", &updateEventBase_); }));
 }
@@ -867,24 +1141,28 @@ void SwSwitch::stopThreads() {
   //
   // Alternatively, it would be nicer to update EventBase so it can notify
   // callbacks when the event loop is being stopped.
-  if (backgroundThread_) {
-    backgroundEventBase_.runInEventBaseThread(
-        [this] { backgroundEventBase_.terminateLoopSoon(); });
-  }
   if (updateThread_) {
     updateEventBase_.runInEventBaseThread(
         [this] { updateEventBase_.terminateLoopSoon(); });
   }
-  if (backgroundThread_) {
-    backgroundThread_->join();
-  }
+  bgThreads_.stop();
   if (updateThread_) {
     updateThread_->join();
   }
+  // The update thread may block on the observer threads, so only stop them
+  // once it is gone.
+  for (auto& evb : observerEventBases_) {
+    auto evbPtr = evb.get();
+    evbPtr->runInEventBaseThread([evbPtr] { evbPtr->terminateLoopSoon(); });
+  }
+  for (auto& thread : observerThreads_) {
+    thread->join();
+  }
 }
 
 void SwSwitch::threadLoop(StringPiece name, EventBase* eventBase) {
   initThread(name);
+  threadMonitor_.registerThread(name, eventBase);
   eventBase->loopForever();
 }
 
@@ -928,6 +1206,30 @@ void SwSwitch::sendPacketSwitched(std::unique_ptr<TxPacket> pkt) noexcept {
   }
 }
 
+void SwSwitch::sendPacketsSwitched(HwSwitch::TxPackets pkts) noexcept {
+  for (const auto& pkt : pkts) {
+    pcapMgr_->packetSent(pkt.get());
+  }
+  auto numPkts = pkts.size();
+  auto numSent = hw_->sendPacketsSwitched(std::move(pkts));
+  if (numSent != numPkts) {
+    LOG(ERROR) << "failed to send " << (numPkts - numSent) << " of "
+               << numPkts << " L2 switched packets";
+  }
+}
+
+void SwSwitch::sendPacketsOutOfPorts(HwSwitch::PortTxPackets pkts) noexcept {
+  for (const auto& pktAndPort : pkts) {
+    pcapMgr_->packetSent(pktAndPort.first.get());
+  }
+  auto numPkts = pkts.size();
+  auto numSent = hw_->sendPacketsOutOfPorts(std::move(pkts));
+  if (numSent != numPkts) {
+    LOG(ERROR) << "failed to send " << (numPkts - numSent) << " of "
+               << numPkts << " packets out of ports";
+  }
+}
+
 void SwSwitch::sendL3Packet(
     RouterID rid, std::unique_ptr<TxPacket> pkt) noexcept {
   folly::IOBuf *buf = pkt->buf();
@@ -9,8 +9,11 @@
  */
 #pragma once
 
+#include "fboss/agent/BackgroundThreads.h"
 #include "fboss/agent/HighresCounterUtil.h"
 #include "fboss/agent/HwSwitch.h"
+#include "fboss/agent/StateUpdateTracer.h"
+#include "fboss/agent/ThreadMonitor.h"
 #include "fboss/agent/state/StateUpdate.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/Transceiver.h"
@@ -19,6 +22,7 @@
 
 #include <folly/SpinLock.h>
 #include <folly/IntrusiveList.h>
+#include <folly/Likely.h>
 #include <folly/Range.h>
 #include <folly/ThreadLocal.h>
 #include <folly/io/async/EventBase.h>
@@ -27,10 +31,13 @@
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
 class ArpHandler;
+class ControlPlanePolicer;
+class DHCPRelayPlans;
 class IPv4Handler;
 class IPv6Handler;
 class LldpManager;
@@ -152,10 +159,31 @@ class SwSwitch : public HwSwitch::Callback {
    * in which case the caller may now have an out-of-date copy of the state.
    * See the comments in SwitchState.h for more details about the copy-on-write
    * semantics of SwitchState.
+   *
+   * This is called for every trapped packet, so the common case takes no
+   * lock: each thread caches the current state in a thread local slot, and
+   * only goes back to stateDontUseDirectly_ when the state version changes.
+   * The returned pointer shares a reference count private to the calling
+   * thread, so copying it does not bounce a cache line between CPUs either.
+   *
+   * While it copies the cached state, the thread flags its slot as in use,
+   * and dropStaleLocalStates() leaves flagged slots alone.  The flag is
+   * set before the version is checked, and the version is bumped before
+   * dropStaleLocalStates() checks the flag, so either the reader sees the
+   * new version and leaves the cached state alone, or the updater sees the
+   * flag and skips the slot.
    */
   std::shared_ptr<SwitchState> getState() const {
-    folly::SpinLockGuard guard(stateLock_);
-    return stateDontUseDirectly_;
+    auto local = localState_.get();
+    local->reading.store(true);
+    if (LIKELY(local->version.load(std::memory_order_relaxed) ==
+               stateVersion_.load())) {
+      auto state = local->state;
+      local->reading.store(false, std::memory_order_release);
+      return state;
+    }
+    local->reading.store(false, std::memory_order_release);
+    return refreshLocalState(local);
   }
 
   /**
@@ -375,10 +403,19 @@ class SwSwitch : public HwSwitch::Callback {
   }
 
   /*
-   * Get the EventBase for the background thread
+   * Get the EventBase for the shared background thread
    */
   folly::EventBase* getBackgroundEVB() {
-    return &backgroundEventBase_;
+    return bgThreads_.getEventBase();
+  }
+
+  /*
+   * Get the EventBase for a background subsystem.  This is the shared
+   * background thread unless --background_threads gives the subsystem a
+   * thread of its own.
+   */
+  folly::EventBase* getBackgroundEVB(BackgroundSubsystem subsystem) {
+    return bgThreads_.getEventBase(subsystem);
   }
 
   /*
@@ -399,6 +436,7 @@ class SwSwitch : public HwSwitch::Callback {
 
   // HwSwitch::Callback methods
   void packetReceived(std::unique_ptr<RxPacket> pkt) noexcept override;
+  void packetsReceived(HwSwitch::RxPackets pkts) noexcept override;
   void linkStateChanged(PortID port, bool up) noexcept override;
   void exitFatal() const noexcept override;
 
@@ -432,6 +470,13 @@ class SwSwitch : public HwSwitch::Callback {
    */
   void sendPacketSwitched(std::unique_ptr<TxPacket> pkt) noexcept;
 
+  /*
+   * Batched versions of sendPacketSwitched() and sendPacketOutOfPort(), for
+   * callers that generate a burst of packets at once.
+   */
+  void sendPacketsSwitched(HwSwitch::TxPackets pkts) noexcept;
+  void sendPacketsOutOfPorts(HwSwitch::PortTxPackets pkts) noexcept;
+
   /**
    * Send out L3 packet through HW
    *
@@ -479,6 +524,20 @@ class SwSwitch : public HwSwitch::Callback {
     return ipv6_.get();
   }
 
+  /*
+   * Get the ControlPlanePolicer, or null if --cp_policer is not set.
+   */
+  ControlPlanePolicer* getControlPlanePolicer() {
+    return cpPolicer_.get();
+  }
+
+  /*
+   * Get the per-VLAN DHCP relay plans shared by the DHCP handlers.
+   */
+  DHCPRelayPlans* getDhcpRelayPlans() {
+    return dhcpRelayPlans_.get();
+  }
+
   /**
    * Get the NeighborUpdater object.
    *
@@ -503,6 +562,21 @@ class SwSwitch : public HwSwitch::Callback {
     return lldpManager_.get();
   }
 
+  /*
+   * Get the StateUpdateTracer, or null if --state_update_trace_size is 0
+   */
+  const StateUpdateTracer* getStateUpdateTracer() const {
+    return updateTracer_.get();
+  }
+
+  /*
+   * Get the ThreadMonitor tracking the CPU usage and event loop lag of the
+   * agent's threads.
+   */
+  ThreadMonitor* getThreadMonitor() {
+    return &threadMonitor_;
+  }
+
   /*
    * Allow hardware to perform any cleanup needed to gracefully restart the
    * agent before we exit application.
@@ -568,6 +642,41 @@ class SwSwitch : public HwSwitch::Callback {
    */
   void setStateInternal(std::shared_ptr<SwitchState> newState);
 
+  /*
+   * Thread local copy of the current state used by getState().
+   */
+  struct LocalState {
+    // Set by the owning thread while getState() reads state
+    std::atomic<bool> reading{false};
+    // Serializes refreshLocalState() and dropStaleLocalStates(), which are
+    // the only writers of the fields below.  getState() does not take it.
+    folly::SpinLock lock;
+    std::atomic<uint64_t> version{0};
+    std::shared_ptr<SwitchState> state;
+  };
+  std::shared_ptr<SwitchState> refreshLocalState(LocalState* local) const;
+
+  /*
+   * Drop every thread's cached copy of a state older than the current one.
+   *
+   * Otherwise a thread that rarely calls getState(), such as a thrift worker,
+   * would keep the state it last saw alive until its next call, and with it
+   * every route table that has since been replaced.  A slot that its thread
+   * is reading is skipped; it is dropped by the next update, or when the
+   * thread next refreshes it.
+   */
+  void dropStaleLocalStates();
+
+  /*
+   * Build the LPM indexes of the current state's RIBs on the ROUTE_INDEX
+   * background thread, if --rib_lpm_index is set.
+   *
+   * Builds are coalesced: a burst of updates only builds the indexes of the
+   * state that is current when the build runs, and RIBs that are unchanged
+   * keep the index they already have.
+   */
+  void scheduleLpmIndexBuild();
+
   /*
    * This function publishes the SFP Dom data (real time values
    * and thresholds to the local in-memory ServiceData Structure
@@ -583,11 +692,15 @@ class SwSwitch : public HwSwitch::Callback {
   void setSwitchRunState(SwitchRunState desiredState);
   SwitchStats* createSwitchStats();
   void handlePacket(std::unique_ptr<RxPacket> pkt);
+  // The part of handlePacket() after the per packet bookkeeping, which the
+  // batch receive path does once for the whole burst
+  void dispatchPacket(std::unique_ptr<RxPacket> pkt, SwitchStats* switchStats);
 
   static void handlePendingUpdatesHelper(SwSwitch* sw);
   void handlePendingUpdates();
   void applyUpdate(const std::shared_ptr<SwitchState>& oldState,
-                   const std::shared_ptr<SwitchState>& newState);
+                   const std::shared_ptr<SwitchState>& newState,
+                   StateUpdateTracer::Trace* trace);
 
   void startThreads();
   void stopThreads();
@@ -610,8 +723,19 @@ class SwSwitch : public HwSwitch::Callback {
 
   /*
    * Notifies all the observers that a state update occured.
+   *
+   * Observers that do not require the update thread are notified in
+   * parallel on the state observer threads, the rest are notified inline.
+   * This returns once every observer has processed the update.
+   *
+   * If trace is non-null a span is added to it for each observer.
    */
-  void notifyStateObservers(const StateDelta& delta);
+  void notifyStateObservers(const StateDelta& delta,
+                            StateUpdateTracer::Trace* trace = nullptr);
+  void notifyStateObserver(StateObserver* observer,
+                           const std::string& name,
+                           const StateDelta& delta,
+                           StateUpdateTracer::Span* span);
 
   void logLinkStateEvent(PortID port, bool up);
 
@@ -653,10 +777,23 @@ class SwSwitch : public HwSwitch::Callback {
   mutable folly::SpinLock stateLock_;
 
   /*
-   * A thread for performing various background tasks.
+   * Bumped, while holding stateLock_, every time stateDontUseDirectly_
+   * changes.  Readers compare it against their LocalState to decide whether
+   * their cached state is still current.
+   *
+   * setStateInternal() drops the cached states left behind by a version
+   * change, so idle threads do not keep old states alive.
    */
-  std::unique_ptr<std::thread> backgroundThread_;
-  folly::EventBase backgroundEventBase_;
+  std::atomic<uint64_t> stateVersion_{1};
+  mutable folly::ThreadLocal<LocalState, SwSwitch> localState_;
+  // Set while an LPM index build is queued but has not yet looked at the
+  // current state
+  std::atomic<bool> lpmIndexBuildPending_{false};
+
+  /*
+   * Threads for performing various background tasks.
+   */
+  BackgroundThreads bgThreads_{FLAGS_background_threads};
 
   /*
    * A thread for processing SwitchState updates.
@@ -664,6 +801,14 @@ class SwSwitch : public HwSwitch::Callback {
   std::unique_ptr<std::thread> updateThread_;
   folly::EventBase updateEventBase_;
 
+  /*
+   * Threads for notifying state observers that do not need to run in the
+   * update thread. The update thread waits on these for every update, so
+   * they are always idle between updates.
+   */
+  std::vector<std::unique_ptr<std::thread>> observerThreads_;
+  std::vector<std::unique_ptr<folly::EventBase>> observerEventBases_;
+
   /*
    * A callback for listening to neighbors coming and going.
    */
@@ -682,8 +827,14 @@ class SwSwitch : public HwSwitch::Callback {
   std::unique_ptr<ArpHandler> arp_;
   std::unique_ptr<IPv4Handler> ipv4_;
   std::unique_ptr<IPv6Handler> ipv6_;
+  std::unique_ptr<DHCPRelayPlans> dhcpRelayPlans_;
   std::unique_ptr<NeighborUpdater> nUpdater_;
   std::unique_ptr<PktCaptureManager> pcapMgr_;
+  // Only set when --cp_policer is enabled
+  std::unique_ptr<ControlPlanePolicer> cpPolicer_;
+  // Only set when --state_update_trace_size is non-zero
+  std::unique_ptr<StateUpdateTracer> updateTracer_;
+  ThreadMonitor threadMonitor_;
 
   std::unique_ptr<TransceiverMap> transceiverMap_;
 
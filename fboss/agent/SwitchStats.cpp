@@ -65,7 +65,24 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap *map)
       delRouteV4_(map, kCounterPrefix + "route.v4.delete", RATE),
       delRouteV6_(map, kCounterPrefix + "route.v6.delete", RATE),
       updateState_(map, kCounterPrefix + "state_update.us", 50000, 0, 1000000),
-      routeUpdate_(map,  kCounterPrefix + "route_update.us", 50, 0, 500) {
+      routeUpdate_(map,  kCounterPrefix + "route_update.us", 50, 0, 500),
+      lldpTx_(map, kCounterPrefix + "lldp.tx.us", 100, 0, 10000),
+      lldpFramesBuilt_(map, kCounterPrefix + "lldp.frames_built", SUM, RATE),
+      map_(map) {
+  for (size_t i = 0; i < ControlPlanePolicer::kNumClasses; ++i) {
+    auto name = ControlPlanePolicer::className(static_cast<CpuPktClass>(i));
+    cpPolicerDrops_[i] = folly::make_unique<TLTimeseries>(map,
+        kCounterPrefix + "cp_policer." + name + ".drops", SUM, RATE);
+  }
+  for (size_t i = 0; i < StateUpdateTracer::kNumPhases; ++i) {
+    auto phase = static_cast<StateUpdatePhase>(i);
+    if (phase == StateUpdatePhase::OBSERVER) {
+      continue;
+    }
+    updateStatePhases_[i] = folly::make_unique<TLHistogram>(map,
+        kCounterPrefix + "state_update." + StateUpdateTracer::phaseName(phase)
+        + ".us", 1000, 0, 100000);
+  }
 }
 
 PortStats* SwitchStats::port(PortID portID) {
@@ -76,6 +93,17 @@ PortStats* SwitchStats::port(PortID portID) {
   return createPortStats(portID);
 }
 
+void SwitchStats::stateObserverUpdate(const std::string& name,
+                                      std::chrono::microseconds us) {
+  auto it = stateObserverUpdate_.find(name);
+  if (it == stateObserverUpdate_.end()) {
+    auto histogram = folly::make_unique<TLHistogram>(map_,
+        kCounterPrefix + "state_observer." + name + ".us", 1000, 0, 100000);
+    it = stateObserverUpdate_.emplace(name, std::move(histogram)).first;
+  }
+  it->second->addValue(us.count());
+}
+
 PortStats* SwitchStats::createPortStats(PortID portID) {
   auto rv = ports_.emplace(portID, folly::make_unique<PortStats>(portID, this));
   const auto& it = rv.first;
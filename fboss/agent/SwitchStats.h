@@ -10,10 +10,14 @@
 #pragma once
 
 #include <chrono>
+#include <map>
+#include <string>
 #include <boost/container/flat_map.hpp>
 #include <boost/noncopyable.hpp>
 #include "common/stats/ThreadCachedServiceData.h"
+#include "fboss/agent/ControlPlanePolicer.h"
 #include "fboss/agent/PortStats.h"
+#include "fboss/agent/StateUpdateTracer.h"
 #include "fboss/agent/types.h"
 
 namespace facebook { namespace fboss {
@@ -65,6 +69,10 @@ class SwitchStats : public boost::noncopyable {
     trapPktUnhandled_.addValue(1);
     trapPktDrops_.addValue(1);
   }
+  void pktPoliced(CpuPktClass cls) {
+    cpPolicerDrops_[static_cast<size_t>(cls)]->addValue(1);
+    trapPktDrops_.addValue(1);
+  }
   void pktToHost(uint32_t bytes) {
     trapPktToHost_.addValue(1);
     trapPktToHostBytes_.addValue(bytes);
@@ -187,6 +195,31 @@ class SwitchStats : public boost::noncopyable {
     updateState_.addValue(us.count());
   }
 
+  /*
+   * Record the time spent in one phase of a state update.
+   */
+  void stateUpdatePhase(StateUpdatePhase phase, std::chrono::microseconds us) {
+    auto& histogram = updateStatePhases_[static_cast<size_t>(phase)];
+    if (histogram) {
+      histogram->addValue(us.count());
+    }
+  }
+
+  /*
+   * Record the time spent in the named StateObserver's stateUpdated() call.
+   */
+  void stateObserverUpdate(const std::string& name,
+                           std::chrono::microseconds us);
+
+  /*
+   * Record the time spent sending one round of LLDP frames, and the number
+   * of per port frames that had to be rebuilt for it.
+   */
+  void lldpTx(std::chrono::microseconds us, uint32_t framesBuilt) {
+    lldpTx_.addValue(us.count());
+    lldpFramesBuilt_.addValue(framesBuilt);
+  }
+
   void routeUpdate(std::chrono::microseconds us, uint64_t routes) {
     // As syncFib() could include no routes.
     if (routes == 0) {
@@ -218,6 +251,9 @@ class SwitchStats : public boost::noncopyable {
   TLTimeseries trapPktErrors_;
   // Trapped packets that the controller didn't know how to handle.
   TLTimeseries trapPktUnhandled_;
+  // Trapped packets dropped by the control plane policer, by class
+  std::unique_ptr<TLTimeseries>
+    cpPolicerDrops_[ControlPlanePolicer::kNumClasses];
   // Trapped packets forwarded to host
   TLTimeseries trapPktToHost_;
   // Trapped packets forwarded to host in bytes
@@ -301,14 +337,38 @@ class SwitchStats : public boost::noncopyable {
    */
   TLHistogram updateState_;
 
+  /*
+   * Histograms for the time used by each phase of a state update (in
+   * microseconds).  There is none for StateUpdatePhase::OBSERVER, which is
+   * covered by stateObserverUpdate_.
+   */
+  std::unique_ptr<TLHistogram>
+    updateStatePhases_[StateUpdateTracer::kNumPhases];
+
   /**
    * Histogram for time used for route update (in microsecond)
    */
   TLHistogram routeUpdate_;
 
+  /**
+   * Histogram for time used to send LLDP on all ports (in microsecond)
+   */
+  TLHistogram lldpTx_;
+  // LLDP frames rebuilt because the port, hostname or MAC changed
+  TLTimeseries lldpFramesBuilt_;
+
+  /**
+   * Histograms for time used by each state observer (in microsecond),
+   * indexed by observer name and created on first use.
+   */
+  std::map<std::string, std::unique_ptr<TLHistogram>> stateObserverUpdate_;
+
   // Create a PortStats object for the given PortID
   PortStats* createPortStats(PortID portID);
 
+  // The stats map used to create counters on demand
+  ThreadLocalStatsMap* map_{nullptr};
+
   // Individual port stats objects, indexed by PortID
   PortStatsMap ports_;
 };
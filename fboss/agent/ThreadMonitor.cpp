@@ -0,0 +1,280 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ThreadMonitor.h"
+
+#include <algorithm>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Portability.h>
+#include <folly/String.h>
+#include <folly/io/async/EventBase.h>
+#include <glog/logging.h>
+
+#include "common/stats/ServiceData.h"
+
+using folly::StringPiece;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::seconds;
+using std::chrono::system_clock;
+using std::string;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+// 1ms buckets, up to a second
+const stats::ExportedHistogram kLagHistogram(1000, 0, 1000000);
+
+pid_t currentTid() {
+  return syscall(SYS_gettid);
+}
+
+string statName(StringPiece thread, StringPiece stat) {
+  return folly::to<string>("thread.", thread, ".", stat);
+}
+
+/*
+ * Read the user and system CPU time of a thread in this process, in clock
+ * ticks.  Returns false if the thread no longer exists.
+ */
+bool readCpuTicks(pid_t tid, int64_t* user, int64_t* system) {
+  string stat;
+  auto path = folly::to<string>("/proc/self/task/", tid, "/stat");
+  if (!folly::readFile(path.c_str(), stat)) {
+    return false;
+  }
+  // The second field is the thread name in parentheses, which may contain
+  // spaces, so start after it.  utime and stime are fields 14 and 15.
+  auto end = stat.rfind(')');
+  if (end == string::npos || end + 2 >= stat.size()) {
+    return false;
+  }
+  std::vector<StringPiece> fields;
+  folly::split(' ', StringPiece(stat).subpiece(end + 2), fields);
+  if (fields.size() < 13) {
+    return false;
+  }
+  *user = folly::to<int64_t>(fields[11]);
+  *system = folly::to<int64_t>(fields[12]);
+  return true;
+}
+
+} // unnamed namespace
+
+struct ThreadMonitor::ThreadInfo {
+  ThreadInfo(string name, pid_t tid, folly::EventBase* evb)
+    : name(std::move(name)),
+      tid(tid),
+      evb(evb) {}
+
+  /*
+   * Record one lag measurement.  Must be called with lock held.
+   */
+  void addLag(int64_t us) {
+    hasLag = true;
+    lagUs = us;
+    maxLagUs = std::max(maxLagUs, us);
+    if (!lagHistogram.second) {
+      lagHistogram = fbData->getHistogramMap()->getOrCreateUnlocked(
+          statName(name, "lag_us"), &kLagHistogram);
+    }
+    if (lagHistogram.second) {
+      auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
+      SpinLockHolder guard(lagHistogram.first.get());
+      lagHistogram.second->addValue(now, us, 1);
+    }
+  }
+
+  const string name;
+  const pid_t tid;
+  folly::EventBase* const evb;
+
+  // Everything below is protected by lock
+  std::mutex lock;
+  stats::ExportedHistogramMap::LockAndHistogram lagHistogram;
+
+  // Updated by sample()
+  int64_t userTicks{0};
+  int64_t systemTicks{0};
+  double cpuPercent{0};
+  Clock::time_point lastSample;
+  bool exited{false};
+
+  // Updated by the event loop probes, or recordLag()
+  bool hasLag{false};
+  bool probePending{false};
+  Clock::time_point probePosted;
+  int64_t lagUs{0};
+  int64_t maxLagUs{0};
+  double loopBusyUs{0};
+  int64_t queueDepth{0};
+};
+
+std::atomic<uint64_t> ThreadMonitor::nextID_{1};
+
+ThreadMonitor::ThreadMonitor()
+  : id_(nextID_++),
+    usPerTick_(1000000 / sysconf(_SC_CLK_TCK)) {
+}
+
+uint64_t& ThreadMonitor::registeredWith() {
+  // The ID rather than the address, so that a new monitor allocated at the
+  // address of an old one is not mistaken for it
+  static FOLLY_TLS uint64_t monitorID = 0;
+  return monitorID;
+}
+
+void ThreadMonitor::registerThread(StringPiece name, folly::EventBase* evb) {
+  auto tid = currentTid();
+  std::lock_guard<std::mutex> guard(lock_);
+  registeredWith() = id_;
+  for (const auto& entry : threads_) {
+    if (entry.second->tid == tid) {
+      return;
+    }
+  }
+  auto uniqueName = name.str();
+  for (int n = 1; threads_.count(uniqueName); ++n) {
+    uniqueName = folly::to<string>(name, ".", n);
+  }
+  VLOG(2) << "monitoring thread " << uniqueName << " (" << tid << ")";
+  threads_.emplace(uniqueName,
+                   std::make_shared<ThreadInfo>(uniqueName, tid, evb));
+}
+
+void ThreadMonitor::recordLag(microseconds lag) {
+  auto tid = currentTid();
+  std::shared_ptr<ThreadInfo> info;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (const auto& entry : threads_) {
+      if (entry.second->tid == tid) {
+        info = entry.second;
+        break;
+      }
+    }
+  }
+  if (!info) {
+    LOG(WARNING) << "lag reported by unregistered thread " << tid;
+    return;
+  }
+  std::lock_guard<std::mutex> guard(info->lock);
+  info->addLag(lag.count());
+}
+
+void ThreadMonitor::sample() {
+  std::vector<std::shared_ptr<ThreadInfo>> threads;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (const auto& entry : threads_) {
+      threads.push_back(entry.second);
+    }
+  }
+  auto now = Clock::now();
+  for (const auto& info : threads) {
+    sampleThread(info, now);
+  }
+}
+
+void ThreadMonitor::sampleThread(const std::shared_ptr<ThreadInfo>& info,
+                                 Clock::time_point now) {
+  int64_t user = 0;
+  int64_t system = 0;
+  bool alive = readCpuTicks(info->tid, &user, &system);
+
+  std::lock_guard<std::mutex> guard(info->lock);
+  if (!alive) {
+    info->exited = true;
+    return;
+  }
+  if (info->lastSample != Clock::time_point()) {
+    auto wallUs = duration_cast<microseconds>(now - info->lastSample).count();
+    auto cpuTicks = (user + system) - (info->userTicks + info->systemTicks);
+    if (wallUs > 0) {
+      info->cpuPercent = 100.0 * cpuTicks * usPerTick_ / wallUs;
+    }
+  }
+  info->userTicks = user;
+  info->systemTicks = system;
+  info->lastSample = now;
+
+  if (info->evb) {
+    // The number of callbacks queued by other threads and not yet run
+    info->queueDepth = info->evb->getNotificationQueueSize();
+    if (info->probePending) {
+      // The loop has not got to the previous probe yet, so it is at least
+      // this far behind
+      info->lagUs = std::max(info->lagUs,
+          duration_cast<microseconds>(now - info->probePosted).count());
+      info->maxLagUs = std::max(info->maxLagUs, info->lagUs);
+    } else {
+      info->probePending = true;
+      info->probePosted = now;
+      info->evb->runInEventBaseThread([info, now] {
+          probeLoop(info, now);
+        });
+    }
+  }
+
+  fbData->setCounter(statName(info->name, "cpu_pct"),
+                     static_cast<int64_t>(info->cpuPercent));
+  fbData->setCounter(statName(info->name, "cpu_ms"),
+                     (user + system) * usPerTick_ / 1000);
+  if (info->hasLag) {
+    fbData->setCounter(statName(info->name, "last_lag_us"), info->lagUs);
+    fbData->setCounter(statName(info->name, "max_lag_us"), info->maxLagUs);
+  }
+  if (info->evb) {
+    fbData->setCounter(statName(info->name, "loop_busy_us"),
+                       static_cast<int64_t>(info->loopBusyUs));
+    fbData->setCounter(statName(info->name, "queue_depth"), info->queueDepth);
+  }
+}
+
+void ThreadMonitor::probeLoop(std::shared_ptr<ThreadInfo> info,
+                              Clock::time_point posted) {
+  auto lag = duration_cast<microseconds>(Clock::now() - posted).count();
+  // This is the only thread that may touch the EventBase's loop stats
+  auto busy = info->evb->getAvgLoopTime();
+  std::lock_guard<std::mutex> guard(info->lock);
+  info->probePending = false;
+  info->loopBusyUs = busy;
+  info->addLag(lag);
+}
+
+std::vector<ThreadStatsThrift> ThreadMonitor::getThreadStats() const {
+  std::vector<ThreadStatsThrift> results;
+  std::lock_guard<std::mutex> guard(lock_);
+  for (const auto& entry : threads_) {
+    auto& info = *entry.second;
+    std::lock_guard<std::mutex> infoGuard(info.lock);
+    ThreadStatsThrift stats;
+    stats.name = info.name;
+    stats.tid = info.tid;
+    stats.userTimeUs = info.userTicks * usPerTick_;
+    stats.systemTimeUs = info.systemTicks * usPerTick_;
+    stats.cpuPercent = info.cpuPercent;
+    stats.hasLag = info.hasLag;
+    stats.lagUs = info.lagUs;
+    stats.maxLagUs = info.maxLagUs;
+    stats.loopBusyUs = info.loopBusyUs;
+    stats.queueDepth = info.queueDepth;
+    stats.exited = info.exited;
+    results.push_back(std::move(stats));
+  }
+  return results;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include <folly/Range.h>
+
+#include "fboss/agent/if/gen-cpp2/ctrl_types.h"
+
+namespace folly {
+class EventBase;
+}
+
+namespace facebook { namespace fboss {
+
+/*
+ * ThreadMonitor keeps track of how busy each of the agent's threads is, to
+ * tell which one is saturated when the agent is slow to converge.
+ *
+ * Threads register themselves by name, along with their EventBase if they
+ * run one.  Each call to sample() then:
+ *
+ *  - reads the CPU time used by each thread from the kernel
+ *  - posts a probe to each event loop, which measures how long the loop
+ *    took to get around to running it (the scheduling lag), and reads the
+ *    loop's average busy time and the number of callbacks queued on it
+ *
+ * and exports the results as counters named "thread.<name>.<stat>", plus a
+ * loop lag histogram for each event loop.  getThreadStats() returns the same
+ * data for the getThreadStats() thrift call.
+ *
+ * Threads that are not event loops, such as a FunctionScheduler thread, can
+ * report their own lag with recordLag().  The SDK's RX and linkscan threads
+ * only get CPU times.
+ *
+ * All of the methods may be called from any thread.
+ */
+class ThreadMonitor {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  ThreadMonitor();
+
+  /*
+   * Register the calling thread.  If the name is already taken by another
+   * thread, ".<n>" is appended to it to make it unique.  Registering the
+   * same thread again is a no-op.
+   */
+  void registerThread(folly::StringPiece name,
+                      folly::EventBase* evb = nullptr);
+
+  /*
+   * Register the calling thread if it has not been registered with this
+   * monitor yet.  This is cheap enough to call on every callback from
+   * threads that we do not create ourselves.
+   */
+  void registerThreadOnce(folly::StringPiece name) {
+    if (registeredWith() != id_) {
+      registerThread(name);
+    }
+  }
+
+  /*
+   * Record the scheduling lag of the calling thread, which must have been
+   * registered.  This is for threads that are not event loops.
+   */
+  void recordLag(std::chrono::microseconds lag);
+
+  /*
+   * Update the CPU times, probe the event loops, and export the counters.
+   * Meant to be called periodically, e.g. from the stats thread.
+   */
+  void sample();
+
+  /*
+   * Return the latest stats of all of the registered threads.
+   */
+  std::vector<ThreadStatsThrift> getThreadStats() const;
+
+ private:
+  struct ThreadInfo;
+
+  // Forbidden copy constructor and assignment operator
+  ThreadMonitor(ThreadMonitor const &) = delete;
+  ThreadMonitor& operator=(ThreadMonitor const &) = delete;
+
+  // The ID of the monitor that the calling thread last registered with
+  static uint64_t& registeredWith();
+  static void probeLoop(std::shared_ptr<ThreadInfo> info,
+                        Clock::time_point posted);
+  void sampleThread(const std::shared_ptr<ThreadInfo>& info,
+                    Clock::time_point now);
+
+  static std::atomic<uint64_t> nextID_;
+
+  const uint64_t id_;
+  const int64_t usPerTick_;
+  mutable std::mutex lock_;
+  std::map<std::string, std::shared_ptr<ThreadInfo>> threads_;
+};
+
+}} // facebook::fboss
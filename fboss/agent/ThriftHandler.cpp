@@ -9,6 +9,7 @@
  */
 #include "fboss/agent/ThriftHandler.h"
 
+#include <algorithm>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 #include "common/stats/ServiceData.h"
@@ -23,6 +24,7 @@
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/PortStatsSnapshot.h"
 #include "fboss/agent/capture/PktCapture.h"
 #include "fboss/agent/capture/PktCaptureManager.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
@@ -44,7 +46,9 @@
 
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/json.h>
 #include <folly/MoveWrapper.h>
+#include <folly/Optional.h>
 #include <folly/Range.h>
 #include <thrift/lib/cpp2/async/DuplexChannel.h>
 
@@ -421,8 +425,33 @@ void ThriftHandler::getL2Table(std::vector<L2EntryThrift>& l2Table) {
   VLOG(6) << "L2 Table size:" << l2Table.size();
 }
 
-void ThriftHandler::fillPortStats(PortInfoThrift& portInfo) {
+void ThriftHandler::fillPortStats(PortInfoThrift& portInfo,
+                                  const PortStatsSnapshot* snapshot) {
   auto portId = portInfo.portId;
+  const auto& status = sw_->getPortStatus(PortID(portId));
+  portInfo.adminState = PortAdminState(status.enabled);
+  portInfo.operState = PortOperState(status.up);
+
+  // Use the counters the hardware collected, if it keeps a snapshot of them
+  auto portStats = snapshot ? snapshot->getPortIf(PortID(portId)) : nullptr;
+  if (portStats) {
+    typedef PortStatsSnapshot S;
+    const auto& counts = portStats->counts;
+    portInfo.input.bytes = counts[S::IN_BYTES];
+    portInfo.input.ucastPkts = counts[S::IN_UNICAST_PKTS];
+    portInfo.input.multicastPkts = counts[S::IN_MULTICAST_PKTS];
+    portInfo.input.broadcastPkts = counts[S::IN_BROADCAST_PKTS];
+    portInfo.input.errors.errors = counts[S::IN_ERRORS];
+    portInfo.input.errors.discards = counts[S::IN_DISCARDS];
+    portInfo.output.bytes = counts[S::OUT_BYTES];
+    portInfo.output.ucastPkts = counts[S::OUT_UNICAST_PKTS];
+    portInfo.output.multicastPkts = counts[S::OUT_MULTICAST_PKTS];
+    portInfo.output.broadcastPkts = counts[S::OUT_BROADCAST_PKTS];
+    portInfo.output.errors.errors = counts[S::OUT_ERRORS];
+    portInfo.output.errors.discards = counts[S::OUT_DISCARDS];
+    return;
+  }
+
   auto statMap = fbData->getStatMap();
 
   auto getSumStat = [&] (StringPiece prefix, StringPiece name) {
@@ -445,10 +474,6 @@ void ThriftHandler::fillPortStats(PortInfoThrift& portInfo) {
     ctr.errors.discards = getSumStat(prefix, "discards");
   };
 
-  const auto& status = sw_->getPortStatus(PortID(portId));
-  portInfo.adminState = PortAdminState(status.enabled);
-  portInfo.operState = PortOperState(status.up);
-
   fillPortCounters(portInfo.output, "out_");
   fillPortCounters(portInfo.input, "in_");
 }
@@ -460,26 +485,33 @@ void ThriftHandler::getPortInfo(PortInfoThrift& portInfo, int32_t portId) {
   if (!port) {
     throw FbossError("no such port ", portId);
   }
-  portInfo.portId = portId;
-  portInfo.name = port->getName();
-  portInfo.description = port->getDescription();
-  portInfo.speedMbps = (int) port->getWorkingSpeed();
-  for (auto entry : port->getVlans()) {
-    portInfo.vlans.push_back(entry.first);
-  }
-  fillPortStats(portInfo);
+  auto snapshot = sw_->getHw()->getPortStatsSnapshot();
+  fillPortInfo(portInfo, port.get(), snapshot.get());
 }
 
 void ThriftHandler::getAllPortInfo(map<int32_t, PortInfoThrift>& portInfoMap) {
   ensureConfigured();
 
+  // Fill in every port from the same snapshot
+  auto snapshot = sw_->getHw()->getPortStatsSnapshot();
   for (const auto& port : (*sw_->getState()->getPorts())) {
-    auto portId = port->getID();
-    auto& portInfo = portInfoMap[portId];
-    getPortInfo(portInfo, portId);
+    auto& portInfo = portInfoMap[port->getID()];
+    fillPortInfo(portInfo, port.get(), snapshot.get());
   }
 }
 
+void ThriftHandler::fillPortInfo(PortInfoThrift& portInfo, const Port* port,
+                                 const PortStatsSnapshot* snapshot) {
+  portInfo.portId = port->getID();
+  portInfo.name = port->getName();
+  portInfo.description = port->getDescription();
+  portInfo.speedMbps = (int) port->getWorkingSpeed();
+  for (auto entry : port->getVlans()) {
+    portInfo.vlans.push_back(entry.first);
+  }
+  fillPortStats(portInfo, snapshot);
+}
+
 void ThriftHandler::getPortStats(PortInfoThrift& portInfo, int32_t portId) {
   getPortInfo(portInfo, portId);
 }
@@ -493,6 +525,19 @@ void ThriftHandler::getRunningConfig(std::string& configStr) {
   configStr = sw_->getConfigStr();
 }
 
+void ThriftHandler::getStateUpdateTrace(std::string& trace) {
+  auto tracer = sw_->getStateUpdateTracer();
+  if (!tracer) {
+    throw FbossError("state update tracing is disabled, "
+                     "restart with --state_update_trace_size");
+  }
+  trace = folly::toJson(tracer->toChromeTrace()).toStdString();
+}
+
+void ThriftHandler::getThreadStats(std::vector<ThreadStatsThrift>& stats) {
+  stats = sw_->getThreadMonitor()->getThreadStats();
+}
+
 void ThriftHandler::getPortStatus(map<int32_t, PortStatus>& statusMap,
                                   unique_ptr<vector<int32_t>> ports) {
   ensureConfigured();
@@ -561,6 +606,163 @@ void ThriftHandler::getRouteTable(std::vector<UnicastRoute>& route) {
   }
 }
 
+namespace {
+
+template<typename AddrT> struct RouteTablePageAddr;
+template<> struct RouteTablePageAddr<IPAddressV4> {
+  static bool isFamily(const IPAddress& ip) { return ip.isV4(); }
+  static IPAddressV4 get(const IPAddress& ip) { return ip.asV4(); }
+};
+template<> struct RouteTablePageAddr<IPAddressV6> {
+  static bool isFamily(const IPAddress& ip) { return ip.isV6(); }
+  static IPAddressV6 get(const IPAddress& ip) { return ip.asV6(); }
+};
+
+/*
+ * Builds one page of a route table dump straight from the RIBs of a
+ * SwitchState snapshot. Every page starts with a tree seek to the cursor
+ * (or prefix filter) rather than a walk from the beginning, so fetching a
+ * full table page by page stays linear in the table size.
+ */
+class RouteTablePageBuilder {
+ public:
+  RouteTablePageBuilder(const RouteTablePageRequest& req,
+                        RouteTablePage& page)
+      : req_(req),
+        page_(page) {
+    if (req_.maxRoutes <= 0) {
+      throw FbossError("maxRoutes must be positive, got ", req_.maxRoutes);
+    }
+    if (req_.__isset.cursor) {
+      cursor_ = std::make_pair(toIPAddress(req_.cursor.ip),
+          static_cast<uint8_t>(req_.cursor.prefixLength));
+    }
+    if (req_.__isset.prefixFilter) {
+      prefixFilter_ = std::make_pair(toIPAddress(req_.prefixFilter.ip),
+          static_cast<uint8_t>(req_.prefixFilter.prefixLength));
+    }
+    if (req_.__isset.nexthopFilter) {
+      nexthopFilter_ = toIPAddress(req_.nexthopFilter);
+    }
+  }
+
+  /*
+   * Append the routes of one RIB to the page. Returns false once the page
+   * is full, in which case nextCursor has been set.
+   */
+  template<typename AddrT>
+  bool addRoutes(const RouteTableRib<AddrT>& rib) {
+    using Addr = RouteTablePageAddr<AddrT>;
+    if (prefixFilter_ && !Addr::isFamily(prefixFilter_->first)) {
+      return true;
+    }
+    const auto& routes = rib.routes();
+    auto itr = routes.begin();
+    if (cursor_ && Addr::isFamily(cursor_->first)) {
+      auto cursorAddr = Addr::get(cursor_->first).mask(cursor_->second);
+      itr = routes.upperBound(cursorAddr, cursor_->second);
+      if (prefixFilter_) {
+        auto filterAddr =
+          Addr::get(prefixFilter_->first).mask(prefixFilter_->second);
+        if (cursorAddr < filterAddr || (cursorAddr == filterAddr &&
+              cursor_->second < prefixFilter_->second)) {
+          itr = routes.lowerBound(filterAddr, prefixFilter_->second);
+        }
+      }
+    } else if (cursor_ && cursor_->first.isV6()) {
+      // IPv6 cursor, so all the IPv4 routes were returned already
+      return true;
+    } else if (prefixFilter_) {
+      itr = routes.lowerBound(Addr::get(prefixFilter_->first),
+          prefixFilter_->second);
+    }
+    for (; itr != routes.end(); ++itr) {
+      if (prefixFilter_ && (itr->masklen() < prefixFilter_->second ||
+            itr->ipAddress().mask(prefixFilter_->second) !=
+            Addr::get(prefixFilter_->first).mask(prefixFilter_->second))) {
+        // Routes within the filter are contiguous in iteration order
+        break;
+      }
+      if (numRoutes_ == req_.maxRoutes) {
+        page_.nextCursor = lastPrefix_;
+        page_.__isset.nextCursor = true;
+        return false;
+      }
+      const auto& route = itr->value();
+      static const RouteForwardNexthops kNoNexthops;
+      const auto& nhops = route->isResolved() ?
+        route->getForwardInfo().getNexthops() : kNoNexthops;
+      if (nexthopFilter_ && std::none_of(nhops.begin(), nhops.end(),
+            [&](const RouteForwardInfo::Nexthop& nh) {
+              return nh.nexthop == *nexthopFilter_;
+            })) {
+        continue;
+      }
+      lastPrefix_.ip = toBinaryAddress(route->prefix().network);
+      lastPrefix_.prefixLength = route->prefix().mask;
+      addRoute(lastPrefix_, nhops);
+    }
+    return true;
+  }
+
+ private:
+  void addRoute(const IpPrefix& dest, const RouteForwardNexthops& nhops) {
+    ++numRoutes_;
+    if (!req_.compact) {
+      UnicastRoute route;
+      route.dest = dest;
+      route.nextHopAddrs.reserve(nhops.size());
+      for (const auto& nh : nhops) {
+        route.nextHopAddrs.push_back(toBinaryAddress(nh.nexthop));
+      }
+      page_.routes.push_back(std::move(route));
+      return;
+    }
+    auto ret = nexthopSets_.emplace(nhops, page_.nextHopSets.size());
+    if (ret.second) {
+      std::vector<BinaryAddress> nextHopAddrs;
+      nextHopAddrs.reserve(nhops.size());
+      for (const auto& nh : nhops) {
+        nextHopAddrs.push_back(toBinaryAddress(nh.nexthop));
+      }
+      page_.nextHopSets.push_back(std::move(nextHopAddrs));
+    }
+    CompactUnicastRoute route;
+    route.dest = dest;
+    route.nextHopSetIdx = ret.first->second;
+    page_.compactRoutes.push_back(std::move(route));
+  }
+
+  typedef network::thrift::cpp2::BinaryAddress BinaryAddress;
+
+  const RouteTablePageRequest& req_;
+  RouteTablePage& page_;
+  folly::Optional<folly::CIDRNetwork> cursor_;
+  folly::Optional<folly::CIDRNetwork> prefixFilter_;
+  folly::Optional<IPAddress> nexthopFilter_;
+  std::map<RouteForwardNexthops, int32_t> nexthopSets_;
+  IpPrefix lastPrefix_;
+  int32_t numRoutes_{0};
+};
+
+} // unnamed namespace
+
+void ThriftHandler::getRouteTablePage(RouteTablePage& page,
+    std::unique_ptr<RouteTablePageRequest> req) {
+  ensureConfigured();
+  // Hold on to one snapshot for the whole page
+  auto state = sw_->getState();
+  auto routeTable = state->getRouteTables()->getRouteTableIf(
+      RouterID(req->vrfId));
+  if (!routeTable) {
+    throw FbossError("No Such VRF ", req->vrfId);
+  }
+  RouteTablePageBuilder builder(*req, page);
+  if (builder.addRoutes(*routeTable->getRibV4())) {
+    builder.addRoutes(*routeTable->getRibV6());
+  }
+}
+
 void ThriftHandler::getIpRoute(UnicastRoute& route,
                                 std::unique_ptr<Address> addr, int32_t vrfId) {
   ensureConfigured();
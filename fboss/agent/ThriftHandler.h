@@ -27,6 +27,8 @@
 
 namespace facebook { namespace fboss {
 
+class Port;
+struct PortStatsSnapshot;
 class SwSwitch;
 class Vlan;
 
@@ -95,6 +97,8 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
       std::map<int32_t, InterfaceDetail>& interfaces) override;
   void getInterfaceList(std::vector<std::string>& interfaceList) override;
   void getRouteTable(std::vector<UnicastRoute>& routeTable) override;
+  void getRouteTablePage(RouteTablePage& page,
+                         std::unique_ptr<RouteTablePageRequest> req) override;
   void getPortStatus(std::map<int32_t, PortStatus>& status,
                      std::unique_ptr<std::vector<int32_t>> ports)
                      override;
@@ -106,6 +110,8 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
   void getPortStats(PortInfoThrift& portInfo, int32_t portId) override;
   void getAllPortStats(std::map<int32_t, PortInfoThrift>& portInfo) override;
   void getRunningConfig(std::string& configStr) override;
+  void getStateUpdateTrace(std::string& trace) override;
+  void getThreadStats(std::vector<ThreadStatsThrift>& stats) override;
   void getArpTable(std::vector<ArpEntryThrift>& arpTable) override;
   void getL2Table(std::vector<L2EntryThrift>& l2Table) override;
   void getNdpTable(std::vector<NdpEntryThrift>& arpTable) override;
@@ -209,7 +215,10 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
                                 std::vector<std::string> added,
                                 std::vector<std::string> deleted);
 
-  void fillPortStats(PortInfoThrift& portInfo);
+  void fillPortInfo(PortInfoThrift& portInfo, const Port* port,
+                    const PortStatsSnapshot* snapshot);
+  void fillPortStats(PortInfoThrift& portInfo,
+                     const PortStatsSnapshot* snapshot);
   Vlan* getVlan(int32_t vlanId);
   Vlan* getVlan(const std::string& vlanName);
   template<typename ADDR_TYPE, typename ADDR_CONVERTER>
@@ -10,9 +10,11 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 #include <folly/String.h>
 #include "fboss/agent/types.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/lib/usb/TransceiverI2CApi.h"
 
 namespace facebook { namespace fboss {
 
@@ -31,6 +33,23 @@ class TransceiverImpl {
                               int len, uint8_t* fieldValue) = 0;
   virtual int writeTransceiver(int dataAddress, int offset,
                               int len, uint8_t* fieldValue) = 0;
+  /*
+   * Run several reads and writes in order.  Returns false if any of them
+   * failed, in which case the rest may not have run.  Implementations on a
+   * shared bus can override this to claim the bus only once.
+   */
+  virtual bool transceiverTransaction(
+      const std::vector<TransceiverI2CApi::Op>& ops) {
+    for (const auto& op : ops) {
+      int ret = op.type == TransceiverI2CApi::Op::READ ?
+        readTransceiver(op.i2cAddress, op.offset, op.len, op.buf) :
+        writeTransceiver(op.i2cAddress, op.offset, op.len, op.buf);
+      if (ret < 0) {
+        return false;
+      }
+    }
+    return true;
+  }
   /*
    * This function will check if the transceiver is present or not
    */
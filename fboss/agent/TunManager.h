@@ -38,11 +38,15 @@ class TunManager : public StateObserver {
    */
   void startProbe();
   /**
-   * Update the intfs_ map based on the given state update. This
-   * overrides the StateObserver stateUpdated api, which is always
-   * guaranteed to be called from the update thread.
+   * Schedule a sync of the intfs_ map to the given state update. This
+   * overrides the StateObserver stateUpdated api. The actual sync runs
+   * in the thread serving 'evb_', so this may be called from any of the
+   * state observer threads.
    */
   void stateUpdated(const StateDelta& delta) override;
+  bool requiresUpdateThread() const override {
+    return false;
+  }
 
   void startObservingUpdates();
   /**
@@ -156,8 +156,9 @@ BcmHost::~BcmHost() {
 }
 
 BcmEcmpHost::BcmEcmpHost(const BcmSwitch *hw, opennsl_vrf_t vrf,
-                         const RouteForwardNexthops& fwd)
+                         std::shared_ptr<const RouteForwardNexthopGroup> group)
     : hw_(hw), vrf_(vrf) {
+  const auto& fwd = group->nexthops();
   CHECK_GT(fwd.size(), 0);
   BcmHostTable *table = hw_->writableHostTable();
   BcmEcmpEgress::Paths paths;
@@ -195,16 +196,17 @@ BcmEcmpHost::BcmEcmpHost(const BcmSwitch *hw, opennsl_vrf_t vrf,
     ecmpEgressId_ = egressId_;
     hw_->writableHostTable()->insertBcmEgress(std::move(ecmp));
   }
-  fwd_ = std::move(prog);
+  fwd_ = std::move(group);
 }
 
 BcmEcmpHost::~BcmEcmpHost() {
   // Deref ECMP egress first since the ECMP egress entry holds references
   // to egress entries.
-  VLOG(3) << "Decremented reference for egress object for " << fwd_;
+  VLOG(3) << "Decremented reference for egress object for "
+          << fwd_->nexthops();
   hw_->writableHostTable()->derefEgress(ecmpEgressId_);
   BcmHostTable *table = hw_->writableHostTable();
-  for (const auto& nhop : fwd_) {
+  for (const auto& nhop : fwd_->nexthops()) {
     table->derefBcmHost(vrf_, nhop.nexthop);
   }
 }
@@ -231,7 +233,7 @@ HostT* BcmHostTable::incRefOrCreateBcmHost(
   SCOPE_FAIL {
     map->erase(iter);
   };
-  auto newHost = folly::make_unique<HostT>(hw_, key.first, key.second, args...);
+  auto newHost = folly::make_unique<HostT>(hw_, key.first, args...);
   auto hostPtr = newHost.get();
   iter->second.first = std::move(newHost);
   return hostPtr;
@@ -239,17 +241,20 @@ HostT* BcmHostTable::incRefOrCreateBcmHost(
 
 BcmHost* BcmHostTable::incRefOrCreateBcmHost(
     opennsl_vrf_t vrf, const IPAddress& addr) {
-  return incRefOrCreateBcmHost(&hosts_, std::make_pair(vrf, addr));
+  return incRefOrCreateBcmHost(&hosts_, std::make_pair(vrf, addr), addr);
 }
 
 BcmHost* BcmHostTable::incRefOrCreateBcmHost(
     opennsl_vrf_t vrf, const IPAddress& addr, opennsl_if_t egressId) {
-  return incRefOrCreateBcmHost(&hosts_, std::make_pair(vrf, addr), egressId);
+  return incRefOrCreateBcmHost(
+      &hosts_, std::make_pair(vrf, addr), addr, egressId);
 }
 
 BcmEcmpHost* BcmHostTable::incRefOrCreateBcmEcmpHost(
-    opennsl_vrf_t vrf, const RouteForwardNexthops& fwd) {
-  return incRefOrCreateBcmHost(&ecmpHosts_, std::make_pair(vrf, fwd));
+    opennsl_vrf_t vrf,
+    const std::shared_ptr<const RouteForwardNexthopGroup>& fwd) {
+  return incRefOrCreateBcmHost(
+      &ecmpHosts_, std::make_pair(vrf, fwd->id()), fwd);
 }
 
 template<typename KeyT, typename HostT, typename... Args>
@@ -278,15 +283,16 @@ BcmHost* BcmHostTable::getBcmHost(
 }
 
 BcmEcmpHost* BcmHostTable::getBcmEcmpHostIf(
-    opennsl_vrf_t vrf, const RouteForwardNexthops& fwd) const {
-  return getBcmHostIf(&ecmpHosts_, vrf, fwd);
+    opennsl_vrf_t vrf, const RouteForwardNexthopGroup& fwd) const {
+  return getBcmHostIf(&ecmpHosts_, vrf, fwd.id());
 }
 
 BcmEcmpHost* BcmHostTable::getBcmEcmpHost(
-    opennsl_vrf_t vrf, const RouteForwardNexthops& fwd) const {
+    opennsl_vrf_t vrf, const RouteForwardNexthopGroup& fwd) const {
   auto host = getBcmEcmpHostIf(vrf, fwd);
   if (!host) {
-    throw FbossError("Cannot find BcmEcmpHost vrf=", vrf, " fwd=", fwd);
+    throw FbossError("Cannot find BcmEcmpHost vrf=", vrf,
+                     " fwd=", fwd.nexthops());
   }
   return host;
 }
@@ -314,8 +320,8 @@ BcmHost* BcmHostTable::derefBcmHost(
 }
 
 BcmEcmpHost* BcmHostTable::derefBcmEcmpHost(
-    opennsl_vrf_t vrf, const RouteForwardNexthops& fwd) noexcept {
-  return derefBcmHost(&ecmpHosts_, vrf, fwd);
+    opennsl_vrf_t vrf, const RouteForwardNexthopGroup& fwd) noexcept {
+  return derefBcmHost(&ecmpHosts_, vrf, fwd.id());
 }
 
 BcmEgressBase* BcmHostTable::incEgressReference(opennsl_if_t egressId) {
@@ -473,7 +479,7 @@ folly::dynamic BcmEcmpHost::toFollyDynamic() const {
   folly::dynamic ecmpHost = folly::dynamic::object;
   ecmpHost[kVrf] = vrf_;
   std::vector<folly::dynamic> nhops;
-  for (auto& nhop: fwd_) {
+  for (auto& nhop: fwd_->nexthops()) {
     nhops.emplace_back(nhop.toFollyDynamic());
   }
   ecmpHost[kNextHops] = std::move(nhops);
@@ -103,7 +103,7 @@ class BcmHost {
 class BcmEcmpHost {
  public:
   BcmEcmpHost(const BcmSwitch* hw, opennsl_vrf_t vrf,
-              const RouteForwardNexthops& fwd);
+              std::shared_ptr<const RouteForwardNexthopGroup> fwd);
   virtual ~BcmEcmpHost();
   opennsl_if_t getEgressId() const {
     return egressId_;
@@ -127,7 +127,9 @@ class BcmEcmpHost {
    */
   opennsl_if_t egressId_{BcmEgressBase::INVALID};
   opennsl_if_t ecmpEgressId_{BcmEgressBase::INVALID};
-  RouteForwardNexthops fwd_;
+  // Holding the group keeps its ID, which is our key in the host table,
+  // from being reused
+  std::shared_ptr<const RouteForwardNexthopGroup> fwd_;
 };
 
 class BcmHostTable {
@@ -137,12 +139,12 @@ class BcmHostTable {
   // throw an exception if not found
   BcmHost* getBcmHost(opennsl_vrf_t vrf, const folly::IPAddress& addr) const;
   BcmEcmpHost* getBcmEcmpHost(
-      opennsl_vrf_t vrf, const RouteForwardNexthops& fwd) const;
+      opennsl_vrf_t vrf, const RouteForwardNexthopGroup& fwd) const;
   // return nullptr if not found
   BcmHost* getBcmHostIf(
       opennsl_vrf_t vrf, const folly::IPAddress& addr) const;
   BcmEcmpHost* getBcmEcmpHostIf(
-      opennsl_vrf_t vrf, const RouteForwardNexthops&) const;
+      opennsl_vrf_t vrf, const RouteForwardNexthopGroup&) const;
   /*
    * The following functions will modify the object. They rely on the global
    * HW update lock in BcmSwitch::lock_ for the protection.
@@ -164,7 +166,8 @@ class BcmHostTable {
   BcmHost* incRefOrCreateBcmHost(
       opennsl_vrf_t vrf, const folly::IPAddress& addr, opennsl_if_t egressId);
   BcmEcmpHost* incRefOrCreateBcmEcmpHost(
-      opennsl_vrf_t vrf, const RouteForwardNexthops& fwd);
+      opennsl_vrf_t vrf,
+      const std::shared_ptr<const RouteForwardNexthopGroup>& fwd);
 
   /**
    * Decrease an existing BcmHost/BcmEcmpHost entry's reference counter by 1.
@@ -179,7 +182,7 @@ class BcmHostTable {
   BcmHost* derefBcmHost(
       opennsl_vrf_t vrf, const folly::IPAddress& addr) noexcept;
   BcmEcmpHost* derefBcmEcmpHost(opennsl_vrf_t vrf,
-                                const RouteForwardNexthops& fwd) noexcept;
+                                const RouteForwardNexthopGroup& fwd) noexcept;
   /*
    * APIs to manage egress objects. Multiple host entries can point
    * to a egress object. Lifetime of these egress objects is thus
@@ -272,7 +275,9 @@ class BcmHostTable {
 
   typedef std::pair<opennsl_vrf_t, folly::IPAddress> Key;
   HostMap<Key, BcmHost> hosts_;
-  typedef std::pair<opennsl_vrf_t, RouteForwardNexthops> EcmpKey;
+  // Nexthop groups are interned, so the group ID identifies the nexthops
+  // without having to compare them
+  typedef std::pair<opennsl_vrf_t, RouteForwardNexthopGroup::ID> EcmpKey;
   HostMap<EcmpKey, BcmEcmpHost> ecmpHosts_;
 
   template<typename KeyT, typename HostT, typename... Args>
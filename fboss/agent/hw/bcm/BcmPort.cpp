@@ -31,39 +31,11 @@ extern "C" {
 #include <opennsl/stat.h>
 }
 
-using std::chrono::duration_cast;
-using std::chrono::seconds;
-using std::chrono::system_clock;
 using std::string;
 using std::shared_ptr;
 
 namespace facebook { namespace fboss {
 
-static const std::vector<opennsl_stat_val_t> kInPktLengthStats = {
-  snmpOpenNSLReceivedPkts64Octets,
-  snmpOpenNSLReceivedPkts65to127Octets,
-  snmpOpenNSLReceivedPkts128to255Octets,
-  snmpOpenNSLReceivedPkts256to511Octets,
-  snmpOpenNSLReceivedPkts512to1023Octets,
-  snmpOpenNSLReceivedPkts1024to1518Octets,
-  snmpOpenNSLReceivedPkts1519to2047Octets,
-  snmpOpenNSLReceivedPkts2048to4095Octets,
-  snmpOpenNSLReceivedPkts4095to9216Octets,
-  snmpOpenNSLReceivedPkts9217to16383Octets,
-};
-static const std::vector<opennsl_stat_val_t> kOutPktLengthStats = {
-  snmpOpenNSLTransmittedPkts64Octets,
-  snmpOpenNSLTransmittedPkts65to127Octets,
-  snmpOpenNSLTransmittedPkts128to255Octets,
-  snmpOpenNSLTransmittedPkts256to511Octets,
-  snmpOpenNSLTransmittedPkts512to1023Octets,
-  snmpOpenNSLTransmittedPkts1024to1518Octets,
-  snmpOpenNSLTransmittedPkts1519to2047Octets,
-  snmpOpenNSLTransmittedPkts2048to4095Octets,
-  snmpOpenNSLTransmittedPkts4095to9216Octets,
-  snmpOpenNSLTransmittedPkts9217to16383Octets,
-};
-
 BcmPort::BcmPort(BcmSwitch* hw, opennsl_port_t port,
                  BcmPlatformPort* platformPort)
     : hw_(hw),
@@ -82,7 +54,8 @@ BcmPort::BcmPort(BcmSwitch* hw, opennsl_port_t port,
   outQueueLen_ = statMap->getLockAndStatItem(statName("out_queue_length"),
                                              &expType);
   auto histMap = fbData->getHistogramMap();
-  stats::ExportedHistogram pktLenHist(1, 0, kInPktLengthStats.size());
+  stats::ExportedHistogram pktLenHist(1, 0,
+                                     PortStatsSnapshot::kNumPktLengthBuckets);
   inPktLengths_ = histMap->getOrCreateUnlocked(statName("in_pkt_lengths"),
                                                &pktLenHist);
   outPktLengths_ = histMap->getOrCreateUnlocked(statName("out_pkt_lengths"),
@@ -164,6 +137,8 @@ void BcmPort::disable(const std::shared_ptr<Port>& swPort) {
 
   rv = opennsl_port_enable_set(unit_, port_, false);
   bcmCheckError(rv, "failed to disable port ", swPort->getID());
+  // With linkscan off we won't hear about the link going down
+  linkUp_.store(false, std::memory_order_relaxed);
 }
 
 bool BcmPort::isEnabled() {
@@ -364,6 +339,7 @@ std::shared_ptr<Port> BcmPort::getSwitchStatePortIf(
 }
 
 void BcmPort::setPortStatus(bool up) {
+  linkUp_.store(up, std::memory_order_relaxed);
   int enabled = 1;
   int rv = opennsl_port_enable_get(unit_, port_, &enabled);
   // We ignore the return value.  If we fail to get the port status
@@ -382,84 +358,54 @@ std::string BcmPort::statName(folly::StringPiece name) const {
   return folly::to<string>("port", platformPort_->getPortID(), ".", name);
 }
 
-void BcmPort::updateStats() {
-  // TODO: It would be nicer to use a monotonic clock, but unfortunately
-  // the ServiceData code currently expects everyone to use system time.
-  auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
-
-  updateStat(now, &inBytes_, opennsl_spl_snmpIfHCInOctets);
-  updateStat(now, &inUnicastPkts_, opennsl_spl_snmpIfHCInUcastPkts);
-  updateStat(now, &inMulticastPkts_, opennsl_spl_snmpIfHCInMulticastPkts);
-  updateStat(now, &inBroadcastPkts_, opennsl_spl_snmpIfHCInBroadcastPkts);
-  updateStat(now, &inDiscards_, opennsl_spl_snmpIfInDiscards);
-  updateStat(now, &inErrors_, opennsl_spl_snmpIfInErrors);
-
-  updateStat(now, &outBytes_, opennsl_spl_snmpIfHCOutOctets);
-  updateStat(now, &outUnicastPkts_, opennsl_spl_snmpIfHCOutUcastPkts);
-  updateStat(now, &outMulticastPkts_, opennsl_spl_snmpIfHCOutMulticastPkts);
-  updateStat(now, &outBroadcastPkts_, opennsl_spl_snmpIfHCOutBroadcastPckts);
-  updateStat(now, &outDiscards_, opennsl_spl_snmpIfOutDiscards);
-  updateStat(now, &outErrors_, opennsl_spl_snmpIfOutErrors);
+void BcmPort::updateStats(std::chrono::seconds now,
+                          const PortStatsSnapshot::Port* stats) {
+  if (stats && stats->fresh) {
+    const auto& counts = stats->counts;
+    inBytes_.updateValue(now, counts[PortStatsSnapshot::IN_BYTES]);
+    inUnicastPkts_.updateValue(now, counts[PortStatsSnapshot::IN_UNICAST_PKTS]);
+    inMulticastPkts_.updateValue(
+        now, counts[PortStatsSnapshot::IN_MULTICAST_PKTS]);
+    inBroadcastPkts_.updateValue(
+        now, counts[PortStatsSnapshot::IN_BROADCAST_PKTS]);
+    inDiscards_.updateValue(now, counts[PortStatsSnapshot::IN_DISCARDS]);
+    inErrors_.updateValue(now, counts[PortStatsSnapshot::IN_ERRORS]);
+
+    outBytes_.updateValue(now, counts[PortStatsSnapshot::OUT_BYTES]);
+    outUnicastPkts_.updateValue(
+        now, counts[PortStatsSnapshot::OUT_UNICAST_PKTS]);
+    outMulticastPkts_.updateValue(
+        now, counts[PortStatsSnapshot::OUT_MULTICAST_PKTS]);
+    outBroadcastPkts_.updateValue(
+        now, counts[PortStatsSnapshot::OUT_BROADCAST_PKTS]);
+    outDiscards_.updateValue(now, counts[PortStatsSnapshot::OUT_DISCARDS]);
+    outErrors_.updateValue(now, counts[PortStatsSnapshot::OUT_ERRORS]);
+
+    // Update the packet length histograms
+    updatePktLenHist(now, &inPktLengths_, stats->inPktLengths);
+    updatePktLenHist(now, &outPktLengths_, stats->outPktLengths);
+  }
 
   setAdditionalStats(now);
 
   // Update the queue length stat
-  uint32_t qlength;
-  auto ret = opennsl_port_queued_count_get(unit_, port_, &qlength);
-  if (OPENNSL_FAILURE(ret)) {
-    LOG(ERROR) << "Failed to get queue length for port " << port_
-               << " :" << opennsl_errmsg(ret);
-  } else {
+  if (stats && stats->queueLength >= 0) {
     SpinLockHolder guard(outQueueLen_.first.get());
-    outQueueLen_.second->addValue(now, qlength);
+    outQueueLen_.second->addValue(now, stats->queueLength);
     // TODO: outQueueLen_ only exports the average queue length over the last
     // 60 seconds, 10 minutes, etc.
     // We should also export the current value.  We could use a simple counter
     // or a dynamic counter for this.
   }
-
-  // Update the packet length histograms
-  updatePktLenHist(now, &inPktLengths_, kInPktLengthStats);
-  updatePktLenHist(now, &outPktLengths_, kOutPktLengthStats);
-};
-
-void BcmPort::updateStat(std::chrono::seconds now,
-                         stats::MonotonicCounter* stat,
-                         opennsl_stat_val_t type) {
-  // Use the non-sync API to just get the values accumulated in software.
-  // The Broadom SDK's counter thread syncs the HW counters to software every
-  // 500000us (defined in config.bcm).
-  uint64_t value;
-  auto ret = opennsl_stat_get(unit_, port_, type, &value);
-  if (OPENNSL_FAILURE(ret)) {
-    LOG(ERROR) << "Failed to get stat " << type << " for port " << port_
-               << " :" << opennsl_errmsg(ret);
-    return;
-  }
-  stat->updateValue(now, value);
 }
 
+template<size_t N>
 void BcmPort::updatePktLenHist(
     std::chrono::seconds now,
     stats::ExportedHistogramMap::LockAndHistogram* hist,
-    const std::vector<opennsl_stat_val_t>& stats) {
-  // Get the counter values
-  uint64_t counters[10];
-  // opennsl_stat_multi_get() unfortunately doesn't correctly const qualify
-  // it's stats arguments right now.
-  opennsl_stat_val_t* statsArg =
-      const_cast<opennsl_stat_val_t*>(&stats.front());
-  auto ret = opennsl_stat_multi_get(unit_, port_,
-                                stats.size(), statsArg, counters);
-  if (OPENNSL_FAILURE(ret)) {
-    LOG(ERROR) << "Failed to get packet length stats for port " << port_
-               << " :" << opennsl_errmsg(ret);
-    return;
-  }
-
-  // Update the histogram
+    const std::array<uint64_t, N>& counters) {
   SpinLockHolder guard(hist->first.get());
-  for (int idx = 0; idx < stats.size(); ++idx) {
+  for (size_t idx = 0; idx < N; ++idx) {
     hist->second->addValue(now, idx, counters[idx]);
   }
 }
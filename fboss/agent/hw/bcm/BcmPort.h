@@ -17,9 +17,11 @@ extern "C" {
 
 #include "common/stats/MonotonicCounter.h"
 #include "common/stats/ExportedHistogram.h"
+#include "fboss/agent/PortStatsSnapshot.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/gen-cpp/switch_config_types.h"
 
+#include <atomic>
 #include <mutex>
 
 namespace facebook { namespace fboss {
@@ -51,6 +53,15 @@ class BcmPort {
   void program(const std::shared_ptr<Port>& swPort);
   bool isEnabled();
 
+  /*
+   * Whether the link is up, as last reported by linkscan.  This does not
+   * query the SDK, so it is cheap enough to call for every port on every
+   * packet we send.
+   */
+  bool isUp() const {
+    return linkUp_.load(std::memory_order_relaxed);
+  }
+
   /*
    * Getters.
    */
@@ -93,9 +104,11 @@ class BcmPort {
   void setSpeed(const std::shared_ptr<Port>& swPort);
 
   /*
-   * Update this port's statistics.
+   * Export this port's statistics from the latest collection cycle.  stats
+   * is null if the port was not collected.
    */
-  void updateStats();
+  void updateStats(std::chrono::seconds now,
+                   const PortStatsSnapshot::Port* stats);
 
  private:
   class MonotonicCounter : public stats::MonotonicCounter {
@@ -112,12 +125,10 @@ class BcmPort {
   BcmPort(BcmPort const &) = delete;
   BcmPort& operator=(BcmPort const &) = delete;
 
-  void updateStat(std::chrono::seconds now,
-                  stats::MonotonicCounter* stat,
-                  opennsl_stat_val_t type);
+  template<size_t N>
   void updatePktLenHist(std::chrono::seconds now,
                         stats::ExportedHistogramMap::LockAndHistogram* hist,
-                        const std::vector<opennsl_stat_val_t>& stats);
+                        const std::array<uint64_t, N>& counters);
   std::string statName(folly::StringPiece name) const;
 
   void disablePause();
@@ -141,6 +152,9 @@ class BcmPort {
   // The port group this port is a part of
   BcmPortGroup* portGroup_{nullptr};
 
+  // Set from linkscan, read by BcmSwitch::isPortUp() on other threads
+  std::atomic<bool> linkUp_{false};
+
   MonotonicCounter inBytes_{statName("in_bytes")};
   MonotonicCounter inUnicastPkts_{statName("in_unicast_pkts")};
   MonotonicCounter inMulticastPkts_{statName("in_multicast_pkts")};
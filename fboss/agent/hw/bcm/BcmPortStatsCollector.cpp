@@ -0,0 +1,217 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmPortStatsCollector.h"
+
+#include <algorithm>
+
+#include "common/stats/ServiceData.h"
+#include <glog/logging.h>
+
+extern "C" {
+#include <opennsl/error.h>
+#include <opennsl/port.h>
+}
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::seconds;
+using std::chrono::system_clock;
+using std::shared_ptr;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+// Indexed by PortStatsSnapshot::Counter
+const opennsl_stat_val_t kCounterStats[] = {
+  opennsl_spl_snmpIfHCInOctets,
+  opennsl_spl_snmpIfHCInUcastPkts,
+  opennsl_spl_snmpIfHCInMulticastPkts,
+  opennsl_spl_snmpIfHCInBroadcastPkts,
+  opennsl_spl_snmpIfInDiscards,
+  opennsl_spl_snmpIfInErrors,
+  opennsl_spl_snmpIfHCOutOctets,
+  opennsl_spl_snmpIfHCOutUcastPkts,
+  opennsl_spl_snmpIfHCOutMulticastPkts,
+  opennsl_spl_snmpIfHCOutBroadcastPckts,
+  opennsl_spl_snmpIfOutDiscards,
+  opennsl_spl_snmpIfOutErrors,
+};
+static_assert(sizeof(kCounterStats) / sizeof(kCounterStats[0]) ==
+              PortStatsSnapshot::NUM_COUNTERS,
+              "kCounterStats does not match PortStatsSnapshot::Counter");
+
+const opennsl_stat_val_t kInPktLengthStats[] = {
+  snmpOpenNSLReceivedPkts64Octets,
+  snmpOpenNSLReceivedPkts65to127Octets,
+  snmpOpenNSLReceivedPkts128to255Octets,
+  snmpOpenNSLReceivedPkts256to511Octets,
+  snmpOpenNSLReceivedPkts512to1023Octets,
+  snmpOpenNSLReceivedPkts1024to1518Octets,
+  snmpOpenNSLReceivedPkts1519to2047Octets,
+  snmpOpenNSLReceivedPkts2048to4095Octets,
+  snmpOpenNSLReceivedPkts4095to9216Octets,
+  snmpOpenNSLReceivedPkts9217to16383Octets,
+};
+const opennsl_stat_val_t kOutPktLengthStats[] = {
+  snmpOpenNSLTransmittedPkts64Octets,
+  snmpOpenNSLTransmittedPkts65to127Octets,
+  snmpOpenNSLTransmittedPkts128to255Octets,
+  snmpOpenNSLTransmittedPkts256to511Octets,
+  snmpOpenNSLTransmittedPkts512to1023Octets,
+  snmpOpenNSLTransmittedPkts1024to1518Octets,
+  snmpOpenNSLTransmittedPkts1519to2047Octets,
+  snmpOpenNSLTransmittedPkts2048to4095Octets,
+  snmpOpenNSLTransmittedPkts4095to9216Octets,
+  snmpOpenNSLTransmittedPkts9217to16383Octets,
+};
+static_assert(sizeof(kInPktLengthStats) / sizeof(kInPktLengthStats[0]) ==
+              PortStatsSnapshot::kNumPktLengthBuckets,
+              "wrong number of packet length stats");
+static_assert(sizeof(kOutPktLengthStats) / sizeof(kOutPktLengthStats[0]) ==
+              PortStatsSnapshot::kNumPktLengthBuckets,
+              "wrong number of packet length stats");
+
+const size_t kInPktLengthOffset = PortStatsSnapshot::NUM_COUNTERS;
+const size_t kOutPktLengthOffset =
+  kInPktLengthOffset + PortStatsSnapshot::kNumPktLengthBuckets;
+
+} // unnamed namespace
+
+BcmPortStatsCollector::BcmPortStatsCollector(int unit)
+  : unit_(unit) {
+  statTypes_.insert(statTypes_.end(),
+                    std::begin(kCounterStats), std::end(kCounterStats));
+  statTypes_.insert(statTypes_.end(),
+                    std::begin(kInPktLengthStats),
+                    std::end(kInPktLengthStats));
+  statTypes_.insert(statTypes_.end(),
+                    std::begin(kOutPktLengthStats),
+                    std::end(kOutPktLengthStats));
+  statValues_.resize(statTypes_.size());
+
+  const auto expType = stats::AVG;
+  collectTime_ = fbData->getStatMap()->getLockAndStatItem(
+      "port_stats.collect_us", &expType);
+}
+
+void BcmPortStatsCollector::addPort(opennsl_port_t bcmPort, PortID port) {
+  auto it = std::lower_bound(
+      ports_.begin(), ports_.end(), port,
+      [](const PortEntry& entry, PortID id) { return entry.port < id; });
+  ports_.emplace(it, bcmPort, port);
+}
+
+shared_ptr<const PortStatsSnapshot> BcmPortStatsCollector::collect() {
+  // TODO: It would be nicer to use a monotonic clock, but unfortunately
+  // the ServiceData code currently expects everyone to use system time.
+  auto timestamp = duration_cast<seconds>(
+      system_clock::now().time_since_epoch());
+  auto start = now();
+  auto prev = getSnapshot();
+
+  auto snapshot = std::make_shared<PortStatsSnapshot>();
+  snapshot->timestamp = timestamp;
+  snapshot->generation = ++generation_;
+  snapshot->ports.reserve(ports_.size());
+  for (auto& entry : ports_) {
+    // ports_ is sorted, so each port goes at the end
+    auto it = snapshot->ports.emplace_hint(
+        snapshot->ports.end(), entry.port, PortStatsSnapshot::Port());
+    collectPort(&entry, now(), prev.get(), &it->second);
+  }
+  snapshot->collectionTime = duration_cast<microseconds>(now() - start);
+
+  {
+    SpinLockHolder guard(collectTime_.first.get());
+    collectTime_.second->addValue(timestamp,
+                                  snapshot->collectionTime.count());
+  }
+  VLOG(4) << "collected stats of " << ports_.size() << " ports in "
+          << snapshot->collectionTime.count() << "us";
+
+  shared_ptr<const PortStatsSnapshot> result(std::move(snapshot));
+  std::atomic_store(&snapshot_, result);
+  return result;
+}
+
+void BcmPortStatsCollector::collectPort(PortEntry* entry,
+                                        Clock::time_point now,
+                                        const PortStatsSnapshot* prev,
+                                        PortStatsSnapshot::Port* stats) {
+  // Use the non-sync API to just get the values accumulated in software.
+  // The Broadom SDK's counter thread syncs the HW counters to software every
+  // 500000us (defined in config.bcm).
+  auto ret = statMultiGet(entry->bcmPort, statTypes_.size(),
+                          statTypes_.data(), statValues_.data());
+  if (OPENNSL_FAILURE(ret)) {
+    LOG(ERROR) << "Failed to get stats for port " << entry->bcmPort
+               << " :" << opennsl_errmsg(ret);
+    // Keep reporting the last counters we read, rather than dropping the
+    // port from the snapshot
+    auto last = prev ? prev->getPortIf(entry->port) : nullptr;
+    if (last) {
+      *stats = *last;
+      stats->rates.fill(0);
+    }
+    stats->fresh = false;
+  } else {
+    double elapsed = 0;
+    if (entry->read) {
+      elapsed = duration<double>(now - entry->lastRead).count();
+    }
+    for (size_t idx = 0; idx < PortStatsSnapshot::NUM_COUNTERS; ++idx) {
+      auto raw = statValues_[idx];
+      if (entry->read) {
+        auto last = entry->lastRaw[idx];
+        auto delta = raw >= last ? raw - last : raw;
+        entry->counts[idx] += delta;
+        if (elapsed > 0) {
+          stats->rates[idx] = delta / elapsed;
+        }
+      }
+      entry->lastRaw[idx] = raw;
+    }
+    entry->read = true;
+    entry->lastRead = now;
+    stats->counts = entry->counts;
+    std::copy_n(statValues_.begin() + kInPktLengthOffset,
+                PortStatsSnapshot::kNumPktLengthBuckets,
+                stats->inPktLengths.begin());
+    std::copy_n(statValues_.begin() + kOutPktLengthOffset,
+                PortStatsSnapshot::kNumPktLengthBuckets,
+                stats->outPktLengths.begin());
+    stats->fresh = true;
+  }
+
+  uint32_t qlength;
+  ret = queuedCountGet(entry->bcmPort, &qlength);
+  if (OPENNSL_FAILURE(ret)) {
+    LOG(ERROR) << "Failed to get queue length for port " << entry->bcmPort
+               << " :" << opennsl_errmsg(ret);
+    stats->queueLength = -1;
+  } else {
+    stats->queueLength = qlength;
+  }
+}
+
+int BcmPortStatsCollector::statMultiGet(opennsl_port_t port, int nstat,
+                                        opennsl_stat_val_t* stats,
+                                        uint64_t* values) {
+  return opennsl_stat_multi_get(unit_, port, nstat, stats, values);
+}
+
+int BcmPortStatsCollector::queuedCountGet(opennsl_port_t port,
+                                          uint32_t* count) {
+  return opennsl_port_queued_count_get(unit_, port, count);
+}
+
+}} // facebook::fboss
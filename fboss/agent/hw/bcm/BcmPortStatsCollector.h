@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+extern "C" {
+#include <opennsl/types.h>
+#include <opennsl/stat.h>
+}
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "common/stats/ExportedTimeseries.h"
+#include "fboss/agent/PortStatsSnapshot.h"
+#include "fboss/agent/types.h"
+
+namespace facebook { namespace fboss {
+
+/*
+ * BcmPortStatsCollector reads the counters of all of the ports in one pass,
+ * and publishes them as an immutable PortStatsSnapshot.
+ *
+ * Each port's SNMP and packet length counters are fetched with a single
+ * opennsl_stat_multi_get() call, plus one call for the queue length.  (The
+ * SDK has no call that reads more than one port at a time.)  Counts since
+ * start and rates are computed once per cycle here, so that neither the
+ * fb303 export nor the thrift handlers need to go back to the SDK.
+ *
+ * collect() must only be called from one thread at a time, normally the
+ * stats thread.  getSnapshot() may be called from any thread.
+ */
+class BcmPortStatsCollector {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit BcmPortStatsCollector(int unit);
+  virtual ~BcmPortStatsCollector() {}
+
+  /*
+   * Add a port to collect the counters of.  All of the ports should be added
+   * before the first call to collect().
+   */
+  void addPort(opennsl_port_t bcmPort, PortID port);
+
+  /*
+   * Read the counters of all of the ports, and publish and return the new
+   * snapshot.
+   */
+  std::shared_ptr<const PortStatsSnapshot> collect();
+
+  /*
+   * Get the latest snapshot, or null if collect() has not been called yet.
+   *
+   * This only copies a shared_ptr, it never waits for a collection cycle.
+   */
+  std::shared_ptr<const PortStatsSnapshot> getSnapshot() const {
+    return std::atomic_load(&snapshot_);
+  }
+
+ protected:
+  /*
+   * The SDK calls made by collect().  Tests override these to feed in
+   * synthetic counters.
+   */
+  virtual int statMultiGet(opennsl_port_t port, int nstat,
+                           opennsl_stat_val_t* stats, uint64_t* values);
+  virtual int queuedCountGet(opennsl_port_t port, uint32_t* count);
+  virtual Clock::time_point now() const {
+    return Clock::now();
+  }
+
+ private:
+  struct PortEntry {
+    PortEntry(opennsl_port_t bcmPort, PortID port)
+      : bcmPort(bcmPort),
+        port(port) {}
+
+    opennsl_port_t bcmPort;
+    PortID port;
+    // The state of the last successful read
+    bool read{false};
+    Clock::time_point lastRead;
+    std::array<uint64_t, PortStatsSnapshot::NUM_COUNTERS> lastRaw{{}};
+    std::array<uint64_t, PortStatsSnapshot::NUM_COUNTERS> counts{{}};
+  };
+
+  // Forbidden copy constructor and assignment operator
+  BcmPortStatsCollector(BcmPortStatsCollector const &) = delete;
+  BcmPortStatsCollector& operator=(BcmPortStatsCollector const &) = delete;
+
+  void collectPort(PortEntry* entry, Clock::time_point now,
+                   const PortStatsSnapshot* prev,
+                   PortStatsSnapshot::Port* stats);
+
+  const int unit_;
+  // Sorted by PortID, so the snapshot's map can be built in order
+  std::vector<PortEntry> ports_;
+  // The stats passed to opennsl_stat_multi_get(), the counters first
+  std::vector<opennsl_stat_val_t> statTypes_;
+  std::vector<uint64_t> statValues_;
+  uint64_t generation_{0};
+  stats::ExportedStatMap::LockAndStatItem collectTime_;
+  std::shared_ptr<const PortStatsSnapshot> snapshot_;
+};
+
+}} // facebook::fboss
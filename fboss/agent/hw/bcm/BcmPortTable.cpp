@@ -48,6 +48,7 @@ void BcmPortTable::initPorts(const opennsl_port_config_t* portConfig,
   // 128 ports, if the platform only defines 32 ports we will only create 32
   // BcmPort objects.
   auto platformPorts = hw_->getPlatform()->initPorts();
+  statsCollector_ = make_unique<BcmPortStatsCollector>(hw_->getUnit());
   for (const auto& entry : platformPorts) {
     opennsl_port_t bcmPortNum = entry.first;
     BcmPlatformPort* platPort = entry.second;
@@ -66,6 +67,7 @@ void BcmPortTable::initPorts(const opennsl_port_config_t* portConfig,
     auto bcmPort = make_unique<BcmPort>(hw_, bcmPortNum, platPort);
     platPort->setBcmPort(bcmPort.get());
     bcmPort->init(warmBoot);
+    statsCollector_->addPort(bcmPortNum, fbossPortID);
 
     fbossPhysicalPorts_.emplace(fbossPortID, bcmPort.get());
     bcmPhysicalPorts_.emplace(bcmPortNum, std::move(bcmPort));
@@ -112,10 +114,11 @@ void BcmPortTable::setPortStatus(opennsl_port_t id, int status) {
 }
 
 void BcmPortTable::updatePortStats() {
- for (const auto& entry : bcmPhysicalPorts_) {
-   BcmPort* bcmPort = entry.second.get();
-   bcmPort->updateStats();
- }
+  auto snapshot = statsCollector_->collect();
+  for (const auto& entry : fbossPhysicalPorts_) {
+    entry.second->updateStats(snapshot->timestamp,
+                              snapshot->getPortIf(entry.first));
+  }
 }
 
 }} // namespace facebook::fboss
@@ -16,6 +16,7 @@ extern "C" {
 
 #include "fboss/agent/types.h"
 #include "fboss/agent/hw/bcm/BcmPort.h"
+#include "fboss/agent/hw/bcm/BcmPortStatsCollector.h"
 
 #include <mutex>
 #include <boost/container/flat_map.hpp>
@@ -62,10 +63,18 @@ class BcmPortTable {
   void setPortStatus(opennsl_port_t id, int status);
 
   /*
-   * Update all ports' statistics.
+   * Collect all ports' statistics, and export them.
    */
   void updatePortStats();
 
+  /*
+   * Get the statistics from the latest call to updatePortStats(), or null if
+   * it has not been called yet.  This may be called from any thread.
+   */
+  std::shared_ptr<const PortStatsSnapshot> getPortStatsSnapshot() const {
+    return statsCollector_ ? statsCollector_->getSnapshot() : nullptr;
+  }
+
   bool portExists(PortID port) const {
     return getBcmPortIf(port) != nullptr;
   }
@@ -103,6 +112,9 @@ class BcmPortTable {
   // outside of the BcmPort objects. This is mainly here to keep a simple
   // ownership model for the port group objects
   BcmPortGroupList bcmPortGroups_;
+
+  // Created by initPorts()
+  std::unique_ptr<BcmPortStatsCollector> statsCollector_;
 };
 
 }} // namespace facebook::fboss
@@ -65,8 +65,9 @@ void BcmRoute::program(const RouteForwardInfo& fwd) {
   }
 
   // function to clean up the host reference
-  auto cleanupHost = [&] (const RouteForwardNexthops& nhopsClean) noexcept {
-    if (nhopsClean.size()) {
+  auto cleanupHost = [&] (const RouteForwardNexthopGroup& nhopsClean)
+      noexcept {
+    if (nhopsClean.nexthops().size()) {
       hw_->writableHostTable()->derefBcmEcmpHost(vrf_, nhopsClean);
     }
   };
@@ -81,8 +82,8 @@ void BcmRoute::program(const RouteForwardInfo& fwd) {
   } else {
     CHECK(action == RouteForwardAction::NEXTHOPS);
     // need to get an entry from the host table for the forward info
-    const RouteForwardNexthops& nhops = fwd.getNexthops();
-    CHECK_GT(nhops.size(), 0);
+    const auto& nhops = fwd.getNexthopGroup();
+    CHECK_GT(nhops->nexthops().size(), 0);
     auto host = hw_->writableHostTable()->incRefOrCreateBcmEcmpHost(
         vrf_, nhops);
     egressId = host->getEgressId();
@@ -93,7 +94,7 @@ void BcmRoute::program(const RouteForwardInfo& fwd) {
   // route table or host table (if this is a host route and use of
   // host table for host routes is allowed by the chip).
   SCOPE_FAIL {
-    cleanupHost(fwd.getNexthops());
+    cleanupHost(*fwd.getNexthopGroup());
   };
   if (canUseHostTable()) {
     if (added_) {
@@ -109,7 +110,7 @@ void BcmRoute::program(const RouteForwardInfo& fwd) {
   }
   if (added_) {
     // the route was added before, need to free the old nexthop(s)
-    cleanupHost(fwd_.getNexthops());
+    cleanupHost(*fwd_.getNexthopGroup());
   }
   fwd_ = fwd;
   // new nexthop has been stored in fwd_. From now on, it is up to
@@ -210,9 +211,9 @@ BcmRoute::~BcmRoute() {
     }
   }
   // decrease reference counter of the host entry for next hops
-  const auto& nhops = fwd_.getNexthops();
-  if (nhops.size()) {
-    hw_->writableHostTable()->derefBcmEcmpHost(vrf_, nhops);
+  const auto& nhops = fwd_.getNexthopGroup();
+  if (nhops->nexthops().size()) {
+    hw_->writableHostTable()->derefBcmEcmpHost(vrf_, *nhops);
   }
 }
 
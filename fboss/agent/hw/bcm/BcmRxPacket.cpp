@@ -9,10 +9,19 @@
  */
 #include "fboss/agent/hw/bcm/BcmRxPacket.h"
 
+#include <algorithm>
+#include <vector>
+
+#include <folly/SpinLock.h>
+#include <gflags/gflags.h>
+
 extern "C" {
 #include <opennsl/rx.h>
 }
 
+DEFINE_int32(bcm_rx_pkt_pool_size, 1024,
+             "Number of freed BcmRxPacket objects kept around for reuse");
+
 using folly::IOBuf;
 
 namespace {
@@ -22,6 +31,21 @@ void freeRxBuf(void *ptr, void* arg) {
   opennsl_rx_free(unit, ptr);
 }
 
+struct RxPacketPool {
+  RxPacketPool() {
+    chunks.reserve(std::max(FLAGS_bcm_rx_pkt_pool_size, 0));
+  }
+
+  folly::SpinLock lock;
+  std::vector<void*> chunks;
+};
+
+RxPacketPool* rxPacketPool() {
+  // Intentionally leaked, since packets may still be freed during shutdown
+  static auto pool = new RxPacketPool();
+  return pool;
+}
+
 }
 
 namespace facebook { namespace fboss {
@@ -61,4 +85,31 @@ BcmRxPacket::~BcmRxPacket() {
   // to free the packet data
 }
 
+void* BcmRxPacket::operator new(size_t size) {
+  if (size == sizeof(BcmRxPacket)) {
+    auto pool = rxPacketPool();
+    folly::SpinLockGuard guard(pool->lock);
+    if (!pool->chunks.empty()) {
+      auto ptr = pool->chunks.back();
+      pool->chunks.pop_back();
+      return ptr;
+    }
+  }
+  return ::operator new(size);
+}
+
+void BcmRxPacket::operator delete(void* ptr, size_t size) {
+  if (size == sizeof(BcmRxPacket)) {
+    auto pool = rxPacketPool();
+    folly::SpinLockGuard guard(pool->lock);
+    // Never grow past the capacity reserved up front, so returning a
+    // packet to the pool does not allocate either
+    if (pool->chunks.size() < pool->chunks.capacity()) {
+      pool->chunks.push_back(ptr);
+      return;
+    }
+  }
+  ::operator delete(ptr);
+}
+
 }} // facebook::fboss
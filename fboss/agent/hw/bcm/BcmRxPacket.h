@@ -17,6 +17,12 @@ extern "C" {
 
 namespace facebook { namespace fboss {
 
+/*
+ * BcmRxPacket objects are allocated from a free list of recycled packet
+ * objects rather than with the global operator new, so that a steady stream
+ * of trapped packets does not hit malloc for each one.  Up to
+ * --bcm_rx_pkt_pool_size freed objects are kept for reuse.
+ */
 class BcmRxPacket : public RxPacket {
  public:
   /*
@@ -29,6 +35,9 @@ class BcmRxPacket : public RxPacket {
 
   ~BcmRxPacket() override;
 
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
  private:
   int unit_{-1};
 };
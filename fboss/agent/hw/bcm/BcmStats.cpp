@@ -28,6 +28,10 @@ BcmStats::BcmStats(ThreadLocalStatsMap *map)
                   SUM, RATE),
       txPktFree_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.freed",
                  SUM, RATE),
+      txPktPoolAlloc_(map, SwitchStats::kCounterPrefix +
+          "bcm.tx.pkt.pool.allocated", SUM, RATE),
+      txPktPoolExhausted_(map, SwitchStats::kCounterPrefix +
+          "bcm.tx.pkt.pool.exhausted", SUM, RATE),
       txSent_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.sent",
               SUM, RATE),
       txSentDone_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.sent.done",
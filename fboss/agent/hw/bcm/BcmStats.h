@@ -38,6 +38,12 @@ class BcmStats {
   void txPktFree() {
     txPktFree_.addValue(1);
   }
+  void txPktPoolAlloc() {
+    txPktPoolAlloc_.addValue(1);
+  }
+  void txPktPoolExhausted() {
+    txPktPoolExhausted_.addValue(1);
+  }
   void txSent() {
     txSent_.addValue(1);
   }
@@ -71,6 +77,9 @@ class BcmStats {
   // Total number of Tx packet allocated right now
   TLTimeseries txPktAlloc_;
   TLTimeseries txPktFree_;
+  // Tx packets served from the buffer pool, and those that found it empty
+  TLTimeseries txPktPoolAlloc_;
+  TLTimeseries txPktPoolExhausted_;
   TLTimeseries txSent_;
   TLTimeseries txSentDone_;
   // Errors in sending packets
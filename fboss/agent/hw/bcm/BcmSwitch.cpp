@@ -182,6 +182,9 @@ unique_ptr<BcmUnit> BcmSwitch::releaseUnit() {
   intfTable_.reset();
   toCPUEgress_.reset();
   portTable_.reset();
+  // Packets still queued in HW free their buffers from the TX completion
+  // callback once the pool is released, so only pooled buffers go here.
+  BcmTxPacket::releasePool(unit_);
 
   unit_ = -1;
   unitObject_->setCookie(nullptr);
@@ -346,9 +349,10 @@ void BcmSwitch::clearWarmBootCache() {
 }
 
 bool BcmSwitch::isPortUp(PortID port) const {
-  int linkStatus;
-  opennsl_port_link_status_get(getUnit(), port, &linkStatus);
-  return linkStatus == OPENNSL_PORT_LINK_STATUS_UP;
+  // Use the status cached from linkscan rather than asking the SDK, since
+  // callers such as LldpManager check every port periodically.
+  auto bcmPort = portTable_->getBcmPortIf(port);
+  return bcmPort && bcmPort->isUp();
 }
 
 std::shared_ptr<SwitchState> BcmSwitch::getColdBootSwitchState() const {
@@ -468,6 +472,7 @@ BcmSwitch::init(Callback* callback) {
   dropDhcpPackets();
   dropIPv6RAs();
   configureRxRateLimiting();
+  BcmTxPacket::preallocatePool(unit_);
 
   // enable IPv4 and IPv6 on CPU port
   opennsl_port_t idx;
@@ -1071,6 +1076,28 @@ bool BcmSwitch::sendPacketOutOfPort(unique_ptr<TxPacket> pkt,
   return OPENNSL_SUCCESS(rv);
 }
 
+size_t BcmSwitch::sendPacketsSwitched(TxPackets pkts) noexcept {
+  std::vector<unique_ptr<BcmTxPacket>> bcmPkts;
+  bcmPkts.reserve(pkts.size());
+  for (auto& pkt : pkts) {
+    bcmPkts.emplace_back(
+        boost::polymorphic_downcast<BcmTxPacket*>(pkt.release()));
+  }
+  return BcmTxPacket::sendAsync(std::move(bcmPkts));
+}
+
+size_t BcmSwitch::sendPacketsOutOfPorts(PortTxPackets pkts) noexcept {
+  std::vector<unique_ptr<BcmTxPacket>> bcmPkts;
+  bcmPkts.reserve(pkts.size());
+  for (auto& pktAndPort : pkts) {
+    bcmPkts.emplace_back(
+        boost::polymorphic_downcast<BcmTxPacket*>(pktAndPort.first.release()));
+    bcmPkts.back()->setDestModPort(
+        getPortTable()->getBcmPortId(pktAndPort.second));
+  }
+  return BcmTxPacket::sendAsync(std::move(bcmPkts));
+}
+
 void BcmSwitch::updateStats(SwitchStats *switchStats) {
   // Update thread-local switch statistics.
   updateThreadLocalSwitchStats(switchStats);
@@ -1098,6 +1125,11 @@ void BcmSwitch::updateGlobalStats() {
   portTable_->updatePortStats();
 }
 
+std::shared_ptr<const PortStatsSnapshot>
+BcmSwitch::getPortStatsSnapshot() const {
+  return portTable_->getPortStatsSnapshot();
+}
+
 opennsl_if_t BcmSwitch::getDropEgressId() const {
   return BcmEgress::getDropEgressId();
 }
@@ -108,6 +108,8 @@ class BcmSwitch : public HwSwitch {
   bool sendPacketSwitched(std::unique_ptr<TxPacket> pkt) noexcept override;
   bool sendPacketOutOfPort(std::unique_ptr<TxPacket> pkt,
                            PortID portID) noexcept override;
+  size_t sendPacketsSwitched(TxPackets pkts) noexcept override;
+  size_t sendPacketsOutOfPorts(PortTxPackets pkts) noexcept override;
 
   bool isRxThreadRunning();
 
@@ -185,6 +187,9 @@ class BcmSwitch : public HwSwitch {
    */
   void updateStats(SwitchStats* switchStats) override;
 
+  std::shared_ptr<const PortStatsSnapshot>
+  getPortStatsSnapshot() const override;
+
   /*
    * Get Broadcom-specific samplers.
    *
@@ -12,10 +12,20 @@
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmStats.h"
 
+#include <algorithm>
+
+#include <boost/container/flat_set.hpp>
+#include <folly/SpinLock.h>
+#include <gflags/gflags.h>
+
 extern "C" {
 #include <opennsl/tx.h>
 }
 
+DEFINE_int32(bcm_tx_pkt_pool_size, 256,
+             "Number of TX packet buffers kept around for reuse. 0 disables "
+             "the TX buffer pool");
+
 using folly::IOBuf;
 using std::unique_ptr;
 
@@ -23,6 +33,78 @@ namespace {
 
 using namespace facebook::fboss;
 
+constexpr auto kTxPktFlags = OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER;
+
+/*
+ * Recycled kPooledSize packet buffers, shared by all units.
+ *
+ * Buffers of packets still in flight come back through give() after their
+ * unit's pool was released, so the pool remembers which units are released
+ * and refuses their buffers.
+ */
+class TxBufferPool {
+ public:
+  static TxBufferPool* get() {
+    static TxBufferPool pool;
+    return &pool;
+  }
+
+  // Returns nullptr when the pool is empty
+  opennsl_pkt_t* take(int unit) {
+    folly::SpinLockGuard guard(lock_);
+    for (auto it = pkts_.rbegin(); it != pkts_.rend(); ++it) {
+      if ((*it)->unit == unit) {
+        auto pkt = *it;
+        pkts_.erase(std::next(it).base());
+        return pkt;
+      }
+    }
+    return nullptr;
+  }
+
+  // Returns false if the pool is full or pkt's unit was released, in which
+  // case the caller still owns pkt
+  bool give(opennsl_pkt_t* pkt) {
+    folly::SpinLockGuard guard(lock_);
+    if (pkts_.size() >= size_t(std::max(FLAGS_bcm_tx_pkt_pool_size, 0)) ||
+        releasedUnits_.count(pkt->unit)) {
+      return false;
+    }
+    pkts_.push_back(pkt);
+    return true;
+  }
+
+  size_t size() const {
+    folly::SpinLockGuard guard(lock_);
+    return pkts_.size();
+  }
+
+  // Start accepting buffers for the unit again
+  void acquire(int unit) {
+    folly::SpinLockGuard guard(lock_);
+    releasedUnits_.erase(unit);
+  }
+
+  // Remove all of the unit's buffers, and refuse any given back later
+  std::vector<opennsl_pkt_t*> release(int unit) {
+    std::vector<opennsl_pkt_t*> pkts;
+    folly::SpinLockGuard guard(lock_);
+    releasedUnits_.insert(unit);
+    auto it = std::partition(pkts_.begin(), pkts_.end(),
+                             [unit](opennsl_pkt_t* pkt) {
+                               return pkt->unit != unit;
+                             });
+    pkts.assign(it, pkts_.end());
+    pkts_.erase(it, pkts_.end());
+    return pkts;
+  }
+
+ private:
+  mutable folly::SpinLock lock_;
+  std::vector<opennsl_pkt_t*> pkts_;
+  boost::container::flat_set<int> releasedUnits_;
+};
+
 void freeTxBuf(void *ptr, void* arg) {
   opennsl_pkt_t* pkt = reinterpret_cast<opennsl_pkt_t*>(arg);
   int rv = opennsl_pkt_free(pkt->unit, pkt);
@@ -30,6 +112,13 @@ void freeTxBuf(void *ptr, void* arg) {
   BcmStats::get()->txPktFree();
 }
 
+void freePooledTxBuf(void *ptr, void* arg) {
+  opennsl_pkt_t* pkt = reinterpret_cast<opennsl_pkt_t*>(arg);
+  if (!TxBufferPool::get()->give(pkt)) {
+    freeTxBuf(ptr, arg);
+  }
+}
+
 void txCallback(int unit, opennsl_pkt_t* pkt, void* cookie) {
   // Put the BcmTxPacket back into a unique_ptr.
   // This will delete it when we return.
@@ -52,12 +141,56 @@ namespace facebook { namespace fboss {
 
 BcmTxPacket::BcmTxPacket(int unit, uint32_t size)
     : queued_(std::chrono::time_point<std::chrono::steady_clock>::min()) {
-  int rv = opennsl_pkt_alloc(unit, size,
-                             OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER, &pkt_);
-  bcmLogError(rv, "Failed to allocate packet.");
-  buf_ = IOBuf::takeOwnership(pkt_->pkt_data->data, size,
-                              freeTxBuf, reinterpret_cast<void*>(pkt_));
-  BcmStats::get()->txPktAlloc();
+  if (size > kPooledSize || FLAGS_bcm_tx_pkt_pool_size <= 0) {
+    int rv = opennsl_pkt_alloc(unit, size, kTxPktFlags, &pkt_);
+    bcmLogError(rv, "Failed to allocate packet.");
+    buf_ = IOBuf::takeOwnership(pkt_->pkt_data->data, size,
+                                freeTxBuf, reinterpret_cast<void*>(pkt_));
+    BcmStats::get()->txPktAlloc();
+    return;
+  }
+
+  pkt_ = TxBufferPool::get()->take(unit);
+  if (pkt_) {
+    // Undo whatever the previous user of the buffer changed.  txCallback()
+    // already pointed pkt_data->data back at the start of the buffer.
+    pkt_->flags = kTxPktFlags;
+    pkt_->call_back = nullptr;
+    OPENNSL_PBMP_CLEAR(pkt_->tx_pbmp);
+    OPENNSL_PBMP_CLEAR(pkt_->tx_upbmp);
+    BcmStats::get()->txPktPoolAlloc();
+  } else {
+    int rv = opennsl_pkt_alloc(unit, kPooledSize, kTxPktFlags, &pkt_);
+    bcmLogError(rv, "Failed to allocate packet.");
+    BcmStats::get()->txPktAlloc();
+    BcmStats::get()->txPktPoolExhausted();
+  }
+  buf_ = IOBuf::takeOwnership(pkt_->pkt_data->data, kPooledSize, size,
+                              freePooledTxBuf, reinterpret_cast<void*>(pkt_));
+}
+
+void BcmTxPacket::preallocatePool(int unit) {
+  auto pool = TxBufferPool::get();
+  pool->acquire(unit);
+  while (pool->size() < size_t(std::max(FLAGS_bcm_tx_pkt_pool_size, 0))) {
+    opennsl_pkt_t* pkt;
+    int rv = opennsl_pkt_alloc(unit, kPooledSize, kTxPktFlags, &pkt);
+    if (OPENNSL_FAILURE(rv)) {
+      bcmLogError(rv, "Failed to pre-allocate TX packet buffer.");
+      return;
+    }
+    BcmStats::get()->txPktAlloc();
+    if (!pool->give(pkt)) {
+      freeTxBuf(nullptr, pkt);
+      return;
+    }
+  }
+}
+
+void BcmTxPacket::releasePool(int unit) {
+  for (auto pkt : TxBufferPool::get()->release(unit)) {
+    freeTxBuf(nullptr, pkt);
+  }
 }
 
 void BcmTxPacket::enableHiGigHeader() {
@@ -68,6 +201,27 @@ void BcmTxPacket::enableHiGigHeader() {
 }
 
 int BcmTxPacket::sendAsync(unique_ptr<BcmTxPacket> pkt) noexcept {
+  return sendAsyncImpl(std::move(pkt), std::chrono::steady_clock::now(),
+                       BcmStats::get());
+}
+
+size_t BcmTxPacket::sendAsync(
+    std::vector<unique_ptr<BcmTxPacket>> pkts) noexcept {
+  // Look up the thread local stats and the clock once for the whole burst
+  auto now = std::chrono::steady_clock::now();
+  auto stats = BcmStats::get();
+  size_t numSent = 0;
+  for (auto& pkt : pkts) {
+    if (OPENNSL_SUCCESS(sendAsyncImpl(std::move(pkt), now, stats))) {
+      ++numSent;
+    }
+  }
+  return numSent;
+}
+
+int BcmTxPacket::sendAsyncImpl(unique_ptr<BcmTxPacket> pkt,
+                               const TimePoint& now,
+                               BcmStats* stats) noexcept {
   opennsl_pkt_t* bcmPkt = pkt->pkt_;
   DCHECK(bcmPkt->call_back == nullptr);
   bcmPkt->call_back = txCallback;
@@ -82,17 +236,20 @@ int BcmTxPacket::sendAsync(unique_ptr<BcmTxPacket> pkt) noexcept {
   // buf->writableBuffer in case there is unused header space in the IOBuf
   bcmPkt->pkt_data->data = buf->writableData();
 
-  pkt->queued_ = std::chrono::steady_clock::now();
+  pkt->queued_ = now;
   auto rv = opennsl_tx(bcmPkt->unit, bcmPkt, pkt.get());
   if (OPENNSL_SUCCESS(rv)) {
     pkt.release();
-    BcmStats::get()->txSent();
+    stats->txSent();
   } else {
+    // Point the buffer back at its start, as txCallback() would have, since
+    // it may be reused from the pool
+    bcmPkt->pkt_data->data = buf->writableBuffer();
     bcmLogError(rv, "failed to send packet");
     if (rv == OPENNSL_E_MEMORY) {
-      BcmStats::get()->txPktAllocErrors();
+      stats->txPktAllocErrors();
     } else if (rv) {
-      BcmStats::get()->txError();
+      stats->txError();
     }
   }
   return rv;
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <chrono>
+#include <vector>
 
 #include "fboss/agent/TxPacket.h"
 
@@ -20,6 +21,18 @@ extern "C" {
 
 namespace facebook { namespace fboss {
 
+class BcmStats;
+
+/*
+ * BcmTxPacket wraps an opennsl_pkt_t DMA buffer.
+ *
+ * Packets up to kPooledSize bytes are carved from a pool of recycled
+ * buffers: when such a packet is freed its buffer goes back onto the pool
+ * instead of back to the SDK, so steady state control plane traffic does not
+ * call opennsl_pkt_alloc()/opennsl_pkt_free() at all.  When the pool is empty
+ * a new buffer is allocated (and counted as a pool exhaustion); it joins the
+ * pool when freed, up to --bcm_tx_pkt_pool_size buffers.
+ */
 class BcmTxPacket : public TxPacket {
  public:
   BcmTxPacket(int unit, uint32_t size);
@@ -58,12 +71,39 @@ class BcmTxPacket : public TxPacket {
    */
   static int sendAsync(std::unique_ptr<BcmTxPacket> pkt) noexcept;
 
+  /*
+   * Send a batch of BcmTxPackets asynchronously.
+   *
+   * Takes ownership of all the packets, like the single packet version.
+   * Returns the number of packets successfully queued to HW.
+   */
+  static size_t sendAsync(
+      std::vector<std::unique_ptr<BcmTxPacket>> pkts) noexcept;
+
+  /*
+   * Fill the TX buffer pool for the unit up to --bcm_tx_pkt_pool_size
+   * buffers, so the first burst after init does not hit the SDK allocator.
+   */
+  static void preallocatePool(int unit);
+
+  /*
+   * Free all of the unit's buffers currently sitting in the TX buffer pool.
+   * This must be called before the unit is detached.  Buffers of packets
+   * still in flight are freed when they complete, rather than returned to
+   * the pool, until preallocatePool() is called for the unit again.
+   */
+  static void releasePool(int unit);
+
+  // The buffer size used by pooled packets
+  enum : uint32_t { kPooledSize = 1536 };
 
  private:
   // Forbidden copy constructor and assignment operator
   BcmTxPacket(BcmTxPacket const &) = delete;
   BcmTxPacket& operator=(BcmTxPacket const &) = delete;
   void enableHiGigHeader();
+  static int sendAsyncImpl(std::unique_ptr<BcmTxPacket> pkt,
+                           const TimePoint& now, BcmStats* stats) noexcept;
 
   opennsl_pkt_t* pkt_{nullptr};
 
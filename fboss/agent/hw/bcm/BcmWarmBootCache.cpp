@@ -8,6 +8,8 @@
  *
  */
 #include "BcmWarmBootCache.h"
+#include <chrono>
+#include <iterator>
 #include <limits>
 #include <string>
 #include <utility>
@@ -31,6 +33,7 @@
 #include "fboss/agent/SysError.h"
 #include "fboss/agent/state/Vlan.h"
 #include "fboss/agent/state/VlanMap.h"
+#include "common/stats/ServiceData.h"
 
 using std::make_pair;
 using std::make_tuple;
@@ -49,6 +52,39 @@ using namespace facebook::fboss;
 
 namespace {
 auto constexpr kEcmpObjects = "ecmpObjects";
+auto constexpr kPopulateTimeCounter = "warm_boot.cache_populate.ms";
+
+/*
+ * Build map out of entries in one go.  When a key shows up more than once
+ * the last entry wins, just as assigning the entries one by one through
+ * operator[] would.
+ */
+template <typename Map>
+void buildIndex(Map& map, vector<typename Map::value_type>& entries) {
+  auto keyComp = map.key_comp();
+  auto entryComp = [&](const typename Map::value_type& a,
+                       const typename Map::value_type& b) {
+    return keyComp(a.first, b.first);
+  };
+  std::stable_sort(entries.begin(), entries.end(), entryComp);
+  auto out = entries.begin();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    auto next = std::next(it);
+    if (next != entries.end() && !entryComp(*it, *next)) {
+      // Superseded by a later entry for the same key
+      continue;
+    }
+    if (out != it) {
+      *out = std::move(*it);
+    }
+    ++out;
+  }
+  entries.erase(out, entries.end());
+  map.insert(boost::container::ordered_unique_range,
+             std::make_move_iterator(entries.begin()),
+             std::make_move_iterator(entries.end()));
+  vector<typename Map::value_type>().swap(entries);
+}
 
 struct AddrTables {
   AddrTables() : arpTable(make_shared<ArpTable>()),
@@ -237,6 +273,7 @@ void BcmWarmBootCache::populateStateFromWarmbootFile() {
 }
 
 void BcmWarmBootCache::populate() {
+  auto start = std::chrono::steady_clock::now();
   populateStateFromWarmbootFile();
   opennsl_vlan_data_t* vlanList = nullptr;
   int vlanCount = 0;
@@ -299,8 +336,11 @@ void BcmWarmBootCache::populate() {
       // Diag shell uses this for getting # of v6 host entries
       l3Info.l3info_max_host / 2,
       hostTraversalCallback, this);
+  // The egress traversal looks up egressId2VrfIp_
+  indexHosts();
   // Get egress entries
   opennsl_l3_egress_traverse(hw_->getUnit(), egressTraversalCallback, this);
+  indexEgresses();
   // Traverse V4 routes
   opennsl_l3_route_traverse(hw_->getUnit(), 0, 0, l3Info.l3info_max_route,
       routeTraversalCallback, this);
@@ -309,12 +349,55 @@ void BcmWarmBootCache::populate() {
       // Diag shell uses this for getting # of v6 route entries
       l3Info.l3info_max_route / 2,
       routeTraversalCallback, this);
+  indexRoutes();
   // Traverse ecmp egress entries
   opennsl_l3_egress_ecmp_traverse(hw_->getUnit(), ecmpEgressTraversalCallback,
       this);
+  indexEcmps();
   // Clear internal egress id table which just gets used while populating
   // warm boot cache
   egressId2VrfIp_.clear();
+
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  fbData->setCounter(kPopulateTimeCounter, duration.count());
+  LOG(INFO) << "Populated warm boot cache with " << vrfIp2Host_.size()
+    << " hosts, " << vrfIp2Egress_.size() << " egresses, "
+    << vrfPrefix2Route_.size() << " routes and " << egressIds2Ecmp_.size()
+    << " ecmp egresses in " << duration.count() << "ms";
+}
+
+void BcmWarmBootCache::indexHosts() {
+  buildIndex(vrfIp2Host_, hostEntries_);
+  buildIndex(egressId2VrfIp_, egressId2VrfIpEntries_);
+}
+
+void BcmWarmBootCache::indexEgresses() {
+  buildIndex(vrfIp2Egress_, egressEntries_);
+}
+
+void BcmWarmBootCache::indexRoutes() {
+  buildIndex(vrfPrefix2Route_, routeEntries_);
+}
+
+void BcmWarmBootCache::indexEcmps() {
+  auto keyComp = egressIds2Ecmp_.key_comp();
+  std::sort(ecmpEntries_.begin(), ecmpEntries_.end(),
+      [&](const EgressIds2Ecmp::value_type& a,
+          const EgressIds2Ecmp::value_type& b) {
+        return keyComp(a.first, b.first);
+      });
+  auto dup = std::adjacent_find(ecmpEntries_.begin(), ecmpEntries_.end(),
+      [](const EgressIds2Ecmp::value_type& a,
+         const EgressIds2Ecmp::value_type& b) {
+        return a.first == b.first;
+      });
+  CHECK(dup == ecmpEntries_.end()) << "Duplicate ecmp egress for : "
+    << toEgressIdsStr(dup->first);
+  for (const auto& idsAndEcmp : ecmpEntries_) {
+    CHECK(egressIds2Ecmp_.find(idsAndEcmp.first) == egressIds2Ecmp_.end());
+  }
+  buildIndex(egressIds2Ecmp_, ecmpEntries_);
 }
 
 bool BcmWarmBootCache::fillVlanPortInfo(Vlan* vlan) {
@@ -343,10 +426,11 @@ int BcmWarmBootCache::hostTraversalCallback(int unit, int index,
     IPAddress::fromBinary(ByteRange(host->l3a_ip6_addr,
           sizeof(host->l3a_ip6_addr))) :
     IPAddress::fromLongHBO(host->l3a_ip_addr);
-  cache->vrfIp2Host_[make_pair(host->l3a_vrf, ip)] = *host;
+  cache->hostEntries_.emplace_back(make_pair(host->l3a_vrf, ip), *host);
   VLOG(1) << "Adding egress id: " << host->l3a_intf << " to " << ip
     <<" mapping";
-  cache->egressId2VrfIp_[host->l3a_intf] = make_pair(host->l3a_vrf, ip);
+  cache->egressId2VrfIpEntries_.emplace_back(host->l3a_intf,
+      make_pair(host->l3a_vrf, ip));
   return 0;
 }
 
@@ -357,7 +441,8 @@ int BcmWarmBootCache::egressTraversalCallback(int unit, EgressId egressId,
   if (itr != cache->egressId2VrfIp_.end()) {
     VLOG(1) << "Adding bcm egress entry for : " << itr->second.second
       << " in VRF : " << itr->second.first;
-    cache->vrfIp2Egress_[itr->second] = make_pair(egressId, *egress);
+    cache->egressEntries_.emplace_back(itr->second,
+        make_pair(egressId, *egress));
   } else {
     // found egress ID that is not used by any host entry, we shall
     // only have two of them. One is for drop and the other one is for TO CPU.
@@ -397,7 +482,8 @@ int BcmWarmBootCache::routeTraversalCallback(int unit, int index,
     IPAddress::fromLongHBO(route->l3a_ip_mask);
   VLOG(3) << "In vrf : " << route->l3a_vrf << " adding route for : "
     << ip << " mask: " << mask;
-  cache->vrfPrefix2Route_[make_tuple(route->l3a_vrf, ip, mask)] = *route;
+  cache->routeEntries_.emplace_back(make_tuple(route->l3a_vrf, ip, mask),
+      *route);
   return 0;
 }
 
@@ -419,9 +505,8 @@ int BcmWarmBootCache::ecmpEgressTraversalCallback(int unit,
   } else {
     egressIds = cache->toEgressIds(intfArray, intfCount);
   }
-  CHECK(cache->egressIds2Ecmp_.find(egressIds) ==
-      cache->egressIds2Ecmp_.end());
-  cache->egressIds2Ecmp_[egressIds] = *ecmp;
+  // Duplicates are caught when the entries get indexed
+  cache->ecmpEntries_.emplace_back(egressIds, *ecmp);
   VLOG(1) << "Added ecmp egress id : " << ecmp->ecmp_intf <<
     " pointing to : " << toEgressIdsStr(egressIds) << " egress ids";
   return 0;
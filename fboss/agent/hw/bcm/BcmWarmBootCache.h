@@ -124,6 +124,18 @@ class BcmWarmBootCache {
   static int ecmpEgressTraversalCallback(int unit,
       opennsl_l3_egress_ecmp_t *ecmp, int intf_count, opennsl_if_t *intf_array,
       void *user_data);
+  /*
+   * The traversal callbacks only append to the *Entries_ vectors below.
+   * Once a traversal is done, these sort the collected entries and build
+   * the corresponding flat_map in one pass, rather than paying for an O(n)
+   * flat_map insert per entry.
+   */
+  void indexHosts();
+  void indexEgresses();
+  void indexRoutes();
+  void indexEcmps();
+  // Lets tests drive the traversal callbacks with synthetic tables
+  friend class BcmWarmBootCacheTest;
  public:
   /*
    * Iterators and find functions for finding VlanInfo
@@ -294,6 +306,12 @@ class BcmWarmBootCache {
   VrfAndIP2Egress vrfIp2Egress_;
   VrfAndPrefix2Route vrfPrefix2Route_;
   EgressIds2Ecmp egressIds2Ecmp_;
+  // Entries collected by the traversal callbacks, waiting to be indexed
+  std::vector<VrfAndIP2Host::value_type> hostEntries_;
+  std::vector<EgressId2VrfAndIP::value_type> egressId2VrfIpEntries_;
+  std::vector<VrfAndIP2Egress::value_type> egressEntries_;
+  std::vector<VrfAndPrefix2Route::value_type> routeEntries_;
+  std::vector<EgressIds2Ecmp::value_type> ecmpEntries_;
   opennsl_if_t dropEgressId_;
   opennsl_if_t toCPUEgressId_;
   // hwSwitchEcmp2EgressIds_ represents what the mapping
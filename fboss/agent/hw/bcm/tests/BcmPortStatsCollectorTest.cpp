@@ -0,0 +1,171 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmPortStatsCollector.h"
+
+#include <map>
+#include <set>
+#include <gtest/gtest.h>
+
+extern "C" {
+#include <opennsl/error.h>
+}
+
+using std::chrono::seconds;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+/*
+ * Stands in for the SDK: every port's counters live in a map, and the test
+ * controls the clock.
+ */
+class FakeSdkCollector : public BcmPortStatsCollector {
+ public:
+  FakeSdkCollector() : BcmPortStatsCollector(0) {}
+
+  int statMultiGet(opennsl_port_t port, int nstat,
+                   opennsl_stat_val_t* stats, uint64_t* values) override {
+    ++multiGets;
+    if (failPorts.count(port)) {
+      return OPENNSL_E_INTERNAL;
+    }
+    for (int idx = 0; idx < nstat; ++idx) {
+      values[idx] = counters[port][stats[idx]];
+    }
+    return OPENNSL_E_NONE;
+  }
+
+  int queuedCountGet(opennsl_port_t port, uint32_t* count) override {
+    ++queuedCountGets;
+    *count = queueLengths[port];
+    return OPENNSL_E_NONE;
+  }
+
+  Clock::time_point now() const override {
+    return time;
+  }
+
+  std::map<opennsl_port_t, std::map<int, uint64_t>> counters;
+  std::map<opennsl_port_t, uint32_t> queueLengths;
+  std::set<opennsl_port_t> failPorts;
+  Clock::time_point time{Clock::now()};
+  int multiGets{0};
+  int queuedCountGets{0};
+};
+
+} // unnamed namespace
+
+class BcmPortStatsCollectorTest : public ::testing::Test {
+ protected:
+  enum : int { kNumPorts = 32 };
+
+  void SetUp() override {
+    // Number the BCM ports backwards, to check the snapshot is still sorted
+    // by PortID
+    for (int i = 0; i < kNumPorts; ++i) {
+      collector_.addPort(bcmPort(i), PortID(i + 1));
+    }
+  }
+
+  static opennsl_port_t bcmPort(int i) {
+    return 100 - i;
+  }
+
+  FakeSdkCollector collector_;
+};
+
+TEST_F(BcmPortStatsCollectorTest, OneMultiGetPerPort) {
+  EXPECT_EQ(nullptr, collector_.getSnapshot());
+  auto snapshot = collector_.collect();
+  EXPECT_EQ(kNumPorts, collector_.multiGets);
+  EXPECT_EQ(kNumPorts, collector_.queuedCountGets);
+
+  EXPECT_EQ(snapshot, collector_.getSnapshot());
+  EXPECT_EQ(1, snapshot->generation);
+  ASSERT_EQ(kNumPorts, snapshot->ports.size());
+  PortID expected(1);
+  for (const auto& entry : snapshot->ports) {
+    EXPECT_EQ(expected, entry.first);
+    EXPECT_TRUE(entry.second.fresh);
+    expected = PortID(expected + 1);
+  }
+  EXPECT_EQ(nullptr, snapshot->getPortIf(PortID(kNumPorts + 1)));
+}
+
+TEST_F(BcmPortStatsCollectorTest, CountsAndRates) {
+  auto& port = collector_.counters[bcmPort(0)];
+  port[opennsl_spl_snmpIfHCInOctets] = 5000;
+  port[opennsl_spl_snmpIfOutErrors] = 7;
+  port[snmpOpenNSLReceivedPkts64Octets] = 11;
+  port[snmpOpenNSLTransmittedPkts9217to16383Octets] = 13;
+  collector_.queueLengths[bcmPort(0)] = 42;
+
+  // The first read only sets the baseline
+  auto first = collector_.collect();
+  auto stats = first->getPortIf(PortID(1));
+  ASSERT_NE(nullptr, stats);
+  EXPECT_EQ(0, stats->counts[PortStatsSnapshot::IN_BYTES]);
+  EXPECT_EQ(0, stats->rates[PortStatsSnapshot::IN_BYTES]);
+  EXPECT_EQ(11, stats->inPktLengths[0]);
+  EXPECT_EQ(13, stats->outPktLengths[9]);
+  EXPECT_EQ(42, stats->queueLength);
+
+  collector_.time += seconds(2);
+  port[opennsl_spl_snmpIfHCInOctets] += 3000;
+  port[opennsl_spl_snmpIfOutErrors] += 4;
+  auto second = collector_.collect();
+  stats = second->getPortIf(PortID(1));
+  EXPECT_EQ(2, second->generation);
+  EXPECT_EQ(3000, stats->counts[PortStatsSnapshot::IN_BYTES]);
+  EXPECT_DOUBLE_EQ(1500, stats->rates[PortStatsSnapshot::IN_BYTES]);
+  EXPECT_EQ(4, stats->counts[PortStatsSnapshot::OUT_ERRORS]);
+  EXPECT_DOUBLE_EQ(2, stats->rates[PortStatsSnapshot::OUT_ERRORS]);
+
+  // The earlier snapshot is untouched
+  EXPECT_EQ(0, first->getPortIf(PortID(1))->counts[
+      PortStatsSnapshot::IN_BYTES]);
+
+  // A counter that goes backwards was cleared, so its new value is all new
+  collector_.time += seconds(1);
+  port[opennsl_spl_snmpIfHCInOctets] = 100;
+  stats = collector_.collect()->getPortIf(PortID(1));
+  EXPECT_EQ(3100, stats->counts[PortStatsSnapshot::IN_BYTES]);
+  EXPECT_DOUBLE_EQ(100, stats->rates[PortStatsSnapshot::IN_BYTES]);
+}
+
+TEST_F(BcmPortStatsCollectorTest, FailedReadKeepsLastCounts) {
+  auto& port = collector_.counters[bcmPort(3)];
+  port[opennsl_spl_snmpIfHCOutOctets] = 1000;
+  collector_.collect();
+  collector_.time += seconds(1);
+  port[opennsl_spl_snmpIfHCOutOctets] = 1500;
+  collector_.collect();
+
+  collector_.failPorts.insert(bcmPort(3));
+  collector_.time += seconds(1);
+  port[opennsl_spl_snmpIfHCOutOctets] = 2500;
+  auto stats = collector_.collect()->getPortIf(PortID(4));
+  ASSERT_NE(nullptr, stats);
+  EXPECT_FALSE(stats->fresh);
+  EXPECT_EQ(500, stats->counts[PortStatsSnapshot::OUT_BYTES]);
+  EXPECT_EQ(0, stats->rates[PortStatsSnapshot::OUT_BYTES]);
+
+  // Once the port can be read again, nothing is lost, and the rate covers
+  // the whole time since the last successful read
+  collector_.failPorts.clear();
+  collector_.time += seconds(1);
+  stats = collector_.collect()->getPortIf(PortID(4));
+  EXPECT_TRUE(stats->fresh);
+  EXPECT_EQ(1500, stats->counts[PortStatsSnapshot::OUT_BYTES]);
+  EXPECT_DOUBLE_EQ(1000.0 / 3, stats->rates[PortStatsSnapshot::OUT_BYTES]);
+}
+
+}} // facebook::fboss
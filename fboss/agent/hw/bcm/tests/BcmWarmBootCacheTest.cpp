@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
+
+#include <folly/IPAddress.h>
+#include <folly/Memory.h>
+#include <gtest/gtest.h>
+
+using folly::IPAddress;
+using folly::IPAddressV4;
+using std::unique_ptr;
+
+namespace facebook { namespace fboss {
+
+/*
+ * Feeds synthetic h/w tables through the warm boot cache traversal
+ * callbacks, the same way BcmWarmBootCache::populate() does with the SDK.
+ */
+class BcmWarmBootCacheTest : public ::testing::Test {
+ protected:
+  enum : int {
+    kNumHosts = 20000,
+    kNumRoutes = 200000,
+    kNumEcmps = 1000,
+    kEgressBase = 100000,
+  };
+  typedef BcmWarmBootCache::EgressId EgressId;
+
+  void SetUp() override {
+    // The traversal callbacks don't touch the BcmSwitch
+    cache_ = folly::make_unique<BcmWarmBootCache>(nullptr);
+  }
+
+  static IPAddressV4 hostIp(int i) {
+    return IPAddressV4::fromLongHBO(0x0a000000 + i);
+  }
+  static EgressId hostEgress(int i) {
+    return kEgressBase + i;
+  }
+
+  void addHost(int i) {
+    opennsl_l3_host_t host;
+    opennsl_l3_host_t_init(&host);
+    host.l3a_vrf = 0;
+    host.l3a_ip_addr = hostIp(i).toLongHBO();
+    host.l3a_intf = hostEgress(i);
+    BcmWarmBootCache::hostTraversalCallback(0, i, &host, cache_.get());
+  }
+
+  void addEgress(EgressId egressId, uint32_t flags = 0) {
+    opennsl_l3_egress_t egress;
+    opennsl_l3_egress_t_init(&egress);
+    egress.flags = flags;
+    BcmWarmBootCache::egressTraversalCallback(0, egressId, &egress,
+                                              cache_.get());
+  }
+
+  void addRoute(uint32_t subnet, uint32_t mask, EgressId egressId) {
+    opennsl_l3_route_t route;
+    opennsl_l3_route_t_init(&route);
+    route.l3a_vrf = 0;
+    route.l3a_subnet = subnet;
+    route.l3a_ip_mask = mask;
+    route.l3a_intf = egressId;
+    BcmWarmBootCache::routeTraversalCallback(0, 0, &route, cache_.get());
+  }
+
+  void addEcmp(EgressId ecmpId, std::vector<EgressId> paths) {
+    opennsl_l3_egress_ecmp_t ecmp;
+    opennsl_l3_egress_ecmp_t_init(&ecmp);
+    ecmp.ecmp_intf = ecmpId;
+    BcmWarmBootCache::ecmpEgressTraversalCallback(0, &ecmp, paths.size(),
+        paths.data(), cache_.get());
+  }
+
+  void indexHosts() {
+    cache_->indexHosts();
+  }
+  void indexEgresses() {
+    cache_->indexEgresses();
+  }
+  void indexRoutes() {
+    cache_->indexRoutes();
+  }
+  void indexEcmps() {
+    cache_->indexEcmps();
+  }
+
+  unique_ptr<BcmWarmBootCache> cache_;
+};
+
+TEST_F(BcmWarmBootCacheTest, populateLargeTables) {
+  // The SDK hands entries back in h/w table order, which need not be sorted
+  for (int i = kNumHosts - 1; i >= 0; --i) {
+    addHost(i);
+  }
+  indexHosts();
+  for (int i = 0; i < kNumHosts; ++i) {
+    addEgress(hostEgress(i));
+  }
+  addEgress(1, OPENNSL_L3_DST_DISCARD);
+  addEgress(2, OPENNSL_L3_L2TOCPU);
+  indexEgresses();
+  for (int i = kNumRoutes - 1; i >= 0; --i) {
+    addRoute(0x0b000000 + (i << 8), 0xffffff00, hostEgress(i % kNumHosts));
+  }
+  // A second entry for the same prefix replaces the first one
+  addRoute(0x0b000000, 0xffffff00, 1);
+  indexRoutes();
+  for (int i = 0; i < kNumEcmps; ++i) {
+    addEcmp(200000 + i, {hostEgress(i), hostEgress(i + 1)});
+  }
+  indexEcmps();
+
+  EXPECT_EQ(1, cache_->getDropEgressId());
+  EXPECT_EQ(2, cache_->getToCPUEgressId());
+  for (int i = 0; i < kNumHosts; ++i) {
+    auto hitr = cache_->findHost(0, IPAddress(hostIp(i)));
+    ASSERT_NE(cache_->vrfAndIP2Host_end(), hitr);
+    EXPECT_EQ(hostEgress(i), hitr->second.l3a_intf);
+    auto eitr = cache_->findEgress(0, IPAddress(hostIp(i)));
+    ASSERT_NE(cache_->vrfAndIP2Egress_end(), eitr);
+    EXPECT_EQ(hostEgress(i), eitr->second.first);
+  }
+  EXPECT_EQ(kNumRoutes, std::distance(cache_->vrfAndPrefix2Route_beg(),
+                                      cache_->vrfAndPrefix2Route_end()));
+  for (int i = 0; i < kNumRoutes; i += 997) {
+    auto ritr = cache_->findRoute(0,
+        IPAddress(IPAddressV4::fromLongHBO(0x0b000000 + (i << 8))), 24);
+    ASSERT_NE(cache_->vrfAndPrefix2Route_end(), ritr);
+    EXPECT_EQ(i == 0 ? 1 : hostEgress(i % kNumHosts),
+              ritr->second.l3a_intf);
+  }
+  for (int i = 0; i < kNumEcmps; ++i) {
+    EgressId paths[] = {hostEgress(i), hostEgress(i + 1)};
+    auto eitr = cache_->findEcmp(BcmWarmBootCache::toEgressIds(paths, 2));
+    ASSERT_NE(cache_->egressIds2Ecmp_end(), eitr);
+    EXPECT_EQ(200000 + i, eitr->second.ecmp_intf);
+  }
+}
+
+}} // facebook::fboss
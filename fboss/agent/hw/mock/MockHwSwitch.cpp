@@ -36,4 +36,14 @@ bool MockHwSwitch::sendPacketOutOfPort(
   sendPacketOutOfPort_(sp);
   return true;
 }
+
+size_t MockHwSwitch::sendPacketsSwitched(TxPackets pkts) noexcept {
+  sendPacketsSwitched_(pkts.size());
+  return HwSwitch::sendPacketsSwitched(std::move(pkts));
+}
+
+size_t MockHwSwitch::sendPacketsOutOfPorts(PortTxPackets pkts) noexcept {
+  sendPacketsOutOfPorts_(pkts.size());
+  return HwSwitch::sendPacketsOutOfPorts(std::move(pkts));
+}
 }} // facebook::fboss
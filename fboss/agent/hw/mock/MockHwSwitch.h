@@ -37,6 +37,14 @@ class MockHwSwitch : public HwSwitch {
   bool sendPacketOutOfPort(std::unique_ptr<TxPacket> pkt,
                           facebook::fboss::PortID portID) noexcept override;
 
+  // The batched sends record the size of each batch and then hand every
+  // packet to the single packet mocks above, so EXPECT_PKT() still works.
+  MOCK_METHOD1(sendPacketsSwitched_, void(size_t));
+  size_t sendPacketsSwitched(TxPackets pkts) noexcept override;
+
+  MOCK_METHOD1(sendPacketsOutOfPorts_, void(size_t));
+  size_t sendPacketsOutOfPorts(PortTxPackets pkts) noexcept override;
+
   // TODO
   void updateStats(SwitchStats *switchStats) override {}
 
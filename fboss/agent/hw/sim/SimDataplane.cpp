@@ -0,0 +1,518 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/sim/SimDataplane.h"
+
+#include <folly/Hash.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+#include "fboss/agent/packet/Ethertype.h"
+#include "fboss/agent/packet/IPProto.h"
+#include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
+#include "fboss/agent/state/NdpTable.h"
+#include "fboss/agent/state/Port.h"
+#include "fboss/agent/state/PortMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/state/VlanMapDelta.h"
+
+using folly::IOBuf;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using folly::io::Cursor;
+using folly::io::RWPrivateCursor;
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace facebook { namespace fboss {
+
+namespace {
+// Ethernet header sizes, with and without an 802.1Q tag
+constexpr uint32_t kUntaggedHdrLen = 14;
+constexpr uint32_t kTaggedHdrLen = 18;
+
+bool isLinkLocalMulticast(MacAddress mac) {
+  // 01:80:c2:00:00:0X is never forwarded by a bridge (IEEE 802.1D)
+  return (mac.u64HBO() & ~0xfULL) == 0x0180c2000000ULL;
+}
+} // unnamed namespace
+
+struct SimDataplane::PacketInfo {
+  PortID srcPort{0};
+  bool fromCpu{false};
+  MacAddress dst;
+  MacAddress src;
+  VlanID vlan{0};
+  uint16_t ethertype{0};
+  // Offset of the ethertype field following the MAC addresses and any tag
+  uint32_t ethertypeOffset{0};
+  uint32_t length{0};
+};
+
+SimDataplane::Egress::Egress(PortID p, unique_ptr<IOBuf> b)
+  : port(p), buf(std::move(b)) {}
+SimDataplane::Egress::~Egress() {}
+SimDataplane::Egress::Egress(Egress&&) noexcept = default;
+SimDataplane::Egress& SimDataplane::Egress::operator=(Egress&&) noexcept =
+  default;
+
+SimDataplane::SimDataplane()
+  : tables_(make_shared<Tables>()) {}
+
+SimDataplane::~SimDataplane() {}
+
+shared_ptr<const SimDataplane::Tables> SimDataplane::getTables() const {
+  folly::SpinLockGuard guard(tablesLock_);
+  return tables_;
+}
+
+void SimDataplane::stateChanged(const StateDelta& delta) {
+  const auto& oldState = delta.oldState();
+  const auto& newState = delta.newState();
+  auto tables = make_shared<Tables>(*getTables());
+
+  if (oldState->getPorts() != newState->getPorts()) {
+    updatePorts(tables.get(), newState.get());
+  }
+  // VLAN entries refer to their interface, so rebuild both together
+  if (oldState->getVlans() != newState->getVlans() ||
+      oldState->getInterfaces() != newState->getInterfaces()) {
+    updateVlans(tables.get(), newState.get());
+    updateIntfs(tables.get(), newState.get());
+  }
+  if (oldState->getVlans() != newState->getVlans()) {
+    updateNeighbors(tables.get(), delta);
+  }
+  if (oldState->getRouteTables() != newState->getRouteTables()) {
+    updateRoutes(tables.get(), newState.get());
+  }
+
+  folly::SpinLockGuard guard(tablesLock_);
+  tables_ = std::move(tables);
+}
+
+void SimDataplane::updatePorts(Tables* tables, const SwitchState* state) {
+  tables->ports.clear();
+  for (const auto& port : *state->getPorts()) {
+    auto& entry = tables->ports[port->getID()];
+    entry.enabled = !port->isDisabled();
+    entry.ingressVlan = port->getIngressVlan();
+  }
+}
+
+void SimDataplane::updateVlans(Tables* tables, const SwitchState* state) {
+  tables->vlans.clear();
+  for (const auto& vlan : *state->getVlans()) {
+    tables->vlans[vlan->getID()].members = vlan->getPorts();
+  }
+}
+
+void SimDataplane::updateIntfs(Tables* tables, const SwitchState* state) {
+  tables->intfs.clear();
+  tables->localAddrs.clear();
+  for (const auto& intf : *state->getInterfaces()) {
+    auto& entry = tables->intfs[intf->getID()];
+    entry.router = intf->getRouterID();
+    entry.vlan = intf->getVlanID();
+    entry.mac = intf->getMac();
+    for (const auto& addr : intf->getAddresses()) {
+      tables->localAddrs.emplace(intf->getRouterID(), addr.first);
+    }
+    auto vlan = tables->vlans.find(intf->getVlanID());
+    if (vlan != tables->vlans.end()) {
+      vlan->second.routable = true;
+      vlan->second.intf = intf->getID();
+    }
+  }
+}
+
+template <typename EntryDeltaT>
+void SimDataplane::updateNeighbor(Tables* tables, const EntryDeltaT& delta) {
+  const auto& oldEntry = delta.getOld();
+  const auto& newEntry = delta.getNew();
+  if (oldEntry) {
+    tables->neighbors.erase(
+        NeighborKey(oldEntry->getIntfID(), IPAddress(oldEntry->getIP())));
+  }
+  if (newEntry) {
+    auto& neighbor = tables->neighbors[
+        NeighborKey(newEntry->getIntfID(), IPAddress(newEntry->getIP()))];
+    neighbor.pending = newEntry->isPending();
+    if (!neighbor.pending) {
+      neighbor.mac = newEntry->getMac();
+      neighbor.port = newEntry->getPort();
+    }
+  }
+}
+
+void SimDataplane::updateNeighbors(Tables* tables, const StateDelta& delta) {
+  for (const auto& vlanDelta : delta.getVlansDelta()) {
+    for (const auto& arpDelta : vlanDelta.getArpDelta()) {
+      updateNeighbor(tables, arpDelta);
+    }
+    for (const auto& ndpDelta : vlanDelta.getNdpDelta()) {
+      updateNeighbor(tables, ndpDelta);
+    }
+  }
+}
+
+void SimDataplane::updateRoutes(Tables* tables, const SwitchState* state) {
+  // The route tables in the state are immutable, so we can simply hold on
+  // to them.  Their longestMatch() uses the published RIB's LPM index.
+  tables->routes.clear();
+  for (const auto& table : *state->getRouteTables()) {
+    tables->routes[table->getID()] = table;
+  }
+}
+
+SimDataplane::Result SimDataplane::processIngress(PortID port,
+                                                  const IOBuf* buf) {
+  auto tables = getTables();
+  return process(*tables, port, false, buf);
+}
+
+SimDataplane::Result SimDataplane::processCpuPacket(const IOBuf* buf) {
+  auto tables = getTables();
+  return process(*tables, PortID(0), true, buf);
+}
+
+SimDataplane::Result SimDataplane::counted(Result result) {
+  switch (result.action) {
+    case Action::FORWARD:
+      forwarded_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case Action::TRAP:
+      trapped_.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case Action::DROP:
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      break;
+  }
+  return result;
+}
+
+SimDataplane::Result SimDataplane::process(const Tables& tables,
+                                           PortID srcPort,
+                                           bool fromCpu,
+                                           const IOBuf* buf) {
+  Result result;
+  PacketInfo pkt;
+  pkt.srcPort = srcPort;
+  pkt.fromCpu = fromCpu;
+  pkt.length = buf->computeChainDataLength();
+  try {
+    Cursor cursor(buf);
+    pkt.dst = PktUtil::readMac(&cursor);
+    pkt.src = PktUtil::readMac(&cursor);
+    pkt.ethertype = cursor.readBE<uint16_t>();
+    if (pkt.ethertype == ETHERTYPE_VLAN) {
+      pkt.vlan = VlanID(cursor.readBE<uint16_t>() & 0xfff);
+      pkt.ethertypeOffset = kTaggedHdrLen - 2;
+      pkt.ethertype = cursor.readBE<uint16_t>();
+    } else {
+      pkt.ethertypeOffset = kUntaggedHdrLen - 2;
+    }
+  } catch (const std::out_of_range&) {
+    return counted(std::move(result));
+  }
+
+  if (!fromCpu) {
+    auto port = tables.ports.find(srcPort);
+    if (port == tables.ports.end() || !port->second.enabled) {
+      return counted(std::move(result));
+    }
+    if (pkt.vlan == VlanID(0)) {
+      pkt.vlan = port->second.ingressVlan;
+    }
+  } else if (pkt.vlan == VlanID(0)) {
+    VLOG(4) << "dropping untagged packet from the CPU";
+    return counted(std::move(result));
+  }
+  result.vlan = pkt.vlan;
+
+  auto vlan = tables.vlans.find(pkt.vlan);
+  if (vlan == tables.vlans.end()) {
+    return counted(std::move(result));
+  }
+  if (!fromCpu) {
+    if (vlan->second.members.find(srcPort) == vlan->second.members.end()) {
+      return counted(std::move(result));
+    }
+    if (!pkt.src.isMulticast()) {
+      learn(pkt.vlan, pkt.src, srcPort);
+    }
+  }
+
+  if (pkt.dst.isMulticast()) {
+    // Broadcast and multicast frames go to the CPU and, except for link
+    // local control protocols such as LLDP, to the rest of the VLAN
+    if (!isLinkLocalMulticast(pkt.dst)) {
+      flood(tables, pkt, buf, &result);
+    }
+    if (!fromCpu) {
+      result.action = Action::TRAP;
+    } else if (!result.egress.empty()) {
+      result.action = Action::FORWARD;
+    }
+    return counted(std::move(result));
+  }
+
+  if (vlan->second.routable) {
+    auto intf = tables.intfs.find(vlan->second.intf);
+    if (intf != tables.intfs.end() && intf->second.mac == pkt.dst) {
+      route(tables, pkt, buf, &result);
+      if (fromCpu && result.action == Action::TRAP) {
+        result.action = Action::DROP;
+      }
+      return counted(std::move(result));
+    }
+  }
+
+  PortID dstPort;
+  if (!lookupL2(pkt.vlan, pkt.dst, &dstPort)) {
+    // Unknown unicast is flooded
+    flood(tables, pkt, buf, &result);
+    if (!result.egress.empty()) {
+      result.action = Action::FORWARD;
+    }
+    return counted(std::move(result));
+  }
+  if (dstPort == srcPort) {
+    return counted(std::move(result));
+  }
+  auto frame = makeFrame(tables, pkt, buf, pkt.vlan, dstPort,
+                         pkt.dst, pkt.src);
+  if (frame) {
+    result.egress.emplace_back(dstPort, std::move(frame));
+    result.action = Action::FORWARD;
+  }
+  return counted(std::move(result));
+}
+
+void SimDataplane::route(const Tables& tables, const PacketInfo& pkt,
+                         const IOBuf* buf, Result* result) {
+  // Anything addressed to the router MAC that we cannot route, such as a
+  // unicast ARP reply, is for the CPU.
+  result->action = Action::TRAP;
+  auto l3Offset = pkt.ethertypeOffset + 2;
+  const auto& vlanIntf = tables.intfs.at(tables.vlans.at(pkt.vlan).intf);
+
+  IPAddress srcIP;
+  IPAddress dstIP;
+  uint8_t ttl = 0;
+  uint8_t proto = 0;
+  uint16_t srcL4Port = 0;
+  uint16_t dstL4Port = 0;
+  bool connected = false;
+  const RouteForwardInfo* fwd = nullptr;
+  try {
+    Cursor cursor(buf);
+    cursor.skip(l3Offset);
+    if (pkt.ethertype == ETHERTYPE_IPV4) {
+      auto versionIhl = cursor.read<uint8_t>();
+      cursor.skip(5);
+      auto fragment = cursor.readBE<uint16_t>() & 0x1fff;
+      ttl = cursor.read<uint8_t>();
+      proto = cursor.read<uint8_t>();
+      cursor.skip(2);
+      srcIP = PktUtil::readIPv4(&cursor);
+      dstIP = PktUtil::readIPv4(&cursor);
+      if (fragment == 0 &&
+          (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP)) {
+        cursor.skip((versionIhl & 0xf) * 4 - 20);
+        srcL4Port = cursor.readBE<uint16_t>();
+        dstL4Port = cursor.readBE<uint16_t>();
+      }
+    } else if (pkt.ethertype == ETHERTYPE_IPV6) {
+      cursor.skip(6);
+      proto = cursor.read<uint8_t>();
+      ttl = cursor.read<uint8_t>();
+      srcIP = PktUtil::readIPv6(&cursor);
+      dstIP = PktUtil::readIPv6(&cursor);
+      if (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) {
+        srcL4Port = cursor.readBE<uint16_t>();
+        dstL4Port = cursor.readBE<uint16_t>();
+      }
+    } else {
+      return;
+    }
+  } catch (const std::out_of_range&) {
+    result->action = Action::DROP;
+    return;
+  }
+
+  if (tables.localAddrs.count(LocalAddrKey(vlanIntf.router, dstIP)) ||
+      (dstIP.isV6() && dstIP.asV6().isLinkLocal()) ||
+      ttl <= 1) {
+    return;
+  }
+
+  auto routes = tables.routes.find(vlanIntf.router);
+  if (routes == tables.routes.end()) {
+    result->action = Action::DROP;
+    return;
+  }
+  // The routes are owned by the route table, which the caller's snapshot of
+  // the tables keeps alive, so fwd stays valid after match goes away.
+  if (dstIP.isV4()) {
+    auto match = routes->second->getRibV4()->longestMatch(dstIP.asV4());
+    if (match && match->isResolved()) {
+      connected = match->isConnected();
+      fwd = &match->getForwardInfo();
+    }
+  } else {
+    auto match = routes->second->getRibV6()->longestMatch(dstIP.asV6());
+    if (match && match->isResolved()) {
+      connected = match->isConnected();
+      fwd = &match->getForwardInfo();
+    }
+  }
+  if (!fwd || fwd->isDrop()) {
+    result->action = Action::DROP;
+    return;
+  }
+  if (fwd->isToCPU()) {
+    return;
+  }
+
+  // Pick one of the ECMP paths by hashing the flow
+  const auto& nexthops = fwd->getNexthops();
+  if (nexthops.empty()) {
+    result->action = Action::DROP;
+    return;
+  }
+  auto hash = folly::hash::hash_combine(srcIP.hash(), dstIP.hash(), proto,
+                                        srcL4Port, dstL4Port);
+  const auto& nexthop = *(nexthops.begin() + hash % nexthops.size());
+  // Directly connected routes have the interface address as their nexthop;
+  // the neighbor to send to is the destination itself.
+  const auto& neighborIP = connected ? dstIP : nexthop.nexthop;
+  auto neighbor = tables.neighbors.find(NeighborKey(nexthop.intf, neighborIP));
+  if (neighbor == tables.neighbors.end()) {
+    // Unresolved nexthops are sent to the CPU, which will resolve them
+    return;
+  }
+  auto egressIntf = tables.intfs.find(nexthop.intf);
+  if (neighbor->second.pending || egressIntf == tables.intfs.end()) {
+    result->action = Action::DROP;
+    return;
+  }
+
+  auto frame = makeFrame(tables, pkt, buf, egressIntf->second.vlan,
+                         neighbor->second.port, neighbor->second.mac,
+                         egressIntf->second.mac);
+  if (!frame) {
+    result->action = Action::DROP;
+    return;
+  }
+
+  // Decrement the TTL, and fix up the IPv4 header checksum to match.  The
+  // new frame may have a different header length, but the L3 header is
+  // still the same distance from its end.
+  uint8_t* l3 = frame->writableTail() - (pkt.length - l3Offset);
+  if (pkt.ethertype == ETHERTYPE_IPV4) {
+    uint8_t oldWord[2] = {l3[8], l3[9]};
+    --l3[8];
+    uint16_t csum = (l3[10] << 8) | l3[11];
+    csum = PktUtil::updateChecksum(csum, oldWord, l3 + 8, 2);
+    l3[10] = csum >> 8;
+    l3[11] = csum & 0xff;
+  } else {
+    --l3[7];
+  }
+  result->egress.emplace_back(neighbor->second.port, std::move(frame));
+  result->action = Action::FORWARD;
+}
+
+void SimDataplane::flood(const Tables& tables, const PacketInfo& pkt,
+                         const IOBuf* buf, Result* result) {
+  const auto& vlan = tables.vlans.at(pkt.vlan);
+  for (const auto& member : vlan.members) {
+    if (member.first == pkt.srcPort && !pkt.fromCpu) {
+      continue;
+    }
+    auto port = tables.ports.find(member.first);
+    if (port == tables.ports.end() || !port->second.enabled) {
+      continue;
+    }
+    auto frame = makeFrame(tables, pkt, buf, pkt.vlan, member.first,
+                           pkt.dst, pkt.src);
+    if (frame) {
+      result->egress.emplace_back(member.first, std::move(frame));
+    }
+  }
+}
+
+unique_ptr<IOBuf> SimDataplane::makeFrame(const Tables& tables,
+                                          const PacketInfo& pkt,
+                                          const IOBuf* buf,
+                                          VlanID vlan,
+                                          PortID port,
+                                          MacAddress dst,
+                                          MacAddress src) {
+  auto vlanEntry = tables.vlans.find(vlan);
+  if (vlanEntry == tables.vlans.end()) {
+    return nullptr;
+  }
+  auto member = vlanEntry->second.members.find(port);
+  if (member == vlanEntry->second.members.end()) {
+    return nullptr;
+  }
+  bool tagged = member->second.tagged;
+
+  // Everything from the ethertype on is copied unchanged
+  auto payloadLen = pkt.length - pkt.ethertypeOffset;
+  auto hdrLen = (tagged ? kTaggedHdrLen : kUntaggedHdrLen) - 2;
+  auto frame = IOBuf::create(hdrLen + payloadLen);
+  frame->append(hdrLen + payloadLen);
+  RWPrivateCursor out(frame.get());
+  out.push(dst.bytes(), MacAddress::SIZE);
+  out.push(src.bytes(), MacAddress::SIZE);
+  if (tagged) {
+    out.writeBE<uint16_t>(ETHERTYPE_VLAN);
+    out.writeBE<uint16_t>(static_cast<uint16_t>(vlan));
+  }
+  Cursor in(buf);
+  in.skip(pkt.ethertypeOffset);
+  in.pull(out.writableData(), payloadLen);
+  return frame;
+}
+
+uint64_t SimDataplane::l2Key(VlanID vlan, MacAddress mac) {
+  return (uint64_t(static_cast<uint16_t>(vlan)) << 48) | mac.u64HBO();
+}
+
+void SimDataplane::learn(VlanID vlan, MacAddress mac, PortID port) {
+  folly::SpinLockGuard guard(l2Lock_);
+  l2Table_[l2Key(vlan, mac)] = port;
+}
+
+bool SimDataplane::lookupL2(VlanID vlan, MacAddress mac, PortID* port) const {
+  folly::SpinLockGuard guard(l2Lock_);
+  auto it = l2Table_.find(l2Key(vlan, mac));
+  if (it == l2Table_.end()) {
+    return false;
+  }
+  *port = it->second;
+  return true;
+}
+
+}} // facebook::fboss
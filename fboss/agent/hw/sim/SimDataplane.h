@@ -0,0 +1,188 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+#include <folly/IPAddress.h>
+#include <folly/MacAddress.h>
+#include <folly/SpinLock.h>
+
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/types.h"
+
+namespace folly {
+class IOBuf;
+}
+
+namespace facebook { namespace fboss {
+
+class RouteTable;
+class StateDelta;
+class SwitchState;
+
+/*
+ * SimDataplane is a software model of the switch forwarding pipeline, used
+ * by SimSwitch so that everything above the HwSwitch interface can be run
+ * and measured end to end without an ASIC.
+ *
+ * It is programmed from StateDelta objects, just like the real hardware,
+ * and models:
+ *  - port enable state and ingress VLANs,
+ *  - VLAN membership and tagging, with MAC learning and flooding,
+ *  - the ARP and NDP tables,
+ *  - the routing tables, with ECMP hashing across resolved nexthops,
+ *  - the trap-to-CPU rules the agent relies on: broadcast and multicast
+ *    frames, packets to our own addresses, TTL expiry, TO_CPU routes and
+ *    nexthops that have no neighbor entry yet.
+ *
+ * The programmed tables are immutable once built; a state change builds a
+ * new set and swaps it in, so packets being processed on other threads
+ * always see a consistent snapshot.  Only the learned MAC table is updated
+ * in place.
+ */
+class SimDataplane {
+ public:
+  enum class Action {
+    // Sent out of the ports in Result::egress
+    FORWARD,
+    // Sent to the CPU; the packet may also have been flooded
+    TRAP,
+    DROP,
+  };
+
+  struct Egress {
+    Egress(PortID port, std::unique_ptr<folly::IOBuf> buf);
+    ~Egress();
+    Egress(Egress&&) noexcept;
+    Egress& operator=(Egress&&) noexcept;
+
+    PortID port;
+    std::unique_ptr<folly::IOBuf> buf;
+  };
+
+  struct Result {
+    Action action{Action::DROP};
+    // The ingress VLAN, for trapped packets
+    VlanID vlan{0};
+    std::vector<Egress> egress;
+  };
+
+  SimDataplane();
+  ~SimDataplane();
+
+  void stateChanged(const StateDelta& delta);
+
+  /*
+   * Process a packet received on a front panel port.  buf is left
+   * untouched, so that the caller can hand it to the CPU if the packet is
+   * trapped.
+   */
+  Result processIngress(PortID port, const folly::IOBuf* buf);
+
+  /*
+   * Process a packet sent by the CPU to be switched by the pipeline.  The
+   * packet must carry a VLAN tag.  Packets sent by the CPU are never
+   * trapped back to it.
+   */
+  Result processCpuPacket(const folly::IOBuf* buf);
+
+  uint64_t getForwardedCount() const {
+    return forwarded_.load(std::memory_order_relaxed);
+  }
+  uint64_t getTrappedCount() const {
+    return trapped_.load(std::memory_order_relaxed);
+  }
+  uint64_t getDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct PortEntry {
+    bool enabled{false};
+    VlanID ingressVlan{0};
+  };
+  struct VlanEntry {
+    Vlan::MemberPorts members;
+    // The interface routing for this VLAN, if any
+    bool routable{false};
+    InterfaceID intf{0};
+  };
+  struct IntfEntry {
+    RouterID router{0};
+    VlanID vlan{0};
+    folly::MacAddress mac;
+  };
+  struct Neighbor {
+    folly::MacAddress mac;
+    PortID port{0};
+    bool pending{false};
+  };
+  typedef std::pair<InterfaceID, folly::IPAddress> NeighborKey;
+  typedef std::pair<RouterID, folly::IPAddress> LocalAddrKey;
+
+  struct Tables {
+    boost::container::flat_map<PortID, PortEntry> ports;
+    boost::container::flat_map<VlanID, VlanEntry> vlans;
+    boost::container::flat_map<InterfaceID, IntfEntry> intfs;
+    boost::container::flat_set<LocalAddrKey> localAddrs;
+    boost::container::flat_map<NeighborKey, Neighbor> neighbors;
+    boost::container::flat_map<RouterID, std::shared_ptr<RouteTable>> routes;
+  };
+
+  // The parsed fields of a packet that the pipeline looks at
+  struct PacketInfo;
+
+  // Forbidden copy constructor and assignment operator
+  SimDataplane(SimDataplane const &) = delete;
+  SimDataplane& operator=(SimDataplane const &) = delete;
+
+  std::shared_ptr<const Tables> getTables() const;
+  static void updatePorts(Tables* tables, const SwitchState* state);
+  static void updateVlans(Tables* tables, const SwitchState* state);
+  static void updateIntfs(Tables* tables, const SwitchState* state);
+  template <typename EntryDeltaT>
+  static void updateNeighbor(Tables* tables, const EntryDeltaT& delta);
+  static void updateNeighbors(Tables* tables, const StateDelta& delta);
+  static void updateRoutes(Tables* tables, const SwitchState* state);
+
+  Result process(const Tables& tables, PortID srcPort, bool fromCpu,
+                 const folly::IOBuf* buf);
+  void route(const Tables& tables, const PacketInfo& pkt,
+             const folly::IOBuf* buf, Result* result);
+  void flood(const Tables& tables, const PacketInfo& pkt,
+             const folly::IOBuf* buf, Result* result);
+  void learn(VlanID vlan, folly::MacAddress mac, PortID port);
+  bool lookupL2(VlanID vlan, folly::MacAddress mac, PortID* port) const;
+  // Update the counters for the result's action
+  Result counted(Result result);
+
+  static uint64_t l2Key(VlanID vlan, folly::MacAddress mac);
+  static std::unique_ptr<folly::IOBuf> makeFrame(
+      const Tables& tables, const PacketInfo& pkt, const folly::IOBuf* buf,
+      VlanID vlan, PortID port, folly::MacAddress dst, folly::MacAddress src);
+
+  mutable folly::SpinLock tablesLock_;
+  std::shared_ptr<const Tables> tables_;
+
+  mutable folly::SpinLock l2Lock_;
+  std::unordered_map<uint64_t, PortID> l2Table_;
+
+  std::atomic<uint64_t> forwarded_{0};
+  std::atomic<uint64_t> trapped_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}} // facebook::fboss
@@ -15,7 +15,9 @@
 
 #include <folly/Conv.h>
 #include <folly/Memory.h>
+#include <folly/io/IOBuf.h>
 
+using folly::IOBuf;
 using folly::make_unique;
 using std::make_shared;
 using std::shared_ptr;
@@ -24,7 +26,8 @@ using std::string;
 namespace facebook { namespace fboss {
 
 SimSwitch::SimSwitch(SimPlatform* platform, uint32_t numPorts)
-  : numPorts_(numPorts) {
+  : numPorts_(numPorts),
+    portTxCount_(numPorts + 1) {
 }
 
 std::pair<std::shared_ptr<SwitchState>, BootType>
@@ -40,7 +43,7 @@ SimSwitch::init(HwSwitch::Callback* callback) {
 }
 
 void SimSwitch::stateChanged(const StateDelta& delta) {
-  // TODO
+  dataplane_.stateChanged(delta);
 }
 
 std::unique_ptr<TxPacket> SimSwitch::allocatePacket(uint32_t size) {
@@ -48,20 +51,61 @@ std::unique_ptr<TxPacket> SimSwitch::allocatePacket(uint32_t size) {
 }
 
 bool SimSwitch::sendPacketSwitched(std::unique_ptr<TxPacket> pkt) noexcept {
-  // TODO
   ++txCount_;
+  auto result = dataplane_.processCpuPacket(pkt->buf());
+  for (auto& egress : result.egress) {
+    transmit(egress.port, std::move(egress.buf));
+  }
   return true;
 }
 
 bool SimSwitch::sendPacketOutOfPort(
     std::unique_ptr<TxPacket> pkt,
     PortID portID) noexcept {
-  // TODO
   ++txCount_;
+  transmit(portID, pkt->buf()->clone());
   return true;
 }
+
+SimDataplane::Action SimSwitch::receivePacket(PortID port,
+                                              std::unique_ptr<IOBuf> buf) {
+  auto result = dataplane_.processIngress(port, buf.get());
+  for (auto& egress : result.egress) {
+    transmit(egress.port, std::move(egress.buf));
+  }
+  if (result.action == SimDataplane::Action::TRAP) {
+    auto pkt = make_unique<MockRxPacket>(std::move(buf));
+    pkt->setSrcPort(port);
+    pkt->setSrcVlan(result.vlan);
+    callback_->packetReceived(std::move(pkt));
+  }
+  return result.action;
+}
+
+void SimSwitch::transmit(PortID port, std::unique_ptr<IOBuf> buf) {
+  if (static_cast<uint32_t>(port) < portTxCount_.size()) {
+    portTxCount_[static_cast<uint32_t>(port)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+  if (egressFn_) {
+    egressFn_(port, std::move(buf));
+  }
+}
+
+uint64_t SimSwitch::getPortTxCount(PortID port) const {
+  if (static_cast<uint32_t>(port) >= portTxCount_.size()) {
+    return 0;
+  }
+  return portTxCount_[static_cast<uint32_t>(port)].load(
+      std::memory_order_relaxed);
+}
+
 void SimSwitch::injectPacket(std::unique_ptr<RxPacket> pkt) {
   callback_->packetReceived(std::move(pkt));
 }
 
+void SimSwitch::injectPackets(RxPackets pkts) {
+  callback_->packetsReceived(std::move(pkts));
+}
+
 }} // facebook::fboss
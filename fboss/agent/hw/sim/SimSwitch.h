@@ -9,7 +9,12 @@
  */
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <vector>
+
 #include "fboss/agent/HwSwitch.h"
+#include "fboss/agent/hw/sim/SimDataplane.h"
 
 namespace facebook { namespace fboss {
 
@@ -17,6 +22,13 @@ class SimPlatform;
 
 class SimSwitch : public HwSwitch {
  public:
+  /*
+   * Called for every packet the switch sends out of a front panel port,
+   * whether forwarded by the dataplane or sent by the CPU.
+   */
+  typedef std::function<void(PortID, std::unique_ptr<folly::IOBuf>)>
+    EgressFn;
+
   SimSwitch(SimPlatform* platform, uint32_t numPorts);
 
   std::pair<std::shared_ptr<SwitchState>, BootType>
@@ -35,7 +47,32 @@ class SimSwitch : public HwSwitch {
     return folly::dynamic::object;
   }
   void clearWarmBootCache() override {}
+  /*
+   * Hand packets straight to SwSwitch, as if they had been trapped to the
+   * CPU, bypassing the dataplane.
+   */
   void injectPacket(std::unique_ptr<RxPacket> pkt);
+  void injectPackets(RxPackets pkts);
+
+  /*
+   * Receive a packet on a front panel port.  It goes through the software
+   * dataplane, and is forwarded out of other ports, trapped to SwSwitch or
+   * dropped just as the hardware would.
+   */
+  SimDataplane::Action receivePacket(PortID port,
+                                     std::unique_ptr<folly::IOBuf> buf);
+
+  /*
+   * Set the function called for each packet sent out of a front panel
+   * port.  This must be set before any packets are sent.
+   */
+  void setEgressHandler(EgressFn fn) {
+    egressFn_ = std::move(fn);
+  }
+  uint64_t getPortTxCount(PortID port) const;
+  const SimDataplane* getDataplane() const {
+    return &dataplane_;
+  }
   void initialConfigApplied() override {}
   cfg::PortSpeed getPortSpeed(PortID port) const override {
     return cfg::PortSpeed::GIGE;
@@ -85,9 +122,16 @@ class SimSwitch : public HwSwitch {
   SimSwitch(SimSwitch const &) = delete;
   SimSwitch& operator=(SimSwitch const &) = delete;
 
+  void transmit(PortID port, std::unique_ptr<folly::IOBuf> buf);
+
   HwSwitch::Callback* callback_{nullptr};
   uint32_t numPorts_{0};
+  // Packets sent by the CPU
   uint64_t txCount_{0};
+  SimDataplane dataplane_;
+  EgressFn egressFn_;
+  // Packets sent out of each port, indexed by PortID
+  std::vector<std::atomic<uint64_t>> portTxCount_;
 };
 
 }} // facebook::fboss
@@ -24,6 +24,45 @@ struct UnicastRoute {
   2: required list<Address.BinaryAddress> nextHopAddrs,
 }
 
+/*
+ * Request for one page of a route table dump. Routes are returned in
+ * (network address, prefix length) order, IPv4 routes before IPv6 routes.
+ */
+struct RouteTablePageRequest {
+  1: i32 vrfId = 0,
+  // Return routes after this prefix. Unset to start from the beginning.
+  2: optional IpPrefix cursor,
+  // Upper bound on the number of routes returned in one page
+  3: i32 maxRoutes = 1000,
+  // Only return routes equal to or more specific than this prefix
+  4: optional IpPrefix prefixFilter,
+  // Only return routes forwarding to this nexthop
+  5: optional Address.BinaryAddress nexthopFilter,
+  /*
+   * Return routes in compactRoutes, with each distinct nexthop list sent
+   * once in nextHopSets, rather than inline in routes.
+   */
+  6: bool compact = false,
+}
+
+struct CompactUnicastRoute {
+  1: IpPrefix dest,
+  // Index into RouteTablePage.nextHopSets
+  2: i32 nextHopSetIdx,
+}
+
+struct RouteTablePage {
+  1: list<UnicastRoute> routes,
+  2: list<CompactUnicastRoute> compactRoutes,
+  3: list<list<Address.BinaryAddress>> nextHopSets,
+  /*
+   * Cursor to pass in the next request. Unset once the dump is complete.
+   * Note that a page may be full even though no more routes follow it, in
+   * which case the next page will be empty.
+   */
+  4: optional IpPrefix nextCursor,
+}
+
 struct ArpEntryThrift {
   1: string mac,
   2: i32 port,
@@ -179,6 +218,33 @@ struct LinkNeighborThrift {
   14: optional string portDescription
 }
 
+/*
+ * How busy one of the agent's threads is
+ */
+struct ThreadStatsThrift {
+  1: string name
+  2: i32 tid
+  // CPU time used since the thread started, as reported by the kernel
+  3: i64 userTimeUs
+  4: i64 systemTimeUs
+  // Percentage of one CPU used since the previous sample
+  5: double cpuPercent
+  // Whether the thread runs an event loop, or reports its own lag
+  6: bool hasLag
+  // Delay between posting a probe to the event loop and the loop running
+  // it, for the most recent probe, and the largest seen so far.  For an
+  // event loop that has not run the latest probe yet, this is how long the
+  // probe has been waiting.
+  7: i64 lagUs
+  8: i64 maxLagUs
+  // Average time an event loop spends running callbacks per iteration
+  9: double loopBusyUs
+  // The thread has exited since it was registered
+  10: bool exited
+  // Callbacks queued on an event loop by other threads and not yet run
+  11: i64 queueDepth
+}
+
 service FbossCtrl extends fb303.FacebookService {
   /*
    * Retrieve up-to-date counters from the hardware, and publish all
@@ -290,6 +356,13 @@ service FbossCtrl extends fb303.FacebookService {
     throws (1: fboss.FbossBaseError error)
   list<UnicastRoute> getRouteTable()
     throws (1: fboss.FbossBaseError error)
+  /*
+   * Returns one page of the route table. Unlike getRouteTable() this does
+   * not need to materialize the whole table in one response, so it should
+   * be preferred by anything that polls the route table periodically.
+   */
+  RouteTablePage getRouteTablePage(1: RouteTablePageRequest req)
+    throws (1: fboss.FbossBaseError error)
   InterfaceDetail getInterfaceDetail(1: i32 interfaceId)
     throws (1: fboss.FbossBaseError error)
 
@@ -328,6 +401,21 @@ service FbossCtrl extends fb303.FacebookService {
   string getRunningConfig()
     throws (1: fboss.FbossBaseError error)
 
+  /*
+   * Return the most recent state updates, with the time spent in each
+   * phase, as JSON in the Chrome trace event format.  Requires the agent
+   * to be started with --state_update_trace_size.
+   */
+  string getStateUpdateTrace()
+    throws (1: fboss.FbossBaseError error)
+
+  /*
+   * Return the CPU usage and event loop lag of each of the agent's
+   * threads, as of the last time the stats were updated.
+   */
+  list<ThreadStatsThrift> getThreadStats()
+    throws (1: fboss.FbossBaseError error)
+
   list<ArpEntryThrift> getArpTable()
     throws (1: fboss.FbossBaseError error)
   list<NdpEntryThrift> getNdpTable()
@@ -105,7 +105,7 @@ class IPv6RAImpl : private folly::AsyncTimeout {
 IPv6RAImpl::IPv6RAImpl(SwSwitch* sw,
                        const SwitchState* state,
                        const Interface* intf)
-  : AsyncTimeout(sw->getBackgroundEVB()),
+  : AsyncTimeout(sw->getBackgroundEVB(BackgroundSubsystem::ROUTE_ADV)),
     sw_(sw) {
   std::chrono::seconds raInterval(
       intf->getNdpConfig().routerAdvertisementSeconds);
@@ -161,8 +161,8 @@ IPv6RouteAdvertiser::IPv6RouteAdvertiser(SwSwitch* sw,
                                          const SwitchState* state,
                                          const Interface* intf) {
   adv_ = new IPv6RAImpl(sw, state, intf);
-  bool ret = sw->getBackgroundEVB()->runInEventBaseThread(
-      IPv6RAImpl::start, adv_);
+  auto evb = sw->getBackgroundEVB(BackgroundSubsystem::ROUTE_ADV);
+  bool ret = evb->runInEventBaseThread(IPv6RAImpl::start, adv_);
   if (!ret) {
     delete adv_;
     adv_ = nullptr;
@@ -181,8 +181,8 @@ IPv6RouteAdvertiser::~IPv6RouteAdvertiser() {
   if (!adv_) {
     return;
   }
-  bool ret = adv_->getSw()->getBackgroundEVB()->runInEventBaseThread(
-      IPv6RAImpl::stop, adv_);
+  auto evb = adv_->getSw()->getBackgroundEVB(BackgroundSubsystem::ROUTE_ADV);
+  bool ret = evb->runInEventBaseThread(IPv6RAImpl::stop, adv_);
   if (!ret) {
     LOG(ERROR) << "failed to stop IPv6 route advertiser";
   }
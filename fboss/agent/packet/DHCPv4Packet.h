@@ -33,6 +33,18 @@ struct DHCPv4Packet {
   enum : uint16_t { kFlagBroadcast = 0x8000 };
   enum : size_t { kFixedPartBytes = 236 };
   enum : size_t { kMinSize = 300 };
+  // Offsets of the fields a relay agent reads or rewrites, for handling
+  // packets without parsing them
+  enum : size_t {
+    kOpOffset = 0,
+    kHopsOffset = 3,
+    kFlagsOffset = 10,
+    kYiaddrOffset = 16,
+    kGiaddrOffset = 24,
+    kChaddrOffset = 28,
+    kCookieOffset = kFixedPartBytes,
+    kOptionsOffset = kFixedPartBytes + kOptionsCookieSize,
+  };
   static const uint8_t kOptionsCookie[kOptionsCookieSize];
 
   void parse(folly::io::Cursor* cursor);
@@ -60,6 +60,13 @@ struct DHCPv6Packet {
   enum { PEERADDR_BYTES = 16 };
   enum { TRANSACTIONID_BYTES = 3 };
 
+  // Layout of the fixed parts, for handling packets without parsing them
+  enum { HEADER_BYTES = TYPE_BYTES + TRANSACTIONID_BYTES };
+  enum { HOPCOUNT_OFFSET = TYPE_BYTES };
+  enum { PEERADDR_OFFSET = HOPCOUNT_OFFSET + HOPCOUNT_BYTES + LINKADDR_BYTES };
+  enum { RELAY_HEADER_BYTES = PEERADDR_OFFSET + PEERADDR_BYTES };
+  enum { OPTION_HEADER_BYTES = 4 };
+
  public:
   DHCPv6Packet() {}
 
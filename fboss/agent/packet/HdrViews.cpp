@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/packet/HdrViews.h"
+
+#include <folly/io/IOBuf.h>
+
+using folly::IOBuf;
+using folly::io::Cursor;
+
+namespace facebook { namespace fboss {
+
+namespace {
+
+// Run a header class's Cursor constructor over the bytes of a view
+template <typename HdrT>
+HdrT decode(const uint8_t* data, size_t len) {
+  IOBuf buf(IOBuf::WRAP_BUFFER, data, len);
+  Cursor cursor(&buf);
+  return HdrT(cursor);
+}
+
+} // unnamed namespace
+
+IPv4HdrView::IPv4HdrView(Cursor& cursor) {
+  try {
+    // The header length is in the first byte, so check that before
+    // attaching to the whole header
+    auto first = Cursor(cursor).read<uint8_t>();
+    if ((first >> 4) != IPV4_VERSION) {
+      throw HdrParseError("IPv4: version != 4");
+    }
+    if ((first & 0x0f) < 5) {
+      throw HdrParseError("IPv4: IHL < 5");
+    }
+    attach(cursor, (first & 0x0f) * 4);
+  } catch (const std::out_of_range& e) {
+    throw HdrParseError("IPv4 header too small");
+  }
+  if (length() < size()) {
+    throw HdrParseError("IPv4: total length < ihl * 4");
+  }
+  if (ttl() == 0) {
+    throw HdrParseError("IPv4: TTL == 0");
+  }
+}
+
+IPv4Hdr IPv4HdrView::toHdr() const {
+  return decode<IPv4Hdr>(data_, size());
+}
+
+IPv6HdrView::IPv6HdrView(Cursor& cursor) {
+  try {
+    attach(cursor, SIZE);
+  } catch (const std::out_of_range& e) {
+    throw HdrParseError("IPv6 header too small");
+  }
+  if (version() != IPV6_VERSION) {
+    throw HdrParseError("IPv6: version != 6");
+  }
+  if (hopLimit() == 0) {
+    throw HdrParseError("IPv6: Hop Limit == 0");
+  }
+}
+
+IPv6Hdr IPv6HdrView::toHdr() const {
+  return decode<IPv6Hdr>(data_, SIZE);
+}
+
+ArpHdrView::ArpHdrView(Cursor& cursor) {
+  auto start = cursor;
+  try {
+    attach(cursor, FIXED_SIZE);
+    if (isEthernetIPv4()) {
+      cursor = start;
+      attach(cursor, SIZE);
+    }
+  } catch (const std::out_of_range& e) {
+    throw HdrParseError("ARP header too small");
+  }
+}
+
+ArpHdr ArpHdrView::toHdr() const {
+  DCHECK(isEthernetIPv4());
+  return decode<ArpHdr>(data_, SIZE);
+}
+
+}} // facebook::fboss
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+/*
+ * Read-only views of the headers of a received packet.
+ *
+ * The header classes (IPv4Hdr, IPv6Hdr, ArpHdr) copy every field out of the
+ * packet and build the address objects as soon as they are constructed.  Most
+ * packets trapped to the CPU are dropped, or punted to the host, after
+ * looking at one or two fields, so the RX handlers use these views instead:
+ * they point at the header bytes and only decode a field when it is read.
+ *
+ * Constructing a view checks that the whole header is present, does the
+ * same validation as the matching header class, and advances the cursor past
+ * the header, just like the header class constructors.  HdrParseError is
+ * thrown for bad headers.
+ *
+ * The header bytes are used in place when they are contiguous in the
+ * cursor's current buffer, which is the case for received packets in
+ * practice.  Otherwise they are copied into the view.  Either way a view must
+ * not outlive the packet it was built from, and it cannot be copied.
+ *
+ * There is no view for ICMPHdr: it is only four bytes of plain integers,
+ * so decoding it up front costs no more than a view would.
+ */
+#include <cstring>
+#include <stdexcept>
+
+#include <folly/Bits.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/Likely.h>
+#include <folly/MacAddress.h>
+#include <folly/io/Cursor.h>
+#include <glog/logging.h>
+
+#include "fboss/agent/packet/ArpHdr.h"
+#include "fboss/agent/packet/HdrParseError.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
+#include "fboss/agent/packet/IPv6Hdr.h"
+
+namespace facebook { namespace fboss {
+
+namespace detail {
+
+template <size_t MaxSize>
+class HdrView {
+ protected:
+  HdrView() {}
+
+  /*
+   * Point data_ at the next len bytes of cursor and advance past them.
+   * Throws std::out_of_range if there aren't len bytes left.
+   */
+  void attach(folly::io::Cursor& cursor, size_t len) {
+    DCHECK_LE(len, MaxSize);
+    if (LIKELY(cursor.length() >= len)) {
+      data_ = cursor.data();
+      cursor.skip(len);
+    } else {
+      cursor.pull(copy_, len);
+      data_ = copy_;
+    }
+  }
+
+  uint8_t u8(size_t offset) const {
+    return data_[offset];
+  }
+  uint16_t u16(size_t offset) const {
+    return folly::Endian::big(folly::loadUnaligned<uint16_t>(data_ + offset));
+  }
+  uint32_t u32(size_t offset) const {
+    return folly::Endian::big(folly::loadUnaligned<uint32_t>(data_ + offset));
+  }
+
+  const uint8_t* data_{nullptr};
+
+ private:
+  // data_ may point into copy_
+  HdrView(HdrView const &) = delete;
+  HdrView& operator=(HdrView const &) = delete;
+
+  uint8_t copy_[MaxSize];
+};
+
+} // detail
+
+class IPv4HdrView : public detail::HdrView<60> {
+ public:
+  explicit IPv4HdrView(folly::io::Cursor& cursor);
+
+  uint8_t version() const { return u8(0) >> 4; }
+  uint8_t ihl() const { return u8(0) & 0x0f; }
+  size_t size() const { return ihl() * 4; }
+  uint8_t dscp() const { return u8(1) >> 2; }
+  uint8_t ecn() const { return u8(1) & 0x03; }
+  uint16_t length() const { return u16(2); }
+  uint16_t id() const { return u16(4); }
+  uint8_t ttl() const { return u8(8); }
+  uint8_t protocol() const { return u8(9); }
+  uint16_t csum() const { return u16(10); }
+  folly::IPAddressV4 srcAddr() const {
+    return folly::IPAddressV4::fromLongHBO(u32(12));
+  }
+  folly::IPAddressV4 dstAddr() const {
+    return folly::IPAddressV4::fromLongHBO(u32(16));
+  }
+
+  /*
+   * Decode the whole header, for the code paths that need an IPv4Hdr.
+   */
+  IPv4Hdr toHdr() const;
+};
+
+class IPv6HdrView : public detail::HdrView<40> {
+ public:
+  enum : size_t { SIZE = 40 };
+
+  explicit IPv6HdrView(folly::io::Cursor& cursor);
+
+  uint8_t version() const { return u8(0) >> 4; }
+  uint8_t trafficClass() const {
+    return ((u8(0) & 0x0f) << 4) | (u8(1) >> 4);
+  }
+  uint32_t flowLabel() const { return u32(0) & 0xfffff; }
+  uint16_t payloadLength() const { return u16(4); }
+  uint8_t nextHeader() const { return u8(6); }
+  uint8_t hopLimit() const { return u8(7); }
+  folly::IPAddressV6 srcAddr() const {
+    return folly::IPAddressV6::fromBinary(folly::ByteRange(data_ + 8, 16));
+  }
+  folly::IPAddressV6 dstAddr() const {
+    return folly::IPAddressV6::fromBinary(folly::ByteRange(data_ + 24, 16));
+  }
+
+  /*
+   * Decode the whole header, for the code paths that need an IPv6Hdr.
+   */
+  IPv6Hdr toHdr() const;
+};
+
+/*
+ * Only the fixed part of the header, up to and including oper, is required
+ * for ARP packets other than Ethernet/IPv4 ARP, so that the caller can still
+ * count them as unsupported.  The cursor is then only advanced past the fixed
+ * part, and the address fields must not be read.
+ */
+class ArpHdrView : public detail::HdrView<28> {
+ public:
+  enum : size_t { FIXED_SIZE = 8, SIZE = 28 };
+
+  explicit ArpHdrView(folly::io::Cursor& cursor);
+
+  uint16_t htype() const { return u16(0); }
+  uint16_t ptype() const { return u16(2); }
+  uint8_t hlen() const { return u8(4); }
+  uint8_t plen() const { return u8(5); }
+  uint16_t oper() const { return u16(6); }
+  bool isEthernetIPv4() const {
+    return htype() == ARP_HTYPE_ETHERNET && ptype() == ARP_PTYPE_IPV4 &&
+      hlen() == ARP_HLEN_ETHERNET && plen() == ARP_PLEN_IPV4;
+  }
+  folly::MacAddress sha() const { return mac(8); }
+  folly::IPAddressV4 spa() const {
+    DCHECK(isEthernetIPv4());
+    return folly::IPAddressV4::fromLongHBO(u32(14));
+  }
+  folly::MacAddress tha() const { return mac(18); }
+  folly::IPAddressV4 tpa() const {
+    DCHECK(isEthernetIPv4());
+    return folly::IPAddressV4::fromLongHBO(u32(24));
+  }
+
+  /*
+   * Decode the whole header, for the code paths that need an ArpHdr.
+   */
+  ArpHdr toHdr() const;
+
+ private:
+  folly::MacAddress mac(size_t offset) const {
+    DCHECK(isEthernetIPv4());
+    return folly::MacAddress::fromBinary(
+        folly::ByteRange(data_ + offset, folly::MacAddress::SIZE));
+  }
+};
+
+}} // facebook::fboss
@@ -12,9 +12,18 @@
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 #include <folly/MacAddress.h>
+#include <folly/Bits.h>
 #include <folly/io/Cursor.h>
 #include "fboss/agent/FbossError.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FBOSS_CHECKSUM_AVX2 1
+#include <immintrin.h>
+#endif
+
 using folly::IPAddressV4;
 using folly::IPAddressV6;
 using folly::MacAddress;
@@ -25,6 +34,110 @@ using folly::IOBuf;
 using folly::StringPiece;
 using std::string;
 
+namespace {
+
+/*
+ * The checksum kernels sum the data as native endian words, which is
+ * cheaper than byte swapping every word.  The one's complement sum is
+ * independent of byte order (RFC 1071 section 2(B)), so we only need to
+ * swap the folded 16 bit result.
+ *
+ * Each kernel returns the unfolded sum.  Sums are accumulated in 64 bits
+ * from 32 bit words, so they cannot overflow for any realistic length.
+ */
+typedef uint64_t (*NativeSumFn)(const uint8_t* data, size_t length);
+
+uint64_t nativeSumScalar(const uint8_t* data, size_t length) {
+  uint64_t sum = 0;
+  while (length >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    sum += word & 0xffffffff;
+    sum += word >> 32;
+    data += 8;
+    length -= 8;
+  }
+  if (length >= 4) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    sum += word;
+    data += 4;
+    length -= 4;
+  }
+  if (length >= 2) {
+    uint16_t word;
+    memcpy(&word, data, sizeof(word));
+    sum += word;
+    data += 2;
+    length -= 2;
+  }
+  if (length) {
+    // The last byte is the most significant byte of a word that is padded
+    // with zero, in network byte order.
+    uint8_t last[2] = {data[0], 0};
+    uint16_t word;
+    memcpy(&word, last, sizeof(word));
+    sum += word;
+  }
+  return sum;
+}
+
+#ifdef FBOSS_CHECKSUM_AVX2
+__attribute__((target("avx2")))
+uint64_t nativeSumAvx2(const uint8_t* data, size_t length) {
+  // Each 32 byte block is split into 32 bit words, which are zero extended
+  // into two vectors of four 64 bit lanes.  Two accumulators keep the
+  // additions independent of each other.
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc0 = zero;
+  __m256i acc1 = zero;
+  while (length >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+    acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+    data += 32;
+    length -= 32;
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes),
+                      _mm256_add_epi64(acc0, acc1));
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+    nativeSumScalar(data, length);
+}
+#endif
+
+NativeSumFn chooseNativeSum() {
+#ifdef FBOSS_CHECKSUM_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return nativeSumAvx2;
+  }
+#endif
+  return nativeSumScalar;
+}
+
+// Function local so that it is set up even if a checksum is computed during
+// static initialization
+NativeSumFn& nativeSum() {
+  static NativeSumFn fn = chooseNativeSum();
+  return fn;
+}
+
+uint32_t foldSum(uint64_t sum) {
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return sum;
+}
+
+// Sum of the contiguous range as 16 bit network byte order words, folded to
+// 16 bits.
+uint32_t contiguousSum(const uint8_t* data, size_t length) {
+  return folly::Endian::big(static_cast<uint16_t>(
+      foldSum(nativeSum()(data, length))));
+}
+
+} // unnamed namespace
+
 namespace facebook { namespace fboss {
 
 MacAddress PktUtil::readMac(Cursor* cursor) {
@@ -62,13 +175,24 @@ IPAddressV6 PktUtil::readIPv6(Cursor* cursor) {
   return IPAddressV6::fromBinary(ByteRange(buf, IPV6_LENGTH));
 }
 
+ByteRange PktUtil::contiguousRemainder(Cursor cursor,
+                                       std::vector<uint8_t>* storage) {
+  auto length = cursor.totalLength();
+  if (cursor.length() >= length) {
+    return ByteRange(cursor.data(), length);
+  }
+
+  storage->resize(length);
+  cursor.pull(storage->data(), length);
+  return ByteRange(storage->data(), length);
+}
+
 uint16_t PktUtil::internetChecksum(folly::io::Cursor start, uint64_t length) {
   return finalizeChecksum(start, length, 0);
 }
 
 uint16_t PktUtil::internetChecksum(const uint8_t* buffer, uint32_t size) {
-  auto buf = IOBuf(IOBuf::WRAP_BUFFER, buffer, size);
-  return finalizeChecksum(Cursor(&buf), size, 0);
+  return finalizeChecksum(contiguousSum(buffer, size));
 }
 
 uint16_t PktUtil::internetChecksum(const IOBuf* buf) {
@@ -78,20 +202,36 @@ uint16_t PktUtil::internetChecksum(const IOBuf* buf) {
 uint32_t PktUtil::partialChecksumImpl(folly::io::Cursor cursor,
                                       uint64_t length,
                                       uint32_t value) {
-  // Checksum all the pairs of bytes first
-  while  (length > 1) {
-    value += cursor.readBE<uint16_t>();
-    length -= 2;
-  }
-  if (length) {
-    // Bytes are interpreted in n/w byte order
-    // so this last octet represents the 8 MSbits
-    // of the last 16 bit number in this buffer.
-    uint16_t last = cursor.read<uint8_t>();
-    value += (last << 8);
-    --length;
+  // Sum each contiguous piece of the IOBuf chain at once, rather than
+  // reading it a word at a time through the cursor.
+  uint64_t sum = value;
+  bool odd = false;
+  while (length) {
+    uint32_t segSum;
+    size_t segLen;
+    auto seg = cursor.peek();
+    if (seg.second == 0) {
+      // We are at the end of a buffer in the chain.  Reading moves on to
+      // the next non-empty one, or throws if there is no more data.
+      uint8_t byte = cursor.read<uint8_t>();
+      segSum = contiguousSum(&byte, 1);
+      segLen = 1;
+    } else {
+      segLen = std::min<uint64_t>(seg.second, length);
+      segSum = contiguousSum(seg.first, segLen);
+      cursor.skip(segLen);
+    }
+    // A piece that starts at an odd offset has its bytes in the opposite
+    // halves of each word, and swapping the bytes of its sum corrects for
+    // that.
+    if (odd) {
+      segSum = folly::Endian::swap(static_cast<uint16_t>(segSum));
+    }
+    sum += segSum;
+    odd ^= (segLen & 1);
+    length -= segLen;
   }
-  return value;
+  return foldSum(sum);
 }
 
 uint32_t PktUtil::partialChecksum(folly::io::Cursor cursor,
@@ -117,6 +257,62 @@ uint16_t PktUtil::finalizeChecksum(uint32_t sum) {
   return static_cast<uint16_t>(sum);
 }
 
+uint16_t PktUtil::updateChecksum(uint16_t csum,
+                                 const uint8_t* oldData,
+                                 const uint8_t* newData,
+                                 uint32_t length) {
+  DCHECK_EQ(length % 2, 0);
+  // HC' = ~(~HC + ~m + m')
+  uint32_t sum = static_cast<uint16_t>(~csum);
+  for (uint32_t i = 0; i < length; i += 2) {
+    uint16_t oldWord = (oldData[i] << 8) | oldData[i + 1];
+    uint16_t newWord = (newData[i] << 8) | newData[i + 1];
+    sum += static_cast<uint16_t>(~oldWord);
+    sum += newWord;
+  }
+  return finalizeChecksum(sum);
+}
+
+bool PktUtil::checksumImplSupported(ChecksumImpl impl) {
+  switch (impl) {
+    case ChecksumImpl::SCALAR:
+      return true;
+    case ChecksumImpl::AVX2:
+#ifdef FBOSS_CHECKSUM_AVX2
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+PktUtil::ChecksumImpl PktUtil::getChecksumImpl() {
+#ifdef FBOSS_CHECKSUM_AVX2
+  if (nativeSum() == nativeSumAvx2) {
+    return ChecksumImpl::AVX2;
+  }
+#endif
+  return ChecksumImpl::SCALAR;
+}
+
+void PktUtil::setChecksumImpl(ChecksumImpl impl) {
+  if (!checksumImplSupported(impl)) {
+    throw FbossError("checksum implementation ", static_cast<int>(impl),
+                     " is not supported on this CPU");
+  }
+  switch (impl) {
+    case ChecksumImpl::SCALAR:
+      nativeSum() = nativeSumScalar;
+      return;
+    case ChecksumImpl::AVX2:
+#ifdef FBOSS_CHECKSUM_AVX2
+      nativeSum() = nativeSumAvx2;
+#endif
+      return;
+  }
+}
+
 string PktUtil::hexDump(Cursor cursor) {
   return hexDump(cursor, cursor.totalLength());
 }
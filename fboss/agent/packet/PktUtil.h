@@ -10,10 +10,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <folly/MacAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
+#include <folly/Range.h>
 
 namespace folly {
 class IOBuf;
@@ -51,11 +53,21 @@ class PktUtil {
    */
   static folly::IPAddressV6 readIPv6(folly::io::Cursor* cursor);
 
+  /**
+   * Get all the data left after a Cursor as one contiguous range.
+   *
+   * The range points into the packet's own buffer when the data is all in
+   * one piece, as it is for packets received from the hardware.  Otherwise
+   * the data is copied into storage, and the range points there.
+   */
+  static folly::ByteRange contiguousRemainder(folly::io::Cursor cursor,
+                                              std::vector<uint8_t>* storage);
+
   /*
    * Compute internet checksum (as defined in RFC 1071) over a sequence
-   * of bytes. Code is as given in RFC 1071 section 4.1, with some
-   * modifications to handle odd number of bytes regardless of
-   * host m/c byte order.
+   * of bytes.  Each contiguous piece of the data is summed with the
+   * widest kernel the CPU supports (see ChecksumImpl below); odd numbers
+   * of bytes are handled regardless of host m/c byte order.
    * Checksum is returned in host byte order. Make sure to convert it
    * to n/w byte order if before sending it out on a wire.
    */
@@ -85,6 +97,38 @@ class PktUtil {
                                    uint32_t value);
   static uint16_t finalizeChecksum(uint32_t value);
 
+  /*
+   * Incrementally update an internet checksum after some of the data it
+   * covers changed, as described in RFC 1624.
+   *
+   * csum is the old checksum, and oldData / newData are the old and new
+   * contents of the changed range.  length must be even, and the range must
+   * start at an even offset from the start of the checksummed data.
+   */
+  static uint16_t updateChecksum(uint16_t csum,
+                                 const uint8_t* oldData,
+                                 const uint8_t* newData,
+                                 uint32_t length);
+
+  /*
+   * The kernels available for summing contiguous data in the checksum
+   * functions above.  The best one supported by the CPU is picked at
+   * startup; SCALAR is always supported.
+   */
+  enum class ChecksumImpl : uint8_t {
+    // Portable, sums 64 bits at a time
+    SCALAR,
+    // x86-64 with AVX2, sums 256 bits at a time
+    AVX2,
+  };
+  static bool checksumImplSupported(ChecksumImpl impl);
+  static ChecksumImpl getChecksumImpl();
+  /*
+   * Switch the checksum kernel.  This is not thread safe, and is only
+   * intended for tests and benchmarks.
+   */
+  static void setChecksumImpl(ChecksumImpl impl);
+
   /**
    * Return a string containing a human readable hex dump of the binary data.
    */
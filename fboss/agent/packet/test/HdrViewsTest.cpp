@@ -0,0 +1,188 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/packet/HdrViews.h"
+
+#include <gtest/gtest.h>
+
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+#include <vector>
+
+#include "fboss/agent/packet/PktUtil.h"
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using folly::io::Cursor;
+using std::unique_ptr;
+
+namespace {
+
+// IPv4, IHL 6 (one word of options), TTL 64, UDP, followed by 4 payload bytes
+const char* kIPv4Hex =
+  "46 00 00 1c  12 34 40 00  40 11 00 00"
+  "0a 00 00 0f  0a 00 00 01"
+  "01 02 03 04"
+  "de ad be ef";
+
+// IPv6, hop limit 255, ICMPv6, followed by 4 payload bytes
+const char* kIPv6Hex =
+  "60 00 00 00  00 04 3a ff"
+  "24 01 db 00 21 10 30 04  00 00 00 00 00 01 00 00"
+  "ff 02 00 00 00 00 00 00  00 00 00 01 ff 00 00 0a"
+  "de ad be ef";
+
+// ARP request from 10.0.0.15 for 10.0.0.1
+const char* kArpHex =
+  "00 01  08 00  06  04  00 01"
+  "00 02 00 01 02 03  0a 00 00 0f"
+  "00 00 00 00 00 00  0a 00 00 01"
+  "de ad be ef";
+
+// ARP over IEEE 802 networks, without any addresses
+const char* kArpIeee802Hex =
+  "00 06  08 00  06  04  00 01"
+  "de ad be ef";
+
+unique_ptr<IOBuf> parse(const char* hex) {
+  return IOBuf::copyBuffer(PktUtil::parseHexData(hex).coalesce());
+}
+
+// The packet in a single buffer, and split after every byte so that the
+// header isn't contiguous
+std::vector<unique_ptr<IOBuf>> variants(const char* hex) {
+  std::vector<unique_ptr<IOBuf>> bufs;
+  bufs.push_back(parse(hex));
+  auto data = bufs[0]->data();
+  auto chain = IOBuf::copyBuffer(data, 1);
+  for (size_t n = 1; n < bufs[0]->length(); ++n) {
+    chain->prependChain(IOBuf::copyBuffer(data + n, 1));
+  }
+  bufs.push_back(std::move(chain));
+  return bufs;
+}
+
+unique_ptr<IOBuf> truncated(const char* hex) {
+  auto buf = parse(hex);
+  buf->trimEnd(buf->length() - 16);
+  return buf;
+}
+
+} // unnamed namespace
+
+TEST(HdrViewsTest, IPv4) {
+  for (const auto& pkt : variants(kIPv4Hex)) {
+    Cursor viewCursor(pkt.get());
+    IPv4HdrView view(viewCursor);
+    Cursor hdrCursor(pkt.get());
+    IPv4Hdr hdr(hdrCursor);
+
+    EXPECT_EQ(hdr.version, view.version());
+    EXPECT_EQ(6, view.ihl());
+    EXPECT_EQ(24, view.size());
+    EXPECT_EQ(hdr.length, view.length());
+    EXPECT_EQ(hdr.id, view.id());
+    EXPECT_EQ(64, view.ttl());
+    EXPECT_EQ(IP_PROTO_UDP, view.protocol());
+    EXPECT_EQ(IPAddressV4("10.0.0.15"), view.srcAddr());
+    EXPECT_EQ(IPAddressV4("10.0.0.1"), view.dstAddr());
+    EXPECT_EQ(hdr, view.toHdr());
+    // Both leave the cursor at the payload
+    EXPECT_EQ(hdrCursor - Cursor(pkt.get()), viewCursor - Cursor(pkt.get()));
+    EXPECT_EQ(0xdeadbeef, viewCursor.readBE<uint32_t>());
+  }
+}
+
+TEST(HdrViewsTest, IPv6) {
+  for (const auto& pkt : variants(kIPv6Hex)) {
+    Cursor viewCursor(pkt.get());
+    IPv6HdrView view(viewCursor);
+    Cursor hdrCursor(pkt.get());
+    IPv6Hdr hdr(hdrCursor);
+
+    EXPECT_EQ(hdr.version, view.version());
+    EXPECT_EQ(hdr.flowLabel, view.flowLabel());
+    EXPECT_EQ(4, view.payloadLength());
+    EXPECT_EQ(IP_PROTO_IPV6_ICMP, view.nextHeader());
+    EXPECT_EQ(255, view.hopLimit());
+    EXPECT_EQ(IPAddressV6("2401:db00:2110:3004::1:0"), view.srcAddr());
+    EXPECT_EQ(IPAddressV6("ff02::1:ff00:a"), view.dstAddr());
+    EXPECT_EQ(hdr, view.toHdr());
+    EXPECT_EQ(0xdeadbeef, viewCursor.readBE<uint32_t>());
+  }
+}
+
+TEST(HdrViewsTest, Arp) {
+  for (const auto& pkt : variants(kArpHex)) {
+    Cursor viewCursor(pkt.get());
+    ArpHdrView view(viewCursor);
+    Cursor hdrCursor(pkt.get());
+    ArpHdr hdr(hdrCursor);
+
+    EXPECT_EQ(ARP_HTYPE_ETHERNET, view.htype());
+    EXPECT_EQ(ARP_PTYPE_IPV4, view.ptype());
+    EXPECT_EQ(ARP_HLEN_ETHERNET, view.hlen());
+    EXPECT_EQ(ARP_PLEN_IPV4, view.plen());
+    EXPECT_TRUE(view.isEthernetIPv4());
+    EXPECT_EQ(ARP_OPER_REQUEST, view.oper());
+    EXPECT_EQ(MacAddress("00:02:00:01:02:03"), view.sha());
+    EXPECT_EQ(IPAddressV4("10.0.0.15"), view.spa());
+    EXPECT_EQ(MacAddress("00:00:00:00:00:00"), view.tha());
+    EXPECT_EQ(IPAddressV4("10.0.0.1"), view.tpa());
+    EXPECT_EQ(hdr, view.toHdr());
+    EXPECT_EQ(0xdeadbeef, viewCursor.readBE<uint32_t>());
+  }
+}
+
+TEST(HdrViewsTest, ArpUnsupported) {
+  // Only the fixed part is needed to tell that the ARP type is unsupported
+  for (const auto& pkt : variants(kArpIeee802Hex)) {
+    Cursor viewCursor(pkt.get());
+    ArpHdrView view(viewCursor);
+
+    EXPECT_FALSE(view.isEthernetIPv4());
+    EXPECT_EQ(6, view.htype());
+    EXPECT_EQ(ARP_PTYPE_IPV4, view.ptype());
+    EXPECT_EQ(ARP_OPER_REQUEST, view.oper());
+    EXPECT_EQ(0xdeadbeef, viewCursor.readBE<uint32_t>());
+  }
+
+  // The fixed part itself is still required
+  auto arp = parse(kArpIeee802Hex);
+  arp->trimEnd(arp->length() - 4);
+  Cursor arpCursor(arp.get());
+  EXPECT_THROW(ArpHdrView view(arpCursor), HdrParseError);
+}
+
+TEST(HdrViewsTest, Errors) {
+  auto v4 = truncated(kIPv4Hex);
+  Cursor v4Cursor(v4.get());
+  EXPECT_THROW(IPv4HdrView view(v4Cursor), HdrParseError);
+  auto v6 = truncated(kIPv6Hex);
+  Cursor v6Cursor(v6.get());
+  EXPECT_THROW(IPv6HdrView view(v6Cursor), HdrParseError);
+  auto arp = truncated(kArpHex);
+  Cursor arpCursor(arp.get());
+  EXPECT_THROW(ArpHdrView view(arpCursor), HdrParseError);
+
+  // Wrong version
+  v6 = parse(kIPv6Hex);
+  v6Cursor = Cursor(v6.get());
+  EXPECT_THROW(IPv4HdrView view(v6Cursor), HdrParseError);
+
+  // Zero TTL
+  v4 = parse(kIPv4Hex);
+  v4->writableData()[8] = 0;
+  v4Cursor = Cursor(v4.get());
+  EXPECT_THROW(IPv4HdrView view(v4Cursor), HdrParseError);
+}
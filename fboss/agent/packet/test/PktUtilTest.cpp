@@ -17,6 +17,9 @@
 #include <folly/Random.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <vector>
+
 using namespace facebook::fboss;
 using folly::MacAddress;
 using folly::IPAddressV4;
@@ -212,3 +215,164 @@ TEST(Checksum, TestKnownOdd) {
   expected = ~expected;
   EXPECT_EQ(expected, PktUtil::internetChecksum(bytes, 9));
 }
+
+namespace {
+
+// The original word at a time implementation, used as the reference for
+// the checksum kernels
+uint16_t referenceChecksum(Cursor cursor, uint64_t length, uint32_t value) {
+  while (length > 1) {
+    value += cursor.readBE<uint16_t>();
+    length -= 2;
+  }
+  if (length) {
+    value += cursor.read<uint8_t>() << 8;
+  }
+  return PktUtil::finalizeChecksum(value);
+}
+
+std::vector<PktUtil::ChecksumImpl> supportedChecksumImpls() {
+  std::vector<PktUtil::ChecksumImpl> impls;
+  for (auto impl : {PktUtil::ChecksumImpl::SCALAR,
+                    PktUtil::ChecksumImpl::AVX2}) {
+    if (PktUtil::checksumImplSupported(impl)) {
+      impls.push_back(impl);
+    }
+  }
+  return impls;
+}
+
+// Restores the default checksum kernel when a test finishes
+class ChecksumImplGuard {
+ public:
+  ChecksumImplGuard() : impl_(PktUtil::getChecksumImpl()) {}
+  ~ChecksumImplGuard() {
+    PktUtil::setChecksumImpl(impl_);
+  }
+ private:
+  PktUtil::ChecksumImpl impl_;
+};
+
+/*
+ * Copy data into an IOBuf chain, starting a new buffer at each of the
+ * given split points.  Each buffer has some headroom so that the data is
+ * not always aligned the same way, and a split point may be repeated to
+ * put an empty buffer in the chain.
+ */
+std::unique_ptr<IOBuf> makeChain(const std::vector<uint8_t>& data,
+                                 std::vector<size_t> splits) {
+  splits.push_back(data.size());
+  std::unique_ptr<IOBuf> head;
+  size_t start = 0;
+  for (auto end : splits) {
+    auto headroom = Random::rand32(32);
+    auto buf = IOBuf::create(headroom + end - start);
+    buf->advance(headroom);
+    memcpy(buf->writableData(), data.data() + start, end - start);
+    buf->append(end - start);
+    if (head) {
+      head->prependChain(std::move(buf));
+    } else {
+      head = std::move(buf);
+    }
+    start = end;
+  }
+  return head;
+}
+
+} // unnamed namespace
+
+TEST(Checksum, KernelsMatchReferenceContiguous) {
+  ChecksumImplGuard guard;
+  std::vector<uint8_t> storage(2048 + 32);
+  for (auto impl : supportedChecksumImpls()) {
+    PktUtil::setChecksumImpl(impl);
+    for (size_t length = 0; length <= 2048; ++length) {
+      // Cover every alignment of the start of the data
+      auto offset = length % 32;
+      for (size_t i = 0; i < length; ++i) {
+        storage[offset + i] = Random::rand32(256);
+      }
+      const uint8_t* data = storage.data() + offset;
+      IOBuf buf(IOBuf::WRAP_BUFFER, data, length);
+      auto expected = referenceChecksum(Cursor(&buf), length, 0);
+      EXPECT_EQ(expected, PktUtil::internetChecksum(data, length))
+        << "impl " << static_cast<int>(impl) << " length " << length;
+    }
+  }
+}
+
+TEST(Checksum, KernelsMatchReferenceAllOnes) {
+  // All 0xff bytes make every addition carry, and sum to the one's
+  // complement representation of zero.
+  ChecksumImplGuard guard;
+  std::vector<uint8_t> data(9000, 0xff);
+  for (auto impl : supportedChecksumImpls()) {
+    PktUtil::setChecksumImpl(impl);
+    for (size_t length : {0, 1, 2, 3, 31, 32, 33, 64, 1500, 8999, 9000}) {
+      IOBuf buf(IOBuf::WRAP_BUFFER, data.data(), length);
+      EXPECT_EQ(referenceChecksum(Cursor(&buf), length, 0),
+                PktUtil::internetChecksum(data.data(), length))
+        << "impl " << static_cast<int>(impl) << " length " << length;
+    }
+  }
+}
+
+TEST(Checksum, KernelsMatchReferenceChained) {
+  ChecksumImplGuard guard;
+  for (auto impl : supportedChecksumImpls()) {
+    PktUtil::setChecksumImpl(impl);
+    for (size_t length = 1; length <= 160; ++length) {
+      std::vector<uint8_t> data(length);
+      for (auto& byte : data) {
+        byte = Random::rand32(256);
+      }
+      IOBuf flat(IOBuf::WRAP_BUFFER, data.data(), length);
+      auto expected = referenceChecksum(Cursor(&flat), length, 0);
+
+      // Every single split point, including empty first and last buffers
+      for (size_t split = 0; split <= length; ++split) {
+        auto chain = makeChain(data, {split});
+        EXPECT_EQ(expected, PktUtil::internetChecksum(chain.get()))
+          << "impl " << static_cast<int>(impl) << " length " << length
+          << " split " << split;
+      }
+
+      // Random chains of several buffers, with odd and empty pieces
+      for (int iter = 0; iter < 20; ++iter) {
+        std::vector<size_t> splits;
+        auto numSplits = Random::rand32(6);
+        for (uint32_t n = 0; n < numSplits; ++n) {
+          splits.push_back(Random::rand32(length + 1));
+        }
+        std::sort(splits.begin(), splits.end());
+        auto chain = makeChain(data, splits);
+        EXPECT_EQ(expected, PktUtil::internetChecksum(chain.get()))
+          << "impl " << static_cast<int>(impl) << " length " << length;
+
+        // Part way into the chain, with a starting partial sum
+        auto skip = Random::rand32(length + 1) & ~1;
+        auto value = Random::rand32(0x10000);
+        Cursor refCursor(&flat);
+        refCursor.skip(skip);
+        Cursor cursor(chain.get());
+        cursor.skip(skip);
+        EXPECT_EQ(referenceChecksum(refCursor, length - skip, value),
+                  PktUtil::finalizeChecksum(cursor, length - skip, value))
+          << "impl " << static_cast<int>(impl) << " length " << length
+          << " skip " << skip;
+        auto even = (length - skip) & ~1;
+        EXPECT_EQ(referenceChecksum(refCursor, even, value),
+                  PktUtil::finalizeChecksum(
+                      PktUtil::partialChecksum(cursor, even, value)));
+      }
+    }
+  }
+}
+
+TEST(Checksum, TruncatedChain) {
+  std::vector<uint8_t> data(20, 1);
+  auto chain = makeChain(data, {7, 7, 13});
+  EXPECT_THROW(PktUtil::finalizeChecksum(Cursor(chain.get()), 21, 0),
+               std::out_of_range);
+}
@@ -38,8 +38,8 @@ void WedgeI2CBusLock::close() {
   closeLocked();
 }
 
-void WedgeI2CBusLock::moduleRead(unsigned int module, uint8_t address,
-                             int offset, int len, uint8_t *buf) {
+template <typename Fn>
+void WedgeI2CBusLock::withBus(Fn fn) {
   lock_guard<std::mutex> g(busMutex_);
 
   // If no one has opened the device, open it, and close it when we
@@ -58,30 +58,30 @@ void WedgeI2CBusLock::moduleRead(unsigned int module, uint8_t address,
     opened = true;
   }
 
-  wedgeI2CBus_->moduleRead(module, address, offset, len, buf);
+  fn();
+}
+
+void WedgeI2CBusLock::moduleRead(unsigned int module, uint8_t address,
+                             int offset, int len, uint8_t *buf) {
+  withBus([&] {
+    wedgeI2CBus_->moduleRead(module, address, offset, len, buf);
+  });
 }
 
 void WedgeI2CBusLock::moduleWrite(unsigned int module, uint8_t address,
                               int offset, int len, uint8_t *buf) {
-  lock_guard<std::mutex> g(busMutex_);
-
-  // If no one has opened the device, open it, and close it when we
-  // leave.  If it has already been opened (say, when we batch a big
-  // set of reads), then don't bother to open it.
-  bool opened = false;
-
-  SCOPE_EXIT {
-    if (opened) {
-      closeLocked();
-    }
-  };
-
-  if (!opened_) {
-    openLocked();
-    opened = true;
-  }
+  withBus([&] {
+    wedgeI2CBus_->moduleWrite(module, address, offset, len, buf);
+  });
+}
 
-  wedgeI2CBus_->moduleWrite(module, address, offset, len, buf);
+void WedgeI2CBusLock::moduleTransaction(
+    unsigned int module, const std::vector<TransceiverI2CApi::Op>& ops) {
+  // Opening the bus resets the I2C switches, so doing it once for all of
+  // the operations saves far more than the switch selection.
+  withBus([&] {
+    wedgeI2CBus_->moduleTransaction(module, ops);
+  });
 }
 
 }} // facebook::fboss
@@ -29,6 +29,8 @@ class WedgeI2CBusLock {
                   int offset, int len, uint8_t* buf);
   void moduleWrite(unsigned int module, uint8_t i2cAddress,
                   int offset, int len, uint8_t* buf);
+  void moduleTransaction(unsigned int module,
+                         const std::vector<TransceiverI2CApi::Op>& ops);
 
  private:
 
@@ -39,6 +41,13 @@ class WedgeI2CBusLock {
   void openLocked();
   void closeLocked();
 
+  /*
+   * Run fn with the lock held and the bus open.  If nobody has opened the
+   * bus, it is only kept open for the duration of the call.
+   */
+  template <typename Fn>
+  void withBus(Fn fn);
+
   std::unique_ptr<BaseWedgeI2CBus> wedgeI2CBus_{nullptr};
   mutable std::mutex busMutex_;
   bool opened_{false};
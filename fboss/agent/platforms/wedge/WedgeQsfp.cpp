@@ -72,6 +72,16 @@ int WedgeQsfp::writeTransceiver(int dataAddress, int offset,
   return len;
 }
 
+bool WedgeQsfp::transceiverTransaction(
+    const std::vector<TransceiverI2CApi::Op>& ops) {
+  try {
+    wedgeI2CBusLock_->moduleTransaction(module_ + 1, ops);
+  } catch (const UsbError& ex) {
+    return false;
+  }
+  return true;
+}
+
 folly::StringPiece WedgeQsfp::getName() {
   return moduleName_;
 }
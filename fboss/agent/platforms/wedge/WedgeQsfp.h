@@ -30,6 +30,9 @@ class WedgeQsfp : public TransceiverImpl {
   /* write to the eeprom (usually to change the page setting) */
   int writeTransceiver(int dataAddress, int offset,
                        int len, uint8_t* fieldValue) override;
+  /* Run all of the operations with the module selected just once */
+  bool transceiverTransaction(
+      const std::vector<TransceiverI2CApi::Op>& ops) override;
   /* This function detects if a SFP is present on the particular port */
   bool detectTransceiver() override;
   /* Returns the name for the port */
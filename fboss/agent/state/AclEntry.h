@@ -49,7 +49,7 @@ class AclEntry :
   static std::shared_ptr<AclEntry>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = AclEntryFields::fromFollyDynamic(json);
-    return std::make_shared<AclEntry>(fields);
+    return makeNode<AclEntry>(fields);
   }
 
   static std::shared_ptr<AclEntry>
@@ -73,7 +73,7 @@ class Interface : public NodeBaseT<Interface, InterfaceFields> {
   static std::shared_ptr<Interface>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = InterfaceFields::fromFollyDynamic(json);
-    return std::make_shared<Interface>(fields);
+    return makeNode<Interface>(fields);
   }
 
   static std::shared_ptr<Interface>
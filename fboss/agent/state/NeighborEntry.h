@@ -77,7 +77,7 @@ class NeighborEntry : public NodeBaseT<SUBCLASS, NeighborEntryFields<IPADDR>> {
   static std::shared_ptr<SUBCLASS>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = NeighborEntryFields<IPADDR>::fromFollyDynamic(json);
-    return std::make_shared<SUBCLASS>(fields);
+    return makeNode<SUBCLASS>(fields);
   }
 
   static std::shared_ptr<SUBCLASS>
@@ -92,7 +92,7 @@ class NeighborResponseTable
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields =
       NeighborResponseTableFields<IPADDR>::fromFollyDynamic(json);
-    return std::make_shared<SUBCLASS>(fields);
+    return makeNode<SUBCLASS>(fields);
   }
 
   static std::shared_ptr<SUBCLASS>
@@ -47,7 +47,7 @@ void NeighborTable<IPADDR, ENTRY, SUBCLASS>::addEntry(
     PortID port,
     InterfaceID intfID) {
   CHECK(!this->isPublished());
-  auto entry = std::make_shared<Entry>(ip, mac, port, intfID);
+  auto entry = makeNode<Entry>(ip, mac, port, intfID);
   this->addNode(entry);
 }
 
@@ -89,7 +89,7 @@ void NeighborTable<IPADDR, ENTRY, SUBCLASS>::addPendingEntry(
     IPADDR ip,
     InterfaceID intfID) {
   CHECK(!this->isPublished());
-  auto pendingEntry = std::make_shared<Entry>(ip, intfID, PENDING);
+  auto pendingEntry = makeNode<Entry>(ip, intfID, PENDING);
   this->addNode(pendingEntry);
  }
 
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <folly/Hash.h>
+
+namespace facebook { namespace fboss {
+
+/*
+ * NexthopGroup is an immutable, interned set of nexthops.
+ *
+ * A FIB typically has a very large number of routes spread over a handful of
+ * ECMP sets.  Rather than each route keeping its own copy of its nexthops,
+ * all of the routes with the same nexthops share one NexthopGroup.  There is
+ * never more than one live group for a given set, so two groups are equal if
+ * and only if they are the same object: comparing the nexthops of two routes
+ * is a pointer compare, and id() can stand in for the whole set as a map key.
+ *
+ * Groups are reference counted, and are dropped from the intern table when
+ * the last reference goes away.  IDs are never reused.  get() may be called
+ * from any thread.
+ */
+template <typename NexthopsT,
+          typename HashT = std::hash<typename NexthopsT::value_type>>
+class NexthopGroup {
+ public:
+  typedef NexthopsT Nexthops;
+  typedef uint64_t ID;
+
+  /*
+   * Return the group for nexthops, creating it if there isn't one yet.
+   */
+  static std::shared_ptr<const NexthopGroup> get(Nexthops nexthops) {
+    if (nexthops.empty()) {
+      return emptyGroup();
+    }
+    auto hash = computeHash(nexthops);
+    auto& table = getTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    auto range = table.groups.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.first->nexthops_ != nexthops) {
+        continue;
+      }
+      auto group = it->second.second.lock();
+      if (group) {
+        return group;
+      }
+      // The group is being destroyed, and release() is waiting for the lock
+      // to remove it.  Fall through and make a new one.
+    }
+    std::shared_ptr<const NexthopGroup> group(
+        new NexthopGroup(std::move(nexthops), hash, table.nextID++),
+        &NexthopGroup::release);
+    table.groups.emplace(hash, std::make_pair(
+        group.get(), std::weak_ptr<const NexthopGroup>(group)));
+    return group;
+  }
+
+  /*
+   * The group with no nexthops.  It is never destroyed, and has ID 0.
+   */
+  static const std::shared_ptr<const NexthopGroup>& emptyGroup() {
+    static const auto* group = new std::shared_ptr<const NexthopGroup>(
+        new NexthopGroup(Nexthops(), 0, 0));
+    return *group;
+  }
+
+  /*
+   * The number of non-empty groups in the intern table.
+   */
+  static size_t numGroups() {
+    auto& table = getTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    return table.groups.size();
+  }
+
+  const Nexthops& nexthops() const {
+    return nexthops_;
+  }
+  size_t hash() const {
+    return hash_;
+  }
+  ID id() const {
+    return id_;
+  }
+
+ private:
+  struct Table {
+    std::mutex lock;
+    // hash -> the group, and a weak reference used to hand it out again.
+    // The raw pointer identifies the entry in release(), after the weak
+    // reference has already expired.
+    std::unordered_multimap<size_t, std::pair<
+      const NexthopGroup*, std::weak_ptr<const NexthopGroup>>> groups;
+    ID nextID{1};
+  };
+
+  NexthopGroup(Nexthops nexthops, size_t hash, ID id)
+    : nexthops_(std::move(nexthops)),
+      hash_(hash),
+      id_(id) {}
+
+  // Forbidden copy constructor and assignment operator
+  NexthopGroup(NexthopGroup const &) = delete;
+  NexthopGroup& operator=(NexthopGroup const &) = delete;
+
+  static Table& getTable() {
+    // Leaked, so that groups held by other statics can still be released
+    // during shutdown.
+    static auto* table = new Table();
+    return *table;
+  }
+
+  static size_t computeHash(const Nexthops& nexthops) {
+    HashT hasher;
+    uint64_t hash = nexthops.size();
+    for (const auto& nexthop : nexthops) {
+      hash = folly::hash::hash_128_to_64(hash, hasher(nexthop));
+    }
+    return hash;
+  }
+
+  static void release(const NexthopGroup* group) {
+    {
+      auto& table = getTable();
+      std::lock_guard<std::mutex> guard(table.lock);
+      auto range = table.groups.equal_range(group->hash_);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.first == group) {
+          table.groups.erase(it);
+          break;
+        }
+      }
+    }
+    delete group;
+  }
+
+  const Nexthops nexthops_;
+  const size_t hash_;
+  const ID id_;
+};
+
+}} // facebook::fboss
@@ -0,0 +1,170 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/NodeAllocator.h"
+
+#include <array>
+#include <atomic>
+#include <new>
+
+#include <folly/SpinLock.h>
+#include <glog/logging.h>
+
+DEFINE_bool(state_node_pool, false,
+            "Allocate SwitchState nodes from a pool of size-class free lists "
+            "that is reused across state generations");
+
+namespace {
+
+// Chunk sizes are rounded up to a multiple of kGranularity.  Anything larger
+// than kMaxPooledSize goes straight to operator new.
+constexpr size_t kGranularity = 16;
+constexpr size_t kMaxPooledSize = 1024;
+constexpr size_t kNumSizeClasses = kMaxPooledSize / kGranularity;
+constexpr size_t kSlabSize = 64 * 1024;
+
+struct FreeChunk {
+  FreeChunk* next;
+};
+
+struct SizeClass {
+  folly::SpinLock lock;
+  FreeChunk* freeList{nullptr};
+};
+
+std::array<SizeClass, kNumSizeClasses> sizeClasses;
+
+// Set by NodePool::init()
+std::atomic<bool> poolEnabled{false};
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> deallocations{0};
+std::atomic<uint64_t> unpooledAllocations{0};
+std::atomic<uint64_t> slabs{0};
+std::atomic<uint64_t> bytesInUse{0};
+std::atomic<uint64_t> bytesReserved{0};
+// Allocations of poolable sizes made while the pool was disabled, and not
+// freed yet
+std::atomic<uint64_t> smallUnpooledInUse{0};
+
+bool isPoolableSize(size_t size) {
+  return size != 0 && size <= kMaxPooledSize;
+}
+
+size_t sizeClassIndex(size_t size) {
+  return (size + kGranularity - 1) / kGranularity - 1;
+}
+
+/*
+ * Carve a new slab into chunks of the given size and return them as a
+ * linked list.  Called with the size class lock held.
+ */
+FreeChunk* allocateSlab(size_t chunkSize) {
+  auto slab = static_cast<char*>(::operator new(kSlabSize));
+  slabs.fetch_add(1, std::memory_order_relaxed);
+  bytesReserved.fetch_add(kSlabSize, std::memory_order_relaxed);
+
+  FreeChunk* head = nullptr;
+  for (size_t offset = kSlabSize - kSlabSize % chunkSize;
+       offset >= chunkSize; offset -= chunkSize) {
+    auto chunk = reinterpret_cast<FreeChunk*>(slab + offset - chunkSize);
+    chunk->next = head;
+    head = chunk;
+  }
+  return head;
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+void NodePool::init() {
+  bool enable = FLAGS_state_node_pool;
+  if (enable == enabled()) {
+    return;
+  }
+  // Chunks allocated one way would otherwise be freed the other way
+  if (enable) {
+    CHECK_EQ(0, smallUnpooledInUse.load())
+      << "cannot enable the node pool while unpooled nodes are alive";
+  } else {
+    CHECK_EQ(0, bytesInUse.load())
+      << "cannot disable the node pool while pooled nodes are alive";
+  }
+  poolEnabled.store(enable);
+}
+
+bool NodePool::enabled() {
+  return poolEnabled.load(std::memory_order_relaxed);
+}
+
+void* NodePool::allocate(size_t size) {
+  if (!isPoolableSize(size)) {
+    unpooledAllocations.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(size);
+  }
+  if (!enabled()) {
+    unpooledAllocations.fetch_add(1, std::memory_order_relaxed);
+    smallUnpooledInUse.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(size);
+  }
+
+  auto index = sizeClassIndex(size);
+  auto chunkSize = (index + 1) * kGranularity;
+  auto& sizeClass = sizeClasses[index];
+  FreeChunk* chunk;
+  {
+    folly::SpinLockGuard guard(sizeClass.lock);
+    if (!sizeClass.freeList) {
+      sizeClass.freeList = allocateSlab(chunkSize);
+    }
+    chunk = sizeClass.freeList;
+    sizeClass.freeList = chunk->next;
+  }
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  bytesInUse.fetch_add(chunkSize, std::memory_order_relaxed);
+  return chunk;
+}
+
+void NodePool::deallocate(void* ptr, size_t size) {
+  if (!isPoolableSize(size)) {
+    ::operator delete(ptr);
+    return;
+  }
+  if (!enabled()) {
+    smallUnpooledInUse.fetch_sub(1, std::memory_order_relaxed);
+    ::operator delete(ptr);
+    return;
+  }
+
+  auto index = sizeClassIndex(size);
+  auto& sizeClass = sizeClasses[index];
+  auto chunk = static_cast<FreeChunk*>(ptr);
+  {
+    folly::SpinLockGuard guard(sizeClass.lock);
+    chunk->next = sizeClass.freeList;
+    sizeClass.freeList = chunk;
+  }
+  deallocations.fetch_add(1, std::memory_order_relaxed);
+  bytesInUse.fetch_sub((index + 1) * kGranularity, std::memory_order_relaxed);
+}
+
+NodePool::Stats NodePool::getStats() {
+  Stats stats;
+  stats.allocations = allocations.load(std::memory_order_relaxed);
+  stats.deallocations = deallocations.load(std::memory_order_relaxed);
+  stats.unpooledAllocations =
+    unpooledAllocations.load(std::memory_order_relaxed);
+  stats.slabs = slabs.load(std::memory_order_relaxed);
+  stats.bytesInUse = bytesInUse.load(std::memory_order_relaxed);
+  stats.bytesReserved = bytesReserved.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,128 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <gflags/gflags.h>
+
+DECLARE_bool(state_node_pool);
+
+namespace facebook { namespace fboss {
+
+/*
+ * NodePool is a size-class allocator for SwitchState nodes.
+ *
+ * Every state update clones the nodes along the path to each change, and
+ * frees the nodes of the generation it replaces.  Large updates (and warm
+ * boot, which rebuilds the whole tree) therefore make millions of small,
+ * short lived allocations of a handful of sizes.  NodePool carves memory for
+ * each size class out of large slabs, and keeps freed chunks on per size
+ * class free lists so the next generation reuses them.  This keeps nodes
+ * created by one update close together in memory and avoids most malloc
+ * calls.
+ *
+ * Memory handed to the pool is never returned to the system; the pool
+ * grows to the peak number of live nodes and stays there.
+ *
+ * The pool is only used when --state_node_pool is set.  The flag is read
+ * once, by NodePool::init(); until that is called every node comes from
+ * operator new.
+ */
+class NodePool {
+ public:
+  struct Stats {
+    // Allocations served from the pool
+    uint64_t allocations{0};
+    // Chunks handed back to the pool
+    uint64_t deallocations{0};
+    // Allocations that bypassed the pool, because they were too large or
+    // the pool is disabled
+    uint64_t unpooledAllocations{0};
+    // Number of slabs the pool had to allocate from the system
+    uint64_t slabs{0};
+    // Bytes of pooled chunks currently handed out
+    uint64_t bytesInUse{0};
+    // Bytes obtained from the system for slabs
+    uint64_t bytesReserved{0};
+  };
+
+  static void* allocate(size_t size);
+  static void deallocate(void* ptr, size_t size);
+
+  static Stats getStats();
+
+  /*
+   * Enable or disable the pool according to --state_node_pool.
+   *
+   * main() calls this once the command line has been parsed, before any
+   * SwitchState is built.  A chunk has to be freed the same way it was
+   * allocated, so changing the setting while nodes small enough to be pooled
+   * are alive is a fatal error.  Tests may call it again to toggle the pool
+   * once they have freed their nodes.
+   */
+  static void init();
+
+  // The setting picked by the last init()
+  static bool enabled();
+
+ private:
+  // Not constructible; everything is static
+  NodePool() = delete;
+};
+
+/*
+ * A std::allocator compatible allocator backed by NodePool.
+ *
+ * Use it with std::allocate_shared() (or makeNode() below) so that the node
+ * and its shared_ptr control block come from the pool in one chunk.
+ */
+template <typename T>
+class NodeAllocator : public std::allocator<T> {
+ public:
+  template <typename U>
+  struct rebind {
+    typedef NodeAllocator<U> other;
+  };
+
+  NodeAllocator() {}
+  template <typename U>
+  NodeAllocator(const NodeAllocator<U>&) {}
+
+  T* allocate(size_t n, const void* /*hint*/ = nullptr) {
+    return static_cast<T*>(NodePool::allocate(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, size_t n) {
+    NodePool::deallocate(ptr, n * sizeof(T));
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const NodeAllocator<T>&, const NodeAllocator<U>&) {
+  return true;
+}
+template <typename T, typename U>
+bool operator!=(const NodeAllocator<T>&, const NodeAllocator<U>&) {
+  return false;
+}
+
+/*
+ * Equivalent of std::make_shared() for state nodes.
+ */
+template <typename NodeT, typename... Args>
+std::shared_ptr<NodeT> makeNode(Args&&... args) {
+  return std::allocate_shared<NodeT>(NodeAllocator<NodeT>(),
+                                     std::forward<Args>(args)...);
+}
+
+}} // facebook::fboss
@@ -11,6 +11,7 @@
 
 #include "fboss/agent/types.h"
 #include "fboss/agent/Utils.h"
+#include "fboss/agent/state/NodeAllocator.h"
 
 #include <boost/cast.hpp>
 #include <boost/container/flat_map.hpp>
@@ -172,9 +173,11 @@ class NodeBaseT : public NodeBase {
    * published and committed.
    *
    * The new node is returned as a shared_ptr for efficient allocation with
-   * make_shared (since published node objects must eventually be stored in a
-   * shared_ptr).  However, the caller is the sole owner of the new object when
-   * it is returned.
+   * allocate_shared (since published node objects must eventually be stored
+   * in a shared_ptr).  However, the caller is the sole owner of the new
+   * object when it is returned.
+   *
+   * The memory comes from NodePool when it is enabled.
    */
   std::shared_ptr<Node> clone() const;
 
@@ -237,7 +240,7 @@ class NodeBaseT : public NodeBase {
       fields_(orig->fields_, std::forward<Args>(args)...) {}
 
  protected:
-  class CloneAllocator : public std::allocator<NodeT> {
+  class CloneAllocator : public NodeAllocator<NodeT> {
    public:
     template<typename... Args>
     void construct(void* p, Args&&... args) {
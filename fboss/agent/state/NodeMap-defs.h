@@ -120,7 +120,7 @@ folly::dynamic NodeMapT<MapTypeT, TraitsT>::toFollyDynamic() const {
 template <typename MapTypeT, typename TraitsT>
 std::shared_ptr<MapTypeT>
 NodeMapT<MapTypeT, TraitsT>::fromFollyDynamic(const folly::dynamic& nodesJson) {
-  auto nodeMap = std::make_shared<MapTypeT>();
+  auto nodeMap = makeNode<MapTypeT>();
   auto entries = nodesJson[kEntries];
   for (const auto& entry: entries) {
     nodeMap->addNode(Node::fromFollyDynamic(entry));
@@ -68,7 +68,7 @@ class Port : public NodeBaseT<Port, PortFields> {
   static std::shared_ptr<Port>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = PortFields::fromFollyDynamic(json);
-    return std::make_shared<Port>(fields);
+    return makeNode<Port>(fields);
   }
 
   static std::shared_ptr<Port>
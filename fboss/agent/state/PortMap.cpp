@@ -22,7 +22,7 @@ PortMap::~PortMap() {
 }
 
 void PortMap::registerPort(PortID id, const std::string& name) {
-  addNode(std::make_shared<Port>(id, name));
+  addNode(makeNode<Port>(id, name));
 }
 
 PortMap* PortMap::modify(std::shared_ptr<SwitchState>* state) {
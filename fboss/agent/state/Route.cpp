@@ -56,7 +56,7 @@ folly::dynamic RouteFields<AddrT>::toFollyDynamic() const {
   folly::dynamic routeFields = folly::dynamic::object;
   routeFields[kPrefix] = prefix.toFollyDynamic();
   std::vector<folly::dynamic> nhopsList;
-  for (const auto& nhop: nexthops) {
+  for (const auto& nhop: nexthops->nexthops()) {
     nhopsList.emplace_back(nhop.str());
   }
   routeFields[kNextHops] = nhopsList;
@@ -69,9 +69,11 @@ template<typename AddrT>
 RouteFields<AddrT>
 RouteFields<AddrT>::fromFollyDynamic(const folly::dynamic& routeJson) {
   RouteFields rt(Prefix::fromFollyDynamic(routeJson[kPrefix]));
+  RouteNextHops nexthops;
   for (const auto& nhop: routeJson[kNextHops]) {
-    rt.nexthops.emplace(nhop.stringPiece());
+    nexthops.emplace(nhop.stringPiece());
   }
+  rt.nexthops = RouteNextHopGroup::get(std::move(nexthops));
   rt.fwd = RouteForwardInfo::fromFollyDynamic(routeJson[kFwdInfo]);
   rt.flags = routeJson[kFlags].asInt();
   return rt;
@@ -100,6 +102,13 @@ Route<AddrT>::Route(const Prefix& prefix, RouteNextHops&& nhs)
   update(std::move(nhs));
 }
 
+template<typename AddrT>
+Route<AddrT>::Route(const Prefix& prefix,
+                    std::shared_ptr<const RouteNextHopGroup> nhs)
+    : RouteBase(prefix) {
+  update(std::move(nhs));
+}
+
 template<typename AddrT>
 Route<AddrT>::Route(const Prefix& prefix, Action action)
     : RouteBase(prefix) {
@@ -114,7 +123,7 @@ template<typename AddrT>
 std::string Route<AddrT>::str() const {
   std::string ret;
   ret = folly::to<string>(prefix(), '@');
-  for (const auto& nh : RouteBase::getFields()->nexthops) {
+  for (const auto& nh : nexthops()) {
     ret.append(folly::to<string>(nh, "."));
   }
   ret.append(" State:");
@@ -149,6 +158,12 @@ bool Route<AddrT>::isSame(InterfaceID intf, const IPAddress& addr) const {
 
 template<typename AddrT>
 bool Route<AddrT>::isSame(const RouteNextHops& nhs) const {
+  return nexthops() == nhs;
+}
+
+template<typename AddrT>
+bool Route<AddrT>::isSame(
+    const std::shared_ptr<const RouteNextHopGroup>& nhs) const {
   return RouteBase::getFields()->nexthops == nhs;
 }
 
@@ -170,30 +185,29 @@ bool Route<AddrT>::isSame(const Route<AddrT>* rt) const {
 template<typename AddrT>
 void Route<AddrT>::update(InterfaceID intf, const IPAddress& addr) {
   // clear all existing nexthop info
-  RouteBase::writableFields()->nexthops.clear();
+  RouteBase::writableFields()->nexthops = RouteNextHopGroup::emptyGroup();
   // replace the forwarding info for this route with just one nexthop
   RouteBase::writableFields()->fwd.setNexthops(intf, addr);
   setFlagsConnected();
 }
 
 template<typename AddrT>
-void Route<AddrT>::updateNexthopCommon(const RouteNextHops& nhs) {
-  if (!nhs.size()) {
-    throw FbossError("Update with an empty set of nexthops for route ", str());
-  }
-  RouteBase::writableFields()->fwd.reset();
-  clearFlags();
+void Route<AddrT>::update(const RouteNextHops& nhs) {
+  update(RouteNextHopGroup::get(nhs));
 }
 
 template<typename AddrT>
-void Route<AddrT>::update(const RouteNextHops& nhs) {
-  updateNexthopCommon(nhs);
-  RouteBase::writableFields()->nexthops = nhs;
+void Route<AddrT>::update(RouteNextHops&& nhs) {
+  update(RouteNextHopGroup::get(std::move(nhs)));
 }
 
 template<typename AddrT>
-void Route<AddrT>::update(RouteNextHops&& nhs) {
-  updateNexthopCommon(nhs);
+void Route<AddrT>::update(std::shared_ptr<const RouteNextHopGroup> nhs) {
+  if (nhs->nexthops().empty()) {
+    throw FbossError("Update with an empty set of nexthops for route ", str());
+  }
+  RouteBase::writableFields()->fwd.reset();
+  clearFlags();
   RouteBase::writableFields()->nexthops = std::move(nhs);
 }
 
@@ -201,7 +215,7 @@ template<typename AddrT>
 void Route<AddrT>::update(Action action) {
   CHECK(action == Action::DROP || action == Action::TO_CPU);
   // clear all existing nexthop info
-  RouteBase::writableFields()->nexthops.clear();
+  RouteBase::writableFields()->nexthops = RouteNextHopGroup::emptyGroup();
   if (action == Action::DROP) {
     this->writableFields()->fwd.setDrop();
     setFlagsResolved();
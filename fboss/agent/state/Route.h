@@ -51,9 +51,11 @@ struct RouteFields {
   // The following fields will not be copied during clone()
   /*
    * All next hops of the routes. This set could be empty if and only if
-   * the route is directly connected
+   * the route is directly connected.  The group is interned, so routes with
+   * the same next hops share it.
    */
-  RouteNextHops nexthops;
+  std::shared_ptr<const RouteNextHopGroup> nexthops{
+    RouteNextHopGroup::emptyGroup()};
   RouteForwardInfo fwd;
   uint32_t flags{0};
 };
@@ -70,6 +72,7 @@ class Route : public NodeBaseT<Route<AddrT>, RouteFields<AddrT>> {
   // Constructor for a route with ECMP
   Route(const Prefix& prefix, const RouteNextHops& nhs);
   Route(const Prefix& prefix, RouteNextHops&& nhs);
+  Route(const Prefix& prefix, std::shared_ptr<const RouteNextHopGroup> nhs);
   // Constructor for a route with special forwarding action
   Route(const Prefix& prefix, Action action);
 
@@ -78,7 +81,7 @@ class Route : public NodeBaseT<Route<AddrT>, RouteFields<AddrT>> {
   static std::shared_ptr<Route<AddrT>>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = RouteFields<AddrT>::fromFollyDynamic(json);
-    return std::make_shared<Route<AddrT>>(fields);
+    return makeNode<Route<AddrT>>(fields);
   }
 
   static std::shared_ptr<Route<AddrT>>
@@ -131,10 +134,14 @@ class Route : public NodeBaseT<Route<AddrT>, RouteFields<AddrT>> {
     return RouteBase::getFields()->fwd;
   }
   const RouteNextHops& nexthops() const {
+    return RouteBase::getFields()->nexthops->nexthops();
+  }
+  const std::shared_ptr<const RouteNextHopGroup>& getNexthopGroup() const {
     return RouteBase::getFields()->nexthops;
   }
   bool isSame(InterfaceID intf, const folly::IPAddress& addr) const;
   bool isSame(const RouteNextHops& nhs) const;
+  bool isSame(const std::shared_ptr<const RouteNextHopGroup>& nhs) const;
   bool isSame(Action action) const;
   bool isSame(const Route* rt) const;
   /*
@@ -170,12 +177,12 @@ class Route : public NodeBaseT<Route<AddrT>, RouteFields<AddrT>> {
   void update(InterfaceID intf, const folly::IPAddress& addr);
   void update(const RouteNextHops& nhs);
   void update(RouteNextHops&& nhs);
+  void update(std::shared_ptr<const RouteNextHopGroup> nhs);
   void update(Action action);
  private:
   // no copy or assign operator
   Route(const Route &) = delete;
   Route& operator&(const Route &) = delete;
-  void updateNexthopCommon(const RouteNextHops& nhs);
   /**
    * Bit definition for RouteFields<>::flags
    *
@@ -65,7 +65,7 @@ folly::dynamic RouteForwardInfo::toFollyDynamic() const {
   folly::dynamic fwdInfo = folly::dynamic::object;
   fwdInfo[kAction] = forwardActionStr(action_);
   vector<folly::dynamic> nhops;
-  for (const auto& nhop: nexthops_) {
+  for (const auto& nhop: getNexthops()) {
     nhops.push_back(nhop.toFollyDynamic());
   }
   fwdInfo[kNexthops] = std::move(nhops);
@@ -75,9 +75,11 @@ folly::dynamic RouteForwardInfo::toFollyDynamic() const {
 RouteForwardInfo
 RouteForwardInfo::fromFollyDynamic(const folly::dynamic& fwdInfoJson) {
   RouteForwardInfo fwdInfo;
+  Nexthops nexthops;
   for (const auto& nhop: fwdInfoJson[kNexthops]) {
-    fwdInfo.nexthops_.insert(Nexthop::fromFollyDynamic(nhop));
+    nexthops.insert(Nexthop::fromFollyDynamic(nhop));
   }
+  fwdInfo.nexthops_ = Group::get(std::move(nexthops));
   fwdInfo.action_ = str2ForwardAction(fwdInfoJson[kAction].asString());
   return fwdInfo;
 }
@@ -13,6 +13,7 @@
 #include <folly/dynamic.h>
 #include <folly/IPAddress.h>
 #include "fboss/agent/types.h"
+#include "fboss/agent/state/NexthopGroup.h"
 #include "fboss/agent/state/RouteTypes.h"
 
 #include <boost/container/flat_set.hpp>
@@ -40,10 +41,9 @@ class RouteForwardInfo {
    */
   struct Nexthop;
   typedef boost::container::flat_set<Nexthop> Nexthops;
+  typedef NexthopGroup<Nexthops> Group;
 
-  explicit RouteForwardInfo(Action action = Action::DROP)
-      : action_(action) {
-  }
+  explicit RouteForwardInfo(Action action = Action::DROP);
   ~RouteForwardInfo() {
   }
 
@@ -51,7 +51,12 @@ class RouteForwardInfo {
     return action_;
   }
 
-  const Nexthops& getNexthops() const {
+  const Nexthops& getNexthops() const;
+  /*
+   * The interned nexthops.  Every RouteForwardInfo with the same nexthops
+   * shares the same group.
+   */
+  const std::shared_ptr<const Group>& getNexthopGroup() const {
     return nexthops_;
   }
 
@@ -68,6 +73,7 @@ class RouteForwardInfo {
   static RouteForwardInfo fromFollyDynamic(const folly::dynamic& fwdInfoJson);
 
   bool operator==(const RouteForwardInfo& info) const {
+    // Nexthop groups are interned, so equal sets are the same group
     return action_ == info.action_ && nexthops_ == info.nexthops_;
   }
 
@@ -76,18 +82,12 @@ class RouteForwardInfo {
   bool isDrop() const {
     return action_ == Action::DROP;
   }
-  void setDrop() {
-    nexthops_.clear();
-    action_ = Action::DROP;
-  }
+  void setDrop();
 
   bool isToCPU() const {
     return action_ == Action::TO_CPU;
   }
-  void setToCPU() {
-    nexthops_.clear();
-    action_ = Action::TO_CPU;
-  }
+  void setToCPU();
 
   void setAction(Action action) {
     CHECK(action == Action::TO_CPU || action == Action::DROP);
@@ -95,33 +95,22 @@ class RouteForwardInfo {
   }
 
   // Set one nexthop, a simple version for non-ECMP case
-  void setNexthops(InterfaceID intf, const folly::IPAddress& nhop) {
-    nexthops_.clear();
-    nexthops_.emplace(intf, nhop);
-    action_ = Action::NEXTHOPS;
-  }
+  void setNexthops(InterfaceID intf, const folly::IPAddress& nhop);
   // Set one or multiple nexthops
-  void setNexthops(const Nexthops& nexthops) {
-    nexthops_ = nexthops;
-    action_ = Action::NEXTHOPS;
-  }
-  void setNexthops(Nexthops&& nexthops) {
-    nexthops_ = std::move(nexthops);
-    action_ = Action::NEXTHOPS;
-  }
+  void setNexthops(const Nexthops& nexthops);
+  void setNexthops(Nexthops&& nexthops);
+  void setNexthops(std::shared_ptr<const Group> nexthops);
 
   // Reset the forwarding info
-  void reset() {
-    nexthops_.clear();
-    action_ = Action::DROP;
-  }
+  void reset();
 
  private:
-  Nexthops nexthops_;
+  std::shared_ptr<const Group> nexthops_;
   Action action_;
 };
 
 typedef RouteForwardInfo::Nexthops RouteForwardNexthops;
+typedef RouteForwardInfo::Group RouteForwardNexthopGroup;
 
 void toAppend(const RouteForwardInfo& fwd, std::string *result);
 std::ostream& operator<<(std::ostream& os, const RouteForwardInfo& fwd);
@@ -161,3 +150,66 @@ void toAppend(const RouteForwardNexthops& fwd, std::string *result);
 std::ostream& operator<<(std::ostream& os, const RouteForwardNexthops& fwd);
 
 }}
+
+namespace std {
+template <>
+struct hash<facebook::fboss::RouteForwardInfo::Nexthop> {
+  size_t operator()(
+      const facebook::fboss::RouteForwardInfo::Nexthop& nhop) const {
+    return folly::hash::hash_128_to_64(
+        static_cast<uint32_t>(nhop.intf),
+        std::hash<folly::IPAddress>()(nhop.nexthop));
+  }
+};
+} // std
+
+namespace facebook { namespace fboss {
+
+// The RouteForwardInfo methods that need RouteForwardInfo::Nexthop
+inline RouteForwardInfo::RouteForwardInfo(Action action)
+    : nexthops_(Group::emptyGroup()),
+      action_(action) {
+}
+
+inline const RouteForwardInfo::Nexthops&
+RouteForwardInfo::getNexthops() const {
+  return nexthops_->nexthops();
+}
+
+inline void RouteForwardInfo::setDrop() {
+  nexthops_ = Group::emptyGroup();
+  action_ = Action::DROP;
+}
+
+inline void RouteForwardInfo::setToCPU() {
+  nexthops_ = Group::emptyGroup();
+  action_ = Action::TO_CPU;
+}
+
+inline void RouteForwardInfo::setNexthops(InterfaceID intf,
+                                          const folly::IPAddress& nhop) {
+  Nexthops nexthops;
+  nexthops.emplace(intf, nhop);
+  setNexthops(std::move(nexthops));
+}
+
+inline void RouteForwardInfo::setNexthops(const Nexthops& nexthops) {
+  setNexthops(Group::get(nexthops));
+}
+
+inline void RouteForwardInfo::setNexthops(Nexthops&& nexthops) {
+  setNexthops(Group::get(std::move(nexthops)));
+}
+
+inline void RouteForwardInfo::setNexthops(
+    std::shared_ptr<const Group> nexthops) {
+  nexthops_ = std::move(nexthops);
+  action_ = Action::NEXTHOPS;
+}
+
+inline void RouteForwardInfo::reset() {
+  nexthops_ = Group::emptyGroup();
+  action_ = Action::DROP;
+}
+
+}}
@@ -52,7 +52,7 @@ class RouteTable : public NodeBaseT<RouteTable, RouteTableFields> {
   static std::shared_ptr<RouteTable>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = RouteTableFields::fromFollyDynamic(json);
-    return std::make_shared<RouteTable>(fields);
+    return makeNode<RouteTable>(fields);
   }
 
   static std::shared_ptr<RouteTable>
@@ -12,6 +12,12 @@
 #include "fboss/agent/state/NodeMap-defs.h"
 #include "fboss/agent/state/Route.h"
 
+#include <folly/Memory.h>
+
+DEFINE_bool(rib_lpm_index, true,
+            "Build a multibit LPM index for longest match lookups in the "
+            "background after each RIB is published");
+
 namespace {
 constexpr auto kRoutes = "routes";
 }
@@ -45,6 +51,20 @@ RouteTableRib<AddrT>::fromFollyDynamic(const folly::dynamic& routes) {
   return rib;
 }
 
+template<typename AddrT>
+void RouteTableRib<AddrT>::buildLpmIndex() const {
+  CHECK(isPublished());
+  if (hasLpmIndex()) {
+    return;
+  }
+  auto index = folly::make_unique<const LpmIndex>(rib_);
+  const LpmIndex* expected = nullptr;
+  if (lpmIndex_.compare_exchange_strong(expected, index.get(),
+                                        std::memory_order_acq_rel)) {
+    index.release();
+  }
+}
+
 template class RouteTableRib<folly::IPAddressV4>;
 template class RouteTableRib<folly::IPAddressV6>;
 
@@ -14,8 +14,14 @@
 #include "fboss/agent/types.h"
 #include "fboss/agent/state/NodeMap.h"
 #include "fboss/agent/state/RouteTypes.h"
+#include "fboss/lib/MultibitLpm.h"
 #include "fboss/lib/RadixTree.h"
 
+#include <atomic>
+#include <gflags/gflags.h>
+
+DECLARE_bool(rib_lpm_index);
+
 namespace facebook { namespace fboss {
 
 template<typename AddrT>
@@ -68,12 +74,16 @@ class RouteTableRib : public NodeBase {
   RouteTableRib() {}
   RouteTableRib(NodeID id, uint32_t generation):
     NodeBase(id, generation) {}
-  ~RouteTableRib() {}
+  ~RouteTableRib() {
+    delete lpmIndex_.load(std::memory_order_relaxed);
+  }
 
   using Prefix =  RoutePrefix<AddrT>;
   using RouteType = Route<AddrT>;
   using Routes = facebook::network::RadixTree<AddrT,
         std::shared_ptr<Route<AddrT>>>;
+  using LpmIndex = facebook::network::MultibitLpm<AddrT,
+        std::shared_ptr<Route<AddrT>>>;
 
   bool empty() const {
     return size() == 0;
@@ -99,7 +109,16 @@ class RouteTableRib : public NodeBase {
     auto citr = rib_.exactMatch(prefix.network, prefix.mask);
     return citr != rib_.end() ? citr->value() : nullptr;
   }
+  /*
+   * Lookups go through the multibit LPM index once buildLpmIndex() has built
+   * it, and walk rib_ until then.
+   */
   std::shared_ptr<Route<AddrT>> longestMatch(const AddrT& nexthop) const {
+    auto index = lpmIndex_.load(std::memory_order_acquire);
+    if (index) {
+      auto match = index->longestMatch(nexthop);
+      return match ? *match : nullptr;
+    }
     auto citr = rib_.longestMatch(nexthop, nexthop.bitCount());
     return citr != rib_.end() ? citr->value() : nullptr;
   }
@@ -163,9 +182,24 @@ class RouteTableRib : public NodeBase {
     }
   }
 
+  /*
+   * Build the LPM index used by longestMatch(), if it has not been built
+   * yet.  The RIB must be published, since the index is a snapshot of it.
+   *
+   * This takes time linear in the number of routes, so SwSwitch runs it on
+   * the ROUTE_INDEX background thread after the RIB is published, and
+   * lookups walk rib_ until the index is installed.  Concurrent lookups are
+   * safe, and if two threads race to build the index one copy is discarded.
+   */
+  void buildLpmIndex() const;
+  bool hasLpmIndex() const {
+    return lpmIndex_.load(std::memory_order_acquire) != nullptr;
+  }
 
  private:
   Routes rib_;
+  // Read only lookup index, owned by the RIB, or null until built
+  mutable std::atomic<const LpmIndex*> lpmIndex_{nullptr};
 };
 
 }}
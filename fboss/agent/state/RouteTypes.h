@@ -14,6 +14,7 @@
 #include <folly/FBString.h>
 #include "fboss/agent/types.h"
 #include <folly/IPAddress.h>
+#include "fboss/agent/state/NexthopGroup.h"
 
 #include <boost/container/flat_set.hpp>
 
@@ -24,6 +25,11 @@ namespace facebook { namespace fboss {
  */
 typedef boost::container::flat_set<folly::IPAddress> RouteNextHops;
 
+/**
+ * The interned nexthops of a route, shared by all routes with the same set
+ */
+typedef NexthopGroup<RouteNextHops> RouteNextHopGroup;
+
 /**
  * Route forward actions
  */
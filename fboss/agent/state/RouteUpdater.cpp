@@ -115,7 +115,7 @@ void RouteUpdater::addRoute(const PrefixT& prefix, RibT *ribCloned,
     newRoute->update(std::forward<Args>(args)...);
     VLOG(3) << "Updated route " << newRoute->str();
   } else {
-    auto newRoute = make_shared<RouteT>(prefix, std::forward<Args>(args)...);
+    auto newRoute = makeNode<RouteT>(prefix, std::forward<Args>(args)...);
     rib->addRoute(newRoute);
     VLOG(3) << "Added route " << newRoute->str();
   }
@@ -163,31 +163,26 @@ void RouteUpdater::addRoute(
 
 void RouteUpdater::addRoute(RouterID id, const folly::IPAddress& network,
                             uint8_t mask, const RouteNextHops& nhs) {
-  if (network.isV4()) {
-    PrefixV4 prefix{network.asV4().mask(mask), mask};
-    return addRoute(prefix, getRibV4(id), nhs);
-  } else {
-    PrefixV6 prefix{network.asV6().mask(mask), mask};
-    if (prefix.network.isLinkLocal()) {
-      throw FbossError("Unexpected v6 routable route for link local address ",
-                       prefix);
-    }
-    return addRoute(prefix, getRibV6(id), nhs);
-  }
+  addRoute(id, network, mask, RouteNextHopGroup::get(nhs));
 }
 
 void RouteUpdater::addRoute(RouterID id, const folly::IPAddress& network,
                             uint8_t mask, RouteNextHops&& nhs) {
+  addRoute(id, network, mask, RouteNextHopGroup::get(std::move(nhs)));
+}
+
+void RouteUpdater::addRoute(RouterID id, const folly::IPAddress& network,
+    uint8_t mask, const std::shared_ptr<const RouteNextHopGroup>& nhs) {
   if (network.isV4()) {
     PrefixV4 prefix{network.asV4().mask(mask), mask};
-    return addRoute(prefix, getRibV4(id), std::move(nhs));
+    return addRoute(prefix, getRibV4(id), nhs);
   } else {
     PrefixV6 prefix{network.asV6().mask(mask), mask};
     if (prefix.network.isLinkLocal()) {
       throw FbossError("Unexpected v6 routable route for link local address ",
                        prefix);
     }
-    return addRoute(prefix, getRibV6(id), std::move(nhs));
+    return addRoute(prefix, getRibV6(id), nhs);
   }
 }
 
@@ -273,7 +268,7 @@ void RouteUpdater::resolve(RouteT* route, RtRibT* rib, ClonedRib* ribCloned) {
   if (route->isPublished()) {
     auto newRoute = route->clone(RouteT::Fields::COPY_ONLY_PREFIX);
     // copy the nexthop
-    newRoute->update(route->nexthops());
+    newRoute->update(route->getNexthopGroup());
     // insert the cloned route back to the RIB
     // Note: resolve() is called in a loop over 'rib'. But we are modifying
     // the rib here. Fortunately, updateRoute() here does not actually
@@ -334,7 +329,7 @@ void RouteUpdater::setRoutesWithNhopsForResolution(RibT* rib) {
     if (route->isWithNexthops()) {
       if (route->isPublished()) {
         auto newRoute = route->clone(RibT::RouteType::Fields::COPY_ONLY_PREFIX);
-        newRoute->update(route->nexthops());
+        newRoute->update(route->getNexthopGroup());
         rib->updateRoute(newRoute);
         route = newRoute.get();
       }
@@ -69,6 +69,10 @@ class RouteUpdater {
                 const RouteNextHops& nhs);
   void addRoute(RouterID id, const folly::IPAddress& network, uint8_t mask,
                 RouteNextHops&& nhs);
+  // Interned nexthops make comparing them with the existing route, if any,
+  // a pointer compare
+  void addRoute(RouterID id, const folly::IPAddress& network, uint8_t mask,
+                const std::shared_ptr<const RouteNextHopGroup>& nhs);
   // methods to delete a route
   void delRoute(RouterID id, const folly::IPAddress& network, uint8_t mask);
 
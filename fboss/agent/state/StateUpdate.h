@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include <folly/IntrusiveList.h>
@@ -74,6 +75,10 @@ class StateUpdate {
 
   std::string name_;
 
+  // When SwSwitch queued the update, to measure how long it waited for the
+  // update thread.
+  std::chrono::steady_clock::time_point queuedTime_;
+
   // An intrusive list hook for maintaining the list of pending updates.
   folly::IntrusiveListHook listHook_;
   // The SwSwitch code needs access to our listHook_ member so it can maintain
@@ -113,7 +113,7 @@ class SwitchState : public NodeBaseT<SwitchState, SwitchStateFields> {
   static std::shared_ptr<SwitchState>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = SwitchStateFields::fromFollyDynamic(json);
-    return std::make_shared<SwitchState>(fields);
+    return makeNode<SwitchState>(fields);
   }
 
   static std::shared_ptr<SwitchState>
@@ -104,7 +104,7 @@ class Vlan : public NodeBaseT<Vlan, VlanFields> {
   static std::shared_ptr<Vlan>
   fromFollyDynamic(const folly::dynamic& json) {
     const auto& fields = VlanFields::fromFollyDynamic(json);
-    return std::make_shared<Vlan>(fields);
+    return makeNode<Vlan>(fields);
   }
 
   static std::shared_ptr<Vlan>
@@ -0,0 +1,212 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/NodeAllocator.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace facebook::fboss;
+using std::vector;
+
+namespace {
+
+struct TestNode {
+  explicit TestNode(int v) : value(v) {}
+  int value;
+};
+
+class NodePoolTest : public ::testing::Test {
+ public:
+  void TearDown() override {
+    setPoolEnabled(false);
+  }
+
+  void setPoolEnabled(bool enabled) {
+    FLAGS_state_node_pool = enabled;
+    NodePool::init();
+    EXPECT_EQ(enabled, NodePool::enabled());
+  }
+
+ private:
+  gflags::FlagSaver flagSaver_;
+};
+
+} // unnamed namespace
+
+TEST_F(NodePoolTest, ReuseAfterFree) {
+  setPoolEnabled(true);
+  auto before = NodePool::getStats();
+
+  auto chunk = NodePool::allocate(40);
+  auto stats = NodePool::getStats();
+  EXPECT_EQ(before.allocations + 1, stats.allocations);
+  EXPECT_EQ(before.unpooledAllocations, stats.unpooledAllocations);
+  // Sizes are rounded up to the size class
+  EXPECT_EQ(before.bytesInUse + 48, stats.bytesInUse);
+
+  NodePool::deallocate(chunk, 40);
+  stats = NodePool::getStats();
+  EXPECT_EQ(before.deallocations + 1, stats.deallocations);
+  EXPECT_EQ(before.bytesInUse, stats.bytesInUse);
+
+  // The chunk just freed is handed out again, to any size in its class
+  EXPECT_EQ(chunk, NodePool::allocate(33));
+  NodePool::deallocate(chunk, 33);
+  EXPECT_EQ(chunk, NodePool::allocate(48));
+  NodePool::deallocate(chunk, 48);
+}
+
+TEST_F(NodePoolTest, FreeInAnyOrder) {
+  setPoolEnabled(true);
+  auto before = NodePool::getStats();
+
+  const int kCount = 10;
+  vector<void*> chunks;
+  for (int i = 0; i < kCount; ++i) {
+    chunks.push_back(NodePool::allocate(64));
+  }
+  EXPECT_EQ(before.bytesInUse + kCount * 64, NodePool::getStats().bytesInUse);
+
+  // Free the even chunks first, then the odd ones from the back
+  vector<void*> freed;
+  for (int i = 0; i < kCount; i += 2) {
+    freed.push_back(chunks[i]);
+  }
+  for (int i = kCount - 1; i > 0; i -= 2) {
+    freed.push_back(chunks[i]);
+  }
+  for (auto chunk : freed) {
+    NodePool::deallocate(chunk, 64);
+  }
+  EXPECT_EQ(before.bytesInUse, NodePool::getStats().bytesInUse);
+
+  // The free list is LIFO, so the chunks come back in reverse order
+  for (auto it = freed.rbegin(); it != freed.rend(); ++it) {
+    EXPECT_EQ(*it, NodePool::allocate(64));
+  }
+  for (auto chunk : chunks) {
+    NodePool::deallocate(chunk, 64);
+  }
+  EXPECT_EQ(before.bytesInUse, NodePool::getStats().bytesInUse);
+}
+
+TEST_F(NodePoolTest, SlabsAreReused) {
+  setPoolEnabled(true);
+
+  // More 1KB chunks than fit in one slab
+  const int kCount = 200;
+  vector<void*> chunks;
+  for (int i = 0; i < kCount; ++i) {
+    chunks.push_back(NodePool::allocate(1024));
+  }
+  auto slabs = NodePool::getStats().slabs;
+  for (auto chunk : chunks) {
+    NodePool::deallocate(chunk, 1024);
+  }
+  chunks.clear();
+
+  for (int i = 0; i < kCount; ++i) {
+    chunks.push_back(NodePool::allocate(1024));
+  }
+  EXPECT_EQ(slabs, NodePool::getStats().slabs);
+  for (auto chunk : chunks) {
+    NodePool::deallocate(chunk, 1024);
+  }
+}
+
+TEST_F(NodePoolTest, LargeAllocationsBypassPool) {
+  setPoolEnabled(true);
+  auto before = NodePool::getStats();
+
+  auto chunk = NodePool::allocate(1025);
+  auto stats = NodePool::getStats();
+  EXPECT_EQ(before.allocations, stats.allocations);
+  EXPECT_EQ(before.unpooledAllocations + 1, stats.unpooledAllocations);
+  EXPECT_EQ(before.bytesInUse, stats.bytesInUse);
+  NodePool::deallocate(chunk, 1025);
+  EXPECT_EQ(before.deallocations, NodePool::getStats().deallocations);
+}
+
+TEST_F(NodePoolTest, Disabled) {
+  setPoolEnabled(false);
+  auto before = NodePool::getStats();
+
+  auto chunk = NodePool::allocate(40);
+  auto stats = NodePool::getStats();
+  EXPECT_EQ(before.allocations, stats.allocations);
+  EXPECT_EQ(before.unpooledAllocations + 1, stats.unpooledAllocations);
+  EXPECT_EQ(before.bytesInUse, stats.bytesInUse);
+  NodePool::deallocate(chunk, 40);
+  EXPECT_EQ(before.deallocations, NodePool::getStats().deallocations);
+}
+
+TEST_F(NodePoolTest, ToggleWithNothingAlive) {
+  // The flag only takes effect through init()
+  FLAGS_state_node_pool = true;
+  EXPECT_FALSE(NodePool::enabled());
+  auto before = NodePool::getStats();
+  NodePool::deallocate(NodePool::allocate(40), 40);
+  EXPECT_EQ(before.unpooledAllocations + 1,
+            NodePool::getStats().unpooledAllocations);
+
+  NodePool::init();
+  EXPECT_TRUE(NodePool::enabled());
+  before = NodePool::getStats();
+  NodePool::deallocate(NodePool::allocate(40), 40);
+  EXPECT_EQ(before.allocations + 1, NodePool::getStats().allocations);
+  EXPECT_EQ(before.deallocations + 1, NodePool::getStats().deallocations);
+
+  setPoolEnabled(false);
+  before = NodePool::getStats();
+  NodePool::deallocate(NodePool::allocate(40), 40);
+  EXPECT_EQ(before.allocations, NodePool::getStats().allocations);
+}
+
+TEST_F(NodePoolTest, ToggleWithNodesAlive) {
+  // Freeing these after the switch would hand operator new memory to the
+  // pool, or pool chunks to operator delete
+  auto unpooled = NodePool::allocate(40);
+  FLAGS_state_node_pool = true;
+  EXPECT_DEATH(NodePool::init(), "unpooled nodes are alive");
+  NodePool::deallocate(unpooled, 40);
+
+  setPoolEnabled(true);
+  auto pooled = NodePool::allocate(40);
+  FLAGS_state_node_pool = false;
+  EXPECT_DEATH(NodePool::init(), "pooled nodes are alive");
+  NodePool::deallocate(pooled, 40);
+
+  // Large allocations never come from the pool, so they do not matter
+  auto large = NodePool::allocate(2048);
+  setPoolEnabled(false);
+  NodePool::deallocate(large, 2048);
+}
+
+TEST_F(NodePoolTest, MakeNode) {
+  setPoolEnabled(true);
+  auto before = NodePool::getStats();
+
+  // The node and its control block come from the pool as one chunk
+  auto node = makeNode<TestNode>(5);
+  EXPECT_EQ(5, node->value);
+  EXPECT_EQ(before.allocations + 1, NodePool::getStats().allocations);
+
+  // The chunk is only freed once the weak references are gone too
+  std::weak_ptr<TestNode> weak = node;
+  node.reset();
+  EXPECT_EQ(before.deallocations, NodePool::getStats().deallocations);
+  weak.reset();
+  auto stats = NodePool::getStats();
+  EXPECT_EQ(before.deallocations + 1, stats.deallocations);
+  EXPECT_EQ(before.bytesInUse, stats.bytesInUse);
+}
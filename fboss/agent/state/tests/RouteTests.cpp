@@ -1143,3 +1143,119 @@ TEST(Route, toCPURoutes) {
   EXPECT_FALSE(r5->needResolve());
   EXPECT_TRUE(r5->isSame(TO_CPU));
 }
+
+TEST(Route, sharedNexthopGroups) {
+  auto stateV1 = make_shared<SwitchState>();
+  stateV1->publish();
+  auto rid = RouterID(0);
+  RouteNextHops ecmp;
+  ecmp.emplace(IPAddress("1.1.1.10"));
+  ecmp.emplace(IPAddress("2.2.2.10"));
+  RouteNextHops single;
+  single.emplace(IPAddress("1.1.1.10"));
+
+  RouteUpdater u1(stateV1->getRouteTables());
+  u1.addRoute(rid, IPAddress("10.0.0.0"), 24, ecmp);
+  u1.addRoute(rid, IPAddress("10.0.1.0"), 24, ecmp);
+  u1.addRoute(rid, IPAddress("10.0.2.0"), 24, single);
+  auto tables2 = u1.updateDone();
+  ASSERT_NE(nullptr, tables2);
+  auto rib = tables2->getRouteTableIf(rid)->getRibV4();
+  auto r1 = rib->exactMatch(RouteV4::Prefix{IPAddressV4("10.0.0.0"), 24});
+  auto r2 = rib->exactMatch(RouteV4::Prefix{IPAddressV4("10.0.1.0"), 24});
+  auto r3 = rib->exactMatch(RouteV4::Prefix{IPAddressV4("10.0.2.0"), 24});
+  ASSERT_NE(nullptr, r1);
+  ASSERT_NE(nullptr, r2);
+  ASSERT_NE(nullptr, r3);
+
+  // Routes with the same nexthops share one group
+  EXPECT_EQ(r1->getNexthopGroup(), r2->getNexthopGroup());
+  EXPECT_NE(r1->getNexthopGroup(), r3->getNexthopGroup());
+  EXPECT_EQ(ecmp, r1->nexthops());
+  EXPECT_TRUE(r1->isSame(RouteNextHopGroup::get(ecmp)));
+  EXPECT_FALSE(r1->isSame(r3->getNexthopGroup()));
+
+  // Including routes read back from their serialized form
+  auto r1Copy = RouteV4::fromFollyDynamic(r1->toFollyDynamic());
+  EXPECT_EQ(r1->getNexthopGroup(), r1Copy->getNexthopGroup());
+  EXPECT_TRUE(r1->isSame(r1Copy.get()));
+
+  // And the forwarding info is interned the same way
+  RouteForwardInfo fwd1, fwd2;
+  fwd1.setNexthops(InterfaceID(1), IPAddress("1.1.1.10"));
+  fwd2.setNexthops(InterfaceID(1), IPAddress("1.1.1.10"));
+  EXPECT_EQ(fwd1.getNexthopGroup(), fwd2.getNexthopGroup());
+  EXPECT_EQ(fwd1, fwd2);
+  fwd2.reset();
+  EXPECT_EQ(RouteForwardNexthopGroup::emptyGroup(), fwd2.getNexthopGroup());
+  EXPECT_EQ(0, fwd2.getNexthopGroup()->id());
+
+  // Groups go away with their last reference, and their IDs aren't reused
+  RouteNextHops other;
+  other.emplace(IPAddress("3.3.3.10"));
+  auto numGroups = RouteNextHopGroup::numGroups();
+  RouteNextHopGroup::ID id;
+  {
+    auto group = RouteNextHopGroup::get(other);
+    EXPECT_EQ(numGroups + 1, RouteNextHopGroup::numGroups());
+    EXPECT_EQ(group, RouteNextHopGroup::get(other));
+    id = group->id();
+  }
+  EXPECT_EQ(numGroups, RouteNextHopGroup::numGroups());
+  EXPECT_NE(id, RouteNextHopGroup::get(other)->id());
+}
+
+TEST(RouteTableRib, lpmIndex) {
+  auto stateV1 = make_shared<SwitchState>();
+  stateV1->publish();
+  auto rid = RouterID(0);
+  RouteNextHops nhop;
+  nhop.emplace(IPAddress("1.1.1.10"));
+
+  RouteUpdater u1(stateV1->getRouteTables());
+  u1.addRoute(rid, InterfaceID(1), IPAddress("1.1.1.1"), 24);
+  u1.addRoute(rid, IPAddress("10.0.0.0"), 8, nhop);
+  u1.addRoute(rid, IPAddress("10.1.0.0"), 16, nhop);
+  u1.addRoute(rid, IPAddress("10.1.2.0"), 24, nhop);
+  u1.addRoute(rid, IPAddress("10.1.2.3"), 32, nhop);
+  auto tables2 = u1.updateDone();
+  ASSERT_NE(nullptr, tables2);
+  tables2->publish();
+  auto rib = tables2->getRouteTableIf(rid)->getRibV4();
+
+  // The index is only built on request, and lookups give the same answers
+  // with and without it
+  std::vector<IPAddressV4> hosts{
+    IPAddressV4("10.9.9.9"), IPAddressV4("10.1.9.9"),
+    IPAddressV4("10.1.2.9"), IPAddressV4("10.1.2.3"),
+    IPAddressV4("1.1.1.10"), IPAddressV4("11.0.0.1"),
+  };
+  std::vector<shared_ptr<RouteV4>> expected;
+  EXPECT_FALSE(rib->hasLpmIndex());
+  for (const auto& host : hosts) {
+    expected.push_back(rib->longestMatch(host));
+  }
+  EXPECT_EQ(nullptr, expected.back());
+  rib->buildLpmIndex();
+  EXPECT_TRUE(rib->hasLpmIndex());
+  for (size_t n = 0; n < hosts.size(); ++n) {
+    EXPECT_EQ(expected[n], rib->longestMatch(hosts[n])) << hosts[n];
+  }
+
+  // RIBs read back from their serialized form, as on warm boot, start
+  // without an index and can build one the same way
+  auto ribCopy = RouteTable::RibTypeV4::fromFollyDynamic(rib->toFollyDynamic());
+  ribCopy->publish();
+  EXPECT_FALSE(ribCopy->hasLpmIndex());
+  ribCopy->buildLpmIndex();
+  EXPECT_TRUE(ribCopy->hasLpmIndex());
+  for (size_t n = 0; n < hosts.size(); ++n) {
+    auto match = ribCopy->longestMatch(hosts[n]);
+    if (expected[n]) {
+      ASSERT_NE(nullptr, match) << hosts[n];
+      EXPECT_EQ(expected[n]->prefix(), match->prefix());
+    } else {
+      EXPECT_EQ(nullptr, match);
+    }
+  }
+}
@@ -29,6 +29,7 @@
 #include "fboss/agent/state/SwitchState.h"
 #include "fboss/agent/state/Vlan.h"
 #include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/state/InterfaceMap.h"
 #include "fboss/agent/state/Interface.h"
 #include "fboss/agent/test/CounterCache.h"
 #include "fboss/agent/test/TestUtils.h"
@@ -740,6 +741,51 @@ TEST(ArpTest, NotMine) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.error.sum", 0);
 }
 
+TEST(ArpTest, NotMineBatch) {
+  auto sw = setupSwitch();
+
+  // Create an ARP request for 10.1.2.3
+  auto pkt = MockRxPacket::fromHex(
+    // dst mac, src mac
+    "ff ff ff ff ff ff  00 02 00 01 02 03"
+    // 802.1q, VLAN 1
+    "81 00  00 01"
+    // ARP, htype: ethernet, ptype: IPv4, hlen: 6, plen: 4
+    "08 06  00 01  08 00  06  04"
+    // ARP Request
+    "00 01"
+    // Sender MAC
+    "00 02 00 01 02 03"
+    // Sender IP: 10.1.2.15
+    "0a 01 02 0f"
+    // Target MAC
+    "00 00 00 00 00 00"
+    // Target IP: 10.1.2.3
+    "0a 01 02 03"
+  );
+  pkt->padToLength(68);
+  pkt->setSrcPort(PortID(1));
+  pkt->setSrcVlan(VlanID(1));
+
+  // Cache the current stats
+  CounterCache counters(sw.get());
+
+  // Hand the SwSwitch a burst of 3 ARP requests at once
+  HwSwitch::RxPackets pkts;
+  for (int i = 0; i < 3; ++i) {
+    pkts.push_back(pkt->clone());
+  }
+  sw->packetsReceived(std::move(pkts));
+
+  // Every packet in the burst should have been accounted for
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.pkts.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.arp.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "arp.not_mine.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.drops.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.error.sum", 0);
+}
+
 TEST(ArpTest, BadHlen) {
   auto sw = setupSwitch();
 
@@ -1337,3 +1383,26 @@ TEST(ArpTest, PortFlapRecover) {
   EXPECT_EQ(entry2->isPending(), false);
   EXPECT_EQ(entry3->isPending(), false);
 }
+
+TEST(ArpTest, GratuitousArpFlood) {
+  auto sw = setupSwitch();
+
+  // Every IPv4 interface address is announced, all in a single batch
+  size_t numAddrs = 0;
+  for (const auto& intf : *sw->getState()->getInterfaces()) {
+    for (const auto& addrEntry : intf->getAddresses()) {
+      if (!addrEntry.first.isV4()) {
+        continue;
+      }
+      auto v4Addr = addrEntry.first.asV4();
+      EXPECT_PKT(sw, "gratuitous ARP",
+                 checkArpRequest(v4Addr, intf->getMac(), v4Addr,
+                                 intf->getVlanID())).Times(1);
+      ++numAddrs;
+    }
+  }
+  ASSERT_GT(numAddrs, 1u);
+  EXPECT_HW_CALL(sw, sendPacketsSwitched_(numAddrs)).Times(1);
+
+  sw->getArpHandler()->floodGratuituousArp();
+}
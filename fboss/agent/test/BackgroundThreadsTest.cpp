@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/BackgroundThreads.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include "gtest/gtest.h"
+
+using namespace facebook::fboss;
+using std::vector;
+
+TEST(BackgroundThreads, DefaultSpec) {
+  auto specs = BackgroundThreads::parse("");
+  ASSERT_EQ(1, specs.size());
+  EXPECT_EQ("fbossBgThread", specs[0].name);
+  EXPECT_EQ(BackgroundThreads::kNumSubsystems, specs[0].subsystems.size());
+  EXPECT_TRUE(specs[0].cpus.empty());
+  EXPECT_EQ(0, specs[0].priority);
+
+  BackgroundThreads threads("");
+  auto shared = threads.getEventBase();
+  EXPECT_EQ(shared, threads.getEventBase(BackgroundSubsystem::NEIGHBOR));
+  EXPECT_EQ(shared, threads.getEventBase(BackgroundSubsystem::LLDP));
+  EXPECT_EQ(shared, threads.getEventBase(BackgroundSubsystem::ROUTE_ADV));
+  EXPECT_EQ(shared, threads.getEventBase(BackgroundSubsystem::TUN));
+}
+
+TEST(BackgroundThreads, DedicatedThreads) {
+  auto specs = BackgroundThreads::parse(
+      "lldp+route_adv:cpus=1-2:prio=10,tun,default:cpus=0");
+  ASSERT_EQ(3, specs.size());
+
+  EXPECT_EQ("fbossBgThread", specs[0].name);
+  EXPECT_EQ(vector<BackgroundSubsystem>{BackgroundSubsystem::NEIGHBOR},
+            specs[0].subsystems);
+  EXPECT_EQ(vector<int>{0}, specs[0].cpus);
+
+  EXPECT_EQ("fbossBg.lldp+route_adv", specs[1].name);
+  EXPECT_EQ((vector<BackgroundSubsystem>{BackgroundSubsystem::LLDP,
+                                         BackgroundSubsystem::ROUTE_ADV}),
+            specs[1].subsystems);
+  EXPECT_EQ((vector<int>{1, 2}), specs[1].cpus);
+  EXPECT_EQ(10, specs[1].priority);
+
+  EXPECT_EQ("fbossBg.tun", specs[2].name);
+  EXPECT_TRUE(specs[2].cpus.empty());
+
+  BackgroundThreads threads("lldp+route_adv,tun");
+  EXPECT_EQ(threads.getEventBase(),
+            threads.getEventBase(BackgroundSubsystem::NEIGHBOR));
+  EXPECT_EQ(threads.getEventBase(BackgroundSubsystem::LLDP),
+            threads.getEventBase(BackgroundSubsystem::ROUTE_ADV));
+  EXPECT_NE(threads.getEventBase(),
+            threads.getEventBase(BackgroundSubsystem::LLDP));
+  EXPECT_NE(threads.getEventBase(BackgroundSubsystem::LLDP),
+            threads.getEventBase(BackgroundSubsystem::TUN));
+}
+
+TEST(BackgroundThreads, InvalidSpecs) {
+  EXPECT_THROW(BackgroundThreads::parse("arp"), FbossError);
+  EXPECT_THROW(BackgroundThreads::parse("lldp,lldp+tun"), FbossError);
+  EXPECT_THROW(BackgroundThreads::parse("default,default"), FbossError);
+  EXPECT_THROW(BackgroundThreads::parse("tun:prio=1000"), FbossError);
+  EXPECT_THROW(BackgroundThreads::parse("tun:cpus=3-1"), FbossError);
+  EXPECT_THROW(BackgroundThreads::parse("tun:nice=5"), FbossError);
+  EXPECT_THROW(BackgroundThreads::parse("tun:cpus"), FbossError);
+}
@@ -0,0 +1,97 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include "fboss/agent/packet/PktUtil.h"
+
+#include <vector>
+
+/*
+ * Compare the checksum kernels in PktUtil against the original word at a
+ * time implementation, for a range of packet sizes.
+ */
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::io::Cursor;
+
+namespace {
+
+std::vector<uint8_t> data;
+
+void init() {
+  data.resize(9000);
+  for (auto& byte : data) {
+    byte = folly::Random::rand32(256);
+  }
+}
+
+uint16_t wordAtATime(Cursor cursor, uint64_t length) {
+  uint32_t value = 0;
+  while (length > 1) {
+    value += cursor.readBE<uint16_t>();
+    length -= 2;
+  }
+  if (length) {
+    value += cursor.read<uint8_t>() << 8;
+  }
+  return PktUtil::finalizeChecksum(value);
+}
+
+void runWordAtATime(size_t numIters, size_t length) {
+  IOBuf buf(IOBuf::WRAP_BUFFER, data.data(), length);
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(wordAtATime(Cursor(&buf), length));
+  }
+}
+
+void runKernel(size_t numIters, size_t length, PktUtil::ChecksumImpl impl) {
+  folly::BenchmarkSuspender suspender;
+  if (!PktUtil::checksumImplSupported(impl)) {
+    return;
+  }
+  auto prevImpl = PktUtil::getChecksumImpl();
+  PktUtil::setChecksumImpl(impl);
+  IOBuf buf(IOBuf::WRAP_BUFFER, data.data(), length);
+  suspender.dismiss();
+
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(
+        PktUtil::internetChecksum(Cursor(&buf), length));
+  }
+
+  suspender.rehire();
+  PktUtil::setChecksumImpl(prevImpl);
+}
+
+} // unnamed namespace
+
+#define CHECKSUM_BENCHMARKS(len) \
+  BENCHMARK_NAMED_PARAM(runWordAtATime, Cursor_##len, len) \
+  BENCHMARK_RELATIVE_NAMED_PARAM(runKernel, Scalar_##len, len, \
+                                 PktUtil::ChecksumImpl::SCALAR) \
+  BENCHMARK_RELATIVE_NAMED_PARAM(runKernel, AVX2_##len, len, \
+                                 PktUtil::ChecksumImpl::AVX2) \
+  BENCHMARK_DRAW_LINE();
+
+CHECKSUM_BENCHMARKS(64)
+CHECKSUM_BENCHMARKS(128)
+CHECKSUM_BENCHMARKS(576)
+CHECKSUM_BENCHMARKS(1500)
+CHECKSUM_BENCHMARKS(9000)
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
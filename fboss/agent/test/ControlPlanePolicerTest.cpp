@@ -0,0 +1,209 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Memory.h>
+#include <folly/io/Cursor.h>
+#include "fboss/agent/ControlPlanePolicer.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/SwitchStats.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/test/CounterCache.h"
+
+#include <boost/cast.hpp>
+#include <gflags/gflags.h>
+#include "gtest/gtest.h"
+
+DECLARE_int32(cp_policer_routing_pps);
+DECLARE_int32(cp_policer_neighbor_pps);
+DECLARE_int32(cp_policer_burst_ms);
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using folly::io::Cursor;
+using folly::make_unique;
+using std::chrono::milliseconds;
+using std::unique_ptr;
+
+namespace {
+
+// Ethernet header, without a VLAN tag
+const char* kEthHdr = "02 00 01 00 00 01  00 02 00 01 02 03";
+
+unique_ptr<MockRxPacket> makePkt(const std::string& ethertypeAndPayload) {
+  auto pkt = MockRxPacket::fromHex(kEthHdr + ethertypeAndPayload);
+  pkt->padToLength(68);
+  pkt->setSrcPort(PortID(1));
+  pkt->setSrcVlan(VlanID(1));
+  return pkt;
+}
+
+CpuPktClass classify(const MockRxPacket& pkt) {
+  Cursor c(pkt.buf());
+  c.skip(12);
+  auto ethertype = c.readBE<uint16_t>();
+  return ControlPlanePolicer::classify(ethertype, c);
+}
+
+unique_ptr<MockRxPacket> arpRequest() {
+  return makePkt(
+      // ARP, htype: ethernet, ptype: IPv4, hlen: 6, plen: 4
+      "08 06  00 01  08 00  06  04"
+      // ARP Request, sender MAC, sender IP 10.0.0.15
+      "00 01  00 02 00 01 02 03  0a 00 00 0f"
+      // Target MAC, target IP 10.0.0.1
+      "00 00 00 00 00 00  0a 00 00 01");
+}
+
+unique_ptr<MockRxPacket> ipv4Pkt(const std::string& protoAndL4) {
+  return makePkt(
+      "08 00"
+      // version/IHL, DSCP, total length, id, flags/fragment, TTL
+      "45 00 00 28  00 00 40 00  40" + protoAndL4);
+}
+
+unique_ptr<MockRxPacket> bgpPkt() {
+  return ipv4Pkt(
+      // TCP, checksum, 10.0.0.15 -> 10.0.0.1
+      "06 00 00  0a 00 00 0f  0a 00 00 01"
+      // source port 49152, destination port 179
+      "c0 00 00 b3  00 00 00 00  00 00 00 00  50 02 ff ff  00 00 00 00");
+}
+
+} // unnamed namespace
+
+TEST(ControlPlanePolicer, Classify) {
+  EXPECT_EQ(CpuPktClass::NEIGHBOR, classify(*arpRequest()));
+  EXPECT_EQ(CpuPktClass::ROUTING, classify(*bgpPkt()));
+  EXPECT_EQ(CpuPktClass::LLDP, classify(*makePkt("88 cc  02 07 04")));
+
+  // DHCP request, UDP 68 -> 67
+  EXPECT_EQ(CpuPktClass::DHCP, classify(*ipv4Pkt(
+      "11 00 00  00 00 00 00  ff ff ff ff"
+      "00 44 00 43  00 14 00 00")));
+  // Some other UDP packet
+  EXPECT_EQ(CpuPktClass::OTHER, classify(*ipv4Pkt(
+      "11 00 00  0a 00 00 0f  0a 00 00 01"
+      "30 39 30 39  00 14 00 00")));
+  // A non-first fragment of a BGP packet has no TCP header to look at
+  EXPECT_EQ(CpuPktClass::OTHER, classify(*makePkt(
+      "08 00  45 00 00 28  00 00 00 10  40 06 00 00"
+      "0a 00 00 0f  0a 00 00 01  00 b3 00 b3")));
+
+  // IPv6 neighbor solicitation
+  EXPECT_EQ(CpuPktClass::NEIGHBOR, classify(*makePkt(
+      "86 dd  60 00 00 00  00 18 3a ff"
+      "fe 80 00 00 00 00 00 00  02 02 00 ff fe 01 02 03"
+      "ff 02 00 00 00 00 00 00  00 00 00 01 ff 00 00 01"
+      "87 00 00 00")));
+  // DHCPv6 solicit
+  EXPECT_EQ(CpuPktClass::DHCP, classify(*makePkt(
+      "86 dd  60 00 00 00  00 08 11 ff"
+      "fe 80 00 00 00 00 00 00  02 02 00 ff fe 01 02 03"
+      "ff 02 00 00 00 00 00 00  00 00 00 00 00 01 00 02"
+      "02 22 02 23  00 08 00 00")));
+
+  // Truncated IPv4 header
+  EXPECT_EQ(CpuPktClass::OTHER, classify(
+      *MockRxPacket::fromHex(std::string(kEthHdr) + "08 00  45 00")));
+}
+
+TEST(ControlPlanePolicer, TokenBucket) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_cp_policer_routing_pps = 2000;
+  FLAGS_cp_policer_neighbor_pps = 10;
+  FLAGS_cp_policer_burst_ms = 500;
+  ControlPlanePolicer policer;
+  auto now = ControlPlanePolicer::TimePoint();
+
+  // The bucket starts full, with 5 packets worth of tokens
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(policer.admit(PortID(1), CpuPktClass::NEIGHBOR, now));
+  }
+  EXPECT_FALSE(policer.admit(PortID(1), CpuPktClass::NEIGHBOR, now));
+
+  // Other ports and classes have their own buckets
+  EXPECT_TRUE(policer.admit(PortID(2), CpuPktClass::NEIGHBOR, now));
+  EXPECT_TRUE(policer.admit(PortID(1), CpuPktClass::OTHER, now));
+
+  // Routing traffic has a much larger bucket, but is still policed
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(policer.admit(PortID(1), CpuPktClass::ROUTING, now));
+  }
+  EXPECT_FALSE(policer.admit(PortID(1), CpuPktClass::ROUTING, now));
+
+  // 10 pps means one more packet every 100ms
+  now += milliseconds(150);
+  EXPECT_TRUE(policer.admit(PortID(1), CpuPktClass::NEIGHBOR, now));
+  EXPECT_FALSE(policer.admit(PortID(1), CpuPktClass::NEIGHBOR, now));
+
+  // The bucket never holds more than the burst size
+  now += milliseconds(10000);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(policer.admit(PortID(1), CpuPktClass::NEIGHBOR, now));
+  }
+  EXPECT_FALSE(policer.admit(PortID(1), CpuPktClass::NEIGHBOR, now));
+}
+
+TEST(ControlPlanePolicer, ArpStorm) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_cp_policer = true;
+  FLAGS_cp_policer_neighbor_pps = 1;
+  FLAGS_cp_policer_burst_ms = 10000;
+
+  MacAddress localMac("02:00:01:00:00:01");
+  auto sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init();
+  auto sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+
+  // The whole storm arrives at the same instant, so no bucket refills
+  // while it lasts
+  auto now = ControlPlanePolicer::TimePoint();
+  ASSERT_NE(nullptr, sw->getControlPlanePolicer());
+  sw->getControlPlanePolicer()->setClock([&] { return now; });
+
+  CounterCache counters(sw.get());
+
+  // One host floods ARP on port 1, while BGP keepalives keep arriving
+  // on the same port
+  const int kArpPkts = 1000;
+  const int kBgpPkts = 50;
+  auto arp = arpRequest();
+  auto bgp = bgpPkt();
+  for (int i = 0; i < kArpPkts; ++i) {
+    sim->injectPacket(arp->clone());
+    if (i % (kArpPkts / kBgpPkts) == 0) {
+      sim->injectPacket(bgp->clone());
+    }
+  }
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.pkts.sum",
+                      kArpPkts + kBgpPkts);
+  // Only the initial burst of 10 ARP requests made it through
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.arp.sum", 10);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "cp_policer.neighbor.drops.sum",
+      kArpPkts - 10);
+  // ...while every BGP packet did
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.ipv4.sum",
+                      kBgpPkts);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "cp_policer.routing.drops.sum", 0);
+
+  // A second later the bucket has room for exactly one more ARP request
+  now += std::chrono::seconds(1);
+  sim->injectPacket(arp->clone());
+  sim->injectPacket(arp->clone());
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.arp.sum", 1);
+  counters.checkDelta(
+      SwitchStats::kCounterPrefix + "cp_policer.neighbor.drops.sum", 1);
+}
@@ -0,0 +1,251 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <boost/cast.hpp>
+
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using folly::make_unique;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+unique_ptr<MockRxPacket> dhcpDiscover;
+unique_ptr<MockRxPacket> dhcpOffer;
+unique_ptr<MockRxPacket> dhcpv6Solicit;
+
+unique_ptr<SwSwitch> setupSwitch() {
+  MacAddress localMac("02:00:01:00:00:01");
+  auto sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init();
+
+  auto updateFn = [&](const shared_ptr<SwitchState>& oldState) {
+    auto state = oldState->clone();
+
+    // Add VLAN 1, and ports 1-9 which belong to it.
+    auto vlan1 = make_shared<Vlan>(VlanID(1), "Vlan1");
+    state->addVlan(vlan1);
+    for (int idx = 1; idx < 10; ++idx) {
+      vlan1->addPort(PortID(idx), false);
+    }
+    // Relay DHCP requests on VLAN 1, with an override for one client that
+    // is not in the benchmarks
+    vlan1->setDhcpV4Relay(IPAddressV4("20.20.20.20"));
+    DhcpV4OverrideMap overrides;
+    overrides[MacAddress("02:00:00:00:00:99")] = IPAddressV4("30.30.30.30");
+    vlan1->setDhcpV4RelayOverrides(overrides);
+    vlan1->setDhcpV6Relay(IPAddressV6("2401:db00:20::20"));
+
+    // Add Interface 1 to VLAN 1
+    auto intf1 = make_shared<Interface>
+      (InterfaceID(1), RouterID(0), VlanID(1),
+       "interface1", MacAddress("02:00:01:00:00:01"), 9000);
+    Interface::Addresses addrs1;
+    addrs1.emplace(IPAddress("10.0.0.1"), 24);
+    addrs1.emplace(IPAddress("192.168.0.1"), 24);
+    addrs1.emplace(IPAddress("2401:db00:2110:3001::1"), 64);
+    intf1->setAddresses(addrs1);
+    state->addIntf(intf1);
+    return state;
+  };
+
+  sw->updateStateBlocking("setup", updateFn);
+  return sw;
+}
+
+string zeros(int count) {
+  string hex;
+  for (int n = 0; n < count; ++n) {
+    hex += " 00";
+  }
+  return hex;
+}
+
+unique_ptr<MockRxPacket> makeDhcpPacket(const string& hex) {
+  auto pkt = MockRxPacket::fromHex(hex);
+  pkt->setSrcPort(PortID(1));
+  pkt->setSrcVlan(VlanID(1));
+  return pkt;
+}
+
+void init() {
+  // Initialize the switch
+  sw = setupSwitch();
+
+  // Create a DHCP discover from a client, to be relayed to the server
+  dhcpDiscover = makeDhcpPacket(
+      // dst mac, src mac
+      "ff ff ff ff ff ff  02 00 00 00 00 02"
+      // 802.1q, VLAN 1
+      "81 00  00 01"
+      // IPv4
+      "08 00"
+      // Version, IHL, DSCP, ECN, Length (328)
+      "45  00  01  48"
+      // Id, Flags, frag offset
+      "00  00  00  00"
+      // TTL, Protocol (UDP), checksum
+      "40  11  00  00"
+      // Source IP: 0.0.0.0, destination IP: 255.255.255.255
+      "00 00 00 00  ff ff ff ff"
+      // UDP ports 68 -> 67, length (308), checksum
+      "00 44  00 43  01 34  00 00"
+      // op: request, htype, hlen, hops
+      "01 01 06 00"
+      // xid, secs, flags
+      "12 34 56 78  00 00  00 00"
+      // ciaddr, yiaddr, siaddr, giaddr
+      + zeros(16) +
+      // chaddr
+      "02 00 00 00 00 02" + zeros(10) +
+      // sname, file
+      zeros(64 + 128) +
+      // DHCP cookie
+      "63 82 53 63"
+      // message type: discover
+      "35 01 01"
+      // parameter request list
+      "37 03 01 03 06"
+      // end, padding
+      "ff" + zeros(51));
+
+  // Create a DHCP offer from the server, to be relayed to the client
+  dhcpOffer = makeDhcpPacket(
+      // dst mac, src mac
+      "02 00 01 00 00 01  02 00 00 00 00 20"
+      // 802.1q, VLAN 1
+      "81 00  00 01"
+      // IPv4
+      "08 00"
+      // Version, IHL, DSCP, ECN, Length (328)
+      "45  00  01  48"
+      // Id, Flags, frag offset
+      "00  00  00  00"
+      // TTL, Protocol (UDP), checksum
+      "40  11  00  00"
+      // Source IP: 20.20.20.20, destination IP: 10.0.0.1
+      "14 14 14 14  0a 00 00 01"
+      // UDP ports 67 -> 67, length (308), checksum
+      "00 43  00 43  01 34  00 00"
+      // op: reply, htype, hlen, hops
+      "02 01 06 01"
+      // xid, secs, flags
+      "12 34 56 78  00 00  00 00"
+      // ciaddr
+      "00 00 00 00"
+      // yiaddr: 10.0.0.10
+      "0a 00 00 0a"
+      // siaddr
+      "00 00 00 00"
+      // giaddr: 10.0.0.1
+      "0a 00 00 01"
+      // chaddr
+      "02 00 00 00 00 02" + zeros(10) +
+      // sname, file
+      zeros(64 + 128) +
+      // DHCP cookie
+      "63 82 53 63"
+      // message type: offer
+      "35 01 02"
+      // server identifier
+      "36 04 14 14 14 14"
+      // relay agent information, which is stripped
+      "52 06 01 04 0a 00 00 01"
+      // end, padding
+      "ff" + zeros(42));
+
+  // Create a DHCPv6 solicit from a client, to be relayed to the server
+  dhcpv6Solicit = makeDhcpPacket(
+      // dst mac, src mac
+      "33 33 00 01 00 02  02 00 00 00 00 02"
+      // 802.1q, VLAN 1
+      "81 00  00 01"
+      // IPv6
+      "86 dd"
+      // Version, traffic class, flow label
+      "60 00 00 00"
+      // Payload length (32), next header (UDP), hop limit
+      "00 20  11  01"
+      // Source IP: fe80::ff:fe00:2
+      "fe 80 00 00 00 00 00 00  00 00 00 ff fe 00 00 02"
+      // Destination IP: ff02::1:2
+      "ff 02 00 00 00 00 00 00  00 00 00 00 00 01 00 02"
+      // UDP ports 546 -> 547, length (32), checksum
+      "02 22  02 23  00 20  00 00"
+      // type: solicit, transaction id
+      "01  12 34 56"
+      // client identifier
+      "00 01 00 0a  00 03 00 01 02 00 00 00 00 02"
+      // elapsed time
+      "00 08 00 02  00 00");
+}
+
+void runRelay(const MockRxPacket& pkt, size_t numIters) {
+  BENCHMARK_SUSPEND {
+    SimSwitch* sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+    sim->resetTxCount();
+  }
+
+  // Send the packet to the switch numIters times
+  for (size_t n = 0; n < numIters; ++n) {
+    sw->packetReceived(pkt.clone());
+  }
+
+  BENCHMARK_SUSPEND {
+    // Make sure the SwSwitch relayed each packet, just to verify that it was
+    // actually taking the relay path
+    SimSwitch* sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+    CHECK_EQ(sim->getTxCount(), numIters);
+  }
+}
+
+} // unnamed namespace
+
+BENCHMARK(DhcpV4RelayRequest, numIters) {
+  runRelay(*dhcpDiscover, numIters);
+}
+
+BENCHMARK(DhcpV4RelayReply, numIters) {
+  runRelay(*dhcpOffer, numIters);
+}
+
+BENCHMARK(DhcpV6RelayForward, numIters) {
+  runRelay(*dhcpv6Solicit, numIters);
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Setting up the switch is fairly expensive.  Do this once before we run the
+  // benchmark functions so we don't have to do it inside the benchmark
+  // functions.
+  init();
+
+  folly::runBenchmarks();
+  return 0;
+}
@@ -445,3 +445,70 @@ TEST(DHCPv4HandlerTest, DHCPBadRequest) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.drop_pkt.sum", 1);
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.pkts.sum", 1);
 }
+
+TEST(DHCPv4HandlerTest, DHCPRequestWithAgentOption) {
+  auto sw = setupSwitch();
+  auto senderMac = kClientMac.toString();
+  std::replace(senderMac.begin(), senderMac.end(), ':', ' ');
+  const string senderIP = "00 00 00 00";
+  const string targetMac = "ff ff ff ff ff ff";
+  const string targetIP = "ff ff ff ff";
+  const string bootpOp = "01";
+  const string vlan = "00 01";
+  const string srcPort = "00 43";
+  const string dstPort = "00 44";
+  const string dhcpMsgTypeOpt = "35  01  01";
+  // Another relay agent already added its option
+  const string agentOption = "52 06 01 04 0a 0a 0a 05";
+  CounterCache counters(sw.get());
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  EXPECT_PLATFORM_CALL(sw, getLocalMac()).
+    WillRepeatedly(Return(kPlatformMac));
+
+  auto dhcpPkt = makeDHCPPacket(senderMac, targetMac, vlan,
+      senderIP, targetIP, srcPort, dstPort, bootpOp, dhcpMsgTypeOpt,
+      agentOption);
+  sw->packetReceived(dhcpPkt->clone());
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.pkt.sum", 1);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV4.bad_pkt.sum", 1);
+}
+
+TEST(DHCPv4HandlerTest, RelayChange) {
+  auto sw = setupSwitch();
+  auto senderMac = kClientMac.toString();
+  std::replace(senderMac.begin(), senderMac.end(), ':', ' ');
+  const string senderIP = "00 00 00 00";
+  const string targetMac = "ff ff ff ff ff ff";
+  const string targetIP = "ff ff ff ff";
+  const string bootpOp = "01";
+  const string vlan = "00 01";
+  const string srcPort = "00 43";
+  const string dstPort = "00 44";
+  const string dhcpMsgTypeOpt = "35  01  01";
+
+  EXPECT_PLATFORM_CALL(sw, getLocalMac()).
+    WillRepeatedly(Return(kPlatformMac));
+
+  EXPECT_PKT(sw, "DHCP request", checkDHCPReq());
+  auto dhcpPkt = makeDHCPPacket(senderMac, targetMac, vlan,
+      senderIP, targetIP, srcPort, dstPort, bootpOp, dhcpMsgTypeOpt);
+  sw->packetReceived(dhcpPkt->clone());
+
+  // The relay plans are rebuilt for the new VLAN settings
+  const IPAddressV4 kNewRelay("40.40.40.40");
+  sw->updateStateBlocking("change relay",
+      [&](const shared_ptr<SwitchState>& state) {
+        auto newState = state->clone();
+        auto newVlan = newState->getVlans()->getVlan(VlanID(1))->modify(
+            &newState);
+        newVlan->setDhcpV4Relay(kNewRelay);
+        return newState;
+      });
+
+  EXPECT_PKT(sw, "DHCP request to new relay", checkDHCPReq(kNewRelay));
+  sw->packetReceived(dhcpPkt->clone());
+}
@@ -0,0 +1,380 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <string>
+#include "common/stats/ServiceData.h"
+#include <folly/Memory.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/SwitchStats.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/DHCPv6Handler.h"
+#include "fboss/agent/UDPHeader.h"
+#include "fboss/agent/hw/mock/MockHwSwitch.h"
+#include "fboss/agent/hw/mock/MockPlatform.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/packet/DHCPv6Packet.h"
+#include "fboss/agent/packet/EthHdr.h"
+#include "fboss/agent/packet/Ethertype.h"
+#include "fboss/agent/packet/IPProto.h"
+#include "fboss/agent/packet/IPv6Hdr.h"
+#include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/CounterCache.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using folly::StringPiece;
+using folly::io::Cursor;
+using folly::io::RWPrivateCursor;
+using folly::make_unique;
+using std::string;
+using std::unique_ptr;
+
+using ::testing::_;
+using testing::Return;
+
+namespace {
+
+// The first IPv6 address of interface 1 in testStateA()
+const IPAddressV6 kVlanInterfaceIP("2401:db00:2110:3001::1");
+const IPAddressV6 kDhcpV6Relay("2401:db00:2110:4000::5");
+const MacAddress kPlatformMac("00:02:00:ab:cd:ef");
+const MacAddress kClientMac("02:00:00:00:00:02");
+const IPAddressV6 kClientIP("fe80::2");
+const MacAddress kServerMac("02:00:00:00:00:05");
+const MacAddress kAgentMac("02:00:00:00:00:03");
+const IPAddressV6 kAgentIP("2401:db00:2110:3001::3");
+
+const string kClientIPHex =
+  "fe 80 00 00 00 00 00 00 00 00 00 00 00 00 00 02";
+// Interface-id option carrying kClientMac
+const string kInterfaceIdOpt = "00 12 00 06  02 00 00 00 00 02";
+
+// A Solicit, 24 bytes long
+const string kSolicit =
+  // msg-type, transaction-id
+  "01  12 34 56"
+  // client identifier, DUID-LL with kClientMac
+  "00 01 00 0a  00 03 00 01  02 00 00 00 00 02"
+  // elapsed time
+  "00 08 00 02  00 00";
+
+// An Advertise, 32 bytes long
+const string kAdvertise =
+  // msg-type, transaction-id
+  "02  12 34 56"
+  // client identifier, DUID-LL with kClientMac
+  "00 01 00 0a  00 03 00 01  02 00 00 00 00 02"
+  // server identifier, DUID-LL with kServerMac
+  "00 02 00 0a  00 03 00 01  02 00 00 00 00 05";
+
+unique_ptr<SwSwitch> setupSwitch() {
+  auto state = testStateA();
+  state->getVlans()->getVlan(VlanID(1))->setDhcpV6Relay(kDhcpV6Relay);
+  auto sw = createMockSw(state);
+  EXPECT_PLATFORM_CALL(sw, getLocalMac()).
+    WillRepeatedly(Return(kPlatformMac));
+  return sw;
+}
+
+unique_ptr<MockRxPacket> makeDHCPv6Packet(
+    MacAddress srcMac, MacAddress dstMac,
+    IPAddressV6 srcIp, IPAddressV6 dstIp,
+    uint16_t srcPort, uint16_t dstPort,
+    uint8_t hopLimit, StringPiece dhcpHex) {
+  auto dhcp = PktUtil::parseHexData(dhcpHex);
+  uint32_t dhcpLength = dhcp.length();
+
+  IPv6Hdr ipHdr(srcIp, dstIp);
+  ipHdr.nextHeader = IP_PROTO_UDP;
+  ipHdr.payloadLength = UDPHeader::size() + dhcpLength;
+  ipHdr.hopLimit = hopLimit;
+  UDPHeader udpHdr(srcPort, dstPort, UDPHeader::size() + dhcpLength);
+
+  uint32_t length = 18 + IPv6Hdr::SIZE + UDPHeader::size() + dhcpLength;
+  auto buf = IOBuf::create(length);
+  buf->append(length);
+  RWPrivateCursor cursor(buf.get());
+  TxPacket::writeEthHeader(&cursor, dstMac, srcMac, VlanID(1),
+                           ETHERTYPE_IPV6);
+  ipHdr.serialize(&cursor);
+  udpHdr.write(&cursor);
+  cursor.push(dhcp.data(), dhcpLength);
+
+  auto pkt = make_unique<MockRxPacket>(std::move(buf));
+  pkt->setSrcPort(PortID(1));
+  pkt->setSrcVlan(VlanID(1));
+  return pkt;
+}
+
+/*
+ * Check every header of a DHCPv6 packet sent by the switch, and that its
+ * DHCPv6 message is exactly the given bytes.
+ */
+TxMatchFn checkDHCPv6Pkt(MacAddress dstMac, MacAddress srcMac, VlanID vlan,
+    IPAddressV6 srcIp, IPAddressV6 dstIp, uint16_t srcPort,
+    uint16_t dstPort, const string& dhcpHex) {
+  auto expected = std::make_shared<IOBuf>(PktUtil::parseHexData(dhcpHex));
+  return [=] (const TxPacket* txPacket) {
+    Cursor c(txPacket->buf());
+    EthHdr ethHdr(c);
+    if (ethHdr.dstAddr != dstMac) {
+      throw FbossError("expected dest MAC to be ", dstMac,
+          "; got ", ethHdr.dstAddr);
+    }
+    if (ethHdr.srcAddr != srcMac) {
+      throw FbossError("expected source MAC to be ", srcMac,
+          "; got ", ethHdr.srcAddr);
+    }
+    if (VlanID(ethHdr.vlanTags[0].vid()) != vlan) {
+      throw FbossError("expected vlan to be ", vlan,
+          "; got ", VlanID(ethHdr.vlanTags[0].vid()));
+    }
+    if (ethHdr.etherType != ETHERTYPE_IPV6) {
+      throw FbossError("expected ether type to be ", ETHERTYPE_IPV6,
+          "; got ", ethHdr.etherType);
+    }
+    IPv6Hdr ipHdr(c);
+    if (ipHdr.srcAddr != srcIp) {
+      throw FbossError("expected source ip to be ", srcIp,
+          "; got ", ipHdr.srcAddr);
+    }
+    if (ipHdr.dstAddr != dstIp) {
+      throw FbossError("expected destination ip to be ", dstIp,
+          "; got ", ipHdr.dstAddr);
+    }
+    if (ipHdr.nextHeader != IP_PROTO_UDP) {
+      throw FbossError("expected protocol to be ", IP_PROTO_UDP,
+          "; got ", ipHdr.nextHeader);
+    }
+    uint16_t expectedLength = UDPHeader::size() + expected->length();
+    if (ipHdr.payloadLength != expectedLength) {
+      throw FbossError("expected payload length to be ", expectedLength,
+          "; got ", ipHdr.payloadLength);
+    }
+    UDPHeader udpHdr;
+    udpHdr.parse(&c);
+    if (udpHdr.srcPort != srcPort) {
+      throw FbossError("expected source port to be ", srcPort,
+          "; got ", udpHdr.srcPort);
+    }
+    if (udpHdr.dstPort != dstPort) {
+      throw FbossError("expected destination port to be ", dstPort,
+          "; got ", udpHdr.dstPort);
+    }
+    if (udpHdr.length != expectedLength) {
+      throw FbossError("expected UDP length to be ", expectedLength,
+          "; got ", udpHdr.length);
+    }
+    auto csum = udpHdr.computeChecksum(ipHdr, c);
+    if (udpHdr.csum != csum) {
+      throw FbossError("expected UDP checksum to be ", csum,
+          "; got ", udpHdr.csum);
+    }
+    auto actualDhcp = PktUtil::hexDump(c);
+    auto expectedDhcp = PktUtil::hexDump(Cursor(expected.get()));
+    if (actualDhcp != expectedDhcp) {
+      throw FbossError("unexpected DHCPv6 message:\n", actualDhcp,
+          "\nexpected:\n", expectedDhcp);
+    }
+  };
+}
+
+// Hand a relay reply from the server to the switch
+void sendRelayReply(SwSwitch* sw, const string& options) {
+  auto pkt = makeDHCPv6Packet(kServerMac, kPlatformMac,
+      kDhcpV6Relay, kVlanInterfaceIP,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT, 64,
+      // msg-type, hop-count
+      "0d 00"
+      // link-address
+      "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00" +
+      // peer-address
+      kClientIPHex +
+      options);
+  sw->packetReceived(std::move(pkt));
+}
+
+} // unnamed namespace
+
+TEST(DHCPv6HandlerTest, SolicitRelayForward) {
+  auto sw = setupSwitch();
+  CounterCache counters(sw.get());
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  // The relay forward wraps the Solicit unchanged, with the client's MAC as
+  // its interface id
+  EXPECT_PKT(sw, "DHCPv6 relay forward",
+      checkDHCPv6Pkt(kPlatformMac, kPlatformMac, VlanID(1),
+          kVlanInterfaceIP, kDhcpV6Relay,
+          DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+          DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+          // msg-type, hop-count
+          "0c 00"
+          // link-address
+          "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00" +
+          // peer-address
+          kClientIPHex +
+          kInterfaceIdOpt +
+          // relay message option
+          "00 09 00 18" + kSolicit));
+
+  // Solicits are sent with a hop limit of 1
+  auto pkt = makeDHCPv6Packet(kClientMac, MacAddress("33:33:00:01:00:02"),
+      kClientIP, IPAddressV6("ff02::1:2"),
+      DHCPv6Packet::DHCP6_CLIENT_UDPPORT,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT, 1, kSolicit);
+  sw->packetReceived(std::move(pkt));
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.pkt.sum", 1);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.drop_pkt.sum", 0);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.pkts.sum", 1);
+}
+
+TEST(DHCPv6HandlerTest, RelayForwardHopCount) {
+  auto sw = setupSwitch();
+  // A relay forward from another relay agent, which already relayed it
+  // through 3 hops
+  const string relayFwdTail =
+    // link-address
+    "24 01 db 00 21 10 30 01 00 00 00 00 00 00 00 01" +
+    // peer-address
+    kClientIPHex +
+    // relay message option
+    "00 09 00 18" + kSolicit;
+
+  // It is passed on with only the hop count incremented
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  EXPECT_PKT(sw, "DHCPv6 relay forward",
+      checkDHCPv6Pkt(kPlatformMac, kAgentMac, VlanID(1),
+          kAgentIP, kDhcpV6Relay,
+          DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+          DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+          "0c 04" + relayFwdTail));
+
+  auto pkt = makeDHCPv6Packet(kAgentMac, kPlatformMac,
+      kAgentIP, kDhcpV6Relay,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT, 64,
+      "0c 03" + relayFwdTail);
+  sw->packetReceived(std::move(pkt));
+}
+
+TEST(DHCPv6HandlerTest, RelayForwardMaxHopCount) {
+  auto sw = setupSwitch();
+  CounterCache counters(sw.get());
+
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  auto pkt = makeDHCPv6Packet(kAgentMac, kPlatformMac,
+      kAgentIP, kDhcpV6Relay,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT, 64,
+      // msg-type, hop-count (MAX_RELAY_HOPCOUNT)
+      "0c 0a"
+      // link-address
+      "24 01 db 00 21 10 30 01 00 00 00 00 00 00 00 01" +
+      // peer-address
+      kClientIPHex +
+      // relay message option
+      "00 09 00 18" + kSolicit);
+  sw->packetReceived(std::move(pkt));
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.pkt.sum", 1);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.bad_pkt.sum", 1);
+}
+
+TEST(DHCPv6HandlerTest, RelayReply) {
+  auto sw = setupSwitch();
+  CounterCache counters(sw.get());
+
+  // The Advertise is unwrapped and sent to the client, on the VLAN of the
+  // interface the server replied to
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  EXPECT_PKT(sw, "DHCPv6 advertise",
+      checkDHCPv6Pkt(kClientMac, kPlatformMac, VlanID(1),
+          kVlanInterfaceIP, kClientIP,
+          DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+          DHCPv6Packet::DHCP6_CLIENT_UDPPORT,
+          kAdvertise)).Times(2);
+
+  sendRelayReply(sw.get(), kInterfaceIdOpt + "00 09 00 20" + kAdvertise);
+  // The order of the options does not matter
+  sendRelayReply(sw.get(), "00 09 00 20" + kAdvertise + kInterfaceIdOpt);
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.pkt.sum", 2);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.drop_pkt.sum", 0);
+}
+
+TEST(DHCPv6HandlerTest, RelayReplyTruncatedOption) {
+  auto sw = setupSwitch();
+  CounterCache counters(sw.get());
+
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  // The relay message option claims 16 more bytes than the packet has
+  sendRelayReply(sw.get(), kInterfaceIdOpt + "00 09 00 30" + kAdvertise);
+  // The interface-id option is cut short by the end of the packet
+  sendRelayReply(sw.get(), "00 09 00 20" + kAdvertise + "00 12 00 06 02 00");
+  // The packet ends partway through an option header
+  sendRelayReply(sw.get(), kInterfaceIdOpt + "00 09");
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.pkt.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.drop_pkt.sum", 3);
+}
+
+TEST(DHCPv6HandlerTest, RelayReplyNoInterfaceId) {
+  auto sw = setupSwitch();
+  CounterCache counters(sw.get());
+
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  // Without the interface id there is no MAC to send the reply to
+  sendRelayReply(sw.get(), "00 09 00 20" + kAdvertise);
+  // An interface id that is not a MAC address is no better
+  sendRelayReply(sw.get(),
+                 "00 12 00 04 0a 0b 0c 0d  00 09 00 20" + kAdvertise);
+  // Nor is one with no relay message to go with it
+  sendRelayReply(sw.get(), kInterfaceIdOpt);
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.pkt.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.drop_pkt.sum", 3);
+}
+
+TEST(DHCPv6HandlerTest, RelayReplyUnknownInterface) {
+  auto sw = setupSwitch();
+  CounterCache counters(sw.get());
+
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  // A reply to an address the switch does not own is dropped
+  auto pkt = makeDHCPv6Packet(kServerMac, kPlatformMac,
+      kDhcpV6Relay, IPAddressV6("2401:db00:2110:3099::1"),
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT,
+      DHCPv6Packet::DHCP6_SERVERAGENT_UDPPORT, 64,
+      "0d 00"
+      "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00" +
+      kClientIPHex + kInterfaceIdOpt + "00 09 00 20" + kAdvertise);
+  sw->packetReceived(std::move(pkt));
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "dhcpV6.drop_pkt.sum", 1);
+}
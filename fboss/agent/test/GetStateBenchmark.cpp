@@ -0,0 +1,138 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include <folly/SpinLock.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using folly::make_unique;
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+
+/*
+ * How SwSwitch::getState() used to work: a spinlock around a shared_ptr
+ * copy.  Kept here as the baseline for the thread local version.
+ */
+class LockedState {
+ public:
+  explicit LockedState(shared_ptr<SwitchState> state)
+    : state_(std::move(state)) {}
+
+  shared_ptr<SwitchState> getState() const {
+    folly::SpinLockGuard guard(lock_);
+    return state_;
+  }
+
+ private:
+  shared_ptr<SwitchState> state_;
+  mutable folly::SpinLock lock_;
+};
+unique_ptr<LockedState> lockedState;
+
+void init() {
+  MacAddress localMac("02:00:01:00:00:01");
+  sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init();
+  sw->updateStateBlocking("setup", [](const shared_ptr<SwitchState>& old) {
+    auto state = old->clone();
+    state->addVlan(make_shared<Vlan>(VlanID(1), "Vlan1"));
+    return state;
+  });
+  lockedState = make_unique<LockedState>(sw->getState());
+}
+
+/*
+ * Have numThreads threads each read the state numIters times, the way
+ * the packet handlers do: grab the state and look something up in it.
+ *
+ * The threads are started and joined with the timer suspended, and wait
+ * for go before reading, so only the reads themselves are measured.
+ */
+template <typename GetStateFn>
+void readState(size_t numIters, int numThreads, GetStateFn getStateFn) {
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+  std::atomic<int> done{0};
+  BENCHMARK_SUSPEND {
+    threads.reserve(numThreads);
+    for (int t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&] {
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        for (size_t n = 0; n < numIters; ++n) {
+          auto state = getStateFn();
+          folly::doNotOptimizeAway(state->getVlans()->getVlanIf(VlanID(1)));
+        }
+        done.fetch_add(1, std::memory_order_release);
+      });
+    }
+  }
+  go.store(true, std::memory_order_release);
+  while (done.load(std::memory_order_acquire) < numThreads) {
+    std::this_thread::yield();
+  }
+  BENCHMARK_SUSPEND {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
+void lockedGetState(size_t numIters, int numThreads) {
+  readState(numIters, numThreads, [] { return lockedState->getState(); });
+}
+
+void swSwitchGetState(size_t numIters, int numThreads) {
+  readState(numIters, numThreads, [] { return sw->getState(); });
+}
+
+} // unnamed namespace
+
+BENCHMARK_NAMED_PARAM(lockedGetState, 1_thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(swSwitchGetState, 1_thread, 1)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(lockedGetState, 2_threads, 2)
+BENCHMARK_RELATIVE_NAMED_PARAM(swSwitchGetState, 2_threads, 2)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(lockedGetState, 4_threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(swSwitchGetState, 4_threads, 4)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(lockedGetState, 8_threads, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(swSwitchGetState, 8_threads, 8)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(lockedGetState, 16_threads, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(swSwitchGetState, 16_threads, 16)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(lockedGetState, 32_threads, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(swSwitchGetState, 32_threads, 32)
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
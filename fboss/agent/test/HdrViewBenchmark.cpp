@@ -0,0 +1,129 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include "fboss/agent/packet/ArpHdr.h"
+#include "fboss/agent/packet/HdrViews.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
+#include "fboss/agent/packet/IPv6Hdr.h"
+#include "fboss/agent/packet/PktUtil.h"
+
+/*
+ * Per packet cost of the early "is this for us" decision in the RX
+ * handlers: parsing with the header classes, which decode every field up
+ * front, against the lazy header views.
+ */
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::io::Cursor;
+using std::unique_ptr;
+
+namespace {
+
+unique_ptr<IOBuf> ipv4Pkt;
+unique_ptr<IOBuf> ipv6Pkt;
+unique_ptr<IOBuf> arpPkt;
+
+unique_ptr<IOBuf> parse(const char* hex) {
+  return IOBuf::copyBuffer(PktUtil::parseHexData(hex).coalesce());
+}
+
+void init() {
+  ipv4Pkt = parse(
+      "45 00 00 1c  00 00 00 00  40 11 00 00"
+      "0a 00 00 0f  0a 00 00 01");
+  ipv6Pkt = parse(
+      "60 00 00 00  00 00 3a ff"
+      "24 01 db 00 21 10 30 04  00 00 00 00 00 01 00 00"
+      "ff 02 00 00 00 00 00 00  00 00 00 01 ff 00 00 0a");
+  arpPkt = parse(
+      "00 01  08 00  06  04  00 01"
+      "00 02 00 01 02 03  0a 00 00 0f"
+      "00 00 00 00 00 00  0a 00 00 01");
+}
+
+} // unnamed namespace
+
+BENCHMARK(IPv4Hdr_DstAddr, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(ipv4Pkt.get());
+    IPv4Hdr hdr(cursor);
+    folly::doNotOptimizeAway(hdr.dstAddr);
+  }
+}
+
+BENCHMARK_RELATIVE(IPv4HdrView_DstAddr, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(ipv4Pkt.get());
+    IPv4HdrView view(cursor);
+    folly::doNotOptimizeAway(view.dstAddr());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(IPv6Hdr_DstAddr, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(ipv6Pkt.get());
+    IPv6Hdr hdr(cursor);
+    folly::doNotOptimizeAway(hdr.dstAddr);
+  }
+}
+
+BENCHMARK_RELATIVE(IPv6HdrView_DstAddr, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(ipv6Pkt.get());
+    IPv6HdrView view(cursor);
+    folly::doNotOptimizeAway(view.dstAddr());
+  }
+}
+
+BENCHMARK(IPv6Hdr_HopLimit, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(ipv6Pkt.get());
+    IPv6Hdr hdr(cursor);
+    folly::doNotOptimizeAway(hdr.hopLimit);
+  }
+}
+
+BENCHMARK_RELATIVE(IPv6HdrView_HopLimit, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(ipv6Pkt.get());
+    IPv6HdrView view(cursor);
+    folly::doNotOptimizeAway(view.hopLimit());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ArpHdr_Tpa, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(arpPkt.get());
+    ArpHdr hdr(cursor);
+    folly::doNotOptimizeAway(hdr.tpa);
+  }
+}
+
+BENCHMARK_RELATIVE(ArpHdrView_Tpa, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    Cursor cursor(arpPkt.get());
+    ArpHdrView view(cursor);
+    folly::doNotOptimizeAway(view.tpa());
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -109,6 +109,47 @@ TEST(LldpManagerTest, LldpSend) {
   lldpManager.sendLldpOnAllPorts(false);
 }
 
+TEST(LldpManagerTest, FramesReused) {
+  auto sw = setupSwitch();
+  auto numPorts = sw->getState()->getPorts()->size();
+  EXPECT_HW_CALL(sw, sendPacketOutOfPort_(_)).Times(3 * numPorts);
+  LldpManager lldpManager(sw.get());
+  CounterCache counters(sw.get());
+
+  // The first round builds a frame per port, the next one reuses them
+  lldpManager.sendLldpOnAllPorts(false);
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "lldp.frames_built.sum",
+                      numPorts);
+  lldpManager.sendLldpOnAllPorts(false);
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "lldp.frames_built.sum",
+                      0);
+
+  // Renaming a port only rebuilds its frame
+  sw->updateStateBlocking("rename port",
+      [](const shared_ptr<SwitchState>& state) {
+        auto newState = state->clone();
+        auto port = newState->getPorts()->getPort(PortID(1))->modify(&newState);
+        port->setName("renamed");
+        return newState;
+      });
+  lldpManager.sendLldpOnAllPorts(false);
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "lldp.frames_built.sum",
+                      1);
+}
+
+TEST(LldpManagerTest, SentAsOneBatch) {
+  auto sw = setupSwitch();
+  auto numPorts = sw->getState()->getPorts()->size();
+  // All the frames are handed to the HwSwitch in a single call
+  EXPECT_HW_CALL(sw, sendPacketsOutOfPorts_(numPorts)).Times(1);
+  EXPECT_HW_CALL(sw, sendPacketOutOfPort_(_)).Times(numPorts);
+  LldpManager lldpManager(sw.get());
+  lldpManager.sendLldpOnAllPorts(false);
+}
+
 TEST(LldpManagerTest, NotEnabledTest) {
   // Setup switch without flags enabling LLDP, and
   // send an LLDP frame nevertheless. Used to segfault
@@ -16,6 +16,7 @@
 #include <folly/io/Cursor.h>
 #include "fboss/agent/AddressUtil.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/TxPacket.h"
@@ -413,6 +414,62 @@ TEST(NDP, UnsolicitedRequest) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.ndp.sum", 1);
 }
 
+TEST(NDP, SolicitedRequest) {
+  auto sw = setupSwitch();
+
+  auto makeSolicitation = [] {
+    auto pkt = MockRxPacket::fromHex(
+        // dst mac, src mac
+        "33 33 ff 00 00 0a  02 05 73 f9 46 fc"
+        // 802.1q, VLAN 5
+        "81 00 00 05"
+        // IPv6
+        "86 dd"
+        // Version 6, traffic class, flow label
+        "6e 00 00 00"
+        // Payload length: 24
+        "00 18"
+        // Next Header: 58 (ICMPv6), Hop Limit (255)
+        "3a ff"
+        // src addr (2401:db00:2110:3004::1:0)
+        "24 01 db 00 21 10 30 04 00 00 00 00 00 01 00 00"
+        // dst addr (ff02::1:ff00:000a)
+        "ff 02 00 00 00 00 00 00 00 00 00 01 ff 00 00 0a"
+        // type: neighbor solicitation
+        "87"
+        // code
+        "00"
+        // checksum
+        "da 66"
+        // reserved
+        "00 00 00 00"
+        // target address (2401:db00:2110:3004::a)
+        "24 01 db 00 21 10 30 04 00 00 00 00 00 00 00 0a");
+    pkt->padToLength(68);
+    pkt->setSrcPort(PortID(1));
+    pkt->setSrcVlan(VlanID(5));
+    return pkt;
+  };
+
+  CounterCache counters(sw.get());
+
+  // The first reply is built from scratch and the second one is patched
+  // from the cached template; both must be addressed to the requester and
+  // carry a valid checksum.
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_PKT(sw, "neighbor advertisement",
+               checkNeighborAdvert(kPlatformMac,
+                                   IPAddressV6("2401:db00:2110:3004::a"),
+                                   MacAddress("02:05:73:f9:46:fc"),
+                                   IPAddressV6("2401:db00:2110:3004::1:0"),
+                                   VlanID(5), 0xe0));
+    sw->packetReceived(makeSolicitation());
+  }
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.ndp.sum", 2);
+}
+
 TEST(NDP, TriggerSolicitation) {
   auto sw = setupSwitch();
   sw->updateStateBlocking("add test route table", addMockRouteTable);
@@ -1431,3 +1488,28 @@ TEST(NdpTest, PortFlapRecover) {
   EXPECT_NE(entry3, nullptr);
   EXPECT_EQ(entry3->isPending(), false);
 }
+
+TEST(NdpTest, UnsolicitedAdvertisementFlood) {
+  auto sw = setupSwitch();
+
+  // Every IPv6 interface address is advertised, all in a single batch
+  size_t numAddrs = 0;
+  for (const auto& intf : *sw->getState()->getInterfaces()) {
+    for (const auto& addrEntry : intf->getAddresses()) {
+      if (!addrEntry.first.isV6()) {
+        continue;
+      }
+      EXPECT_PKT(sw, "unsolicited neighbor advertisement",
+                 checkNeighborAdvert(intf->getMac(),
+                                     addrEntry.first.asV6(),
+                                     MacAddress::BROADCAST,
+                                     IPAddressV6("ff01::1"),
+                                     intf->getVlanID(), 0xa0)).Times(1);
+      ++numAddrs;
+    }
+  }
+  ASSERT_GT(numAddrs, 1u);
+  EXPECT_HW_CALL(sw, sendPacketsSwitched_(numAddrs)).Times(1);
+
+  sw->getIPv6Handler()->floodNeighborAdvertisements();
+}
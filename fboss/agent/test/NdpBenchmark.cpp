@@ -0,0 +1,175 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <boost/cast.hpp>
+
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/NdpResponseTable.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using folly::make_unique;
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+unique_ptr<MockRxPacket> solicitationMine;
+unique_ptr<MockRxPacket> solicitationNotMine;
+
+unique_ptr<SwSwitch> setupSwitch() {
+  MacAddress localMac("02:00:01:00:00:01");
+  auto sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init();
+
+  auto updateFn = [&](const shared_ptr<SwitchState>& oldState) {
+    auto state = oldState->clone();
+
+    // Add VLAN 5, and ports 1-9 which belong to it.
+    auto vlan5 = make_shared<Vlan>(VlanID(5), "Vlan5");
+    state->addVlan(vlan5);
+    for (int idx = 1; idx < 10; ++idx) {
+      vlan5->addPort(PortID(idx), false);
+    }
+    // Add Interface 5 to VLAN 5
+    auto intf5 = make_shared<Interface>
+      (InterfaceID(5), RouterID(0), VlanID(5),
+       "interface5", MacAddress("02:00:01:00:00:05"), 9000);
+    Interface::Addresses addrs5;
+    addrs5.emplace(IPAddress("2401:db00:2110:3004::a"), 64);
+    intf5->setAddresses(addrs5);
+    state->addIntf(intf5);
+
+    // Set up an NDP response table for VLAN 5 with an entry for
+    // 2401:db00:2110:3004::a
+    auto respTable5 = make_shared<NdpResponseTable>();
+    respTable5->setEntry(IPAddressV6("2401:db00:2110:3004::a"),
+                         MacAddress("02:00:01:00:00:05"),
+                         InterfaceID(5));
+    vlan5->setNdpResponseTable(respTable5);
+    return state;
+  };
+
+  sw->updateStateBlocking("setup", updateFn);
+  return sw;
+}
+
+unique_ptr<MockRxPacket> makeSolicitation(folly::StringPiece target,
+                                          folly::StringPiece checksum) {
+  auto pkt = MockRxPacket::fromHex(
+      // dst mac, src mac
+      "33 33 ff 00 00 0a  02 05 73 f9 46 fc"
+      // 802.1q, VLAN 5
+      "81 00 00 05"
+      // IPv6
+      "86 dd"
+      // Version 6, traffic class, flow label
+      "6e 00 00 00"
+      // Payload length: 24
+      "00 18"
+      // Next Header: 58 (ICMPv6), Hop Limit (255)
+      "3a ff"
+      // src addr (2401:db00:2110:3004::1:0)
+      "24 01 db 00 21 10 30 04 00 00 00 00 00 01 00 00"
+      // dst addr (ff02::1:ff00:000a)
+      "ff 02 00 00 00 00 00 00 00 00 00 01 ff 00 00 0a"
+      // type: neighbor solicitation, code
+      "87 00" +
+      // checksum
+      checksum.str() +
+      // reserved
+      "00 00 00 00" +
+      // target address
+      target.str());
+  pkt->padToLength(68);
+  pkt->setSrcPort(PortID(1));
+  pkt->setSrcVlan(VlanID(5));
+  return pkt;
+}
+
+void init() {
+  // Initialize the switch
+  sw = setupSwitch();
+
+  // A solicitation for 2401:db00:2110:3004::a, which is answered from the
+  // cached neighbor advertisement template
+  solicitationMine = makeSolicitation(
+      "24 01 db 00 21 10 30 04 00 00 00 00 00 00 00 0a", "da 66");
+  // A solicitation for 2401:db00:2110:3004::b, which is not ours
+  solicitationNotMine = makeSolicitation(
+      "24 01 db 00 21 10 30 04 00 00 00 00 00 00 00 0b", "da 65");
+}
+
+} // unnamed namespace
+
+BENCHMARK(NdpSolicitation, numIters) {
+  BENCHMARK_SUSPEND {
+    SimSwitch* sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+    sim->resetTxCount();
+  }
+
+  // Send the packet to the switch numIters times
+  for (size_t n = 0; n < numIters; ++n) {
+    sw->packetReceived(solicitationMine->clone());
+  }
+
+  BENCHMARK_SUSPEND {
+    // Make sure the SwSwitch sent out 1 packet for each iteration,
+    // just to verify that it was actually sending advertisements
+    SimSwitch* sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+    CHECK_EQ(sim->getTxCount(), numIters);
+  }
+}
+
+BENCHMARK(NdpSolicitationNotMine, numIters) {
+  BENCHMARK_SUSPEND {
+    SimSwitch* sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+    sim->resetTxCount();
+  }
+
+  // Send the packet to the switch numIters times
+  for (size_t n = 0; n < numIters; ++n) {
+    sw->packetReceived(solicitationNotMine->clone());
+  }
+
+  BENCHMARK_SUSPEND {
+    // This solicitation wasn't for one of our IPs, so no outgoing packets
+    // should have been generated.
+    SimSwitch* sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+    CHECK_EQ(sim->getTxCount(), 0);
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Setting up the switch is fairly expensive.  Do this once before we run the
+  // benchmark functions so we don't have to do it inside the benchmark
+  // functions.  The first solicitation builds the advertisement template, so
+  // every iteration measures the cached path.
+  init();
+  sw->packetReceived(solicitationMine->clone());
+
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/IPAddressV4.h>
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+/*
+ * Benchmarks for programming a large FIB whose routes share a few ECMP
+ * nexthop groups: adding all of the routes, and re-adding the same routes,
+ * which is what a full FIB sync from the routing daemon usually does.
+ */
+
+DEFINE_int32(num_routes, 500000, "Number of routes to add");
+DEFINE_int32(num_ecmp_groups, 16, "Number of distinct nexthop sets");
+DEFINE_int32(ecmp_width, 4, "Number of nexthops in each set");
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+
+const RouterID kRid(0);
+
+vector<RouteNextHops> nexthopSets;
+shared_ptr<RouteTableMap> emptyTables;
+shared_ptr<RouteTableMap> fullTables;
+
+shared_ptr<RouteTableMap> addRoutes(const shared_ptr<RouteTableMap>& tables) {
+  RouteUpdater updater(tables, true);
+  for (int n = 0; n < FLAGS_num_routes; ++n) {
+    // 11.0.0.0/8 has room for 16M host routes
+    IPAddress network(IPAddressV4::fromLongHBO(0x0b000000 + n));
+    updater.addRoute(kRid, network, 32, nexthopSets[n % nexthopSets.size()]);
+  }
+  return updater.updateDone();
+}
+
+void init() {
+  for (int group = 0; group < FLAGS_num_ecmp_groups; ++group) {
+    RouteNextHops nexthops;
+    for (int n = 0; n < FLAGS_ecmp_width; ++n) {
+      nexthops.emplace(IPAddressV4::fromLongHBO(
+            0x0a000000 + (group << 8) + n + 1));
+    }
+    nexthopSets.push_back(std::move(nexthops));
+  }
+  auto state = make_shared<SwitchState>();
+  state->publish();
+  emptyTables = state->getRouteTables();
+  fullTables = addRoutes(emptyTables);
+  CHECK(fullTables);
+  fullTables->publish();
+
+  // Every route points at one of a handful of groups, rather than holding
+  // its own copy of its nexthops
+  auto rib = fullTables->getRouteTableIf(kRid)->getRibV4();
+  size_t setBytes = 0;
+  for (const auto& nexthops : nexthopSets) {
+    setBytes += sizeof(RouteNextHops) +
+      nexthops.size() * sizeof(RouteNextHops::value_type);
+  }
+  LOG(INFO) << rib->size() << " routes share "
+            << RouteNextHopGroup::numGroups() << " nexthop groups; "
+            << "per route nexthop copies would take "
+            << (setBytes / nexthopSets.size()) * rib->size() << " bytes";
+}
+
+} // unnamed namespace
+
+BENCHMARK(AddRoutes, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    auto tables = addRoutes(emptyTables);
+    folly::doNotOptimizeAway(tables);
+    BENCHMARK_SUSPEND {
+      tables.reset();
+    }
+  }
+}
+
+BENCHMARK(ReAddSameRoutes, numIters) {
+  // Comparing the nexthops of each route with the existing one is a
+  // pointer compare
+  for (size_t n = 0; n < numIters; ++n) {
+    auto tables = addRoutes(fullTables);
+    CHECK(!tables);
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
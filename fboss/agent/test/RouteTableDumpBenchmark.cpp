@@ -0,0 +1,160 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/ThriftHandler.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+
+DEFINE_int32(route_dump_v4_routes, 100000,
+             "Number of IPv4 routes in the benchmarked route table");
+DEFINE_int32(route_dump_v6_routes, 20000,
+             "Number of IPv6 routes in the benchmarked route table");
+DEFINE_int32(route_dump_page_size, 1000,
+             "Page size used by the paginated route dump benchmarks");
+
+using namespace facebook::fboss;
+using facebook::network::toBinaryAddress;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::MacAddress;
+using folly::make_unique;
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+unique_ptr<ThriftHandler> handler;
+
+unique_ptr<SwSwitch> setupSwitch() {
+  MacAddress localMac("02:00:01:00:00:01");
+  auto sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init();
+
+  auto updateFn = [&](const shared_ptr<SwitchState>& oldState) {
+    auto state = oldState->clone();
+    auto vlan1 = make_shared<Vlan>(VlanID(1), "Vlan1");
+    state->addVlan(vlan1);
+    for (int idx = 1; idx < 10; ++idx) {
+      vlan1->addPort(PortID(idx), false);
+    }
+    auto intf1 = make_shared<Interface>
+      (InterfaceID(1), RouterID(0), VlanID(1),
+       "interface1", localMac, 9000);
+    Interface::Addresses addrs1;
+    addrs1.emplace(IPAddress("10.0.0.1"), 24);
+    addrs1.emplace(IPAddress("2401:db00:2110:3001::1"), 64);
+    intf1->setAddresses(addrs1);
+    state->addIntf(intf1);
+    return state;
+  };
+  sw->updateStateBlocking("setup", updateFn);
+  sw->initialConfigApplied();
+  return sw;
+}
+
+// Spread the routes over a handful of ECMP groups, as in a data center FIB
+std::vector<UnicastRoute> generateRoutes() {
+  constexpr int kNumEcmpGroups = 16;
+  constexpr int kEcmpWidth = 4;
+  std::vector<UnicastRoute> routes;
+  for (int i = 0; i < FLAGS_route_dump_v4_routes; ++i) {
+    UnicastRoute route;
+    route.dest.ip = toBinaryAddress(IPAddressV4::fromLongHBO(
+          0x0b000000 + (i << 8)));
+    route.dest.prefixLength = 24;
+    for (int j = 0; j < kEcmpWidth; ++j) {
+      route.nextHopAddrs.push_back(toBinaryAddress(IPAddressV4::fromLongHBO(
+            0x0a000002 + (i % kNumEcmpGroups) + j)));
+    }
+    routes.push_back(std::move(route));
+  }
+  for (int i = 0; i < FLAGS_route_dump_v6_routes; ++i) {
+    UnicastRoute route;
+    auto bytes = IPAddressV6("2401:db00::").toByteArray();
+    bytes[4] = (i >> 8) & 0xff;
+    bytes[5] = i & 0xff;
+    route.dest.ip = toBinaryAddress(IPAddressV6(bytes));
+    route.dest.prefixLength = 48;
+    for (int j = 0; j < kEcmpWidth; ++j) {
+      auto nhBytes = IPAddressV6("2401:db00:2110:3001::").toByteArray();
+      nhBytes[15] = 2 + (i % kNumEcmpGroups) + j;
+      route.nextHopAddrs.push_back(toBinaryAddress(IPAddressV6(nhBytes)));
+    }
+    routes.push_back(std::move(route));
+  }
+  return routes;
+}
+
+void init() {
+  sw = setupSwitch();
+  handler = make_unique<ThriftHandler>(sw.get());
+  handler->syncFib(0, make_unique<std::vector<UnicastRoute>>(
+        generateRoutes()));
+}
+
+size_t dumpPaged(bool compact) {
+  size_t numRoutes = 0;
+  RouteTablePageRequest req;
+  req.maxRoutes = FLAGS_route_dump_page_size;
+  req.compact = compact;
+  while (true) {
+    RouteTablePage page;
+    handler->getRouteTablePage(page,
+        make_unique<RouteTablePageRequest>(req));
+    numRoutes += page.routes.size() + page.compactRoutes.size();
+    if (!page.__isset.nextCursor) {
+      return numRoutes;
+    }
+    req.cursor = page.nextCursor;
+    req.__isset.cursor = true;
+  }
+}
+
+} // unnamed namespace
+
+BENCHMARK(RouteTableFullDump, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    std::vector<UnicastRoute> routes;
+    handler->getRouteTable(routes);
+    folly::doNotOptimizeAway(routes.size());
+  }
+}
+
+BENCHMARK_RELATIVE(RouteTablePagedDump, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(dumpPaged(false));
+  }
+}
+
+BENCHMARK_RELATIVE(RouteTablePagedCompactDump, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    folly::doNotOptimizeAway(dumpPaged(true));
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Building a full table is expensive, so do it once up front rather than
+  // inside the benchmark functions.
+  init();
+
+  folly::runBenchmarks();
+  return 0;
+}
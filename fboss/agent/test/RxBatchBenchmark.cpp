@@ -0,0 +1,149 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <boost/cast.hpp>
+
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/state/ArpResponseTable.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+
+/*
+ * Compare delivering a burst of trapped ARP requests to the SwSwitch one
+ * packet at a time against delivering it with packetsReceived().
+ */
+
+DEFINE_int32(rx_batch_size, 32, "Number of packets in each burst");
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::MacAddress;
+using folly::make_unique;
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+unique_ptr<MockRxPacket> arpRequest;
+
+void init() {
+  MacAddress localMac("02:00:01:00:00:01");
+  sw = make_unique<SwSwitch>(make_unique<SimPlatform>(localMac, 10));
+  sw->init();
+
+  sw->updateStateBlocking("setup", [](const shared_ptr<SwitchState>& old) {
+    auto state = old->clone();
+    auto vlan1 = make_shared<Vlan>(VlanID(1), "Vlan1");
+    state->addVlan(vlan1);
+    for (int idx = 1; idx < 10; ++idx) {
+      vlan1->addPort(PortID(idx), false);
+    }
+    auto intf1 = make_shared<Interface>
+      (InterfaceID(1), RouterID(0), VlanID(1),
+       "interface1", MacAddress("02:00:01:00:00:01"), 9000);
+    Interface::Addresses addrs1;
+    addrs1.emplace(IPAddress("10.0.0.1"), 24);
+    intf1->setAddresses(addrs1);
+    state->addIntf(intf1);
+
+    auto respTable1 = make_shared<ArpResponseTable>();
+    respTable1->setEntry(IPAddressV4("10.0.0.1"),
+                         MacAddress("00:02:00:00:00:01"),
+                         InterfaceID(1));
+    state->getVlans()->getVlan(VlanID(1))->setArpResponseTable(respTable1);
+    return state;
+  });
+
+  // An ARP request for 10.0.0.1
+  arpRequest = MockRxPacket::fromHex(
+      // dst mac, src mac
+      "ff ff ff ff ff ff  00 02 00 01 02 03"
+      // 802.1q, VLAN 1
+      "81 00  00 01"
+      // ARP, htype: ethernet, ptype: IPv4, hlen: 6, plen: 4
+      "08 06  00 01  08 00  06  04"
+      // ARP Request
+      "00 01"
+      // Sender MAC
+      "00 02 00 01 02 03"
+      // Sender IP: 10.0.0.15
+      "0a 00 00 0f"
+      // Target MAC
+      "00 00 00 00 00 00"
+      // Target IP: 10.0.0.1
+      "0a 00 00 01"
+      );
+  arpRequest->padToLength(68);
+  arpRequest->setSrcPort(PortID(1));
+  arpRequest->setSrcVlan(VlanID(1));
+}
+
+SimSwitch* getSim() {
+  return boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+}
+
+HwSwitch::RxPackets makeBurst() {
+  HwSwitch::RxPackets pkts;
+  pkts.reserve(FLAGS_rx_batch_size);
+  for (int i = 0; i < FLAGS_rx_batch_size; ++i) {
+    pkts.push_back(arpRequest->clone());
+  }
+  return pkts;
+}
+
+} // unnamed namespace
+
+BENCHMARK(ArpRequestsOneAtATime, numIters) {
+  BENCHMARK_SUSPEND {
+    getSim()->resetTxCount();
+  }
+
+  for (size_t n = 0; n < numIters; ++n) {
+    for (auto& pkt : makeBurst()) {
+      getSim()->injectPacket(std::move(pkt));
+    }
+  }
+
+  BENCHMARK_SUSPEND {
+    // Each request should have generated a reply
+    CHECK_EQ(getSim()->getTxCount(), numIters * FLAGS_rx_batch_size);
+  }
+}
+
+BENCHMARK_RELATIVE(ArpRequestsBatched, numIters) {
+  BENCHMARK_SUSPEND {
+    getSim()->resetTxCount();
+  }
+
+  for (size_t n = 0; n < numIters; ++n) {
+    getSim()->injectPackets(makeBurst());
+  }
+
+  BENCHMARK_SUSPEND {
+    CHECK_EQ(getSim()->getTxCount(), numIters * FLAGS_rx_batch_size);
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <boost/cast.hpp>
+
+#include <folly/Benchmark.h>
+#include <folly/IPAddressV4.h>
+#include <folly/Memory.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/TestUtils.h"
+#include "fboss/agent/gen-cpp/switch_config_types.h"
+
+/*
+ * End to end benchmarks using the SimSwitch software dataplane:
+ *  - forwarding of routed packets,
+ *  - the time from a neighbor entry being added to the state until
+ *    packets are forwarded to it,
+ *  - ARP requests trapped through the dataplane and answered by SwSwitch.
+ */
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::IPAddressV4;
+using folly::MacAddress;
+using folly::io::RWPrivateCursor;
+using folly::make_unique;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+const MacAddress kPlatformMac("02:01:02:03:04:05");
+const MacAddress kHostMac("02:00:00:00:00:0a");
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+SimSwitch* sim;
+unique_ptr<IOBuf> routedPkt;
+unique_ptr<IOBuf> connectedPkt;
+unique_ptr<IOBuf> arpRequest;
+
+cfg::SwitchConfig createConfig() {
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].name = "Vlan1";
+  config.vlans[0].id = 1;
+  config.vlans[0].routable = true;
+  config.vlans[0].intfID = 1;
+
+  config.ports.resize(4);
+  config.vlanPorts.resize(4);
+  for (int n = 0; n < 4; ++n) {
+    config.ports[n].logicalID = n + 1;
+    config.ports[n].state = cfg::PortState::UP;
+    config.ports[n].minFrameSize = 64;
+    config.ports[n].maxFrameSize = 9000;
+    config.ports[n].routable = true;
+    config.ports[n].ingressVlan = 1;
+    config.vlanPorts[n].vlanID = 1;
+    config.vlanPorts[n].logicalPort = n + 1;
+    config.vlanPorts[n].spanningTreeState =
+      cfg::SpanningTreeState::FORWARDING;
+    config.vlanPorts[n].emitTags = false;
+  }
+
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].ipAddresses.resize(1);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+
+  config.__isset.staticRoutesWithNhops = true;
+  config.staticRoutesWithNhops.resize(1);
+  config.staticRoutesWithNhops[0].prefix = "20.0.0.0/8";
+  config.staticRoutesWithNhops[0].nexthops.resize(2);
+  config.staticRoutesWithNhops[0].nexthops[0] = "10.0.0.2";
+  config.staticRoutesWithNhops[0].nexthops[1] = "10.0.0.3";
+  return config;
+}
+
+void setNeighbor(const char* ip, MacAddress mac, PortID port, bool add) {
+  sw->updateStateBlocking("update neighbor",
+      [&](const shared_ptr<SwitchState>& state) {
+        shared_ptr<SwitchState> newState(state);
+        auto* vlan = newState->getVlans()->getVlan(VlanID(1)).get();
+        auto* arp = vlan->getArpTable()->modify(&vlan, &newState);
+        if (add) {
+          arp->addEntry(IPAddressV4(ip), mac, port, InterfaceID(1));
+        } else {
+          arp->removeEntry(IPAddressV4(ip));
+        }
+        return newState;
+      });
+}
+
+unique_ptr<IOBuf> udpPacket(const char* dstIP) {
+  auto buf = IOBuf::create(64);
+  buf->append(64);
+  memset(buf->writableData(), 0, buf->length());
+  RWPrivateCursor c(buf.get());
+  c.push(kPlatformMac.bytes(), MacAddress::SIZE);
+  c.push(kHostMac.bytes(), MacAddress::SIZE);
+  c.writeBE<uint16_t>(0x0800);
+  uint8_t* ip = c.writableData();
+  c.write<uint8_t>(0x45);
+  c.write<uint8_t>(0);
+  c.writeBE<uint16_t>(28);
+  c.writeBE<uint32_t>(0);
+  c.write<uint8_t>(64);
+  c.write<uint8_t>(17);
+  c.writeBE<uint16_t>(0);
+  c.write<uint32_t>(IPAddressV4("10.0.0.10").toLong());
+  c.write<uint32_t>(IPAddressV4(dstIP).toLong());
+  c.writeBE<uint16_t>(10000);
+  c.writeBE<uint16_t>(53);
+  c.writeBE<uint16_t>(8);
+  c.writeBE<uint16_t>(0);
+  auto csum = PktUtil::internetChecksum(ip, 20);
+  ip[10] = csum >> 8;
+  ip[11] = csum & 0xff;
+  return buf;
+}
+
+void init() {
+  sw = make_unique<SwSwitch>(make_unique<SimPlatform>(kPlatformMac, 4));
+  sw->init();
+  sim = boost::polymorphic_downcast<SimSwitch*>(sw->getHw());
+
+  auto config = createConfig();
+  auto platform = sw->getPlatform();
+  sw->updateStateBlocking("config",
+      [&](const shared_ptr<SwitchState>& state) {
+        auto newState = state;
+        return publishAndApplyConfig(newState, &config, platform);
+      });
+  setNeighbor("10.0.0.2", MacAddress("02:00:00:00:00:02"), PortID(2), true);
+  setNeighbor("10.0.0.3", MacAddress("02:00:00:00:00:03"), PortID(3), true);
+
+  routedPkt = udpPacket("20.1.2.3");
+  connectedPkt = udpPacket("10.0.0.5");
+  arpRequest = IOBuf::copyBuffer(PktUtil::parseHexData(
+      // dst mac, src mac, ARP
+      "ff ff ff ff ff ff  02 00 00 00 00 0a  08 06"
+      // htype, ptype, hlen, plen, request
+      "00 01  08 00  06  04  00 01"
+      // Sender MAC and IP 10.0.0.10
+      "02 00 00 00 00 0a  0a 00 00 0a"
+      // Target MAC and IP 10.0.0.1
+      "00 00 00 00 00 00  0a 00 00 01"
+      // Padding
+      "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00"
+      ).coalesce());
+}
+
+} // unnamed namespace
+
+BENCHMARK(RoutedForwarding, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    auto action = sim->receivePacket(PortID(1), routedPkt->clone());
+    DCHECK(action == SimDataplane::Action::FORWARD);
+  }
+}
+
+BENCHMARK(NeighborConvergence, numIters) {
+  // Time from a neighbor entry being added until the first packet to it
+  // is forwarded, including the whole SwSwitch state update.
+  const char* ip = "10.0.0.5";
+  const MacAddress mac("02:00:00:00:00:05");
+  for (size_t n = 0; n < numIters; ++n) {
+    setNeighbor(ip, mac, PortID(4), true);
+    auto action = sim->receivePacket(PortID(1), connectedPkt->clone());
+    CHECK(action == SimDataplane::Action::FORWARD);
+
+    BENCHMARK_SUSPEND {
+      setNeighbor(ip, mac, PortID(4), false);
+    }
+  }
+}
+
+BENCHMARK(ArpThroughDataplane, numIters) {
+  BENCHMARK_SUSPEND {
+    sim->resetTxCount();
+  }
+  for (size_t n = 0; n < numIters; ++n) {
+    sim->receivePacket(PortID(1), arpRequest->clone());
+  }
+  BENCHMARK_SUSPEND {
+    // Every request should have been trapped and answered
+    CHECK_EQ(sim->getTxCount(), numIters);
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <mutex>
+
+#include <boost/cast.hpp>
+#include <folly/IPAddressV4.h>
+#include <folly/MacAddress.h>
+#include <folly/Memory.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <gtest/gtest.h>
+
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/hw/sim/SimSwitch.h"
+#include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/state/ArpTable.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+#include "fboss/agent/state/VlanMap.h"
+#include "fboss/agent/test/TestUtils.h"
+#include "fboss/agent/gen-cpp/switch_config_types.h"
+
+using namespace facebook::fboss;
+using folly::IOBuf;
+using folly::IPAddressV4;
+using folly::MacAddress;
+using folly::io::Cursor;
+using folly::io::RWPrivateCursor;
+using folly::make_unique;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+const MacAddress kPlatformMac("02:01:02:03:04:05");
+const MacAddress kHostA("02:00:00:00:00:0a");
+const MacAddress kHostB("02:00:00:00:00:0b");
+const MacAddress kNexthop2("02:00:00:00:00:02");
+const MacAddress kNexthop3("02:00:00:00:00:03");
+
+cfg::SwitchConfig createConfig() {
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].name = "Vlan1";
+  config.vlans[0].id = 1;
+  config.vlans[0].routable = true;
+  config.vlans[0].intfID = 1;
+
+  config.ports.resize(4);
+  config.vlanPorts.resize(4);
+  for (int n = 0; n < 4; ++n) {
+    config.ports[n].logicalID = n + 1;
+    config.ports[n].state = cfg::PortState::UP;
+    config.ports[n].minFrameSize = 64;
+    config.ports[n].maxFrameSize = 9000;
+    config.ports[n].routable = true;
+    config.ports[n].ingressVlan = 1;
+    config.vlanPorts[n].vlanID = 1;
+    config.vlanPorts[n].logicalPort = n + 1;
+    config.vlanPorts[n].spanningTreeState =
+      cfg::SpanningTreeState::FORWARDING;
+    config.vlanPorts[n].emitTags = false;
+  }
+
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].ipAddresses.resize(1);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+
+  // ECMP across two neighbors, plus drop and punt routes
+  config.__isset.staticRoutesWithNhops = true;
+  config.staticRoutesWithNhops.resize(1);
+  config.staticRoutesWithNhops[0].prefix = "20.0.0.0/8";
+  config.staticRoutesWithNhops[0].nexthops.resize(2);
+  config.staticRoutesWithNhops[0].nexthops[0] = "10.0.0.2";
+  config.staticRoutesWithNhops[0].nexthops[1] = "10.0.0.3";
+  config.__isset.staticRoutesToNull = true;
+  config.staticRoutesToNull.resize(1);
+  config.staticRoutesToNull[0].prefix = "30.0.0.0/8";
+  config.__isset.staticRoutesToCPU = true;
+  config.staticRoutesToCPU.resize(1);
+  config.staticRoutesToCPU[0].prefix = "40.0.0.0/8";
+  return config;
+}
+
+class SimDataplaneTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    sw_ = make_unique<SwSwitch>(make_unique<SimPlatform>(kPlatformMac, 4));
+    sw_->init();
+    sim_ = boost::polymorphic_downcast<SimSwitch*>(sw_->getHw());
+    sim_->setEgressHandler([this](PortID port, unique_ptr<IOBuf> buf) {
+      // Only keep the test's own UDP packets, and not whatever the agent
+      // sends by itself
+      Cursor c(buf.get());
+      c.skip(12);
+      if (c.readBE<uint16_t>() != 0x0800) {
+        return;
+      }
+      std::lock_guard<std::mutex> g(lock_);
+      egress_.emplace_back(port, std::move(buf));
+    });
+
+    auto config = createConfig();
+    auto platform = sw_->getPlatform();
+    sw_->updateStateBlocking("config",
+        [&](const shared_ptr<SwitchState>& state) {
+          auto newState = state;
+          return publishAndApplyConfig(newState, &config, platform);
+        });
+  }
+
+  void TearDown() override {
+    sim_->setEgressHandler(nullptr);
+  }
+
+  void addNeighbor(const char* ip, MacAddress mac, PortID port) {
+    sw_->updateStateBlocking("add neighbor",
+        [&](const shared_ptr<SwitchState>& state) {
+          shared_ptr<SwitchState> newState(state);
+          auto* vlan = newState->getVlans()->getVlan(VlanID(1)).get();
+          auto* arp = vlan->getArpTable()->modify(&vlan, &newState);
+          arp->addEntry(IPAddressV4(ip), mac, port, InterfaceID(1));
+          return newState;
+        });
+  }
+
+  void removeNeighbor(const char* ip) {
+    sw_->updateStateBlocking("remove neighbor",
+        [&](const shared_ptr<SwitchState>& state) {
+          shared_ptr<SwitchState> newState(state);
+          auto* vlan = newState->getVlans()->getVlan(VlanID(1)).get();
+          auto* arp = vlan->getArpTable()->modify(&vlan, &newState);
+          arp->removeEntry(IPAddressV4(ip));
+          return newState;
+        });
+  }
+
+  // An untagged UDP packet with a valid IPv4 header checksum
+  static unique_ptr<IOBuf> udpPacket(MacAddress dstMac, MacAddress srcMac,
+                                     const char* srcIP, const char* dstIP,
+                                     uint16_t srcPort = 10000,
+                                     uint8_t ttl = 64) {
+    auto buf = IOBuf::create(64);
+    buf->append(64);
+    memset(buf->writableData(), 0, buf->length());
+    RWPrivateCursor c(buf.get());
+    c.push(dstMac.bytes(), MacAddress::SIZE);
+    c.push(srcMac.bytes(), MacAddress::SIZE);
+    c.writeBE<uint16_t>(0x0800);
+    uint8_t* ip = c.writableData();
+    c.write<uint8_t>(0x45);
+    c.write<uint8_t>(0);
+    c.writeBE<uint16_t>(28);
+    c.writeBE<uint32_t>(0);
+    c.write<uint8_t>(ttl);
+    c.write<uint8_t>(17);
+    c.writeBE<uint16_t>(0);
+    c.write<uint32_t>(IPAddressV4(srcIP).toLong());
+    c.write<uint32_t>(IPAddressV4(dstIP).toLong());
+    c.writeBE<uint16_t>(srcPort);
+    c.writeBE<uint16_t>(53);
+    c.writeBE<uint16_t>(8);
+    c.writeBE<uint16_t>(0);
+    auto csum = PktUtil::internetChecksum(ip, 20);
+    ip[10] = csum >> 8;
+    ip[11] = csum & 0xff;
+    return buf;
+  }
+
+  std::vector<std::pair<PortID, unique_ptr<IOBuf>>> takeEgress() {
+    std::lock_guard<std::mutex> g(lock_);
+    return std::move(egress_);
+  }
+
+ protected:
+  unique_ptr<SwSwitch> sw_;
+  SimSwitch* sim_{nullptr};
+  std::mutex lock_;
+  std::vector<std::pair<PortID, unique_ptr<IOBuf>>> egress_;
+};
+
+} // unnamed namespace
+
+TEST_F(SimDataplaneTest, Switching) {
+  // Unknown unicast is flooded to the rest of the VLAN
+  EXPECT_EQ(SimDataplane::Action::FORWARD, sim_->receivePacket(
+      PortID(1), udpPacket(kHostB, kHostA, "10.0.0.10", "10.0.0.11")));
+  auto egress = takeEgress();
+  ASSERT_EQ(3, egress.size());
+  EXPECT_EQ(PortID(2), egress[0].first);
+  EXPECT_EQ(PortID(3), egress[1].first);
+  EXPECT_EQ(PortID(4), egress[2].first);
+
+  // Host A was learned on port 1, so the reply only goes there
+  EXPECT_EQ(SimDataplane::Action::FORWARD, sim_->receivePacket(
+      PortID(3), udpPacket(kHostA, kHostB, "10.0.0.11", "10.0.0.10")));
+  egress = takeEgress();
+  ASSERT_EQ(1, egress.size());
+  EXPECT_EQ(PortID(1), egress[0].first);
+
+  // ...and host B is now known to be on port 3
+  EXPECT_EQ(SimDataplane::Action::FORWARD, sim_->receivePacket(
+      PortID(1), udpPacket(kHostB, kHostA, "10.0.0.10", "10.0.0.11")));
+  egress = takeEgress();
+  ASSERT_EQ(1, egress.size());
+  EXPECT_EQ(PortID(3), egress[0].first);
+}
+
+TEST_F(SimDataplaneTest, EcmpRouting) {
+  addNeighbor("10.0.0.2", kNexthop2, PortID(2));
+  addNeighbor("10.0.0.3", kNexthop3, PortID(3));
+
+  const int kFlows = 64;
+  for (int flow = 0; flow < kFlows; ++flow) {
+    EXPECT_EQ(SimDataplane::Action::FORWARD, sim_->receivePacket(
+        PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10",
+                             "20.1.2.3", 10000 + flow)));
+  }
+
+  int perPort[5] = {0};
+  for (const auto& egress : takeEgress()) {
+    ASSERT_TRUE(egress.first == PortID(2) || egress.first == PortID(3));
+    ++perPort[static_cast<int>(egress.first)];
+
+    Cursor c(egress.second.get());
+    auto dst = PktUtil::readMac(&c);
+    EXPECT_EQ(egress.first == PortID(2) ? kNexthop2 : kNexthop3, dst);
+    EXPECT_EQ(kPlatformMac, PktUtil::readMac(&c));
+    EXPECT_EQ(0x0800, c.readBE<uint16_t>());
+    // TTL decremented, with a header checksum that is still valid
+    const uint8_t* ip = c.data();
+    EXPECT_EQ(63, ip[8]);
+    EXPECT_EQ(0, PktUtil::internetChecksum(ip, 20));
+  }
+  EXPECT_EQ(kFlows, perPort[2] + perPort[3]);
+  EXPECT_LT(0, perPort[2]);
+  EXPECT_LT(0, perPort[3]);
+
+  // Once a neighbor goes away its flows go to the CPU to be resolved again
+  removeNeighbor("10.0.0.2");
+  removeNeighbor("10.0.0.3");
+  EXPECT_EQ(SimDataplane::Action::TRAP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "20.1.2.3")));
+}
+
+TEST_F(SimDataplaneTest, Traps) {
+  auto trapped = sim_->getDataplane()->getTrappedCount();
+
+  // Broadcast ARP request
+  auto arp = IOBuf::copyBuffer(PktUtil::parseHexData(
+      "ff ff ff ff ff ff  02 00 00 00 00 0a  08 06"
+      "00 01  08 00  06  04  00 01"
+      "02 00 00 00 00 0a  0a 00 00 0a"
+      "00 00 00 00 00 00  0a 00 00 01"
+      "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00"
+      ).coalesce());
+  EXPECT_EQ(SimDataplane::Action::TRAP,
+            sim_->receivePacket(PortID(1), std::move(arp)));
+
+  // Our own address
+  EXPECT_EQ(SimDataplane::Action::TRAP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "10.0.0.1")));
+  // TTL expiring
+  addNeighbor("10.0.0.2", kNexthop2, PortID(2));
+  EXPECT_EQ(SimDataplane::Action::TRAP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "20.1.2.3",
+                           10000, 1)));
+  // A connected host we have no ARP entry for
+  EXPECT_EQ(SimDataplane::Action::TRAP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "10.0.0.99")));
+  // A route to the CPU
+  EXPECT_EQ(SimDataplane::Action::TRAP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "40.0.0.1")));
+  EXPECT_EQ(trapped + 5, sim_->getDataplane()->getTrappedCount());
+
+  // A null route, and a destination with no route at all
+  EXPECT_EQ(SimDataplane::Action::DROP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "30.0.0.1")));
+  EXPECT_EQ(SimDataplane::Action::DROP, sim_->receivePacket(
+      PortID(1), udpPacket(kPlatformMac, kHostA, "10.0.0.10", "50.0.0.1")));
+}
@@ -0,0 +1,666 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/Memory.h>
+#include <folly/String.h>
+#include "fboss/agent/state/NodeMapDelta.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteDelta.h"
+#include "fboss/agent/state/RouteTable.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/StateDelta.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/VlanMapDelta.h"
+#include "fboss/lib/RadixTree.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+/*
+ * Benchmarks for the state and routing code, at FIB sizes from a small
+ * top-of-rack table up to a full internet table:
+ *
+ *  - RouteUpdater adding, deleting, and resolving routes, and a full FIB sync
+ *  - computing and walking a RouteTablesDelta and a StateDelta
+ *  - publishing a SwitchState, and cloning a RIB and a NodeMap
+ *  - converting a SwitchState to and from folly::dynamic
+ *  - RadixTree insert, lookup, and erase
+ *
+ * Each benchmark is registered once per table size, and the RouteUpdater
+ * ones once per ECMP width as well, so that the name of a benchmark says
+ * what it measured, e.g. "RouteUpdaterAdd/100000/ecmp8".  The prefixes are
+ * generated with a fixed seed from a mix of prefix lengths shaped like the
+ * public internet tables, so runs are comparable with each other.
+ *
+ * Run with --json to get the results as a JSON object mapping each benchmark
+ * to its time per iteration in nanoseconds, for tracking them run over run.
+ */
+
+DEFINE_string(state_bench_sizes, "1000,10000,100000,1000000",
+              "Comma separated list of the numbers of prefixes to benchmark "
+              "with");
+DEFINE_string(state_bench_ecmp_widths, "1,8,64",
+              "Comma separated list of the numbers of nexthops for each "
+              "route to benchmark the RouteUpdater with.  The other "
+              "benchmarks use the first one.");
+DEFINE_int32(state_bench_v6_percent, 20,
+             "Percentage of the prefixes that are IPv6");
+DEFINE_int32(state_bench_ecmp_groups, 16,
+             "Number of distinct nexthop sets the routes are spread over");
+DEFINE_int32(state_bench_churn_percent, 10,
+             "Percentage of the routes changed by an incremental update");
+DEFINE_int32(state_bench_lookups, 100000,
+             "Number of addresses looked up by the RadixTree lookup "
+             "benchmarks");
+DEFINE_int32(state_bench_seed, 1, "Seed for generating the prefixes");
+
+using namespace facebook::fboss;
+using facebook::network::RadixTree;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+using folly::StringPiece;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace {
+
+const RouterID kRid(0);
+const InterfaceID kIntf(1);
+// The nexthops are in these subnets, which the generated prefixes never
+// overlap.
+const IPAddress kIntfAddrV4("10.0.0.1");
+const uint8_t kIntfMaskV4 = 16;
+const IPAddress kIntfAddrV6("fc00::1");
+const uint8_t kIntfMaskV6 = 64;
+
+struct PrefixMix {
+  uint8_t mask;
+  uint32_t weight;
+};
+
+// Roughly the shape of the public IPv4 table: over half of it is /24s
+const PrefixMix kV4Mix[] = {
+  {16, 2}, {17, 1}, {18, 2}, {19, 4}, {20, 5}, {21, 5}, {22, 10}, {23, 9},
+  {24, 58}, {32, 4},
+};
+// /48s dominate the public IPv6 table, plus a /64 per connected subnet
+const PrefixMix kV6Mix[] = {
+  {29, 2}, {32, 10}, {36, 3}, {40, 4}, {44, 6}, {48, 50}, {56, 5}, {64, 20},
+};
+
+struct Prefix {
+  Prefix(IPAddress network, uint8_t mask)
+    : network(std::move(network)),
+      mask(mask) {}
+
+  IPAddress network;
+  uint8_t mask;
+};
+
+/*
+ * The generated prefixes for one table size, IPv4 ones first.
+ */
+struct Prefixes {
+  size_t size() const {
+    return v4.size() + v6.size();
+  }
+
+  vector<Prefix> v4;
+  vector<Prefix> v6;
+};
+
+/*
+ * Route tables with one set of generated prefixes, for one ECMP width.
+ */
+struct Tables {
+  size_t size{0};
+  size_t width{0};
+  // Just the interface routes
+  shared_ptr<SwitchState> empty;
+  // All of the prefixes
+  shared_ptr<SwitchState> full;
+  // full, with state_bench_churn_percent of the routes deleted, and as many
+  // more moved to other nexthops
+  shared_ptr<SwitchState> churned;
+  vector<shared_ptr<const RouteNextHopGroup>> groupsV4;
+  vector<shared_ptr<const RouteNextHopGroup>> groupsV6;
+  // The routes of full as NodeMaps, only built by the benchmarks using them
+  shared_ptr<RouteTableRibNodeMap<IPAddressV4>> nodeMapV4;
+  shared_ptr<RouteTableRibNodeMap<IPAddressV6>> nodeMapV6;
+};
+
+vector<size_t> sizes;
+vector<size_t> widths;
+std::map<size_t, Prefixes> prefixCache;
+std::unique_ptr<Tables> currentTables;
+// folly keeps the benchmark names by pointer
+std::deque<string> benchmarkNames;
+
+vector<size_t> parseList(const string& flag, const char* name) {
+  vector<StringPiece> parts;
+  folly::split(',', flag, parts, true);
+  vector<size_t> values;
+  for (auto part : parts) {
+    values.push_back(folly::to<size_t>(part));
+  }
+  CHECK(!values.empty()) << "--" << name << " must not be empty";
+  return values;
+}
+
+template <size_t N>
+uint8_t pickMask(const PrefixMix (&mix)[N], std::mt19937_64& rng) {
+  uint32_t total = 0;
+  for (const auto& entry : mix) {
+    total += entry.weight;
+  }
+  auto pick = std::uniform_int_distribution<uint32_t>(0, total - 1)(rng);
+  for (const auto& entry : mix) {
+    if (pick < entry.weight) {
+      return entry.mask;
+    }
+    pick -= entry.weight;
+  }
+  return mix[N - 1].mask;
+}
+
+Prefixes generatePrefixes(size_t count) {
+  std::mt19937_64 rng(FLAGS_state_bench_seed);
+  Prefixes prefixes;
+  auto numV6 = count * FLAGS_state_bench_v6_percent / 100;
+  auto numV4 = count - numV6;
+
+  // Unicast space, 11.0.0.0 - 223.255.255.255
+  std::uniform_int_distribution<uint32_t> v4Dist(0x0b000000, 0xdfffffff);
+  std::unordered_set<uint64_t> seenV4;
+  prefixes.v4.reserve(numV4);
+  while (prefixes.v4.size() < numV4) {
+    auto mask = pickMask(kV4Mix, rng);
+    uint32_t addr = v4Dist(rng) & ~(0xffffffffULL >> mask);
+    if (!seenV4.insert((uint64_t(addr) << 8) | mask).second) {
+      continue;
+    }
+    prefixes.v4.emplace_back(IPAddress(IPAddressV4::fromLongHBO(addr)), mask);
+  }
+
+  // Global unicast space, 2000::/3.  None of the masks are longer than 64
+  // bits, so only the upper half of the address is random.
+  std::uniform_int_distribution<uint64_t> v6Dist(
+      0x2000000000000000ULL, 0x3fffffffffffffffULL);
+  std::set<std::pair<uint64_t, uint8_t>> seenV6;
+  prefixes.v6.reserve(numV6);
+  while (prefixes.v6.size() < numV6) {
+    auto mask = pickMask(kV6Mix, rng);
+    uint64_t upper = v6Dist(rng);
+    if (mask < 64) {
+      upper &= ~(~0ULL >> mask);
+    }
+    if (!seenV6.emplace(upper, mask).second) {
+      continue;
+    }
+    uint8_t bytes[16] = {};
+    for (int i = 0; i < 8; ++i) {
+      bytes[i] = upper >> (56 - 8 * i);
+    }
+    prefixes.v6.emplace_back(
+        IPAddress(IPAddressV6::fromBinary(folly::ByteRange(bytes, 16))), mask);
+  }
+  return prefixes;
+}
+
+const Prefixes& getPrefixes(size_t size) {
+  auto it = prefixCache.find(size);
+  if (it == prefixCache.end()) {
+    it = prefixCache.emplace(size, generatePrefixes(size)).first;
+  }
+  return it->second;
+}
+
+/*
+ * Nexthop n of group g is the (g * 256 + n + 2)'th address of the interface
+ * subnet.
+ */
+IPAddress makeNexthop(bool v6, size_t group, size_t n) {
+  auto offset = (group << 8) + n + 2;
+  if (!v6) {
+    return IPAddress(IPAddressV4::fromLongHBO(
+          kIntfAddrV4.asV4().toLongHBO() - 1 + offset));
+  }
+  auto bytes = kIntfAddrV6.asV6().toByteArray();
+  bytes[14] = offset >> 8;
+  bytes[15] = offset & 0xff;
+  return IPAddress(IPAddressV6(bytes));
+}
+
+vector<shared_ptr<const RouteNextHopGroup>> makeGroups(bool v6, size_t width) {
+  CHECK_LE(width, 254) << "nexthop groups are 256 addresses apart";
+  vector<shared_ptr<const RouteNextHopGroup>> groups;
+  for (int group = 0; group < FLAGS_state_bench_ecmp_groups; ++group) {
+    RouteNextHops nexthops;
+    for (size_t n = 0; n < width; ++n) {
+      nexthops.emplace(makeNexthop(v6, group, n));
+    }
+    groups.push_back(RouteNextHopGroup::get(std::move(nexthops)));
+  }
+  return groups;
+}
+
+void addRoutes(RouteUpdater* updater, const Tables& tables,
+               const Prefixes& prefixes) {
+  for (size_t n = 0; n < prefixes.v4.size(); ++n) {
+    const auto& prefix = prefixes.v4[n];
+    updater->addRoute(kRid, prefix.network, prefix.mask,
+        tables.groupsV4[n % tables.groupsV4.size()]);
+  }
+  for (size_t n = 0; n < prefixes.v6.size(); ++n) {
+    const auto& prefix = prefixes.v6[n];
+    updater->addRoute(kRid, prefix.network, prefix.mask,
+        tables.groupsV6[n % tables.groupsV6.size()]);
+  }
+}
+
+/*
+ * Every churnStep()'th prefix is deleted by the churn, and the one after it
+ * moves to another nexthop group.
+ */
+size_t churnStep() {
+  return std::max(1, 100 / std::max(1, FLAGS_state_bench_churn_percent));
+}
+
+template <typename Fn>
+void forEachChurned(const vector<Prefix>& prefixes, Fn fn) {
+  auto step = churnStep();
+  for (size_t n = 0; n < prefixes.size(); n += step) {
+    fn(n, prefixes[n], true);
+    if (n + 1 < prefixes.size()) {
+      fn(n + 1, prefixes[n + 1], false);
+    }
+  }
+}
+
+void churnRoutes(RouteUpdater* updater, const Tables& tables,
+                 const Prefixes& prefixes) {
+  auto churn = [&](const vector<shared_ptr<const RouteNextHopGroup>>& groups,
+                   size_t n, const Prefix& prefix, bool remove) {
+    if (remove) {
+      updater->delRoute(kRid, prefix.network, prefix.mask);
+    } else {
+      updater->addRoute(kRid, prefix.network, prefix.mask,
+                        groups[(n + 1) % groups.size()]);
+    }
+  };
+  forEachChurned(prefixes.v4, [&](size_t n, const Prefix& prefix, bool rm) {
+    churn(tables.groupsV4, n, prefix, rm);
+  });
+  forEachChurned(prefixes.v6, [&](size_t n, const Prefix& prefix, bool rm) {
+    churn(tables.groupsV6, n, prefix, rm);
+  });
+}
+
+shared_ptr<SwitchState> makeState(const shared_ptr<SwitchState>& base,
+                                  shared_ptr<RouteTableMap> routeTables) {
+  auto state = base->clone();
+  state->resetRouteTables(std::move(routeTables));
+  return state;
+}
+
+/*
+ * Return the tables for size and width, building them if needed.  Only one
+ * set is kept around at a time, since a million routes take a lot of memory.
+ * Must be called with the benchmark timer suspended.
+ */
+const Tables& getTables(size_t size, size_t width) {
+  if (currentTables &&
+      currentTables->size == size && currentTables->width == width) {
+    return *currentTables;
+  }
+  currentTables.reset();
+  const auto& prefixes = getPrefixes(size);
+  auto tables = folly::make_unique<Tables>();
+  tables->size = size;
+  tables->width = width;
+  tables->groupsV4 = makeGroups(false, width);
+  tables->groupsV6 = makeGroups(true, width);
+
+  auto state = make_shared<SwitchState>();
+  RouteUpdater intfUpdater(state->getRouteTables());
+  intfUpdater.addRoute(kRid, kIntf, kIntfAddrV4, kIntfMaskV4);
+  intfUpdater.addRoute(kRid, kIntf, kIntfAddrV6, kIntfMaskV6);
+  state->resetRouteTables(intfUpdater.updateDone());
+  state->publish();
+  tables->empty = state;
+
+  RouteUpdater fullUpdater(tables->empty->getRouteTables());
+  addRoutes(&fullUpdater, *tables, prefixes);
+  tables->full = makeState(tables->empty, fullUpdater.updateDone());
+  tables->full->publish();
+
+  RouteUpdater churnUpdater(tables->full->getRouteTables());
+  churnRoutes(&churnUpdater, *tables, prefixes);
+  tables->churned = makeState(tables->full, churnUpdater.updateDone());
+  tables->churned->publish();
+
+  currentTables = std::move(tables);
+  return *currentTables;
+}
+
+/*
+ * Build the NodeMaps of tables.full if they have not been built yet.
+ * Must be called with the benchmark timer suspended.
+ */
+void buildNodeMaps(Tables* tables) {
+  if (tables->nodeMapV4) {
+    return;
+  }
+  auto rt = tables->full->getRouteTables()->getRouteTableIf(kRid);
+  tables->nodeMapV4 = make_shared<RouteTableRibNodeMap<IPAddressV4>>();
+  tables->nodeMapV4->addRoutes(*rt->getRibV4());
+  tables->nodeMapV6 = make_shared<RouteTableRibNodeMap<IPAddressV6>>();
+  tables->nodeMapV6->addRoutes(*rt->getRibV6());
+}
+
+template <typename Fn>
+void addBenchmark(const string& name, size_t size, size_t width, Fn fn,
+                  bool showWidth = false) {
+  auto fullName = folly::to<string>(name, "/", size);
+  if (showWidth) {
+    folly::toAppend("/ecmp", width, &fullName);
+  }
+  benchmarkNames.push_back(std::move(fullName));
+  folly::addBenchmark(__FILE__, benchmarkNames.back().c_str(),
+      [=](unsigned iters) -> unsigned {
+        const Tables* tables = nullptr;
+        BENCHMARK_SUSPEND {
+          tables = &getTables(size, width);
+        }
+        for (unsigned n = 0; n < iters; ++n) {
+          fn(*tables);
+        }
+        return iters;
+      });
+}
+
+/*
+ * Count the changed routes, the way a HwSwitch walks them.
+ */
+size_t walkRouteTablesDelta(const StateDelta& delta) {
+  size_t changed = 0;
+  for (const auto& rtDelta : delta.getRouteTablesDelta()) {
+    for (const auto& routeDelta : rtDelta.getRoutesV4Delta()) {
+      changed += routeDelta.getNew() != nullptr;
+    }
+    for (const auto& routeDelta : rtDelta.getRoutesV6Delta()) {
+      changed += routeDelta.getNew() != nullptr;
+    }
+  }
+  return changed;
+}
+
+void radixInsert(RadixTree<IPAddressV4, int>* tree4,
+                 RadixTree<IPAddressV6, int>* tree6,
+                 const Prefixes& prefixes) {
+  for (size_t n = 0; n < prefixes.v4.size(); ++n) {
+    const auto& prefix = prefixes.v4[n];
+    tree4->insert(prefix.network.asV4(), prefix.mask, n);
+  }
+  for (size_t n = 0; n < prefixes.v6.size(); ++n) {
+    const auto& prefix = prefixes.v6[n];
+    tree6->insert(prefix.network.asV6(), prefix.mask, n);
+  }
+}
+
+void registerSizeBenchmarks(size_t size) {
+  auto width = widths.front();
+
+  addBenchmark("RouteTablesDeltaFull", size, width, [](const Tables& tables) {
+    // Everything is new, as when the agent programs the FIB after starting
+    StateDelta delta(tables.empty, tables.full);
+    auto changed = walkRouteTablesDelta(delta);
+    folly::doNotOptimizeAway(changed);
+  });
+
+  addBenchmark("StateDeltaChurn", size, width, [](const Tables& tables) {
+    StateDelta delta(tables.full, tables.churned);
+    size_t changed = walkRouteTablesDelta(delta);
+    for (const auto& portDelta : delta.getPortsDelta()) {
+      ++changed;
+    }
+    for (const auto& vlanDelta : delta.getVlansDelta()) {
+      for (const auto& arpDelta : vlanDelta.getArpDelta()) {
+        ++changed;
+      }
+      for (const auto& ndpDelta : vlanDelta.getNdpDelta()) {
+        ++changed;
+      }
+    }
+    for (const auto& intfDelta : delta.getIntfsDelta()) {
+      ++changed;
+    }
+    for (const auto& aclDelta : delta.getAclsDelta()) {
+      ++changed;
+    }
+    folly::doNotOptimizeAway(changed);
+  });
+
+  addBenchmark("SwitchStatePublish", size, width, [](const Tables& tables) {
+    shared_ptr<SwitchState> state;
+    BENCHMARK_SUSPEND {
+      RouteUpdater updater(tables.empty->getRouteTables());
+      addRoutes(&updater, tables, getPrefixes(tables.size));
+      state = makeState(tables.empty, updater.updateDone());
+    }
+    state->publish();
+    BENCHMARK_SUSPEND {
+      state.reset();
+    }
+  });
+
+  addBenchmark("RibClone", size, width, [](const Tables& tables) {
+    auto rt = tables.full->getRouteTables()->getRouteTableIf(kRid);
+    auto v4 = rt->getRibV4()->clone();
+    auto v6 = rt->getRibV6()->clone();
+    folly::doNotOptimizeAway(v4);
+    folly::doNotOptimizeAway(v6);
+    BENCHMARK_SUSPEND {
+      v4.reset();
+      v6.reset();
+    }
+  });
+
+  addBenchmark("NodeMapClone", size, width, [](const Tables& tables) {
+    BENCHMARK_SUSPEND {
+      buildNodeMaps(currentTables.get());
+    }
+    auto v4 = tables.nodeMapV4->clone();
+    auto v6 = tables.nodeMapV6->clone();
+    folly::doNotOptimizeAway(v4);
+    folly::doNotOptimizeAway(v6);
+    BENCHMARK_SUSPEND {
+      v4.reset();
+      v6.reset();
+    }
+  });
+
+  addBenchmark("ToFollyDynamic", size, width, [](const Tables& tables) {
+    auto json = tables.full->toFollyDynamic();
+    folly::doNotOptimizeAway(json);
+    BENCHMARK_SUSPEND {
+      json = nullptr;
+    }
+  });
+
+  addBenchmark("FromFollyDynamic", size, width, [](const Tables& tables) {
+    folly::dynamic json = nullptr;
+    BENCHMARK_SUSPEND {
+      json = tables.full->toFollyDynamic();
+    }
+    auto state = SwitchState::fromFollyDynamic(json);
+    folly::doNotOptimizeAway(state);
+    BENCHMARK_SUSPEND {
+      state.reset();
+      json = nullptr;
+    }
+  });
+
+  addBenchmark("RadixTreeInsert", size, width, [](const Tables& tables) {
+    const auto& prefixes = getPrefixes(tables.size);
+    RadixTree<IPAddressV4, int> tree4;
+    RadixTree<IPAddressV6, int> tree6;
+    radixInsert(&tree4, &tree6, prefixes);
+    BENCHMARK_SUSPEND {
+      tree4.clear();
+      tree6.clear();
+    }
+  });
+
+  addBenchmark("RadixTreeLookup", size, width, [](const Tables& tables) {
+    const auto& prefixes = getPrefixes(tables.size);
+    RadixTree<IPAddressV4, int> tree4;
+    RadixTree<IPAddressV6, int> tree6;
+    vector<IPAddressV4> hosts4;
+    vector<IPAddressV6> hosts6;
+    BENCHMARK_SUSPEND {
+      radixInsert(&tree4, &tree6, prefixes);
+      // Hosts inside the prefixes, in the same proportion as the prefixes
+      std::mt19937_64 rng(FLAGS_state_bench_seed);
+      std::uniform_int_distribution<size_t> pick(0, prefixes.size() - 1);
+      for (int n = 0; n < FLAGS_state_bench_lookups; ++n) {
+        auto idx = pick(rng);
+        if (idx < prefixes.v4.size()) {
+          auto addr = prefixes.v4[idx].network.asV4().toLongHBO();
+          hosts4.push_back(IPAddressV4::fromLongHBO(addr | (rng() & 0xff)));
+        } else {
+          hosts6.push_back(prefixes.v6[idx - prefixes.v4.size()]
+                           .network.asV6());
+        }
+      }
+    }
+    size_t found = 0;
+    for (const auto& host : hosts4) {
+      found += tree4.longestMatch(host, 32) != tree4.end();
+    }
+    for (const auto& host : hosts6) {
+      found += tree6.longestMatch(host, 128) != tree6.end();
+    }
+    folly::doNotOptimizeAway(found);
+    BENCHMARK_SUSPEND {
+      tree4.clear();
+      tree6.clear();
+    }
+  });
+
+  addBenchmark("RadixTreeErase", size, width, [](const Tables& tables) {
+    const auto& prefixes = getPrefixes(tables.size);
+    RadixTree<IPAddressV4, int> tree4;
+    RadixTree<IPAddressV6, int> tree6;
+    BENCHMARK_SUSPEND {
+      radixInsert(&tree4, &tree6, prefixes);
+    }
+    for (const auto& prefix : prefixes.v4) {
+      tree4.erase(prefix.network.asV4(), prefix.mask);
+    }
+    for (const auto& prefix : prefixes.v6) {
+      tree6.erase(prefix.network.asV6(), prefix.mask);
+    }
+    CHECK_EQ(0, tree4.size() + tree6.size());
+  });
+}
+
+void registerRouteUpdaterBenchmarks(size_t size, size_t width) {
+  addBenchmark("RouteUpdaterAdd", size, width, [](const Tables& tables) {
+    RouteUpdater updater(tables.empty->getRouteTables());
+    addRoutes(&updater, tables, getPrefixes(tables.size));
+    auto newTables = updater.updateDone();
+    BENCHMARK_SUSPEND {
+      newTables.reset();
+    }
+  }, true);
+
+  addBenchmark("RouteUpdaterChurn", size, width, [](const Tables& tables) {
+    // Delete some routes and move some others to other nexthops
+    RouteUpdater updater(tables.full->getRouteTables());
+    churnRoutes(&updater, tables, getPrefixes(tables.size));
+    auto newTables = updater.updateDone();
+    BENCHMARK_SUSPEND {
+      newTables.reset();
+    }
+  }, true);
+
+  addBenchmark("RouteUpdaterDelete", size, width, [](const Tables& tables) {
+    const auto& prefixes = getPrefixes(tables.size);
+    RouteUpdater updater(tables.full->getRouteTables());
+    for (const auto& prefix : prefixes.v4) {
+      updater.delRoute(kRid, prefix.network, prefix.mask);
+    }
+    for (const auto& prefix : prefixes.v6) {
+      updater.delRoute(kRid, prefix.network, prefix.mask);
+    }
+    auto newTables = updater.updateDone();
+    BENCHMARK_SUSPEND {
+      newTables.reset();
+    }
+  }, true);
+
+  addBenchmark("RouteUpdaterResolve", size, width, [](const Tables& tables) {
+    // Changing a single route clones the RIBs and re-resolves every route
+    // in them
+    RouteUpdater updater(tables.full->getRouteTables());
+    updater.addRoute(kRid, IPAddress("10.1.0.0"), 24, tables.groupsV4[0]);
+    auto newTables = updater.updateDone();
+    BENCHMARK_SUSPEND {
+      newTables.reset();
+    }
+  }, true);
+
+  addBenchmark("RouteUpdaterSync", size, width, [](const Tables& tables) {
+    // A full FIB sync with nothing changed
+    RouteUpdater updater(tables.full->getRouteTables(), true);
+    updater.addRoute(kRid, kIntf, kIntfAddrV4, kIntfMaskV4);
+    updater.addRoute(kRid, kIntf, kIntfAddrV6, kIntfMaskV6);
+    addRoutes(&updater, tables, getPrefixes(tables.size));
+    auto newTables = updater.updateDone();
+    CHECK(!newTables);
+  }, true);
+}
+
+void init() {
+  sizes = parseList(FLAGS_state_bench_sizes, "state_bench_sizes");
+  widths = parseList(FLAGS_state_bench_ecmp_widths, "state_bench_ecmp_widths");
+  // Register the benchmarks that share a set of tables next to each other,
+  // since folly runs them in order and only one set is kept at a time
+  for (auto size : sizes) {
+    registerSizeBenchmarks(size);
+    for (auto width : widths) {
+      registerRouteUpdaterBenchmarks(size, width);
+    }
+  }
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  init();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/state/NodeAllocator.h"
+#include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/SwitchState.h"
+
+/*
+ * Clone heavy SwitchState workloads.  Run this once as is and once with
+ * --state_node_pool to compare the system allocator against NodePool.
+ */
+
+DEFINE_int32(node_pool_routes, 100000,
+             "Number of routes added by each benchmark iteration");
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using std::make_shared;
+using std::shared_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+shared_ptr<SwitchState> baseState;
+shared_ptr<SwitchState> fullState;
+folly::dynamic fullStateJson;
+
+shared_ptr<SwitchState> addRoutes(const shared_ptr<SwitchState>& state) {
+  RouteUpdater updater(state->getRouteTables());
+  RouteNextHops nhops;
+  nhops.emplace(IPAddress("10.0.0.2"));
+  nhops.emplace(IPAddress("10.0.0.3"));
+  for (int i = 0; i < FLAGS_node_pool_routes; ++i) {
+    updater.addRoute(RouterID(0),
+                     IPAddress(IPAddressV4::fromLongHBO(0x0b000000 + (i << 8))),
+                     24, nhops);
+  }
+  auto newState = state->clone();
+  newState->resetRouteTables(updater.updateDone());
+  newState->publish();
+  return newState;
+}
+
+void init() {
+  baseState = make_shared<SwitchState>();
+  RouteUpdater updater(baseState->getRouteTables());
+  updater.addRoute(RouterID(0), InterfaceID(1), IPAddress("10.0.0.1"), 24);
+  baseState->resetRouteTables(updater.updateDone());
+  baseState->publish();
+
+  fullState = addRoutes(baseState);
+  fullStateJson = fullState->toFollyDynamic();
+}
+
+void printPoolStats() {
+  auto stats = NodePool::getStats();
+  LOG(INFO) << "NodePool: allocations=" << stats.allocations
+            << " deallocations=" << stats.deallocations
+            << " unpooled=" << stats.unpooledAllocations
+            << " slabs=" << stats.slabs
+            << " bytesInUse=" << stats.bytesInUse
+            << " bytesReserved=" << stats.bytesReserved;
+}
+
+} // unnamed namespace
+
+BENCHMARK(AddRoutes, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    auto state = addRoutes(baseState);
+    folly::doNotOptimizeAway(state);
+  }
+}
+
+BENCHMARK(CloneAllRoutes, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    // Re-adding every published route clones each of them
+    auto state = addRoutes(fullState);
+    folly::doNotOptimizeAway(state);
+  }
+}
+
+BENCHMARK(WarmBootReload, numIters) {
+  for (size_t n = 0; n < numIters; ++n) {
+    auto state = SwitchState::fromFollyDynamic(fullStateJson);
+    folly::doNotOptimizeAway(state);
+  }
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  NodePool::init();
+  init();
+  folly::runBenchmarks();
+  printPoolStats();
+  return 0;
+}
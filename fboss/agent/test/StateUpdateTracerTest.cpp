@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Memory.h>
+#include "fboss/agent/StateUpdateTracer.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <set>
+#include <gflags/gflags.h>
+#include "gtest/gtest.h"
+
+using namespace facebook::fboss;
+using folly::MacAddress;
+using folly::make_unique;
+using std::shared_ptr;
+
+namespace {
+
+StateUpdateTracer::Trace makeTrace(const std::string& name) {
+  StateUpdateTracer::Trace trace;
+  trace.updates.push_back(name);
+  auto now = StateUpdateTracer::Clock::now();
+  trace.spans.emplace_back(StateUpdatePhase::UPDATE_FN, name, 0, now, now);
+  trace.spans.emplace_back(StateUpdatePhase::HW_UPDATE, "", 0, now, now);
+  return trace;
+}
+
+} // unnamed namespace
+
+TEST(StateUpdateTracer, RingBuffer) {
+  StateUpdateTracer tracer(2);
+  tracer.record(makeTrace("first"));
+  tracer.record(makeTrace("second"));
+  tracer.record(makeTrace("third"));
+  EXPECT_EQ(2, tracer.size());
+
+  // The oldest trace was dropped, and the rest come out oldest first
+  auto events = tracer.toChromeTrace()["traceEvents"];
+  ASSERT_EQ(4, events.size());
+  EXPECT_EQ("second", events[0]["name"].asString());
+  EXPECT_EQ("update_fn", events[0]["cat"].asString());
+  // Spans without a name of their own are named after the updates
+  EXPECT_EQ("second", events[1]["name"].asString());
+  EXPECT_EQ("hw_update", events[1]["cat"].asString());
+  EXPECT_EQ("third", events[2]["name"].asString());
+  EXPECT_EQ("X", events[2]["ph"].asString());
+}
+
+TEST(StateUpdateTracer, SwSwitch) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_state_update_trace_size = 8;
+
+  auto sw = make_unique<SwSwitch>(
+      make_unique<SimPlatform>(MacAddress("02:00:01:00:00:01"), 4));
+  sw->init();
+  auto tracer = sw->getStateUpdateTracer();
+  ASSERT_NE(nullptr, tracer);
+  EXPECT_EQ(0, tracer->size());
+
+  sw->updateStateBlocking("trace me",
+      [](const shared_ptr<SwitchState>& state) {
+        return state->clone();
+      });
+  ASSERT_EQ(1, tracer->size());
+
+  std::set<std::string> phases;
+  for (const auto& event : tracer->toChromeTrace()["traceEvents"]) {
+    phases.insert(event["cat"].asString());
+    EXPECT_EQ("trace me", event["args"]["updates"][0].asString());
+    EXPECT_GE(event["dur"].asInt(), 0);
+  }
+  for (auto phase : {StateUpdatePhase::QUEUED, StateUpdatePhase::UPDATE_FN,
+                     StateUpdatePhase::PUBLISH, StateUpdatePhase::DELTA,
+                     StateUpdatePhase::HW_UPDATE,
+                     StateUpdatePhase::OBSERVERS}) {
+    EXPECT_EQ(1, phases.count(StateUpdateTracer::phaseName(phase)));
+  }
+}
@@ -0,0 +1,87 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ThreadMonitor.h"
+
+#include <folly/io/async/EventBase.h>
+
+#include <chrono>
+#include <thread>
+#include "gtest/gtest.h"
+
+using namespace facebook::fboss;
+using folly::EventBase;
+using std::chrono::milliseconds;
+
+namespace {
+
+ThreadStatsThrift findThread(const ThreadMonitor& monitor,
+                             const std::string& name) {
+  for (const auto& stats : monitor.getThreadStats()) {
+    if (stats.name == name) {
+      return stats;
+    }
+  }
+  ADD_FAILURE() << "no thread named " << name;
+  return ThreadStatsThrift();
+}
+
+} // unnamed namespace
+
+TEST(ThreadMonitor, EventBaseLag) {
+  ThreadMonitor monitor;
+  EventBase evb;
+  std::thread thread([&] {
+    monitor.registerThread("testLoop", &evb);
+    evb.loopForever();
+  });
+  evb.waitUntilRunning();
+  // Make sure the thread has registered itself
+  evb.runInEventBaseThreadAndWait([] {});
+
+  // Keep the loop busy, so that the probe has to wait for it
+  evb.runInEventBaseThread([] {
+    std::this_thread::sleep_for(milliseconds(50));
+  });
+  monitor.sample();
+  evb.runInEventBaseThreadAndWait([] {});
+
+  auto stats = findThread(monitor, "testLoop");
+  EXPECT_TRUE(stats.hasLag);
+  EXPECT_GE(stats.lagUs, 25000);
+  EXPECT_EQ(stats.lagUs, stats.maxLagUs);
+  EXPECT_FALSE(stats.exited);
+
+  evb.runInEventBaseThreadAndWait([&] { evb.terminateLoopSoon(); });
+  thread.join();
+  monitor.sample();
+  EXPECT_TRUE(findThread(monitor, "testLoop").exited);
+}
+
+TEST(ThreadMonitor, RegisterAndRecordLag) {
+  ThreadMonitor monitor;
+  monitor.registerThread("worker");
+  // Registering the same thread again does nothing
+  monitor.registerThreadOnce("worker");
+  monitor.registerThread("worker");
+  std::thread thread([&] { monitor.registerThreadOnce("worker"); });
+  thread.join();
+  EXPECT_EQ(2, monitor.getThreadStats().size());
+  EXPECT_FALSE(findThread(monitor, "worker.1").hasLag);
+
+  monitor.recordLag(std::chrono::microseconds(300));
+  monitor.recordLag(std::chrono::microseconds(100));
+  monitor.sample();
+  auto stats = findThread(monitor, "worker");
+  EXPECT_TRUE(stats.hasLag);
+  EXPECT_EQ(100, stats.lagUs);
+  EXPECT_EQ(300, stats.maxLagUs);
+  EXPECT_FALSE(stats.exited);
+  EXPECT_GE(stats.userTimeUs + stats.systemTimeUs, 0);
+}
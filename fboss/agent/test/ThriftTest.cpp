@@ -28,6 +28,8 @@ using std::unique_ptr;
 using std::shared_ptr;
 using testing::UnorderedElementsAreArray;
 using facebook::network::toBinaryAddress;
+using facebook::network::toIPAddress;
+using facebook::network::thrift::cpp2::BinaryAddress;
 using cfg::PortSpeed;
 
 namespace {
@@ -136,3 +138,118 @@ TEST(ThriftTest, LinkLocalRoutes) {
   // Verify that the route is to link local addr.
   ASSERT_EQ(longestMatchRoute->prefix().network, ip);
 }
+
+TEST(ThriftTest, getRouteTablePage) {
+  auto sw = setupSwitch();
+  ThriftHandler handler(sw.get());
+
+  auto nhopA = toBinaryAddress(IPAddress("10.0.0.22"));
+  auto nhopB = toBinaryAddress(IPAddress("10.0.0.33"));
+  auto nhopV6 = toBinaryAddress(IPAddress("2401:db00:2110:3001::22"));
+  auto routes = folly::make_unique<std::vector<UnicastRoute>>();
+  auto addRoute = [&](StringPiece ip, int len,
+                      std::vector<BinaryAddress> nhops) {
+    UnicastRoute route;
+    route.dest = ipPrefix(ip, len);
+    route.nextHopAddrs = std::move(nhops);
+    routes->push_back(std::move(route));
+  };
+  addRoute("1.1.0.0", 16, {nhopA});
+  addRoute("1.1.1.0", 24, {nhopA, nhopB});
+  addRoute("1.1.2.0", 24, {nhopB});
+  addRoute("1.2.0.0", 16, {nhopA, nhopB});
+  addRoute("2.0.0.0", 8, {nhopA});
+  addRoute("1000::", 64, {nhopV6});
+  addRoute("1000:1::", 64, {nhopV6});
+  handler.syncFib(0, std::move(routes));
+
+  std::vector<UnicastRoute> fullTable;
+  handler.getRouteTable(fullTable);
+
+  auto toStr = [](const IpPrefix& prefix) {
+    return folly::to<std::string>(toIPAddress(prefix.ip).str(), "/",
+                                  prefix.prefixLength);
+  };
+  auto dump = [&](RouteTablePageRequest req) {
+    std::vector<UnicastRoute> result;
+    while (true) {
+      RouteTablePage page;
+      handler.getRouteTablePage(
+          page, folly::make_unique<RouteTablePageRequest>(req));
+      EXPECT_LE(page.routes.size(), req.maxRoutes);
+      for (const auto& route : page.compactRoutes) {
+        UnicastRoute expanded;
+        expanded.dest = route.dest;
+        expanded.nextHopAddrs = page.nextHopSets.at(route.nextHopSetIdx);
+        page.routes.push_back(std::move(expanded));
+      }
+      result.insert(result.end(), page.routes.begin(), page.routes.end());
+      if (!page.__isset.nextCursor) {
+        break;
+      }
+      req.cursor = page.nextCursor;
+      req.__isset.cursor = true;
+    }
+    return result;
+  };
+
+  // Paging through in any page size returns the same routes, in the same
+  // order, as getRouteTable()
+  for (int pageSize = 1; pageSize <= fullTable.size() + 1; ++pageSize) {
+    RouteTablePageRequest req;
+    req.maxRoutes = pageSize;
+    EXPECT_EQ(fullTable, dump(req));
+    req.compact = true;
+    EXPECT_EQ(fullTable, dump(req));
+  }
+
+  // Compact pages send each distinct nexthop list once
+  RouteTablePageRequest compactReq;
+  compactReq.compact = true;
+  RouteTablePage compactPage;
+  handler.getRouteTablePage(
+      compactPage, folly::make_unique<RouteTablePageRequest>(compactReq));
+  EXPECT_TRUE(compactPage.routes.empty());
+  EXPECT_EQ(fullTable.size(), compactPage.compactRoutes.size());
+  EXPECT_GT(compactPage.compactRoutes.size(), compactPage.nextHopSets.size());
+
+  // Prefix filter
+  RouteTablePageRequest filterReq;
+  filterReq.maxRoutes = 1;
+  filterReq.prefixFilter = ipPrefix("1.1.0.0", 16);
+  filterReq.__isset.prefixFilter = true;
+  std::vector<std::string> prefixes;
+  for (const auto& route : dump(filterReq)) {
+    prefixes.push_back(toStr(route.dest));
+  }
+  EXPECT_EQ(
+      std::vector<std::string>({"1.1.0.0/16", "1.1.1.0/24", "1.1.2.0/24"}),
+      prefixes);
+
+  filterReq.prefixFilter = ipPrefix("1000::", 16);
+  prefixes.clear();
+  for (const auto& route : dump(filterReq)) {
+    prefixes.push_back(toStr(route.dest));
+  }
+  EXPECT_EQ(std::vector<std::string>({"1000::/64", "1000:1::/64"}), prefixes);
+
+  // Nexthop filter
+  RouteTablePageRequest nhopReq;
+  nhopReq.maxRoutes = 2;
+  nhopReq.nexthopFilter = nhopB;
+  nhopReq.__isset.nexthopFilter = true;
+  prefixes.clear();
+  for (const auto& route : dump(nhopReq)) {
+    prefixes.push_back(toStr(route.dest));
+  }
+  EXPECT_EQ(
+      std::vector<std::string>({"1.1.1.0/24", "1.1.2.0/24", "1.2.0.0/16"}),
+      prefixes);
+
+  // Unknown VRF
+  RouteTablePageRequest vrfReq;
+  vrfReq.vrfId = 5;
+  RouteTablePage vrfPage;
+  EXPECT_THROW(handler.getRouteTablePage(
+      vrfPage, folly::make_unique<RouteTablePageRequest>(vrfReq)), FbossError);
+}
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/HwSwitch.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/agent/hw/mock/MockHwSwitch.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::to;
+using std::unique_ptr;
+
+using ::testing::_;
+using ::testing::InSequence;
+
+namespace {
+
+constexpr int kBatchSize = 5;
+constexpr uint32_t kPktLen = 68;
+
+unique_ptr<SwSwitch> setupSwitch() {
+  auto sw = createMockSw(testStateA());
+  sw->initialConfigApplied();
+  waitForStateUpdates(sw.get());
+  return sw;
+}
+
+// Packets are tagged with their position in the batch in the first byte,
+// so the matchers below can check the order they reach the HwSwitch in.
+unique_ptr<TxPacket> makePacket(SwSwitch* sw, uint8_t tag) {
+  auto pkt = sw->allocatePacket(kPktLen);
+  memset(pkt->buf()->writableData(), 0, kPktLen);
+  pkt->buf()->writableData()[0] = tag;
+  return pkt;
+}
+
+TxMatchFn checkTag(uint8_t tag) {
+  return [=](const TxPacket* pkt) {
+    auto actual = pkt->buf()->data()[0];
+    if (actual != tag) {
+      throw FbossError("expected packet ", int(tag), " but got ", int(actual));
+    }
+  };
+}
+
+} // unnamed namespace
+
+TEST(TxBatch, SendPacketsSwitched) {
+  auto sw = setupSwitch();
+
+  HwSwitch::TxPackets pkts;
+  for (int i = 0; i < kBatchSize; ++i) {
+    pkts.push_back(makePacket(sw.get(), i));
+  }
+
+  // The whole batch is handed to the HwSwitch in one call, and every packet
+  // goes out in the order it was queued in
+  EXPECT_HW_CALL(sw, sendPacketsSwitched_(kBatchSize)).Times(1);
+  {
+    InSequence seq;
+    for (int i = 0; i < kBatchSize; ++i) {
+      EXPECT_PKT(sw, to<std::string>("packet ", i), checkTag(i)).Times(1);
+    }
+  }
+  EXPECT_HW_CALL(sw, sendPacketOutOfPort_(_)).Times(0);
+  sw->sendPacketsSwitched(std::move(pkts));
+}
+
+TEST(TxBatch, SendPacketsOutOfPorts) {
+  auto sw = setupSwitch();
+
+  HwSwitch::PortTxPackets pkts;
+  for (int i = 0; i < kBatchSize; ++i) {
+    pkts.emplace_back(makePacket(sw.get(), i), PortID(i + 1));
+  }
+
+  EXPECT_HW_CALL(sw, sendPacketsOutOfPorts_(kBatchSize)).Times(1);
+  {
+    InSequence seq;
+    for (int i = 0; i < kBatchSize; ++i) {
+      EXPECT_HW_CALL(sw, sendPacketOutOfPort_(TxPacketMatcher::createMatcher(
+          to<std::string>("packet ", i), checkTag(i)))).Times(1);
+    }
+  }
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  sw->sendPacketsOutOfPorts(std::move(pkts));
+}
+
+TEST(TxBatch, EmptyBatch) {
+  auto sw = setupSwitch();
+
+  // An empty batch is passed through as is, and sends nothing
+  EXPECT_HW_CALL(sw, sendPacketsSwitched_(0)).Times(1);
+  EXPECT_HW_CALL(sw, sendPacketSwitched_(_)).Times(0);
+  sw->sendPacketsSwitched(HwSwitch::TxPackets());
+}
@@ -0,0 +1,155 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#ifndef MULTIBIT_LPM_H
+#define MULTIBIT_LPM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include <glog/logging.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+namespace facebook { namespace network {
+
+/*
+ * Immutable multibit trie for longest prefix match lookups of host
+ * addresses.
+ *
+ * RadixTree::longestMatch() walks a binary tree, so a lookup chases one
+ * pointer and takes one unpredictable branch per differing bit.
+ * MultibitLpm instead resolves the first 16 bits of the address with a
+ * single array access, and each following byte with one more (a DIR-16-8-8
+ * layout for IPv4, and the same with up to 14 more 8 bit levels for IPv6).
+ * Prefixes are expanded into every slot they cover and pushed down into the
+ * child tables below them, so a lookup never has to backtrack: it stops at
+ * the first slot that is not a child table.
+ *
+ * All levels live in one flat array.  Each slot is 32 bits:
+ *  - 0 means no match,
+ *  - kChild | offset points to the 256 slot table starting at offset,
+ *  - anything else is 1 + the index of the value in values_.
+ *
+ * The index is built once from the contents of a RadixTree and cannot be
+ * modified; rebuild it when the tree changes.  Memory use is 256KB for the
+ * first level plus 1KB for every distinct (prefix / 8 bit boundary) that a
+ * prefix longer than 16 bits runs through.
+ */
+template <typename IPADDRTYPE, typename T>
+class MultibitLpm {
+ public:
+  /*
+   * Build the index from a RadixTree<IPADDRTYPE, ...>, using
+   * getValue(node.value()) as the value for each prefix in the tree.
+   */
+  template <typename TreeT, typename GetValueFn>
+  MultibitLpm(const TreeT& tree, GetValueFn getValue) {
+    std::vector<std::tuple<IPADDRTYPE, uint8_t, size_t>> prefixes;
+    prefixes.reserve(tree.size());
+    values_.reserve(tree.size());
+    for (const auto& node : tree) {
+      prefixes.emplace_back(node.ipAddress(), node.masklen(), values_.size());
+      values_.push_back(getValue(node.value()));
+    }
+    // Insert shorter prefixes first, so that longer ones overwrite them.
+    std::stable_sort(prefixes.begin(), prefixes.end(),
+        [](const std::tuple<IPADDRTYPE, uint8_t, size_t>& a,
+           const std::tuple<IPADDRTYPE, uint8_t, size_t>& b) {
+          return std::get<1>(a) < std::get<1>(b);
+        });
+    table_.assign(kRootSize, kNoMatch);
+    for (const auto& prefix : prefixes) {
+      insert(std::get<0>(prefix), std::get<1>(prefix),
+             std::get<2>(prefix) + 1);
+    }
+  }
+
+  template <typename TreeT>
+  explicit MultibitLpm(const TreeT& tree)
+    : MultibitLpm(tree, [](const T& value) { return value; }) {}
+
+  /*
+   * Return a pointer to the value of the longest prefix containing addr,
+   * or nullptr if there is none.
+   */
+  const T* longestMatch(const IPADDRTYPE& addr) const {
+    const uint8_t* bytes = addr.bytes();
+    uint32_t slot = table_[(uint32_t(bytes[0]) << 8) | bytes[1]];
+    size_t byteIdx = 2;
+    while (slot & kChild) {
+      DCHECK_LT(byteIdx, IPADDRTYPE::byteCount());
+      slot = table_[(slot & ~kChild) + bytes[byteIdx++]];
+    }
+    return slot == kNoMatch ? nullptr : &values_[slot - 1];
+  }
+
+  size_t size() const {
+    return values_.size();
+  }
+
+  size_t memoryUsage() const {
+    return table_.capacity() * sizeof(uint32_t) + values_.capacity() * sizeof(T);
+  }
+
+ private:
+  enum : uint32_t {
+    kNoMatch = 0,
+    kChild = 0x80000000,
+  };
+  enum : size_t {
+    kRootBits = 16,
+    kRootSize = 1 << kRootBits,
+    kStrideBits = 8,
+    kStrideSize = 1 << kStrideBits,
+  };
+
+  // Fill slots [base + first, base + first + count) with slot
+  void fill(size_t base, uint32_t first, uint32_t count, uint32_t slot) {
+    std::fill(table_.begin() + base + first,
+              table_.begin() + base + first + count, slot);
+  }
+
+  void insert(const IPADDRTYPE& addr, uint8_t masklen, uint32_t slot) {
+    const uint8_t* bytes = addr.bytes();
+    uint32_t root = (uint32_t(bytes[0]) << 8) | bytes[1];
+    if (masklen <= kRootBits) {
+      uint32_t span = 1 << (kRootBits - masklen);
+      fill(0, root & ~(span - 1), span, slot);
+      return;
+    }
+
+    // Prefixes are inserted in increasing length, so any slot we walk
+    // through is either a shorter prefix (which we push down into the new
+    // child table) or already a child table.
+    size_t parent = root;
+    size_t byteIdx = 2;
+    uint32_t levelEnd = kRootBits + kStrideBits;
+    while (true) {
+      if (!(table_[parent] & kChild)) {
+        auto pushed = table_[parent];
+        auto child = table_.size();
+        CHECK_LT(child, kChild) << "LPM index too large";
+        table_.resize(child + kStrideSize, pushed);
+        table_[parent] = kChild | child;
+      }
+      size_t base = table_[parent] & ~kChild;
+      uint32_t idx = bytes[byteIdx];
+      if (masklen <= levelEnd) {
+        uint32_t span = 1 << (levelEnd - masklen);
+        fill(base, idx & ~(span - 1), span, slot);
+        return;
+      }
+      parent = base + idx;
+      ++byteIdx;
+      levelEnd += kStrideBits;
+    }
+  }
+
+  std::vector<uint32_t> table_;
+  std::vector<T> values_;
+};
+
+}} // facebook::network
+
+#endif
@@ -44,7 +44,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::longestMatchImpl(const IPADDRTYPE& ipaddr,
   // have a parent pointer
   TreeNode* parent = nullptr;
   TreeNode* lastValueNodeSeen = nullptr;
-  auto curNode = root_.get();
+  auto curNode = root_;
   auto done = false;
   while (curNode && !done) {
     auto searchDirection = curNode->searchDirection(ipaddr, masklen);
@@ -90,6 +90,60 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::longestMatchImpl(const IPADDRTYPE& ipaddr,
 }
 
 
+template<typename IPADDRTYPE, typename T, typename TreeTraits>
+const typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNode*
+RadixTree<IPADDRTYPE, T, TreeTraits>::upperBoundImpl(const IPADDRTYPE& ipaddr,
+    uint8_t masklen) const {
+  auto curNode = root_;
+  while (curNode) {
+    auto searchDirection = curNode->searchDirection(ipaddr, masklen);
+    switch (searchDirection) {
+      case TreeDirection::THIS_NODE:
+        // Everything in our subtree comes after us
+        if (curNode->left()) {
+          return curNode->left();
+        }
+        return curNode->right() ? curNode->right() : nextSubTree(curNode);
+      case TreeDirection::LEFT:
+        // curNode is a less specific prefix of ipaddr/masklen, so it
+        // comes before it, while the whole right subtree comes after.
+        if (curNode->left()) {
+          curNode = curNode->left();
+          break;
+        }
+        return curNode->right() ? curNode->right() : nextSubTree(curNode);
+      case TreeDirection::RIGHT:
+        // curNode and its left subtree both come before ipaddr/masklen
+        if (curNode->right()) {
+          curNode = curNode->right();
+          break;
+        }
+        return nextSubTree(curNode);
+      case TreeDirection::PARENT:
+        // curNode does not cover ipaddr/masklen, so its whole subtree is
+        // either before or after it.
+        if (ipaddr < curNode->ipAddress() || (ipaddr == curNode->ipAddress()
+              && masklen < curNode->masklen())) {
+          return curNode;
+        }
+        return nextSubTree(curNode);
+    }
+  }
+  return nullptr;
+}
+
+template<typename IPADDRTYPE, typename T, typename TreeTraits>
+const typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNode*
+RadixTree<IPADDRTYPE, T, TreeTraits>::nextSubTree(const TreeNode* node) {
+  for (auto parent = node->parent(); parent;
+      node = parent, parent = parent->parent()) {
+    if (parent->left() == node && parent->right()) {
+      return parent->right();
+    }
+  }
+  return nullptr;
+}
+
 template<typename IPADDRTYPE, typename T, typename TreeTraits>
 inline void  RadixTree<IPADDRTYPE, T, TreeTraits>
 ::trailAppend(VecConstIterators* trail,
@@ -124,43 +178,43 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
     }
   }
   auto newNode = makeNode(toAdd, mask, std::forward<VALUE>(value));
-  // Cache new node pointer since the unique_ptr maybe moved
-  auto newNodeRaw = newNode.get();
+  // Free newNode if we fail to allocate an internal node for it
+  auto newNodeGuard = folly::makeGuard([&] { freeNode(newNode); });
   if (!bestMatch) {
     // No match found
     if (!root_) {
       // Empty tree, make this the root
-      makeRoot(std::move(newNode));
+      makeRoot(newNode);
     } else {
       // The root exists but this ipaddr, mask failed to
       // match even the root->ipaddr/mask. We need a less
       // specific root.
       auto prefix = IPADDRTYPE::longestCommonPrefix(
         {root_->ipAddress(), root_->masklen()}, {toAdd, mask});
-      std::unique_ptr<TreeNode> newRoot = nullptr;
-      if (prefix.first == toAdd && prefix.second == mask) {
+      TreeNode* newRoot = nullptr;
+      auto newNodeIsRoot = prefix.first == toAdd && prefix.second == mask;
+      if (newNodeIsRoot) {
         // To be added node is the new root
-        newRoot = std::move(newNode);
+        newRoot = newNode;
       } else {
         // Add new root as a non value internal node
         newRoot = makeNode(prefix.first, prefix.second);
       }
-      auto oldRootDirection = newRoot->searchDirection(root_.get());
+      auto oldRootDirection = newRoot->searchDirection(root_);
       CHECK(oldRootDirection == TreeDirection::LEFT ||
          oldRootDirection == TreeDirection::RIGHT);
       if (oldRootDirection == TreeDirection::LEFT) {
-        newRoot->resetLeft(std::move(root_));
-        if (newNode) {
-          // new node was not moved to be the new root
-          newRoot->resetRight(std::move(newNode));
+        newRoot->resetLeft(root_);
+        if (!newNodeIsRoot) {
+          newRoot->resetRight(newNode);
         }
       } else {
-        newRoot->resetRight(std::move(root_));
-        if (newNode) {
-          newRoot->resetLeft(std::move(newNode));
+        newRoot->resetRight(root_);
+        if (!newNodeIsRoot) {
+          newRoot->resetLeft(newNode);
         }
       }
-      makeRoot(std::move(newRoot));
+      makeRoot(newRoot);
     }
   } else {
     auto toAddDirection = bestMatch->searchDirection(toAdd, mask);
@@ -169,12 +223,12 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
         toAddDirection == TreeDirection::RIGHT);
     if (toAddDirection == TreeDirection::LEFT) {
       if (!bestMatch->left()) {
-        bestMatch->resetLeft(std::move(newNode));
+        bestMatch->resetLeft(newNode);
         done = true;
       }
     } else {
       if (!bestMatch->right()) {
-        bestMatch->resetRight(std::move(newNode));
+        bestMatch->resetRight(newNode);
         done = true;
       }
     }
@@ -205,47 +259,45 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
         // We need to insert a non value internal node as a parent of
         // bestMatchChild and new node.
         auto internalNode = makeNode(prefix.first, prefix.second);
-        auto internalNodeRaw = internalNode.get();
-        std::unique_ptr<TreeNode> oldBestMatchChild = nullptr;
+        TreeNode* oldBestMatchChild = nullptr;
         if (toAddDirection ==  TreeDirection::LEFT) {
-          oldBestMatchChild = bestMatch->resetLeft(std::move(internalNode));
+          oldBestMatchChild = bestMatch->resetLeft(internalNode);
         } else {
-          oldBestMatchChild = bestMatch->resetRight(std::move(internalNode));
+          oldBestMatchChild = bestMatch->resetRight(internalNode);
         }
-        auto newNodeDirection = internalNodeRaw->searchDirection(newNode.get());
+        auto newNodeDirection = internalNode->searchDirection(newNode);
         CHECK(newNodeDirection == TreeDirection::LEFT ||
             newNodeDirection == TreeDirection::RIGHT);
         if (newNodeDirection == TreeDirection::LEFT) {
-          internalNodeRaw->resetLeft(std::move(newNode));
-          internalNodeRaw->resetRight(std::move(oldBestMatchChild));
+          internalNode->resetLeft(newNode);
+          internalNode->resetRight(oldBestMatchChild);
         } else {
-          internalNodeRaw->resetRight(std::move(newNode));
-          internalNodeRaw->resetLeft(std::move(oldBestMatchChild));
+          internalNode->resetRight(newNode);
+          internalNode->resetLeft(oldBestMatchChild);
         }
-        CHECK(internalNode == nullptr);
       } else {
         // New node needs to be inserted  b/w bestMatch and bestMatchChild
-        std::unique_ptr<TreeNode> oldBestMatchChild = nullptr;
+        TreeNode* oldBestMatchChild = nullptr;
         if (toAddDirection ==  TreeDirection::LEFT) {
-          oldBestMatchChild = bestMatch->resetLeft(std::move(newNode));
+          oldBestMatchChild = bestMatch->resetLeft(newNode);
         } else {
-          oldBestMatchChild = bestMatch->resetRight(std::move(newNode));
+          oldBestMatchChild = bestMatch->resetRight(newNode);
         }
         auto bestMatchChildDirection =
-          newNodeRaw->searchDirection(oldBestMatchChild.get());
+          newNode->searchDirection(oldBestMatchChild);
         DCHECK(bestMatchChildDirection == TreeDirection::LEFT ||
             bestMatchChildDirection == TreeDirection::RIGHT);
         if (bestMatchChildDirection == TreeDirection::LEFT) {
-          newNodeRaw->resetLeft(std::move(oldBestMatchChild));
+          newNode->resetLeft(oldBestMatchChild);
         } else {
-          newNodeRaw->resetRight(std::move(oldBestMatchChild));
+          newNode->resetRight(oldBestMatchChild);
         }
       }
     }
   }
-  CHECK(newNode == nullptr);
+  newNodeGuard.dismiss();
   ++size_;
-  return std::make_pair(traits_.makeItr(newNodeRaw), true);
+  return std::make_pair(traits_.makeItr(newNode), true);
 }
 
 /*
@@ -283,21 +335,18 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::erase(TreeNode* toDelete) {
   } else if (left || right) {
     // toDelete has just one child, let the child's grandparent
     // adopt it since toDelete is about to got away.
+    auto child = left ? left : right;
     if (parent) {
-      //Note - toDelete gets freed here.
       if (parent->left() == toDelete) {
-        parent->resetLeft(left ? toDelete->resetLeft(nullptr) :
-                          toDelete->resetRight(nullptr));
+        parent->resetLeft(child);
       } else {
-        parent->resetRight(left ? toDelete->resetLeft(nullptr) :
-                           toDelete->resetRight(nullptr));
+        parent->resetRight(child);
       }
     } else {
-      CHECK(root_.get() == toDelete);
-      // Update root, toDelete (old root) gets deleted as a result
-      makeRoot(left ? toDelete->resetLeft(nullptr) :
-               toDelete->resetRight(nullptr));
+      CHECK(root_ == toDelete);
+      makeRoot(child);
     }
+    freeNode(toDelete);
     // We just made toDelete's parent the parent of toDelete's only
     // child. There are 2 possibilities with regard to toDelete's parent
     // a) The parent is a value node - In this case there is no bearing
@@ -311,9 +360,9 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::erase(TreeNode* toDelete) {
   } else {
     // toDelete has no children.
     if (parent) {
-      //Free toDelete
       parent->left() == toDelete ? parent->resetLeft(nullptr):
         parent->resetRight(nullptr);
+      freeNode(toDelete);
       if (parent->isNonValueNode()) {
         // toDelete's parent is a non value node. Since we removed
         // toDelete, toDelete's parent needs to be deleted as well
@@ -326,10 +375,10 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::erase(TreeNode* toDelete) {
           parent->resetRight(nullptr);
         CHECK(toDeleteSibling);
         if (grandParent) {
-          //Free toDelete's parent
           grandParent->left() == parent ?
-            grandParent->resetLeft(std::move(toDeleteSibling)):
-            grandParent->resetRight(std::move(toDeleteSibling));
+            grandParent->resetLeft(toDeleteSibling):
+            grandParent->resetRight(toDeleteSibling);
+          freeNode(parent);
           // Here we replaced one of grandparent's children with
           // another and removed parent, toDelete nodes. There are
           // 2 possibilities with regards to grand parent
@@ -348,9 +397,10 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::erase(TreeNode* toDelete) {
           // 2 children), each subtree of such a tree is also valid.
           // Since the tree under toDeleteSibling is one such tree,
           // our post condition is held.
-          CHECK(root_.get() == parent);
+          CHECK(root_ == parent);
           CHECK(parent->isLeaf()); // Both children should be set to null
-          makeRoot(std::move(toDeleteSibling));
+          makeRoot(toDeleteSibling);
+          freeNode(parent);
         }
       } else {
          // toDelete's parent is a value node.
@@ -362,9 +412,10 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::erase(TreeNode* toDelete) {
     } else {
       // To be deleted node has no parent and no children.
       // Its thus the root (and only node) in the tree.
-      CHECK_EQ(root_.get(), toDelete);
+      CHECK_EQ(root_, toDelete);
       // Empty tree, post condition trivially held.
-      root_.reset(nullptr);
+      root_ = nullptr;
+      freeNode(toDelete);
     }
   }
   --size_;
@@ -388,19 +439,20 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::radixSubTreesEqual(
 
 
 template<typename IPADDRTYPE, typename T, typename TreeTraits>
-std::unique_ptr<typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNode>
+typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNode*
 RadixTree<IPADDRTYPE, T, TreeTraits>::cloneSubTree(const TreeNode* node) {
   if (!node) {
     return nullptr;
   }
-  std::unique_ptr<TreeNode> copy;
+  TreeNode* copy = nullptr;
   if (node->isValueNode()) {
-    copy = folly::make_unique<TreeNode>(node->ipAddress(),
-      node->masklen(), node->value(), node->nodeDeleteCallback());
+    copy = makeNode(node->ipAddress(), node->masklen(), node->value());
   } else {
-    copy = folly::make_unique<TreeNode>(node->ipAddress(),
-      node->masklen(), node->nodeDeleteCallback());
+    copy = makeNode(node->ipAddress(), node->masklen());
   }
+  SCOPE_FAIL {
+    freeSubTree(copy);
+  };
   copy->resetLeft(cloneSubTree(node->left()));
   copy->resetRight(cloneSubTree(node->right()));
   return copy;
@@ -9,11 +9,13 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <folly/Conv.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
 #include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
@@ -25,29 +27,25 @@ namespace facebook { namespace network {
  * ones created by the radix tree implementation, which will
  * hold no values. All non value nodes will have 2 children,
  * this invariant must be maintained at all times.
+ *
+ * Nodes are owned by their RadixTree, which allocates them from its
+ * RadixTreeNodePool and frees them, children included, itself; the links
+ * between nodes are plain pointers.  The delete callback belongs to
+ * the tree too, see RadixTree::nodeDeleteCallback().
 */
 template<typename IPADDRTYPE, typename T>
 class RadixTreeNode {
  public:
-  // Optional function parameter to call from destructor
+  // Optional function parameter for the tree to call before it frees a node
   typedef std::function<void(const RadixTreeNode<IPADDRTYPE, T>&)>
     NodeDeleteCallback;
 
-  RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen,
-      NodeDeleteCallback deleteCallback):
-    ipAddress_(ipAddr), masklen_(mlen), deleteCallback_(deleteCallback) {}
+  RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen):
+    ipAddress_(ipAddr), masklen_(mlen) {}
 
   template<typename VALUE>
-  RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen, VALUE&& val,
-       NodeDeleteCallback deleteCallback): ipAddress_(ipAddr),
-  masklen_(mlen), value_(std::forward<VALUE>(val)),
-  deleteCallback_(deleteCallback) {}
-
-  ~RadixTreeNode() {
-    if (deleteCallback_) {
-      deleteCallback_(*this);
-    }
-  }
+  RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen, VALUE&& val):
+    ipAddress_(ipAddr), masklen_(mlen), value_(std::forward<VALUE>(val)) {}
 
   enum class TreeDirection { LEFT, RIGHT, PARENT, THIS_NODE};
 
@@ -55,18 +53,17 @@ class RadixTreeNode {
   bool  isNonValueNode() const { return !isValueNode(); }
   bool  isValueNode()   const  { return value_.hasValue(); }
   uint32_t masklen() const { return masklen_; }
-  const RadixTreeNode* left() const { return left_.get(); }
-  RadixTreeNode* left() { return left_.get();}
-  const RadixTreeNode* right() const { return right_.get();  }
-  RadixTreeNode* right() { return right_.get();  }
+  const RadixTreeNode* left() const { return left_; }
+  RadixTreeNode* left() { return left_;}
+  const RadixTreeNode* right() const { return right_;  }
+  RadixTreeNode* right() { return right_;  }
   RadixTreeNode*  parent() { return parent_;  }
   const RadixTreeNode* parent() const { return parent_; }
   bool    isLeaf()  const { return left_ == nullptr && right_ == nullptr; }
   const T& value() const { return value_.value();  }
   T&       value()       { return value_.value();  }
-  NodeDeleteCallback nodeDeleteCallback() const { return deleteCallback_; }
   std::string str(bool printValue = true) const {
-    auto nodeStr = folly::to<std::string>(ipAddress_.str(), "/", masklen_);
+    auto nodeStr = folly::to<std::string>(ipAddress_.str(), "/", masklen());
     if (printValue) {
       nodeStr += isNonValueNode() ?  "(*)" :
         folly::to<std::string>("(",this->value(), ")");
@@ -90,20 +87,20 @@ class RadixTreeNode {
           this->value() == r.value());
   }
 
-  std::unique_ptr<RadixTreeNode>
-    resetLeft(std::unique_ptr<RadixTreeNode> newLeft) {
-    auto old = std::move(left_);
-    left_ = std::move(newLeft);
+  // Replace a child, returning the old one.  The old child's parent
+  // pointer is left as is.
+  RadixTreeNode* resetLeft(RadixTreeNode* newLeft) {
+    auto old = left_;
+    left_ = newLeft;
     if (left_) {
       left_->setParent(this);
     }
     return old;
   }
 
-  std::unique_ptr<RadixTreeNode>
-    resetRight(std::unique_ptr<RadixTreeNode> newRight) {
-    auto old = std::move(right_);
-    right_ = std::move(newRight);
+  RadixTreeNode* resetRight(RadixTreeNode* newRight) {
+    auto old = right_;
+    right_ = newRight;
     if (right_) {
       right_->setParent(this);
     }
@@ -123,13 +120,114 @@ class RadixTreeNode {
     value_.clear();
   }
  protected:
+  // Forbidden copy constructor and assignment operator
+  RadixTreeNode(RadixTreeNode const &) = delete;
+  RadixTreeNode& operator=(RadixTreeNode const &) = delete;
+
   IPADDRTYPE ipAddress_;
-  uint32_t masklen_{0}; // Number of bits to match.
+  uint8_t masklen_{0}; // Number of bits to match.
   folly::Optional<T> value_;
-  std::unique_ptr<RadixTreeNode> left_{nullptr};
-  std::unique_ptr<RadixTreeNode> right_{nullptr};
+  RadixTreeNode* left_{nullptr};
+  RadixTreeNode* right_{nullptr};
   RadixTreeNode* parent_{nullptr};
-  NodeDeleteCallback deleteCallback_;
+};
+
+/*
+ * Storage for the nodes of a RadixTree.
+ *
+ * Nodes are carved out of chunks which double in size as the tree grows, so
+ * a tree costs a handful of allocations rather than one per node, and nodes
+ * inserted together sit together in memory.  Freed nodes go on a free list
+ * to be reused; the chunks themselves are only returned by reset(), which
+ * must not be called while any node is still alive.
+ */
+template<typename NODE>
+class RadixTreeNodePool {
+ public:
+  RadixTreeNodePool() {}
+  ~RadixTreeNodePool() {}
+
+  RadixTreeNodePool(RadixTreeNodePool&& r) noexcept {
+    *this = std::move(r);
+  }
+  RadixTreeNodePool& operator=(RadixTreeNodePool&& r) noexcept {
+    chunks_ = std::move(r.chunks_);
+    freeList_ = r.freeList_;
+    chunkSize_ = r.chunkSize_;
+    chunkUsed_ = r.chunkUsed_;
+    allocatedSlots_ = r.allocatedSlots_;
+    r.chunks_.clear();
+    r.freeList_ = nullptr;
+    r.chunkSize_ = r.chunkUsed_ = r.allocatedSlots_ = 0;
+    return *this;
+  }
+
+  template<typename... Args>
+  NODE* create(Args&&... args) {
+    auto slot = allocate();
+    SCOPE_FAIL {
+      release(slot);
+    };
+    return new (slot) NODE(std::forward<Args>(args)...);
+  }
+
+  void destroy(NODE* node) {
+    node->~NODE();
+    release(reinterpret_cast<Slot*>(node));
+  }
+
+  void reset() {
+    chunks_.clear();
+    freeList_ = nullptr;
+    chunkSize_ = chunkUsed_ = allocatedSlots_ = 0;
+  }
+
+  // Memory held for nodes, whether in use or free
+  size_t allocatedBytes() const {
+    return allocatedSlots_ * sizeof(Slot);
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  RadixTreeNodePool(RadixTreeNodePool const &) = delete;
+  RadixTreeNodePool& operator=(RadixTreeNodePool const &) = delete;
+
+  union Slot {
+    Slot* next;
+    typename std::aligned_storage<sizeof(NODE), alignof(NODE)>::type node;
+  };
+  enum : size_t {
+    kMinChunkSlots = 8,
+    kMaxChunkSlots = 4096,
+  };
+
+  Slot* allocate() {
+    if (freeList_) {
+      auto slot = freeList_;
+      freeList_ = slot->next;
+      return slot;
+    }
+    if (chunkUsed_ == chunkSize_) {
+      auto size = chunkSize_ ?
+        std::min<size_t>(chunkSize_ * 2, kMaxChunkSlots) : kMinChunkSlots;
+      chunks_.emplace_back(new Slot[size]);
+      chunkSize_ = size;
+      chunkUsed_ = 0;
+      allocatedSlots_ += size;
+    }
+    return &chunks_.back()[chunkUsed_++];
+  }
+
+  void release(Slot* slot) {
+    slot->next = freeList_;
+    freeList_ = slot;
+  }
+
+  std::vector<std::unique_ptr<Slot[]>> chunks_;
+  Slot* freeList_{nullptr};
+  size_t chunkSize_{0};
+  size_t chunkUsed_{0};
+  size_t allocatedSlots_{0};
 };
 
 
@@ -356,15 +454,21 @@ class RadixTree {
   RadixTree(const RadixTree& r) = delete;
   RadixTree& operator=(const RadixTree& r) = delete;
 
-  Iterator  begin()  { return traits_.makeItr(root_.get()); }
+  ~RadixTree() {
+    clear();
+  }
+
+  Iterator  begin()  { return traits_.makeItr(root_); }
   Iterator  end()    { return traits_.makeItr(nullptr); }
-  ConstIterator begin() const { return traits_.makeCItr(root_.get()); }
+  ConstIterator begin() const { return traits_.makeCItr(root_); }
   ConstIterator end()   const { return traits_.makeCItr(nullptr);  }
 
   // Free all nodes and clear the tree.
   void clear() {
-    root_.reset(nullptr);
+    freeSubTree(root_);
+    root_ = nullptr;
     size_ = 0;
+    pool_.reset();
   }
   RadixTree(RadixTree&& r) noexcept
    : nodeDeleteCallback_(r.nodeDeleteCallback_),
@@ -374,10 +478,16 @@ class RadixTree {
   // Move radix tree onto this
   RadixTree& operator=(RadixTree&& r) noexcept {
     // Don't copy the traits and delete callback, use
-    // ones with which this Radix tree was created
-    size_ = r.size_;
-    makeRoot(std::move(r.root_));
-    r.size_ = 0;
+    // ones with which this Radix tree was created. The nodes
+    // taken from r are freed with our delete callback from now on.
+    if (this != &r) {
+      clear();
+      pool_ = std::move(r.pool_);
+      size_ = r.size_;
+      makeRoot(r.root_);
+      r.root_ = nullptr;
+      r.size_ = 0;
+    }
     return *this;
   }
   // Clone this radix tree onto another
@@ -388,7 +498,7 @@ class RadixTree {
         "clone template type must be the same as Radix tree value type");
     RadixTree copy(nodeDeleteCallback_, traits_);
     copy.size_ = size_;
-    copy.root_ = cloneSubTree(root_.get());
+    copy.root_ = copy.cloneSubTree(root_);
     return copy;
   }
   /*
@@ -447,6 +557,24 @@ class RadixTree {
         const_cast<const RadixTree*>(this)->exactMatch(ipaddr, mask));
   }
 
+  /*
+   * Iteration is a preorder walk with left (0 bit) children visited
+   * before right (1 bit) children, so value nodes are visited in
+   * (masked IP, masklen) order. upperBound returns an iterator to the
+   * first value node that comes strictly after IP, mask in that order,
+   * lowerBound to the first one that does not come before it. These let
+   * callers resume a walk from a previously seen prefix in O(depth)
+   * rather than re-walking the tree from begin().
+   */
+  ConstIterator upperBound(const IPADDRTYPE& ipaddr, uint8_t masklen) const {
+    return traits_.makeCItr(upperBoundImpl(ipaddr.mask(masklen), masklen));
+  }
+
+  ConstIterator lowerBound(const IPADDRTYPE& ipaddr, uint8_t masklen) const {
+    auto itr = exactMatch(ipaddr.mask(masklen), masklen);
+    return itr != end() ? itr : upperBound(ipaddr, masklen);
+  }
+
   /*
    * Get longest match as with the longestMatch api, but in addition record
    * the path from root to this node. Boolean parameter to control whether
@@ -524,12 +652,17 @@ class RadixTree {
   }
 
   size_t size()  const { return size_; }
-  const TreeNode* root() const { return root_.get(); }
-  TreeNode* root() { return root_.get();  }
+  const TreeNode* root() const { return root_; }
+  TreeNode* root() { return root_;  }
   NodeDeleteCallback nodeDeleteCallback() const { return nodeDeleteCallback_; }
   const TreeTraits&  traits() const { return traits_; }
+  // Memory held for the nodes of this tree, including freed nodes
+  // which have not been reused yet
+  size_t allocatedBytes() const { return pool_.allocatedBytes(); }
  private:
-  static std::unique_ptr<TreeNode> cloneSubTree(const TreeNode* node);
+  // Copy the subtree rooted at node, which may belong to another tree,
+  // into this tree's pool
+  TreeNode* cloneSubTree(const TreeNode* node);
   // Worker function to do the actual longest match lookup.
   const TreeNode* longestMatchImpl(const IPADDRTYPE& ipaddr,
       uint8_t masklen, bool& foundExact, bool includeNonValueNodes = false,
@@ -544,31 +677,60 @@ class RadixTree {
             masklen, foundExact, includeNonValueNodes, trail));
   }
 
-  std::unique_ptr<TreeNode> makeNode(const IPADDRTYPE& ip,
-      uint8_t masklen) {
-    return folly::make_unique<TreeNode>(ip, masklen, nodeDeleteCallback_);
+  // Worker function for upperBound. May return a non value node, in which
+  // case the iterator built on it skips ahead to the next value node.
+  const TreeNode* upperBoundImpl(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const;
+
+  // First node visited after the subtree rooted at node
+  static const TreeNode* nextSubTree(const TreeNode* node);
+
+  TreeNode* makeNode(const IPADDRTYPE& ip, uint8_t masklen) {
+    return pool_.create(ip, masklen);
   }
 
   template<typename VALUE>
-  std::unique_ptr<TreeNode> makeNode(const IPADDRTYPE& ip,
-      uint8_t masklen, VALUE&& value) {
-    return folly::make_unique<TreeNode>(ip, masklen,
-                                        std::forward<VALUE>(value),
-                                        nodeDeleteCallback_);
+  TreeNode* makeNode(const IPADDRTYPE& ip, uint8_t masklen, VALUE&& value) {
+    return pool_.create(ip, masklen, std::forward<VALUE>(value));
   }
 
-  void makeRoot(std::unique_ptr<TreeNode> newRoot) {
-    CHECK(root_ != newRoot || root_ == nullptr);
+  // Free a single node. Its children, if any, must have been
+  // moved elsewhere or freed already.
+  void freeNode(TreeNode* node) {
+    if (nodeDeleteCallback_) {
+      nodeDeleteCallback_(*node);
+    }
+    pool_.destroy(node);
+  }
+
+  // Free a node and all of its descendants
+  void freeSubTree(TreeNode* node) {
+    if (!node) {
+      return;
+    }
+    auto left = node->left();
+    auto right = node->right();
+    // Parents are reported before their children, and right subtrees
+    // before left ones
+    freeNode(node);
+    freeSubTree(right);
+    freeSubTree(left);
+  }
+
+  // Make newRoot the root. The old root, if any, must already have been
+  // linked under newRoot or freed.
+  void makeRoot(TreeNode* newRoot) {
     if (newRoot) {
         newRoot->setParent(nullptr);
     }
-    root_ = std::move(newRoot);
+    root_ = newRoot;
   }
 
   inline void trailAppend(VecConstIterators* trail,
   bool includeNonValueNodes, const TreeNode* node) const;
 
-  std::unique_ptr<TreeNode> root_{nullptr};
+  RadixTreeNodePool<TreeNode> pool_;
+  TreeNode* root_{nullptr};
   size_t  size_{0};
   NodeDeleteCallback nodeDeleteCallback_;
   TreeTraits  traits_;
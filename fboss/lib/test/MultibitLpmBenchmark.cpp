@@ -0,0 +1,119 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <vector>
+#include "common/init/Init.h"
+#include "common/base/Random.h"
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/Benchmark.h>
+#include "fboss/lib/MultibitLpm.h"
+#include "fboss/lib/RadixTree.h"
+
+using namespace std;
+using namespace folly;
+using namespace facebook;
+using namespace facebook::network;
+
+DEFINE_int32(lpm_route_count, 100000,
+             "The number of prefixes in the benchmarked tables");
+DEFINE_int32(lpm_lookup_count, 10000,
+             "The number of addresses to look up on each lookup iteration");
+namespace {
+RadixTree<IPAddressV4, int> rtree4;
+RadixTree<IPAddressV6, int> rtree6;
+unique_ptr<MultibitLpm<IPAddressV4, int>> lpm4;
+unique_ptr<MultibitLpm<IPAddressV6, int>> lpm6;
+vector<IPAddressV4> lookups4;
+vector<IPAddressV6> lookups6;
+
+// V4 benchmarks
+
+BENCHMARK(RadixTreeLongestMatch4, iters) {
+  while (iters--) {
+    for (const auto& ip: lookups4) {
+      doNotOptimizeAway(rtree4.longestMatch(ip, 32));
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(MultibitLpmLongestMatch4, iters) {
+  while (iters--) {
+    for (const auto& ip: lookups4) {
+      doNotOptimizeAway(lpm4->longestMatch(ip));
+    }
+  }
+}
+
+BENCHMARK(MultibitLpmBuild4) {
+  MultibitLpm<IPAddressV4, int> lpm(rtree4);
+  doNotOptimizeAway(lpm.size());
+}
+
+BENCHMARK_DRAW_LINE();
+
+// V6 benchmarks
+
+BENCHMARK(RadixTreeLongestMatch6, iters) {
+  while (iters--) {
+    for (const auto& ip: lookups6) {
+      doNotOptimizeAway(rtree6.longestMatch(ip, 128));
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(MultibitLpmLongestMatch6, iters) {
+  while (iters--) {
+    for (const auto& ip: lookups6) {
+      doNotOptimizeAway(lpm6->longestMatch(ip));
+    }
+  }
+}
+
+BENCHMARK(MultibitLpmBuild6) {
+  MultibitLpm<IPAddressV6, int> lpm(rtree6);
+  doNotOptimizeAway(lpm.size());
+}
+
+}
+
+int main (int argc, char *argv[]) {
+  initFacebook(&argc, &argv);
+
+  // A data center like FIB: mostly /24s (v4) and /48 - /64s (v6) under a
+  // handful of aggregates, plus a default route.
+  rtree4.insert(IPAddressV4("0.0.0.0"), 0, 0);
+  rtree6.insert(IPAddressV6("::"), 0, 0);
+  vector<IPAddressV4> inserted4;
+  vector<IPAddressV6> inserted6;
+  for (int i = 1; i <= FLAGS_lpm_route_count; ++i) {
+    auto mask4 = 16 + random32(17);
+    auto ip4 = IPAddressV4::fromLongHBO(0x0a000000 | random32(1 << 24))
+      .mask(mask4);
+    if (rtree4.insert(ip4, mask4, i).second) {
+      inserted4.push_back(ip4);
+    }
+
+    auto mask6 = random32(2) ? 48 : 64;
+    ByteArray16 ba = IPAddressV6("2401:db00::").toByteArray();
+    *(uint32_t*)(&ba[4]) = random32();
+    auto ip6 = IPAddressV6(ba).mask(mask6);
+    if (rtree6.insert(ip6, mask6, i).second) {
+      inserted6.push_back(ip6);
+    }
+  }
+  lpm4.reset(new MultibitLpm<IPAddressV4, int>(rtree4));
+  lpm6.reset(new MultibitLpm<IPAddressV6, int>(rtree6));
+  LOG(INFO) << "LPM index memory: v4 " << lpm4->memoryUsage()
+            << " bytes, v6 " << lpm6->memoryUsage() << " bytes";
+
+  // Look up host addresses inside the inserted prefixes
+  for (int i = 0; i < FLAGS_lpm_lookup_count; ++i) {
+    auto bytes4 = inserted4[random32(inserted4.size())].toByteArray();
+    bytes4[3] |= random32(256);
+    lookups4.push_back(IPAddressV4(bytes4));
+    auto bytes6 = inserted6[random32(inserted6.size())].toByteArray();
+    *(uint64_t*)(&bytes6[8]) = random64();
+    lookups6.push_back(IPAddressV6(bytes6));
+  }
+  runBenchmarks();
+}
@@ -0,0 +1,140 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "common/base/Random.h"
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include "fboss/lib/MultibitLpm.h"
+#include "fboss/lib/RadixTree.h"
+
+using namespace facebook;
+using namespace facebook::network;
+using namespace std;
+
+namespace {
+using IPAddressV4 = folly::IPAddressV4;
+using IPAddressV6 = folly::IPAddressV6;
+using ByteArray16 = folly::ByteArray16;
+
+const int kInsertCount = 10000;
+// Random long v6 prefixes rarely share child tables, so keep this smaller
+const int kInsertCount6 = 1000;
+const int kLookupCount = 100000;
+
+IPAddressV4 randomV4() {
+  return IPAddressV4::fromLongHBO(random32());
+}
+
+IPAddressV6 randomV6() {
+  ByteArray16 ba;
+  *(uint64_t*)(&ba[0]) = random64();
+  *(uint64_t*)(&ba[8]) = random64();
+  return IPAddressV6(ba);
+}
+
+// Check that the index agrees with RadixTree::longestMatch for addr
+template<typename IPADDRTYPE>
+void checkMatch(const RadixTree<IPADDRTYPE, int>& rtree,
+                const MultibitLpm<IPADDRTYPE, int>& lpm,
+                const IPADDRTYPE& addr) {
+  auto itr = rtree.longestMatch(addr, IPADDRTYPE::bitCount());
+  auto match = lpm.longestMatch(addr);
+  if (itr == rtree.end()) {
+    EXPECT_EQ(nullptr, match) << addr;
+  } else {
+    ASSERT_NE(nullptr, match) << addr;
+    EXPECT_EQ(itr->value(), *match) << addr;
+  }
+}
+}
+
+TEST(MultibitLpm, Empty) {
+  RadixTree<IPAddressV4, int> rtree4;
+  MultibitLpm<IPAddressV4, int> lpm4(rtree4);
+  EXPECT_EQ(0, lpm4.size());
+  EXPECT_EQ(nullptr, lpm4.longestMatch(IPAddressV4("10.0.0.1")));
+
+  RadixTree<IPAddressV6, int> rtree6;
+  MultibitLpm<IPAddressV6, int> lpm6(rtree6);
+  EXPECT_EQ(nullptr, lpm6.longestMatch(IPAddressV6("2401:db00::1")));
+}
+
+TEST(MultibitLpm, V4) {
+  RadixTree<IPAddressV4, int> rtree;
+  rtree.insert(IPAddressV4("0.0.0.0"), 0, 1);
+  rtree.insert(IPAddressV4("10.0.0.0"), 8, 2);
+  rtree.insert(IPAddressV4("10.0.0.0"), 16, 3);
+  rtree.insert(IPAddressV4("10.0.1.0"), 24, 4);
+  rtree.insert(IPAddressV4("10.0.1.128"), 25, 5);
+  rtree.insert(IPAddressV4("10.0.1.129"), 32, 6);
+  rtree.insert(IPAddressV4("10.128.0.0"), 9, 7);
+  MultibitLpm<IPAddressV4, int> lpm(rtree);
+  EXPECT_EQ(7, lpm.size());
+
+  EXPECT_EQ(1, *lpm.longestMatch(IPAddressV4("11.0.0.1")));
+  EXPECT_EQ(2, *lpm.longestMatch(IPAddressV4("10.1.0.1")));
+  EXPECT_EQ(3, *lpm.longestMatch(IPAddressV4("10.0.2.1")));
+  EXPECT_EQ(4, *lpm.longestMatch(IPAddressV4("10.0.1.1")));
+  EXPECT_EQ(5, *lpm.longestMatch(IPAddressV4("10.0.1.130")));
+  EXPECT_EQ(6, *lpm.longestMatch(IPAddressV4("10.0.1.129")));
+  EXPECT_EQ(7, *lpm.longestMatch(IPAddressV4("10.200.0.1")));
+}
+
+TEST(MultibitLpm, V6) {
+  RadixTree<IPAddressV6, int> rtree;
+  rtree.insert(IPAddressV6("2401:db00::"), 32, 1);
+  rtree.insert(IPAddressV6("2401:db00:2110::"), 48, 2);
+  rtree.insert(IPAddressV6("2401:db00:2110:3001::"), 64, 3);
+  rtree.insert(IPAddressV6("2401:db00:2110:3001::1"), 128, 4);
+  rtree.insert(IPAddressV6("fe80::"), 10, 5);
+  MultibitLpm<IPAddressV6, int> lpm(rtree);
+
+  EXPECT_EQ(nullptr, lpm.longestMatch(IPAddressV6("2401:db01::1")));
+  EXPECT_EQ(1, *lpm.longestMatch(IPAddressV6("2401:db00:1::1")));
+  EXPECT_EQ(2, *lpm.longestMatch(IPAddressV6("2401:db00:2110:1::1")));
+  EXPECT_EQ(3, *lpm.longestMatch(IPAddressV6("2401:db00:2110:3001::2")));
+  EXPECT_EQ(4, *lpm.longestMatch(IPAddressV6("2401:db00:2110:3001::1")));
+  EXPECT_EQ(5, *lpm.longestMatch(IPAddressV6("febf::1")));
+  EXPECT_EQ(nullptr, lpm.longestMatch(IPAddressV6("fec0::1")));
+}
+
+TEST(MultibitLpm, RandomV4) {
+  RadixTree<IPAddressV4, int> rtree;
+  vector<IPAddressV4> inserted;
+  for (int i = 0; i < kInsertCount; ++i) {
+    auto mask = random32(32);
+    auto ip = randomV4().mask(mask);
+    if (rtree.insert(ip, mask, i).second) {
+      inserted.push_back(ip);
+    }
+  }
+  MultibitLpm<IPAddressV4, int> lpm(rtree);
+  for (const auto& ip : inserted) {
+    checkMatch(rtree, lpm, ip);
+  }
+  for (int i = 0; i < kLookupCount; ++i) {
+    checkMatch(rtree, lpm, randomV4());
+  }
+}
+
+TEST(MultibitLpm, RandomV6) {
+  RadixTree<IPAddressV6, int> rtree;
+  vector<IPAddressV6> inserted;
+  for (int i = 0; i < kInsertCount6; ++i) {
+    auto mask = random32(128);
+    auto ip = randomV6().mask(mask);
+    if (rtree.insert(ip, mask, i).second) {
+      inserted.push_back(ip);
+    }
+  }
+  MultibitLpm<IPAddressV6, int> lpm(rtree);
+  for (const auto& ip : inserted) {
+    checkMatch(rtree, lpm, ip);
+  }
+  for (int i = 0; i < kLookupCount; ++i) {
+    checkMatch(rtree, lpm, randomV6());
+  }
+}
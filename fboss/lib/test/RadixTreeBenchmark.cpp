@@ -1,5 +1,6 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 
+#include <cstdio>
 #include <set>
 #include <vector>
 #include "common/init/Init.h"
@@ -111,6 +112,27 @@ BENCHMARK_RELATIVE(RadixTreeLongestMatch4) {
   }
 }
 
+// Full length lookups, as done when forwarding a packet
+BENCHMARK(PyRadixHostLookup4) {
+  PyRadixWrapper<IPAddressV4, int> pyrtree;
+  BENCHMARK_SUSPEND {
+    setupTree4(pyrtree);
+  }
+  for (auto pfx: exactMatchSet4) {
+    pyrtree.longestMatch(pfx.ip, 32);
+  }
+}
+
+BENCHMARK_RELATIVE(RadixTreeHostLookup4) {
+  RadixTree<IPAddressV4, int> rtree;
+  BENCHMARK_SUSPEND {
+    setupTree4(rtree);
+  }
+  for (auto pfx: exactMatchSet4) {
+    rtree.longestMatch(pfx.ip, 32);
+  }
+}
+
 // V6 benchmarks
 
 template<typename TREE>
@@ -191,6 +213,37 @@ BENCHMARK_RELATIVE(RadixTreeLongestMatch6) {
   }
 }
 
+BENCHMARK(PyRadixHostLookup6) {
+  PyRadixWrapper<IPAddressV6, int> pyrtree;
+  BENCHMARK_SUSPEND {
+    setupTree6(pyrtree);
+  }
+  for (auto pfx: exactMatchSet6) {
+    pyrtree.longestMatch(pfx.ip, 128);
+  }
+}
+
+BENCHMARK_RELATIVE(RadixTreeHostLookup6) {
+  RadixTree<IPAddressV6, int> rtree;
+  BENCHMARK_SUSPEND {
+    setupTree6(rtree);
+  }
+  for (auto pfx: exactMatchSet6) {
+    rtree.longestMatch(pfx.ip, 128);
+  }
+}
+
+// Memory held by the tree nodes, per prefix inserted
+void printMemoryPerPrefix() {
+  RadixTree<IPAddressV4, int> rtree4;
+  setupTree4(rtree4);
+  RadixTree<IPAddressV6, int> rtree6;
+  setupTree6(rtree6);
+  printf("RadixTree node bytes per prefix: v4 %.1f, v6 %.1f\n",
+      double(rtree4.allocatedBytes()) / rtree4.size(),
+      double(rtree6.allocatedBytes()) / rtree6.size());
+}
+
 }
 
 int main (int argc, char *argv[]) {
@@ -246,6 +299,7 @@ int main (int argc, char *argv[]) {
     auto newIp = pfx.ip.mask(newMask);
     longestMatchSet6.insert(Prefix6(newIp, newMask));
   }
+  printMemoryPerPrefix();
   runBenchmarks();
 }
 
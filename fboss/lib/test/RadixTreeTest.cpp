@@ -1447,3 +1447,142 @@ TEST(RadixTree, SubTreeIterator) {
   }
   EXPECT_EQ(rtree.end().subTreeIterator(), rtree.end());
 }
+
+TEST(RadixTree, UpperLowerBound) {
+  RadixTree<IPAddressV4, int> rtree;
+  // Prefixes in iteration order, value is the position in iteration order
+  vector<string> subnets = {
+    "1.0.0.0/8",
+    "1.1.0.0/16",
+    "1.1.1.0/24",
+    "1.1.1.254/32",
+    "1.1.254.0/24",
+    "1.1.254.1/32",
+    // "1.254.0.0/16", - non-value node
+    "1.254.1.0/24",
+    "1.254.1.0/28",
+    "1.254.1.1/32",
+    "1.254.1.15/32",
+    "1.254.254.0/24",
+    "1.254.254.254/32",
+  };
+  for (int i = 0; i < subnets.size(); ++i) {
+    auto subnet = IPAddress::createNetwork(subnets[i]);
+    EXPECT_TRUE(rtree.insert(subnet.first.asV4(), subnet.second, i).second);
+  }
+  const auto& crtree = rtree;
+  for (int i = 0; i < subnets.size(); ++i) {
+    auto subnet = IPAddress::createNetwork(subnets[i]);
+    auto lower = crtree.lowerBound(subnet.first.asV4(), subnet.second);
+    ASSERT_NE(crtree.end(), lower);
+    EXPECT_EQ(i, lower->value());
+    auto upper = crtree.upperBound(subnet.first.asV4(), subnet.second);
+    if (i + 1 < subnets.size()) {
+      ASSERT_NE(crtree.end(), upper);
+      EXPECT_EQ(i + 1, upper->value());
+    } else {
+      EXPECT_EQ(crtree.end(), upper);
+    }
+  }
+  // Prefixes not in the tree
+  vector<pair<string, int>> absent = {
+    // { prefix, position of first value node after it, -1 for end }
+    {"0.0.0.0/0", 0},
+    {"0.0.0.0/8", 0},
+    {"1.0.0.0/9", 1},
+    {"1.1.1.128/25", 3},
+    {"1.1.128.0/17", 4},
+    {"1.254.0.0/16", 6},
+    {"1.254.1.0/25", 7},
+    {"1.254.1.2/32", 9},
+    {"1.254.255.0/24", -1},
+    {"2.0.0.0/8", -1},
+  };
+  for (const auto& entry: absent) {
+    auto subnet = IPAddress::createNetwork(entry.first);
+    auto lower = crtree.lowerBound(subnet.first.asV4(), subnet.second);
+    auto upper = crtree.upperBound(subnet.first.asV4(), subnet.second);
+    EXPECT_EQ(lower, upper);
+    if (entry.second < 0) {
+      EXPECT_EQ(crtree.end(), upper) << entry.first;
+    } else {
+      ASSERT_NE(crtree.end(), upper) << entry.first;
+      EXPECT_EQ(entry.second, upper->value()) << entry.first;
+    }
+  }
+  // Walking with upperBound visits the same nodes as iteration
+  int count = 0;
+  for (auto itr = crtree.begin(); itr != crtree.end();
+      itr = crtree.upperBound(itr->ipAddress(), itr->masklen())) {
+    EXPECT_EQ(count++, itr->value());
+  }
+  EXPECT_EQ(subnets.size(), count);
+}
+
+TEST(RadixTree, NodePool) {
+  auto deleteCount = 0;
+  RadixTree<IPAddressV6, int> rtree(
+      [&](const RadixTreeNode<IPAddressV6, int>& node) { ++deleteCount; });
+  EXPECT_EQ(0, rtree.allocatedBytes());
+  const int kCount = 1000;
+  vector<Prefix6> prefixes;
+  for (int i = 0; i < kCount; ++i) {
+    prefixes.push_back(Prefix6(
+          IPAddressV6(folly::to<string>("2401:db00:", i, "::")), 48));
+    rtree.insert(prefixes.back().ip, prefixes.back().mask, i);
+  }
+  auto nodeCount = accumulate(rtree.begin(), rtree.end(), 0,
+      [](int cnt, RadixTreeIterator<IPAddressV6, int>::ValueType) {
+        return cnt + 1;
+      });
+  EXPECT_EQ(kCount, nodeCount);
+  // Nodes come out of chunks with no per node allocation overhead. Allow
+  // for the internal nodes, and chunks being at most half used.
+  auto allocated = rtree.allocatedBytes();
+  EXPECT_GT(allocated, 0);
+  EXPECT_LE(allocated / kCount,
+      4 * sizeof(RadixTreeNode<IPAddressV6, int>));
+
+  // Erased nodes are reused rather than allocating more
+  for (const auto& pfx : prefixes) {
+    EXPECT_TRUE(rtree.erase(pfx.ip, pfx.mask));
+  }
+  EXPECT_EQ(0, rtree.size());
+  EXPECT_EQ(nullptr, rtree.root());
+  auto erasedCount = deleteCount;
+  EXPECT_GE(erasedCount, kCount);
+  for (int i = 0; i < kCount; ++i) {
+    rtree.insert(prefixes[i].ip, prefixes[i].mask, i);
+  }
+  EXPECT_EQ(allocated, rtree.allocatedBytes());
+
+  // Clearing the tree frees every node, and the pool
+  rtree.clear();
+  EXPECT_EQ(2 * erasedCount, deleteCount);
+  EXPECT_EQ(0, rtree.allocatedBytes());
+}
+
+TEST(RadixTree, DeleteCallbackOrder) {
+  vector<string> deleted;
+  RadixTree<IPAddressV4, int> rtree(
+      [&](const RadixTreeNode<IPAddressV4, int>& node) {
+        deleted.push_back(node.str(false));
+      });
+  rtree.insert(IPAddressV4("10.0.0.0"), 8, 1);
+  rtree.insert(IPAddressV4("10.0.0.0"), 16, 2);
+  rtree.insert(IPAddressV4("10.128.0.0"), 16, 3);
+  rtree.insert(IPAddressV4("10.0.0.0"), 24, 4);
+  rtree.insert(IPAddressV4("10.0.128.0"), 24, 5);
+
+  // Parents are reported before their children, and right subtrees before
+  // left ones, the order in which the node destructors used to run
+  rtree.clear();
+  vector<string> expected{
+    "10.0.0.0/8",
+    "10.128.0.0/16",
+    "10.0.0.0/16",
+    "10.0.128.0/24",
+    "10.0.0.0/24",
+  };
+  EXPECT_EQ(expected, deleted);
+}
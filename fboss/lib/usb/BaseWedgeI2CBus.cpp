@@ -11,6 +11,7 @@
 #include "fboss/lib/usb/BaseWedgeI2CBus.h"
 #include "fboss/lib/usb/UsbError.h"
 
+using folly::ByteRange;
 using folly::MutableByteRange;
 using std::lock_guard;
 
@@ -19,25 +20,59 @@ namespace facebook { namespace fboss {
 BaseWedgeI2CBus::BaseWedgeI2CBus() {
 }
 
+BaseWedgeI2CBus::BaseWedgeI2CBus(std::unique_ptr<UsbIntrPipe> pipe)
+  : dev_(std::move(pipe)) {
+}
+
 void BaseWedgeI2CBus::open() {
   dev_.open();
 
   selectedPort_ = NO_PORT;
   verifyBus();
   initBus();
+  muxStateKnown_ = true;
 
   VLOG(4) << "successfully opened wedge CP2112 I2C bus";
 }
 
 void BaseWedgeI2CBus::close() {
+  // Don't leave a module selected for whoever opens the bus next.
+  try {
+    unselectQsfp();
+  } catch (const UsbError& ex) {
+    LOG(WARNING) << "failed to unselect QSFP " << selectedPort_
+                 << " before closing the bus: " << ex.what();
+  }
   dev_.close();
 }
 
 void BaseWedgeI2CBus::moduleRead(unsigned int module, uint8_t address,
                              int offset, int len, uint8_t *buf) {
-  CHECK_LE(offset, 255);
+  selectQsfp(module);
+  readSelected(address, offset, len, buf);
+}
 
+void BaseWedgeI2CBus::moduleWrite(unsigned int module, uint8_t address,
+                              int offset, int len, uint8_t *buf) {
   selectQsfp(module);
+  writeSelected(address, offset, len, buf);
+}
+
+void BaseWedgeI2CBus::moduleTransaction(unsigned int module,
+                                        const std::vector<Op>& ops) {
+  selectQsfp(module);
+  for (const auto& op : ops) {
+    if (op.type == Op::READ) {
+      readSelected(op.i2cAddress, op.offset, op.len, op.buf);
+    } else {
+      writeSelected(op.i2cAddress, op.offset, op.len, op.buf);
+    }
+  }
+}
+
+void BaseWedgeI2CBus::readSelected(uint8_t address, int offset,
+                                   int len, uint8_t* buf) {
+  CHECK_LE(offset, 255);
   CHECK_NE(selectedPort_, NO_PORT);
 
   // CP2112 uses addresses in the on-the-wire format, while we generally
@@ -50,21 +85,20 @@ void BaseWedgeI2CBus::moduleRead(unsigned int module, uint8_t address,
   // that's okay since there aren't any other master devices on the bus.
 
   // Also note that we can't read more than 128 bytes at a time.
-  dev_.writeByte(address, offset);
+  uint8_t offsetByte = offset;
+  i2cWrite(address, ByteRange(&offsetByte, 1));
   if (len > 128) {
-    dev_.read(address, MutableByteRange(buf, 128));
-    dev_.writeByte(address, offset + 128);
-    dev_.read(address, MutableByteRange(buf + 128, len - 128));
+    i2cRead(address, MutableByteRange(buf, 128));
+    offsetByte = offset + 128;
+    i2cWrite(address, ByteRange(&offsetByte, 1));
+    i2cRead(address, MutableByteRange(buf + 128, len - 128));
   } else {
-    dev_.read(address, MutableByteRange(buf, len));
+    i2cRead(address, MutableByteRange(buf, len));
   }
-
-  unselectQsfp();
 }
 
-void BaseWedgeI2CBus::moduleWrite(unsigned int module, uint8_t address,
-                              int offset, int len, uint8_t *buf) {
-  selectQsfp(module);
+void BaseWedgeI2CBus::writeSelected(uint8_t address, int offset,
+                                    int len, uint8_t* buf) {
   CHECK_NE(selectedPort_, NO_PORT);
 
   // CP2112 uses addresses in the on-the-wire format, while we generally
@@ -79,24 +113,60 @@ void BaseWedgeI2CBus::moduleWrite(unsigned int module, uint8_t address,
   uint8_t output[61]; // USB buffer size;
   output[0] = offset;
   memcpy(output + 1, buf, len);
-  dev_.write(address, MutableByteRange(output, len + 1));
+  i2cWrite(address, ByteRange(output, len + 1));
+}
+
+void BaseWedgeI2CBus::i2cRead(uint8_t address, MutableByteRange buf) {
+  dev_.read(address, buf);
+}
 
-  unselectQsfp();
+void BaseWedgeI2CBus::i2cWrite(uint8_t address, ByteRange buf) {
+  dev_.write(address, buf);
 }
 
 void BaseWedgeI2CBus::selectQsfp(unsigned int port) {
-  VLOG(4) << "selecting QSFP " << port;
   CHECK_GT(port, 0);
-  if (port != selectedPort_) {
+  recoverMuxState();
+  if (port == selectedPort_) {
+    VLOG(5) << "QSFP " << port << " is already selected";
+    return;
+  }
+
+  VLOG(4) << "selecting QSFP " << port;
+  try {
     selectQsfpImpl(port);
+  } catch (...) {
+    muxStateKnown_ = false;
+    throw;
   }
 }
 
 void BaseWedgeI2CBus::unselectQsfp() {
+  recoverMuxState();
+  if (selectedPort_ == NO_PORT) {
+    return;
+  }
+
   VLOG(4) << "unselecting all QSFPs";
-  if (selectedPort_ != NO_PORT) {
+  try {
     selectQsfpImpl(NO_PORT);
+  } catch (...) {
+    muxStateKnown_ = false;
+    throw;
+  }
+}
+
+void BaseWedgeI2CBus::recoverMuxState() {
+  if (muxStateKnown_) {
+    return;
   }
+
+  // The selectQsfpImpl() implementations only write the switches that need
+  // to change, which relies on selectedPort_ being accurate.
+  VLOG(1) << "resetting I2C switches after a failed QSFP selection";
+  selectedPort_ = NO_PORT;
+  initBus();
+  muxStateKnown_ = true;
 }
 
 }} // facebook::fboss
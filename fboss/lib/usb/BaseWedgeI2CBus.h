@@ -12,6 +12,7 @@
 #include "fboss/lib/usb/TransceiverI2CApi.h"
 #include "fboss/lib/usb/CP2112.h"
 
+#include <memory>
 #include <mutex>
 #include <folly/Range.h>
 
@@ -32,16 +33,34 @@ class BaseWedgeI2CBus : public TransceiverI2CApi {
                           int offset, int len, uint8_t* buf) override;
   virtual void moduleWrite(unsigned int module, uint8_t i2cAddress,
                            int offset, int len, uint8_t* buf) override;
+  /*
+   * Run all of the operations with the module selected just once.
+   */
+  virtual void moduleTransaction(unsigned int module,
+                                 const std::vector<Op>& ops) override;
 
  protected:
   enum : unsigned int {
     NO_PORT = 0,
   };
 
+  /*
+   * Construct a bus on top of a CP2112 that talks through the given pipe.
+   * This is only for tests, which override i2cRead() and i2cWrite() too.
+   */
+  explicit BaseWedgeI2CBus(std::unique_ptr<UsbIntrPipe> pipe);
+
   virtual void initBus() = 0;
   virtual void verifyBus(bool autoReset = true) = 0;
   virtual void selectQsfpImpl(unsigned int module) = 0;
 
+  /*
+   * Raw I2C operations on the selected module.  These are virtual so that
+   * tests can see them without a device.
+   */
+  virtual void i2cRead(uint8_t address, folly::MutableByteRange buf);
+  virtual void i2cWrite(uint8_t address, folly::ByteRange buf);
+
   CP2112 dev_;
   unsigned int selectedPort_{NO_PORT};
 
@@ -49,9 +68,22 @@ class BaseWedgeI2CBus : public TransceiverI2CApi {
   /*
    * Set the PCA9548 switches so that we can read from the selected QSFP
    * module.
+   *
+   * The selection is left in place after each transaction, so consecutive
+   * transactions on the same module don't touch the switches at all.  It is
+   * only cleared when the bus is closed, since other processes may open the
+   * bus after us and expect no module to be selected.
    */
   void selectQsfp(unsigned int module);
   void unselectQsfp();
+  void recoverMuxState();
+
+  void readSelected(uint8_t address, int offset, int len, uint8_t* buf);
+  void writeSelected(uint8_t address, int offset, int len, uint8_t* buf);
+
+  // False if a switch write failed part way, so selectedPort_ may not match
+  // the switches and they have to be reset before the next selection.
+  bool muxStateKnown_{true};
 
   // Forbidden copy constructor and assignment operator
   BaseWedgeI2CBus(BaseWedgeI2CBus const &) = delete;
@@ -29,6 +29,7 @@
 #include "fboss/lib/usb/UsbError.h"
 
 #include <folly/Bits.h>
+#include <folly/Memory.h>
 #include <libusb-1.0/libusb.h>
 
 using folly::ByteRange;
@@ -57,6 +58,29 @@ struct Hid {
   };
 };
 
+// Bounds on the interval between transfer status polls
+const microseconds kMinPollInterval(100);
+const microseconds kMaxPollInterval(10000);
+
+/*
+ * Doubles the poll interval each time it is used, between kMinPollInterval
+ * and kMaxPollInterval.
+ */
+class PollBackoff {
+ public:
+  explicit PollBackoff(microseconds first)
+    : next_(std::min(std::max(first, kMinPollInterval), kMaxPollInterval)) {}
+
+  microseconds next() {
+    auto interval = next_;
+    next_ = std::min(next_ * 2, kMaxPollInterval);
+    return interval;
+  }
+
+ private:
+  microseconds next_;
+};
+
 template<typename INT>
 void setBE(uint8_t* buf, INT value) {
   INT be = Endian::big<INT>(value);
@@ -121,6 +145,11 @@ CP2112::CP2112(libusb_context* ctx)
     ownCtx_(false) {
 }
 
+CP2112::CP2112(std::unique_ptr<UsbIntrPipe> pipe)
+  : pipe_(std::move(pipe)),
+    ownCtx_(false) {
+}
+
 CP2112::~CP2112() {
   close();
   if (ctx_ && ownCtx_) {
@@ -144,6 +173,8 @@ void CP2112::open(bool setSmbusConfig) {
 }
 
 void CP2112::close() {
+  // The pipe's transfers must be cancelled before the handle goes away
+  pipe_.reset();
   handle_.close();
   dev_.reset();
 }
@@ -263,6 +294,7 @@ void CP2112::setSMBusConfig(SMBusConfig config) {
   DCHECK_LE(config.readTimeoutMS, 1000);
   // The retry limit must also be less than 1000
   DCHECK_LE(config.retryLimit, 1000);
+  busSpeed_ = config.speed;
 
   config.speed = Endian::big<uint32_t>(config.speed);
   config.writeTimeoutMS = Endian::big<uint16_t>(config.writeTimeoutMS);
@@ -328,7 +360,7 @@ void CP2112::write(uint8_t address, ByteRange buf, milliseconds timeout) {
   // Wait for the write to complete
   auto end = steady_clock::now() + timeout;
   intrOut("write request", usbBuf, sizeof(usbBuf), timeout);
-  waitForTransfer("write", end);
+  waitForTransfer("write", end, buf.size());
 }
 
 void CP2112::writeReadUnsafe(uint8_t address,
@@ -367,6 +399,7 @@ void CP2112::openDevice() {
   dev_ = UsbDevice::find(ctx_, VENDOR_ID, PRODUCT_ID);
   handle_ = dev_.open();
   handle_.claimInterface(0);
+  pipe_ = folly::make_unique<AsyncUsbIntrPipe>(ctx_, handle_.handle());
 }
 
 void CP2112::initSettings() {
@@ -412,6 +445,7 @@ void CP2112::initSettings() {
   if (config != desiredConfig) {
     setSMBusConfig(desiredConfig);
   }
+  busSpeed_ = desiredConfig.speed;
 }
 
 void CP2112::ensureGoodState() {
@@ -555,13 +589,14 @@ void CP2112::processReadResponse(MutableByteRange buf, milliseconds timeout) {
   // for this request.  By using XFER_STATUS_REQUEST we know that any
   // READ_RESPONSE we receive right now is extraneous.)
   auto end = steady_clock::now() + timeout;
-  milliseconds timeLeft = waitForTransfer("read", end);
+  milliseconds timeLeft = waitForTransfer("read", end, buf.size());
 
   // The device has finished reading data from the I2C bus.
   // Now we just have to read it over USB.
   uint8_t usbBuf[64];
   uint16_t bytesRead{0};
   bool sendRead = true;
+  PollBackoff backoff(kMinPollInterval);
   while (true) {
     // Send READ_FORCE_SEND if we think the device won't send data to us
     // otherwise.
@@ -591,7 +626,7 @@ void CP2112::processReadResponse(MutableByteRange buf, milliseconds timeout) {
       if (ex.errorCode() != LIBUSB_ERROR_TIMEOUT) {
         throw;
       }
-      timeLeft = updateTimeLeft(end, false);
+      timeLeft = updateTimeLeft(end, microseconds(0));
       if (timeLeft <= milliseconds(0)) {
         throw UsbError("timed out waiting on read response data");
       }
@@ -648,9 +683,9 @@ void CP2112::processReadResponse(MutableByteRange buf, milliseconds timeout) {
 
     // If we are still here the transaction is still in progress.
     // Update timeLeft.  If no data was returned, also sleep briefly to avoid
-    // spinning on the CPU.
-    bool sleep = (length == 0);
-    timeLeft = updateTimeLeft(end, sleep);
+    // spinning on the CPU, backing off if this keeps happening.
+    timeLeft = updateTimeLeft(
+        end, length == 0 ? backoff.next() : microseconds(0));
     if (timeLeft <= milliseconds(0)) {
       throw UsbError("timed out waiting on read response data");
     }
@@ -716,9 +751,14 @@ void CP2112::getTransferStatusImpl(uint8_t* usbBuf,
 }
 
 milliseconds CP2112::waitForTransfer(StringPiece operation,
-                                     steady_clock::time_point end) {
-  auto now = steady_clock::now();
-  milliseconds timeLeft = duration_cast<milliseconds>(end - now);
+                                     steady_clock::time_point end,
+                                     size_t busBytes) {
+  // Polling takes a USB round trip each time, so rather than starting right
+  // away, give the transfer about as long as it needs on the bus first.
+  // Later polls back off from a fraction of that.
+  auto busTime = estimateBusTime(busBytes);
+  milliseconds timeLeft = updateTimeLeft(end, busTime);
+  PollBackoff backoff(busTime / 4);
 
   uint8_t usbBuf[64];
   uint32_t loopIter{0};
@@ -750,7 +790,7 @@ milliseconds CP2112::waitForTransfer(StringPiece operation,
                      " while waiting on ", operation, " completion");
     }
 
-    timeLeft = updateTimeLeft(end, true);
+    timeLeft = updateTimeLeft(end, backoff.next());
     if (timeLeft < milliseconds(0)) {
       cancelTransfer();
       throw UsbError("timed out waiting on ", operation, " response: ",
@@ -759,16 +799,22 @@ milliseconds CP2112::waitForTransfer(StringPiece operation,
   }
 }
 
-milliseconds CP2112::updateTimeLeft(steady_clock::time_point end, bool sleep) {
-  auto now = steady_clock::now();
-  auto timeLeft = duration_cast<milliseconds>(end - now);
-  if (timeLeft >= milliseconds(0) && sleep) {
-    auto sleepDuration = std::min(timeLeft, milliseconds(10));
-    usleep(sleepDuration.count() * 1000);
+milliseconds CP2112::updateTimeLeft(steady_clock::time_point end,
+                                    microseconds sleep) {
+  auto timeLeft = duration_cast<microseconds>(end - steady_clock::now());
+  if (timeLeft >= microseconds(0) && sleep > microseconds(0)) {
+    auto sleepDuration = std::min(timeLeft, sleep);
+    usleep(sleepDuration.count());
     timeLeft -= sleepDuration;
   }
 
-  return timeLeft;
+  return duration_cast<milliseconds>(timeLeft);
+}
+
+microseconds CP2112::estimateBusTime(size_t busBytes) const {
+  // Each byte, plus the address byte, takes 9 clocks including the ACK
+  uint64_t clocks = (busBytes + 1) * 9;
+  return microseconds(clocks * 1000000 / busSpeed_);
 }
 
 uint16_t CP2112::featureReportIn(ReportID report,
@@ -827,13 +873,10 @@ void CP2112::intrOut(StringPiece name,
                      const uint8_t* buf, uint16_t length,
                      milliseconds timeout) {
   // The CP2112 always uses 64-byte interrupt transfers.
-  DCHECK_EQ(length, 64);
+  DCHECK_EQ(length, UsbIntrPipe::kReportSize);
+  CHECK(pipe_);
   vlogHex(6, "intr out:", buf, length);
 
-  // The CP2112 always uses endpoint 1 for interrupt transfers.
-  uint8_t outEndpoint = LIBUSB_ENDPOINT_OUT | 1;
-  int lenResult;
-
   // Always pass in a timeout of at least 5ms, even if the caller specifies
   // something smaller.  We generally don't want to timeout inside
   // libusb calls--if this occurs we can't easily tell if the tranfer was sent
@@ -841,42 +884,41 @@ void CP2112::intrOut(StringPiece name,
   //
   // This minimum timeout helps ensure that we timeout inside our own timeout
   // checks, and not inside libusb calls.
-  int usbTimeout = std::max(timeout.count(), 5L);
+  auto usbTimeout = std::max(timeout, milliseconds(5));
 
-  int rc = libusb_interrupt_transfer(handle_.handle(), outEndpoint,
-                                     const_cast<uint8_t*>(buf), length,
-                                     &lenResult, usbTimeout);
-  if (rc != 0) {
+  UsbIntrPipe::Report report;
+  memcpy(report.data(), buf, report.size());
+  try {
+    pipe_->send(report, usbTimeout);
+  } catch (const LibusbError& ex) {
     busGood_ = false;
-    throw LibusbError(rc, "failed to send ", name, " request");
+    throw LibusbError(ex.errorCode(), "failed to send ", name, " request");
   }
 }
 
 void CP2112::intrIn(uint8_t* buf, uint16_t length,
                     milliseconds timeout) {
   // The CP2112 always uses 64-byte interrupt transfers.
-  DCHECK_EQ(length, 64);
-
-  // The CP2112 always uses endpoint 1 for interrupt transfers.
-  uint8_t outEndpoint = LIBUSB_ENDPOINT_IN | 1;
-  int lenResult;
-
-  // Pass in a timeout of at least 1ms for libusb.
-  // With a timeout of 0 libusb won't even bother checking for available data,
-  // it just returns a timeout error immediately.
-  int usbTimeout = std::max(timeout.count(), 1L);
-  int rc = libusb_interrupt_transfer(handle_.handle(), outEndpoint,
-                                     buf, length,
-                                     &lenResult, usbTimeout);
-  if (rc != 0) {
+  DCHECK_EQ(length, UsbIntrPipe::kReportSize);
+  CHECK(pipe_);
+
+  // Wait at least 1ms, so that a report the device is just sending is not
+  // missed.
+  auto usbTimeout = std::max(timeout, milliseconds(1));
+  UsbIntrPipe::Report report;
+  bool received;
+  try {
+    received = pipe_->receive(&report, usbTimeout);
+  } catch (const UsbError&) {
     busGood_ = false;
-    throw LibusbError(rc, "error waiting for interrupt response");
+    throw;
   }
-  if (lenResult != 64) {
+  if (!received) {
     busGood_ = false;
-    throw UsbError("unexpected interrupt response length received from "
-                   "CP2112:", lenResult);
+    throw LibusbError(LIBUSB_ERROR_TIMEOUT,
+                      "error waiting for interrupt response");
   }
+  memcpy(buf, report.data(), report.size());
   vlogHex(6, "intr in:", buf, length);
 }
 
@@ -11,11 +11,13 @@
 
 #include "fboss/lib/usb/UsbDevice.h"
 #include "fboss/lib/usb/UsbHandle.h"
+#include "fboss/lib/usb/UsbIntrPipe.h"
 
 #include <folly/Range.h>
 
 #include <chrono>
 #include <cstdint>
+#include <memory>
 
 struct libusb_transfer;
 
@@ -28,6 +30,12 @@ namespace facebook { namespace fboss {
  * implement a non-blocking API, but Linux's standard I2C APIs only provide
  * blocking APIs.  Code that wants to deal with other I2C interfaces therefore
  * already has to support blocking operation.
+ *
+ * Underneath, the interrupt reports travel over an AsyncUsbIntrPipe, which
+ * keeps IN transfers queued so responses are picked up as soon as the device
+ * sends them.  While a transfer is in progress on the bus, its status is
+ * first polled after about as long as the transfer should take at the
+ * current bus speed, and then with an exponential backoff.
  */
 class CP2112 {
  public:
@@ -207,6 +215,13 @@ class CP2112 {
 
   CP2112();
   explicit CP2112(libusb_context* ctx);
+  /*
+   * Talk to the device over the given pipe rather than finding and opening
+   * it on USB, e.g. to test against a simulated device.  Only the SMBus
+   * transfer calls work on such an instance, since the feature reports need
+   * a real USB handle.  open() must not be called.
+   */
+  explicit CP2112(std::unique_ptr<UsbIntrPipe> pipe);
   ~CP2112();
 
   void open(bool setSmbusConfig=true);
@@ -374,10 +389,12 @@ class CP2112 {
                              uint32_t loopIter);
   std::chrono::milliseconds waitForTransfer(
       folly::StringPiece operation,
-      std::chrono::steady_clock::time_point end);
+      std::chrono::steady_clock::time_point end,
+      size_t busBytes);
   std::chrono::milliseconds updateTimeLeft(
       std::chrono::steady_clock::time_point end,
-      bool sleep);
+      std::chrono::microseconds sleep);
+  std::chrono::microseconds estimateBusTime(size_t busBytes) const;
 
   uint16_t featureReportIn(ReportID report, uint8_t* buf, uint16_t length);
   void fullFeatureReportIn(ReportID report, uint8_t* buf, uint16_t length);
@@ -390,9 +407,12 @@ class CP2112 {
   libusb_context* ctx_{nullptr};
   UsbDevice dev_;
   UsbHandle handle_;
+  std::unique_ptr<UsbIntrPipe> pipe_;
   bool ownCtx_{false};
   bool busGood_{true};
   std::chrono::milliseconds defaultTimeout_{500};
+  // The SMBus clock rate, used to estimate how long transfers take
+  uint32_t busSpeed_{SMBusConfig().speed};
 };
 
 }} // facebook::fboss
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
@@ -19,6 +20,27 @@ namespace facebook { namespace fboss {
  */
 class TransceiverI2CApi {
  public:
+  /*
+   * A single read or write, for running several against the same module
+   * with moduleTransaction().
+   */
+  struct Op {
+    enum Type : uint8_t { READ, WRITE };
+
+    static Op read(uint8_t i2cAddress, int offset, int len, uint8_t* buf) {
+      return Op{READ, i2cAddress, offset, len, buf};
+    }
+    static Op write(uint8_t i2cAddress, int offset, int len, uint8_t* buf) {
+      return Op{WRITE, i2cAddress, offset, len, buf};
+    }
+
+    Type type;
+    uint8_t i2cAddress;
+    int offset;
+    int len;
+    uint8_t* buf;
+  };
+
   TransceiverI2CApi() {};
   virtual ~TransceiverI2CApi() {}
   virtual void open() = 0;
@@ -28,6 +50,22 @@ class TransceiverI2CApi {
   virtual void moduleWrite(unsigned int module, uint8_t i2cAddress,
                            int offset, int len, uint8_t* buf) = 0;
 
+  /*
+   * Run several operations against one module, in order, stopping at the
+   * first one that throws.  Buses that have to select the module before
+   * talking to it can do so once for the whole list.
+   */
+  virtual void moduleTransaction(unsigned int module,
+                                 const std::vector<Op>& ops) {
+    for (const auto& op : ops) {
+      if (op.type == Op::READ) {
+        moduleRead(module, op.i2cAddress, op.offset, op.len, op.buf);
+      } else {
+        moduleWrite(module, op.i2cAddress, op.offset, op.len, op.buf);
+      }
+    }
+  }
+
   // Addresses to be queried by external callers:
   enum : uint8_t {
     ADDR_QSFP = 0x50,
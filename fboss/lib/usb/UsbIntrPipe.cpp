@@ -0,0 +1,240 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/lib/usb/UsbIntrPipe.h"
+#include "fboss/lib/usb/UsbError.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <folly/Memory.h>
+#include <glog/logging.h>
+#include <libusb-1.0/libusb.h>
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+// Interrupt transfers always use endpoint 1
+const uint8_t kInEndpoint = LIBUSB_ENDPOINT_IN | 1;
+const uint8_t kOutEndpoint = LIBUSB_ENDPOINT_OUT | 1;
+
+int transferStatusToError(int status) {
+  switch (status) {
+    case LIBUSB_TRANSFER_TIMED_OUT:
+      return LIBUSB_ERROR_TIMEOUT;
+    case LIBUSB_TRANSFER_STALL:
+      return LIBUSB_ERROR_PIPE;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+      return LIBUSB_ERROR_NO_DEVICE;
+    case LIBUSB_TRANSFER_OVERFLOW:
+      return LIBUSB_ERROR_OVERFLOW;
+  }
+  return LIBUSB_ERROR_IO;
+}
+
+}
+
+namespace facebook { namespace fboss {
+
+int UsbTransferOps::submit(libusb_transfer* transfer) {
+  return libusb_submit_transfer(transfer);
+}
+
+int UsbTransferOps::cancel(libusb_transfer* transfer) {
+  return libusb_cancel_transfer(transfer);
+}
+
+int UsbTransferOps::handleEvents(libusb_context* ctx, microseconds timeout) {
+  struct timeval tv;
+  tv.tv_sec = timeout.count() / 1000000;
+  tv.tv_usec = timeout.count() % 1000000;
+  return libusb_handle_events_timeout_completed(ctx, &tv, nullptr);
+}
+
+int UsbTransferOps::interruptTransfer(libusb_device_handle* handle,
+                                      uint8_t endpoint,
+                                      uint8_t* data,
+                                      int length,
+                                      int* transferred,
+                                      milliseconds timeout) {
+  return libusb_interrupt_transfer(handle, endpoint, data, length,
+                                   transferred, timeout.count());
+}
+
+AsyncUsbIntrPipe::AsyncUsbIntrPipe(libusb_context* ctx,
+                                   libusb_device_handle* handle)
+  : AsyncUsbIntrPipe(ctx, handle, folly::make_unique<UsbTransferOps>()) {
+}
+
+AsyncUsbIntrPipe::AsyncUsbIntrPipe(libusb_context* ctx,
+                                   libusb_device_handle* handle,
+                                   std::unique_ptr<UsbTransferOps> ops)
+  : ctx_(ctx),
+    handle_(handle),
+    ops_(std::move(ops)) {
+  try {
+    for (size_t idx = 0; idx < kNumInTransfers; ++idx) {
+      inTransfers_[idx] = libusb_alloc_transfer(0);
+      if (!inTransfers_[idx]) {
+        throw UsbError("failed to allocate USB interrupt transfer");
+      }
+      // No timeout: the transfers stay queued until a report arrives
+      libusb_fill_interrupt_transfer(inTransfers_[idx], handle_, kInEndpoint,
+                                     inBuffers_[idx].data(), kReportSize,
+                                     inCallback, this, 0);
+      submitIn(idx);
+      if (error_) {
+        throw LibusbError(error_, "failed to submit USB interrupt transfer");
+      }
+    }
+  } catch (...) {
+    cancelAll();
+    throw;
+  }
+}
+
+AsyncUsbIntrPipe::~AsyncUsbIntrPipe() {
+  cancelAll();
+}
+
+void AsyncUsbIntrPipe::send(const Report& report, milliseconds timeout) {
+  // The synchronous call handles events for the whole context while it
+  // waits, so it also collects any IN reports that complete meanwhile.
+  int lenResult;
+  int rc = ops_->interruptTransfer(handle_, kOutEndpoint,
+                                   const_cast<uint8_t*>(report.data()),
+                                   report.size(), &lenResult, timeout);
+  if (rc != 0) {
+    throw LibusbError(rc, "failed to send interrupt report");
+  }
+}
+
+bool AsyncUsbIntrPipe::receive(Report* report, microseconds timeout) {
+  auto end = steady_clock::now() + timeout;
+  while (true) {
+    // Hand out the reports that arrived before any error first, since they
+    // are still good
+    if (!received_.empty()) {
+      *report = received_.front();
+      received_.pop_front();
+      return true;
+    }
+    if (error_) {
+      auto error = error_;
+      error_ = 0;
+      // Requeue the failed transfers, so the pipe works again once the
+      // caller has resynchronized with the device
+      for (size_t idx = 0; idx < kNumInTransfers; ++idx) {
+        if (!inActive_[idx]) {
+          submitIn(idx);
+        }
+      }
+      throw LibusbError(error, "error waiting for interrupt response");
+    }
+
+    auto timeLeft = duration_cast<microseconds>(end - steady_clock::now());
+    if (timeLeft <= microseconds(0)) {
+      return false;
+    }
+    handleEvents(timeLeft);
+  }
+}
+
+void AsyncUsbIntrPipe::inCallback(libusb_transfer* transfer) {
+  auto pipe = static_cast<AsyncUsbIntrPipe*>(transfer->user_data);
+  auto it = std::find(pipe->inTransfers_.begin(), pipe->inTransfers_.end(),
+                      transfer);
+  DCHECK(it != pipe->inTransfers_.end());
+  pipe->inCompleted(it - pipe->inTransfers_.begin());
+}
+
+void AsyncUsbIntrPipe::inCompleted(size_t idx) {
+  auto transfer = inTransfers_[idx];
+  inActive_[idx] = false;
+  switch (transfer->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+      if (transfer->actual_length != kReportSize) {
+        LOG(ERROR) << "unexpected interrupt report length "
+                   << transfer->actual_length;
+        error_ = LIBUSB_ERROR_IO;
+        break;
+      }
+      received_.push_back(inBuffers_[idx]);
+      // A transfer that completed while cancelAll() is waiting must not be
+      // requeued, or it would be freed while still submitted
+      if (!closing_) {
+        submitIn(idx);
+      }
+      break;
+    case LIBUSB_TRANSFER_CANCELLED:
+      break;
+    default:
+      // Leave the transfer idle until receive() reports the error
+      error_ = transferStatusToError(transfer->status);
+      break;
+  }
+}
+
+void AsyncUsbIntrPipe::submitIn(size_t idx) {
+  int rc = ops_->submit(inTransfers_[idx]);
+  if (rc != 0) {
+    error_ = rc;
+    return;
+  }
+  inActive_[idx] = true;
+}
+
+void AsyncUsbIntrPipe::handleEvents(microseconds timeout) {
+  int rc = ops_->handleEvents(ctx_, timeout);
+  if (rc != 0) {
+    throw LibusbError(rc, "failed to handle USB events");
+  }
+}
+
+void AsyncUsbIntrPipe::cancelAll() {
+  closing_ = true;
+
+  // Transfers can only be freed once their cancellation has completed.
+  // Cancel whatever is still active on every pass, since a cancellation
+  // can race with the transfer completing.
+  auto end = steady_clock::now() + milliseconds(1000);
+  auto anyActive = [this] {
+    return std::find(inActive_.begin(), inActive_.end(), true) !=
+      inActive_.end();
+  };
+  while (anyActive() && steady_clock::now() < end) {
+    for (size_t idx = 0; idx < kNumInTransfers; ++idx) {
+      if (inActive_[idx]) {
+        ops_->cancel(inTransfers_[idx]);
+      }
+    }
+    try {
+      handleEvents(milliseconds(10));
+    } catch (const LibusbError& ex) {
+      LOG(ERROR) << "error cancelling USB interrupt transfers: " << ex.what();
+      break;
+    }
+  }
+
+  for (size_t idx = 0; idx < kNumInTransfers; ++idx) {
+    if (inActive_[idx]) {
+      // Freeing it now could corrupt libusb's state, so leak it instead
+      LOG(ERROR) << "USB interrupt transfer " << idx << " failed to cancel";
+    } else if (inTransfers_[idx]) {
+      libusb_free_transfer(inTransfers_[idx]);
+    }
+    inTransfers_[idx] = nullptr;
+  }
+}
+
+}} // facebook::fboss
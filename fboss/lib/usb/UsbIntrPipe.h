@@ -0,0 +1,129 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+struct libusb_context;
+struct libusb_device_handle;
+struct libusb_transfer;
+
+namespace facebook { namespace fboss {
+
+/*
+ * A pair of interrupt endpoints carrying fixed size reports, which is all
+ * the CP2112 protocol needs from USB.
+ *
+ * CP2112 talks to the device only through this interface, so tests can swap
+ * in a simulated device.
+ */
+class UsbIntrPipe {
+ public:
+  enum : uint16_t { kReportSize = 64 };
+  typedef std::array<uint8_t, kReportSize> Report;
+
+  virtual ~UsbIntrPipe() {}
+
+  /*
+   * Send a report to the device.  Throws a LibusbError on failure.
+   */
+  virtual void send(const Report& report,
+                    std::chrono::milliseconds timeout) = 0;
+
+  /*
+   * Wait for the next report from the device.  Returns false if none arrived
+   * within the timeout, and throws a LibusbError on any other failure.
+   */
+  virtual bool receive(Report* report,
+                       std::chrono::microseconds timeout) = 0;
+};
+
+/*
+ * The libusb calls that AsyncUsbIntrPipe moves its transfers with.  Each
+ * returns a libusb error code, or 0 on success.
+ *
+ * The default implementation calls straight into libusb.  Tests substitute
+ * one that completes, cancels and fails transfers on demand, by invoking
+ * their callbacks from handleEvents() like libusb does.
+ */
+class UsbTransferOps {
+ public:
+  virtual ~UsbTransferOps() {}
+
+  virtual int submit(libusb_transfer* transfer);
+  virtual int cancel(libusb_transfer* transfer);
+  virtual int handleEvents(libusb_context* ctx,
+                           std::chrono::microseconds timeout);
+  virtual int interruptTransfer(libusb_device_handle* handle,
+                                uint8_t endpoint,
+                                uint8_t* data,
+                                int length,
+                                int* transferred,
+                                std::chrono::milliseconds timeout);
+};
+
+/*
+ * UsbIntrPipe over an open libusb device, using endpoint 1 in each
+ * direction.
+ *
+ * Rather than submitting an IN transfer only while a caller is waiting, this
+ * keeps a ring of them queued at all times, and their completion callbacks
+ * collect the reports as they arrive.  This means that a multi-report
+ * response streams in back to back instead of each report waiting for the
+ * next transfer to be submitted, and that receive() returns as soon as the
+ * report is delivered.
+ *
+ * Events are handled in whichever thread calls receive() or send(), so no
+ * thread of its own is needed.  Like CP2112, this must only be used from one
+ * thread at a time.
+ */
+class AsyncUsbIntrPipe : public UsbIntrPipe {
+ public:
+  AsyncUsbIntrPipe(libusb_context* ctx, libusb_device_handle* handle);
+  AsyncUsbIntrPipe(libusb_context* ctx,
+                   libusb_device_handle* handle,
+                   std::unique_ptr<UsbTransferOps> ops);
+  ~AsyncUsbIntrPipe() override;
+
+  void send(const Report& report, std::chrono::milliseconds timeout) override;
+  bool receive(Report* report, std::chrono::microseconds timeout) override;
+
+ private:
+  enum : size_t { kNumInTransfers = 4 };
+
+  // Forbidden copy constructor and assignment operator
+  AsyncUsbIntrPipe(AsyncUsbIntrPipe const &) = delete;
+  AsyncUsbIntrPipe& operator=(AsyncUsbIntrPipe const &) = delete;
+
+  static void inCallback(libusb_transfer* transfer);
+  void inCompleted(size_t idx);
+  void submitIn(size_t idx);
+  void handleEvents(std::chrono::microseconds timeout);
+  void cancelAll();
+
+  libusb_context* const ctx_;
+  libusb_device_handle* const handle_;
+  std::unique_ptr<UsbTransferOps> ops_;
+  std::array<libusb_transfer*, kNumInTransfers> inTransfers_{{}};
+  std::array<Report, kNumInTransfers> inBuffers_;
+  // Which of inTransfers_ are submitted
+  std::array<bool, kNumInTransfers> inActive_{{}};
+  std::deque<Report> received_;
+  // A libusb error code from a failed IN transfer, or 0
+  int error_{0};
+  // Set by cancelAll(), after which completed transfers are not requeued
+  bool closing_{false};
+};
+
+}} // facebook::fboss
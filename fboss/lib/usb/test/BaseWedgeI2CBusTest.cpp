@@ -0,0 +1,173 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/lib/usb/BaseWedgeI2CBus.h"
+#include "fboss/lib/usb/UsbError.h"
+
+#include <folly/Memory.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::ByteRange;
+using folly::MutableByteRange;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::vector;
+
+namespace {
+
+// Nothing in these tests should reach the CP2112 itself
+class NoDevicePipe : public UsbIntrPipe {
+ public:
+  void send(const Report& /*report*/, milliseconds /*timeout*/) override {
+    ADD_FAILURE() << "unexpected USB report";
+    throw UsbError("no device");
+  }
+  bool receive(Report* /*report*/, microseconds /*timeout*/) override {
+    ADD_FAILURE() << "unexpected USB report";
+    return false;
+  }
+};
+
+/*
+ * A bus that counts switch writes and records which module each I2C
+ * operation went to.
+ */
+class FakeWedgeI2CBus : public BaseWedgeI2CBus {
+ public:
+  struct I2COp {
+    unsigned int module;
+    bool read;
+    size_t len;
+  };
+
+  FakeWedgeI2CBus()
+    : BaseWedgeI2CBus(folly::make_unique<NoDevicePipe>()) {}
+
+  unsigned int getSelectedPort() const {
+    return selectedPort_;
+  }
+
+  int muxWrites{0};
+  int initBuses{0};
+  bool failNextSelect{false};
+  vector<I2COp> ops;
+
+ protected:
+  void initBus() override {
+    ++initBuses;
+    muxPort_ = NO_PORT;
+  }
+  void verifyBus(bool) override {}
+
+  void selectQsfpImpl(unsigned int port) override {
+    ++muxWrites;
+    if (failNextSelect) {
+      failNextSelect = false;
+      selectedPort_ = NO_PORT;
+      throw UsbError("mux write failed");
+    }
+    muxPort_ = port;
+    selectedPort_ = port;
+  }
+
+  void i2cRead(uint8_t /*address*/, MutableByteRange buf) override {
+    ops.push_back(I2COp{muxPort_, true, buf.size()});
+    memset(buf.begin(), muxPort_, buf.size());
+  }
+  void i2cWrite(uint8_t /*address*/, ByteRange buf) override {
+    ops.push_back(I2COp{muxPort_, false, buf.size()});
+  }
+
+ private:
+  unsigned int muxPort_{NO_PORT};
+};
+
+} // unnamed namespace
+
+TEST(BaseWedgeI2CBusTest, SameModuleIsSelectedOnce) {
+  FakeWedgeI2CBus bus;
+  uint8_t buf[16];
+  for (int n = 0; n < 3; ++n) {
+    bus.moduleRead(3, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf);
+    EXPECT_EQ(3, buf[0]);
+  }
+  EXPECT_EQ(1, bus.muxWrites);
+  // Each read is an offset write followed by the read itself
+  EXPECT_EQ(6, bus.ops.size());
+
+  bus.moduleRead(4, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf);
+  bus.moduleRead(3, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf);
+  EXPECT_EQ(3, bus.muxWrites);
+  EXPECT_EQ(3, buf[0]);
+}
+
+TEST(BaseWedgeI2CBusTest, Transaction) {
+  typedef TransceiverI2CApi::Op Op;
+  FakeWedgeI2CBus bus;
+  uint8_t page0 = 0;
+  uint8_t page3 = 3;
+  uint8_t lower[128];
+  uint8_t upper0[128];
+  uint8_t upper3[128];
+  uint8_t all[256];
+  bus.moduleTransaction(5, {
+    Op::read(TransceiverI2CApi::ADDR_QSFP, 0, sizeof(lower), lower),
+    Op::write(TransceiverI2CApi::ADDR_QSFP, 127, 1, &page0),
+    Op::read(TransceiverI2CApi::ADDR_QSFP, 128, sizeof(upper0), upper0),
+    Op::write(TransceiverI2CApi::ADDR_QSFP, 127, 1, &page3),
+    Op::read(TransceiverI2CApi::ADDR_QSFP, 128, sizeof(upper3), upper3),
+    Op::read(TransceiverI2CApi::ADDR_QSFP, 0, sizeof(all), all),
+  });
+
+  EXPECT_EQ(1, bus.muxWrites);
+  // Reads of up to 128 bytes take two I2C operations, longer ones four
+  ASSERT_EQ(12, bus.ops.size());
+  for (const auto& op : bus.ops) {
+    EXPECT_EQ(5, op.module);
+  }
+  EXPECT_FALSE(bus.ops[2].read);
+  EXPECT_EQ(2, bus.ops[2].len);
+  EXPECT_EQ(5, upper3[127]);
+  EXPECT_EQ(5, all[255]);
+}
+
+TEST(BaseWedgeI2CBusTest, CloseUnselects) {
+  FakeWedgeI2CBus bus;
+  uint8_t buf[1];
+  bus.moduleRead(7, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf);
+  EXPECT_EQ(7, bus.getSelectedPort());
+
+  bus.close();
+  EXPECT_EQ(2, bus.muxWrites);
+  EXPECT_EQ(0, bus.getSelectedPort());
+}
+
+TEST(BaseWedgeI2CBusTest, FailedSelectionResetsSwitches) {
+  FakeWedgeI2CBus bus;
+  uint8_t buf[1];
+  bus.moduleRead(1, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf);
+
+  bus.failNextSelect = true;
+  EXPECT_THROW(
+      bus.moduleRead(2, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf),
+      UsbError);
+  EXPECT_EQ(2, bus.ops.size());
+  EXPECT_EQ(0, bus.initBuses);
+
+  // The switches are in an unknown state, so they get reset before the
+  // next selection, even of the module that was selected before
+  bus.moduleRead(1, TransceiverI2CApi::ADDR_QSFP, 0, sizeof(buf), buf);
+  EXPECT_EQ(1, bus.initBuses);
+  EXPECT_EQ(3, bus.muxWrites);
+  EXPECT_EQ(1, bus.ops.back().module);
+}
@@ -0,0 +1,271 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/lib/usb/CP2112.h"
+#include "fboss/lib/usb/UsbError.h"
+
+#include <folly/Memory.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace facebook::fboss;
+using folly::ByteRange;
+using folly::MutableByteRange;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::vector;
+
+namespace {
+
+/*
+ * Simulates the interrupt report protocol of a CP2112 with I2C devices
+ * behind it, with transfers that take as long as they would at the default
+ * 100kHz bus speed.
+ */
+class FakeCP2112 : public UsbIntrPipe {
+ public:
+  enum : uint8_t {
+    READ_REQUEST = 0x10,
+    WRITE_READ_REQUEST = 0x11,
+    READ_FORCE_SEND = 0x12,
+    READ_RESPONSE = 0x13,
+    WRITE = 0x14,
+    XFER_STATUS_REQUEST = 0x15,
+    XFER_STATUS_RESPONSE = 0x16,
+    CANCEL_XFER = 0x17,
+  };
+
+  // Shared with the test, which keeps it after the CP2112 takes the pipe
+  struct State {
+    std::map<uint8_t, vector<uint8_t>> memory;
+    std::set<uint8_t> nackAddresses;
+    // Transfers on the bus never finish
+    bool hang{false};
+    // How many READ_RESPONSE reports each READ_FORCE_SEND produces at most.
+    // The real device stops after about 300 bytes.
+    int maxResponsesPerForceSend{5};
+    std::map<uint8_t, int> requests;
+  };
+
+  explicit FakeCP2112(std::shared_ptr<State> state)
+    : state_(std::move(state)) {}
+
+  void send(const Report& report, milliseconds /*timeout*/) override {
+    ++state_->requests[report[0]];
+    switch (report[0]) {
+      case READ_REQUEST:
+        startRead(report[1], readLength(report), 0);
+        break;
+      case WRITE_READ_REQUEST:
+        startRead(report[1], readLength(report), report[5]);
+        break;
+      case WRITE: {
+        auto length = report[2];
+        auto& memory = state_->memory[report[1]];
+        memory.assign(report.begin() + 3, report.begin() + 3 + length);
+        startTransfer(report[1], length);
+        break;
+      }
+      case XFER_STATUS_REQUEST:
+        sendStatus();
+        break;
+      case READ_FORCE_SEND:
+        forceSend();
+        break;
+      case CANCEL_XFER:
+        active_ = false;
+        break;
+      default:
+        FAIL() << "unexpected report " << (int)report[0];
+    }
+  }
+
+  bool receive(Report* report, microseconds timeout) override {
+    if (responses_.empty()) {
+      std::this_thread::sleep_for(timeout);
+      return false;
+    }
+    *report = responses_.front();
+    responses_.pop_front();
+    return true;
+  }
+
+ private:
+  static uint16_t readLength(const Report& report) {
+    return (report[2] << 8) | report[3];
+  }
+
+  void startTransfer(uint8_t address, size_t bytes) {
+    active_ = true;
+    failed_ = state_->nackAddresses.count(address);
+    // 9 clocks per byte, plus the address, at 100kHz
+    doneAt_ = steady_clock::now() + microseconds((bytes + 1) * 90);
+  }
+
+  void startRead(uint8_t address, uint16_t length, uint8_t offset) {
+    startTransfer(address, length);
+    auto& memory = state_->memory[address];
+    readData_.assign(length, 0);
+    for (size_t idx = 0; idx < length && offset + idx < memory.size();
+         ++idx) {
+      readData_[idx] = memory[offset + idx];
+    }
+    readOffset_ = 0;
+    sentFinal_ = false;
+  }
+
+  bool done() const {
+    return active_ && !state_->hang && steady_clock::now() >= doneAt_;
+  }
+
+  void sendStatus() {
+    Report status{{XFER_STATUS_RESPONSE}};
+    if (!active_) {
+      status[1] = 0;
+    } else if (!done()) {
+      status[1] = 1;
+      status[2] = 2;
+    } else if (failed_) {
+      status[1] = 3;
+      status[2] = 0;
+    } else {
+      status[1] = 2;
+      status[2] = 5;
+      status[5] = readData_.size() >> 8;
+      status[6] = readData_.size() & 0xff;
+    }
+    responses_.push_back(status);
+  }
+
+  void forceSend() {
+    if (!done()) {
+      responses_.push_back(Report{{READ_RESPONSE, 1, 0}});
+      return;
+    }
+    for (int n = 0; n < state_->maxResponsesPerForceSend; ++n) {
+      if (readOffset_ == readData_.size()) {
+        // The device always finishes with an empty response
+        if (!sentFinal_) {
+          responses_.push_back(Report{{READ_RESPONSE, 0, 0}});
+          sentFinal_ = true;
+        }
+        return;
+      }
+      auto length = std::min<size_t>(61, readData_.size() - readOffset_);
+      Report response{{READ_RESPONSE, 2, static_cast<uint8_t>(length)}};
+      memcpy(response.data() + 3, readData_.data() + readOffset_, length);
+      readOffset_ += length;
+      responses_.push_back(response);
+    }
+  }
+
+  std::shared_ptr<State> state_;
+  std::deque<Report> responses_;
+  bool active_{false};
+  bool failed_{false};
+  steady_clock::time_point doneAt_;
+  vector<uint8_t> readData_;
+  size_t readOffset_{0};
+  bool sentFinal_{false};
+};
+
+class CP2112Test : public ::testing::Test {
+ protected:
+  enum : uint8_t { kAddress = 0xa0 };
+
+  void SetUp() override {
+    state_ = std::make_shared<FakeCP2112::State>();
+    auto& memory = state_->memory[kAddress];
+    for (int i = 0; i < 512; ++i) {
+      memory.push_back(i * 7);
+    }
+    cp2112_ = folly::make_unique<CP2112>(
+        folly::make_unique<FakeCP2112>(state_));
+  }
+
+  std::shared_ptr<FakeCP2112::State> state_;
+  std::unique_ptr<CP2112> cp2112_;
+};
+
+} // unnamed namespace
+
+TEST_F(CP2112Test, Read) {
+  uint8_t buf[128];
+  cp2112_->read(kAddress, MutableByteRange(buf, sizeof(buf)));
+  for (size_t i = 0; i < sizeof(buf); ++i) {
+    EXPECT_EQ(uint8_t(i * 7), buf[i]) << "byte " << i;
+  }
+}
+
+TEST_F(CP2112Test, LargeReadNeedsSeveralForceSends) {
+  uint8_t buf[512];
+  cp2112_->read(kAddress, MutableByteRange(buf, sizeof(buf)));
+  EXPECT_EQ(0, memcmp(buf, state_->memory[kAddress].data(), sizeof(buf)));
+  EXPECT_GT(state_->requests[FakeCP2112::READ_FORCE_SEND], 1);
+}
+
+TEST_F(CP2112Test, WriteAndWriteRead) {
+  uint8_t data[] = {1, 2, 3, 4};
+  cp2112_->write(0x50, ByteRange(data, sizeof(data)));
+  EXPECT_EQ(vector<uint8_t>(data, data + sizeof(data)),
+            state_->memory[0x50]);
+
+  uint8_t offset = 100;
+  uint8_t buf[16];
+  cp2112_->writeReadUnsafe(kAddress, ByteRange(&offset, 1),
+                           MutableByteRange(buf, sizeof(buf)));
+  for (size_t i = 0; i < sizeof(buf); ++i) {
+    EXPECT_EQ(uint8_t((offset + i) * 7), buf[i]) << "byte " << i;
+  }
+}
+
+TEST_F(CP2112Test, Nack) {
+  state_->nackAddresses.insert(0x52);
+  uint8_t buf[16];
+  EXPECT_THROW(cp2112_->read(0x52, MutableByteRange(buf, sizeof(buf))),
+               UsbError);
+
+  // The next transfer works normally
+  cp2112_->read(kAddress, MutableByteRange(buf, sizeof(buf)));
+  EXPECT_EQ(7, buf[1]);
+}
+
+TEST_F(CP2112Test, Timeout) {
+  state_->hang = true;
+  uint8_t buf[16];
+  EXPECT_THROW(cp2112_->read(kAddress, MutableByteRange(buf, sizeof(buf)),
+                             milliseconds(30)),
+               UsbError);
+  EXPECT_EQ(1, state_->requests[FakeCP2112::CANCEL_XFER]);
+}
+
+TEST_F(CP2112Test, ShortTransfersAreNotHeldUpByPolling) {
+  // Each 16 byte read takes about 1.5ms on the bus.  Polling the status
+  // every 10ms would take at least 10ms per read.
+  const int kNumReads = 20;
+  uint8_t buf[16];
+  auto start = steady_clock::now();
+  for (int n = 0; n < kNumReads; ++n) {
+    cp2112_->read(kAddress, MutableByteRange(buf, sizeof(buf)));
+  }
+  auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+  EXPECT_LT(elapsed, milliseconds(10 * kNumReads));
+  // Waiting for the estimated bus time first means most reads are complete
+  // by the first poll
+  EXPECT_LE(state_->requests[FakeCP2112::XFER_STATUS_REQUEST], 2 * kNumReads);
+}
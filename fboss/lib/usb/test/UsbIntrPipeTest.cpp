@@ -0,0 +1,333 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/lib/usb/UsbIntrPipe.h"
+#include "fboss/lib/usb/UsbError.h"
+
+#include <folly/Memory.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <libusb-1.0/libusb.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+using namespace facebook::fboss;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::unique_ptr;
+
+namespace {
+
+/*
+ * Stands in for libusb underneath an AsyncUsbIntrPipe.
+ *
+ * Submitted transfers stay queued until the test completes or fails them.
+ * Like libusb, their callbacks only run from handleEvents(), so a transfer
+ * can finish after the pipe has asked for it to be cancelled.
+ */
+class FakeTransferOps : public UsbTransferOps {
+ public:
+  // Shared with the test, which keeps it after the pipe takes the ops
+  struct State {
+    // Submitted transfers that have not finished, oldest first
+    std::deque<libusb_transfer*> submitted;
+    // Finished transfers whose callbacks have not run yet
+    std::deque<libusb_transfer*> finished;
+    size_t numSubmits{0};
+    int numSubmitsAfterCancel{0};
+    bool cancelCalled{false};
+    // Error codes to return from the next calls, or 0
+    int submitError{0};
+    int handleEventsError{0};
+    int interruptError{0};
+    std::deque<UsbIntrPipe::Report> sent;
+
+    // Complete the oldest submitted transfer with a report
+    void complete(const UsbIntrPipe::Report& report) {
+      auto transfer = finishOldest(LIBUSB_TRANSFER_COMPLETED);
+      memcpy(transfer->buffer, report.data(), report.size());
+      transfer->actual_length = report.size();
+    }
+
+    // Complete the oldest submitted transfer with only part of a report
+    void completeShort(int length) {
+      auto transfer = finishOldest(LIBUSB_TRANSFER_COMPLETED);
+      transfer->actual_length = length;
+    }
+
+    // Fail the oldest submitted transfer
+    void fail(libusb_transfer_status status) {
+      finishOldest(status);
+    }
+
+   private:
+    libusb_transfer* finishOldest(libusb_transfer_status status) {
+      CHECK(!submitted.empty());
+      auto transfer = submitted.front();
+      submitted.pop_front();
+      transfer->status = status;
+      transfer->actual_length = 0;
+      finished.push_back(transfer);
+      return transfer;
+    }
+  };
+
+  explicit FakeTransferOps(std::shared_ptr<State> state)
+    : state_(std::move(state)) {}
+
+  int submit(libusb_transfer* transfer) override {
+    if (state_->submitError) {
+      return state_->submitError;
+    }
+    ++state_->numSubmits;
+    if (state_->cancelCalled) {
+      ++state_->numSubmitsAfterCancel;
+    }
+    state_->submitted.push_back(transfer);
+    return 0;
+  }
+
+  int cancel(libusb_transfer* transfer) override {
+    state_->cancelCalled = true;
+    auto& submitted = state_->submitted;
+    auto it = std::find(submitted.begin(), submitted.end(), transfer);
+    if (it == submitted.end()) {
+      // Already finished, even if its callback has not run yet
+      return LIBUSB_ERROR_NOT_FOUND;
+    }
+    submitted.erase(it);
+    transfer->status = LIBUSB_TRANSFER_CANCELLED;
+    transfer->actual_length = 0;
+    state_->finished.push_back(transfer);
+    return 0;
+  }
+
+  int handleEvents(libusb_context* /*ctx*/,
+                   microseconds /*timeout*/) override {
+    if (state_->handleEventsError) {
+      return state_->handleEventsError;
+    }
+    while (!state_->finished.empty()) {
+      auto transfer = state_->finished.front();
+      state_->finished.pop_front();
+      transfer->callback(transfer);
+    }
+    return 0;
+  }
+
+  int interruptTransfer(libusb_device_handle* /*handle*/,
+                        uint8_t /*endpoint*/,
+                        uint8_t* data,
+                        int length,
+                        int* transferred,
+                        milliseconds /*timeout*/) override {
+    if (state_->interruptError) {
+      return state_->interruptError;
+    }
+    UsbIntrPipe::Report report;
+    CHECK_EQ(length, int(report.size()));
+    memcpy(report.data(), data, length);
+    state_->sent.push_back(report);
+    *transferred = length;
+    return 0;
+  }
+
+ private:
+  std::shared_ptr<State> state_;
+};
+
+const microseconds kTimeout = milliseconds(5);
+// The number of IN transfers the pipe keeps queued
+const size_t kNumInTransfers = 4;
+
+UsbIntrPipe::Report makeReport(uint8_t id) {
+  UsbIntrPipe::Report report;
+  report.fill(id);
+  return report;
+}
+
+class UsbIntrPipeTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    state_ = std::make_shared<FakeTransferOps::State>();
+  }
+
+  unique_ptr<AsyncUsbIntrPipe> createPipe() {
+    return folly::make_unique<AsyncUsbIntrPipe>(
+        nullptr, nullptr, folly::make_unique<FakeTransferOps>(state_));
+  }
+
+ protected:
+  std::shared_ptr<FakeTransferOps::State> state_;
+};
+
+} // unnamed namespace
+
+TEST_F(UsbIntrPipeTest, ReceiveRequeues) {
+  auto pipe = createPipe();
+  EXPECT_EQ(kNumInTransfers, state_->submitted.size());
+
+  UsbIntrPipe::Report report;
+  EXPECT_FALSE(pipe->receive(&report, kTimeout));
+
+  // Reports come out in the order they arrived, and every transfer that
+  // delivered one is queued again straight away
+  state_->complete(makeReport(1));
+  state_->complete(makeReport(2));
+  ASSERT_TRUE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(makeReport(1), report);
+  EXPECT_EQ(kNumInTransfers, state_->submitted.size());
+  ASSERT_TRUE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(makeReport(2), report);
+  EXPECT_FALSE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(kNumInTransfers + 2, state_->numSubmits);
+}
+
+TEST_F(UsbIntrPipeTest, MoreReportsThanTransfers) {
+  auto pipe = createPipe();
+
+  // Each round completes every queued transfer, so this only works if they
+  // are requeued in between
+  UsbIntrPipe::Report report;
+  for (int round = 0; round < 3; ++round) {
+    for (size_t n = 0; n < kNumInTransfers; ++n) {
+      state_->complete(makeReport(round * kNumInTransfers + n));
+    }
+    for (size_t n = 0; n < kNumInTransfers; ++n) {
+      ASSERT_TRUE(pipe->receive(&report, kTimeout));
+      EXPECT_EQ(makeReport(round * kNumInTransfers + n), report);
+    }
+  }
+}
+
+TEST_F(UsbIntrPipeTest, TransferError) {
+  auto pipe = createPipe();
+
+  // A report that arrived before the error is still handed out first
+  state_->complete(makeReport(1));
+  state_->fail(LIBUSB_TRANSFER_STALL);
+  UsbIntrPipe::Report report;
+  ASSERT_TRUE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(makeReport(1), report);
+
+  try {
+    pipe->receive(&report, kTimeout);
+    ADD_FAILURE() << "receive() did not report the failed transfer";
+  } catch (const LibusbError& ex) {
+    EXPECT_EQ(LIBUSB_ERROR_PIPE, ex.errorCode());
+  }
+
+  // The failed transfer was queued again, and the pipe works as before
+  EXPECT_EQ(kNumInTransfers, state_->submitted.size());
+  state_->complete(makeReport(2));
+  ASSERT_TRUE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(makeReport(2), report);
+}
+
+TEST_F(UsbIntrPipeTest, ShortReport) {
+  auto pipe = createPipe();
+
+  state_->completeShort(10);
+  UsbIntrPipe::Report report;
+  try {
+    pipe->receive(&report, kTimeout);
+    ADD_FAILURE() << "receive() accepted a short report";
+  } catch (const LibusbError& ex) {
+    EXPECT_EQ(LIBUSB_ERROR_IO, ex.errorCode());
+  }
+  EXPECT_EQ(kNumInTransfers, state_->submitted.size());
+}
+
+TEST_F(UsbIntrPipeTest, ResubmitError) {
+  auto pipe = createPipe();
+
+  // Requeueing the failed transfer fails as well.  That error is reported by
+  // the next receive(), which tries to requeue it again.
+  state_->fail(LIBUSB_TRANSFER_NO_DEVICE);
+  state_->submitError = LIBUSB_ERROR_NO_DEVICE;
+  UsbIntrPipe::Report report;
+  EXPECT_THROW(pipe->receive(&report, kTimeout), LibusbError);
+  EXPECT_EQ(kNumInTransfers - 1, state_->submitted.size());
+  EXPECT_THROW(pipe->receive(&report, kTimeout), LibusbError);
+  EXPECT_EQ(kNumInTransfers - 1, state_->submitted.size());
+
+  state_->submitError = 0;
+  EXPECT_THROW(pipe->receive(&report, kTimeout), LibusbError);
+  EXPECT_EQ(kNumInTransfers, state_->submitted.size());
+  state_->complete(makeReport(1));
+  ASSERT_TRUE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(makeReport(1), report);
+}
+
+TEST_F(UsbIntrPipeTest, HandleEventsError) {
+  auto pipe = createPipe();
+
+  state_->handleEventsError = LIBUSB_ERROR_INTERRUPTED;
+  UsbIntrPipe::Report report;
+  try {
+    pipe->receive(&report, kTimeout);
+    ADD_FAILURE() << "receive() ignored the event handling error";
+  } catch (const LibusbError& ex) {
+    EXPECT_EQ(LIBUSB_ERROR_INTERRUPTED, ex.errorCode());
+  }
+
+  state_->handleEventsError = 0;
+  state_->complete(makeReport(1));
+  ASSERT_TRUE(pipe->receive(&report, kTimeout));
+  EXPECT_EQ(makeReport(1), report);
+}
+
+TEST_F(UsbIntrPipeTest, SubmitErrorOnCreate) {
+  state_->submitError = LIBUSB_ERROR_NO_DEVICE;
+  try {
+    createPipe();
+    ADD_FAILURE() << "the pipe was created without its transfers";
+  } catch (const LibusbError& ex) {
+    EXPECT_EQ(LIBUSB_ERROR_NO_DEVICE, ex.errorCode());
+  }
+  EXPECT_TRUE(state_->submitted.empty());
+}
+
+TEST_F(UsbIntrPipeTest, CancelOnDestroy) {
+  auto pipe = createPipe();
+  pipe.reset();
+
+  EXPECT_TRUE(state_->cancelCalled);
+  EXPECT_TRUE(state_->submitted.empty());
+  EXPECT_TRUE(state_->finished.empty());
+  EXPECT_EQ(0, state_->numSubmitsAfterCancel);
+}
+
+TEST_F(UsbIntrPipeTest, CancelRacesCompletion) {
+  auto pipe = createPipe();
+
+  // These transfers finish before the pipe gets to cancel them, but their
+  // callbacks only run once it waits for the cancellations.  They must not
+  // be requeued, or they would be freed while still submitted.
+  state_->complete(makeReport(1));
+  state_->complete(makeReport(2));
+  pipe.reset();
+
+  EXPECT_TRUE(state_->submitted.empty());
+  EXPECT_TRUE(state_->finished.empty());
+  EXPECT_EQ(0, state_->numSubmitsAfterCancel);
+}
+
+TEST_F(UsbIntrPipeTest, Send) {
+  auto pipe = createPipe();
+
+  pipe->send(makeReport(7), milliseconds(10));
+  ASSERT_EQ(1u, state_->sent.size());
+  EXPECT_EQ(makeReport(7), state_->sent.front());
+
+  state_->interruptError = LIBUSB_ERROR_TIMEOUT;
+  EXPECT_THROW(pipe->send(makeReport(8), milliseconds(10)), LibusbError);
+}
@@ -23,15 +23,17 @@
 #include <mutex>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <linux/filter.h>
 #include <linux/if_ether.h>
-#include <netpacket/packet.h>
+#include <linux/if_packet.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <err.h>
 #include <errno.h>
+#include <poll.h>
 #include <string.h>
 #include <time.h>
 
@@ -64,6 +66,17 @@ DEFINE_int32(linkscan_interval_us, 250000,
              "The Broadcom linkscan interval");
 DEFINE_string(if_name, "eth0", "The local interface to listen on");
 DEFINE_int32(mtu, 9000, "The maximum packet size to expect");
+DEFINE_bool(packet_ring, true,
+            "Receive packets on the local interface through a TPACKET_V3 "
+            "ring shared with the kernel, rather than with one recvfrom() "
+            "call per packet");
+DEFINE_int32(ring_block_size, 1 << 17,
+             "The size of each block of the receive ring.  This must be a "
+             "multiple of the page size, and large enough for one packet");
+DEFINE_int32(ring_blocks, 8, "The number of blocks in the receive ring");
+DEFINE_int32(ring_block_timeout_ms, 100,
+             "How long the kernel waits for a partly filled ring block to "
+             "fill up before handing it to us anyway");
 DEFINE_bool(verbose, false,
              "Print more verbose information about each neighbor packet");
 
@@ -334,6 +347,9 @@ class LocalInterfaceProcessor {
     : interface_(interface.str()) {}
 
   virtual ~LocalInterfaceProcessor() {
+    if (ring_) {
+      munmap(ring_, ringSize_);
+    }
     if (fd_ >= 0) {
       ::close(fd_);
     }
@@ -349,12 +365,23 @@ class LocalInterfaceProcessor {
   void run();
 
  private:
+  void setupRing();
+  void runRing();
+  void runRecv();
+  void processBlock(const struct tpacket_block_desc* block);
+
   int fd_{-1};
   std::string interface_;
+
+  // The TPACKET_V3 receive ring, if --packet_ring is set
+  uint8_t* ring_{nullptr};
+  size_t ringSize_{0};
 };
 
 void LocalInterfaceProcessor::prepare() {
-  fd_ = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+  // Don't pass a protocol yet, so no packets are queued for us until the
+  // filter and ring are in place.
+  fd_ = socket(PF_PACKET, SOCK_RAW, 0);
   checkUnixError(fd_, "failed to create socket for local interface ",
                  interface_);
 
@@ -364,14 +391,6 @@ void LocalInterfaceProcessor::prepare() {
   int rc = ioctl(fd_, SIOCGIFINDEX, &ifr);
   checkUnixError(rc, "failed to get interface index for ", interface_);
 
-  // Bind the socket
-  struct sockaddr_ll addr;
-  addr.sll_family = AF_PACKET;
-  addr.sll_ifindex = ifr.ifr_ifindex;
-  addr.sll_protocol = htons(ETH_P_ALL);
-  rc = bind(fd_, (struct sockaddr*)&addr, sizeof(addr));
-  checkUnixError(rc, "failed to bind socket for ", interface_);
-
   // Ask linux to also send us packets sent to LLDP "nearest bridge" multicast
   // MAC address
   struct packet_mreq mr;
@@ -388,13 +407,40 @@ void LocalInterfaceProcessor::prepare() {
   rc = setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr, sizeof(mr));
   checkUnixError(rc, "failed to add CDP packet membership for ", interface_);
 
-  // Set a filter to ignore non-multicast packets, so we don't get a flood
-  // of meaningless packets that we don't care about.
+  // Have the kernel drop everything other than LLDP and CDP, so we don't
+  // spend time on the rest of the traffic on a busy interface.  This
+  // accepts:
+  // - LLDP, possibly VLAN tagged, sent to one of the 01:80:c2:00:00:0X
+  //   bridge group addresses
+  // - anything sent to the CDP address
   //
-  // tcpdump -i eth0 -dd ether multicast
+  //      ld [0]
+  //      jeq #0x0180c200, lldp, cdp
+  // lldp: ldh [4]
+  //      jset #0xfff0, drop, type
+  // type: ldh [12]
+  //      jeq #0x88cc, accept, vlan
+  // vlan: jeq #0x8100, inner, drop
+  // inner: ldh [16]
+  //      jeq #0x88cc, accept, drop
+  // cdp: jeq #0x01000ccc, cdp2, drop
+  // cdp2: ldh [4]
+  //      jeq #0xcccc, accept, drop
+  // accept: ret #65535
+  // drop: ret #0
   static struct sock_filter PACKET_FILTER[] = {
-    { 0x30, 0, 0, 0x00000000 },
-    { 0x45, 0, 1, 0x00000001 },
+    { 0x20, 0, 0, 0x00000000 },
+    { 0x15, 0, 7, 0x0180c200 },
+    { 0x28, 0, 0, 0x00000004 },
+    { 0x45, 9, 0, 0x0000fff0 },
+    { 0x28, 0, 0, 0x0000000c },
+    { 0x15, 6, 0, 0x000088cc },
+    { 0x15, 0, 6, 0x00008100 },
+    { 0x28, 0, 0, 0x00000010 },
+    { 0x15, 3, 4, 0x000088cc },
+    { 0x15, 0, 3, 0x01000ccc },
+    { 0x28, 0, 0, 0x00000004 },
+    { 0x15, 0, 1, 0x0000cccc },
     { 0x6, 0, 0, 0x0000ffff },
     { 0x6, 0, 0, 0x00000000 },
   };
@@ -403,14 +449,124 @@ void LocalInterfaceProcessor::prepare() {
   bpf.filter = PACKET_FILTER;
   rc = setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &bpf, sizeof(bpf));
   checkUnixError(rc, "failed to set socket packet filter for ", interface_);
+
+  if (FLAGS_packet_ring) {
+    setupRing();
+  }
+
+  // Bind the socket, which starts receiving packets
+  struct sockaddr_ll addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sll_family = AF_PACKET;
+  addr.sll_ifindex = ifr.ifr_ifindex;
+  addr.sll_protocol = htons(ETH_P_ALL);
+  rc = bind(fd_, (struct sockaddr*)&addr, sizeof(addr));
+  checkUnixError(rc, "failed to bind socket for ", interface_);
+}
+
+void LocalInterfaceProcessor::setupRing() {
+  // With TPACKET_V3 the kernel packs packets into large blocks, and hands
+  // us a whole block at a time once it is full or has timed out.  Reading
+  // them needs no system calls other than a poll() when we catch up.
+  int version = TPACKET_V3;
+  int rc = setsockopt(fd_, SOL_PACKET, PACKET_VERSION,
+                      &version, sizeof(version));
+  checkUnixError(rc, "failed to use TPACKET_V3 for ", interface_,
+                 " (use --nopacket_ring to receive without a ring)");
+
+  struct tpacket_req3 req;
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = FLAGS_ring_block_size;
+  req.tp_block_nr = FLAGS_ring_blocks;
+  // Frames are variable sized in TPACKET_V3, but the kernel still checks
+  // the frame size and count against the blocks.
+  req.tp_frame_size = TPACKET_ALIGNMENT << 7;
+  req.tp_frame_nr =
+    (req.tp_block_size / req.tp_frame_size) * req.tp_block_nr;
+  req.tp_retire_blk_tov = FLAGS_ring_block_timeout_ms;
+  rc = setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+  checkUnixError(rc, "failed to set up receive ring for ", interface_,
+                 " with ", FLAGS_ring_blocks, " blocks of ",
+                 FLAGS_ring_block_size, " bytes");
+
+  ringSize_ = size_t(req.tp_block_size) * req.tp_block_nr;
+  auto ring = mmap(nullptr, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd_, 0);
+  if (ring == MAP_FAILED) {
+    folly::throwSystemError("failed to map receive ring for ", interface_);
+  }
+  ring_ = static_cast<uint8_t*>(ring);
 }
 
 void LocalInterfaceProcessor::run() {
+  if (ring_) {
+    runRing();
+  } else {
+    runRecv();
+  }
+}
+
+void LocalInterfaceProcessor::runRing() {
+  size_t blockIdx = 0;
+  while (true) {
+    auto block = reinterpret_cast<struct tpacket_block_desc*>(
+        ring_ + blockIdx * FLAGS_ring_block_size);
+    auto status = __atomic_load_n(&block->hdr.bh1.block_status,
+                                  __ATOMIC_ACQUIRE);
+    if (!(status & TP_STATUS_USER)) {
+      // The kernel hasn't finished with this block yet, so wait for it
+      struct pollfd pfd;
+      pfd.fd = fd_;
+      pfd.events = POLLIN | POLLERR;
+      pfd.revents = 0;
+      int rc = poll(&pfd, 1, -1);
+      if (rc < 0 && errno == EINTR) {
+        continue;
+      }
+      checkUnixError(rc, "error waiting for packets from ", interface_);
+      continue;
+    }
+
+    processBlock(block);
+
+    // Hand the block back to the kernel
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                     __ATOMIC_RELEASE);
+    blockIdx = (blockIdx + 1) % FLAGS_ring_blocks;
+  }
+}
+
+void LocalInterfaceProcessor::processBlock(
+    const struct tpacket_block_desc* block) {
+  auto numPkts = block->hdr.bh1.num_pkts;
+  VLOG(4) << "received block of " << numPkts << " packets from "
+          << interface_;
+
+  auto pkt = reinterpret_cast<const uint8_t*>(block) +
+    block->hdr.bh1.offset_to_first_pkt;
+  for (uint32_t n = 0; n < numPkts; ++n) {
+    auto hdr = reinterpret_cast<const struct tpacket3_hdr*>(pkt);
+    // Parse the packet where it is in the ring.  processPacket() is done
+    // with it before we return the block to the kernel.
+    IOBuf buf(IOBuf::WRAP_BUFFER, pkt + hdr->tp_mac, hdr->tp_snaplen);
+    PortID srcPort{0};
+    VlanID srcVlan{0};
+    // The kernel strips any VLAN tag, but reports it here
+    if (hdr->tp_status & TP_STATUS_VLAN_VALID) {
+      srcVlan = VlanID(hdr->hv1.tp_vlan_tci & 0xfff);
+    }
+    processPacket(&buf, srcPort, srcVlan, interface_);
+    pkt += hdr->tp_next_offset;
+  }
+}
+
+void LocalInterfaceProcessor::runRecv() {
+  IOBuf buf(IOBuf::CREATE, FLAGS_mtu);
   while (true) {
-    IOBuf buf(IOBuf::CREATE, FLAGS_mtu);
+    buf.clear();
 
     struct sockaddr_ll src_addr;
-    socklen_t addr_len;
+    socklen_t addr_len = sizeof(src_addr);
     ssize_t len = recvfrom(fd_, buf.writableTail(), buf.tailroom(), 0,
                            (struct sockaddr*)&src_addr, &addr_len);
     checkUnixError(len, "error reading packet from ", interface_);
@@ -0,0 +1,361 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2004-present, Facebook, Inc.
+# All rights reserved.
+#
+# This source code is licensed under the BSD-style license found in the
+# LICENSE file in the root directory of this source tree. An additional grant
+# of patent rights can be found in the PATENTS file in the same directory.
+#
+"""
+Check lldp_tool's local interface receive path on a veth pair.
+
+One end of the pair is moved into a new network namespace, where lldp_tool
+listens on it with --nobcm.  This script sends LLDP, CDP and noise frames
+into the other end, and compares what lldp_tool reports with what was sent:
+
+  filter   LLDP (to several bridge group addresses, and VLAN tagged) and CDP
+           frames, mixed into thousands of frames the socket filter has to
+           drop.  Every LLDP and CDP frame must be reported, and in ring mode
+           no other frame may reach the ring.
+  burst    A burst of LLDP frames, which must arrive in a single ring block.
+  paced    Paced LLDP frames through a small ring, which must wrap around
+           several times without losing any.
+
+The filter check runs both with the ring and with --nopacket_ring.  Run it as
+root, with the path to an lldp_tool binary:
+
+  sudo fboss/util/lldp_tool_veth_test.py path/to/lldp_tool
+"""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+import argparse
+import binascii
+import os
+import re
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+ETH_P_ALL = 0x0003
+ETHERTYPE_IPV4 = 0x0800
+ETHERTYPE_ARP = 0x0806
+ETHERTYPE_VLAN = 0x8100
+ETHERTYPE_LLDP = 0x88cc
+
+SRC_MAC = '02:00:00:00:00:01'
+BROADCAST = 'ff:ff:ff:ff:ff:ff'
+LLDP_NEAREST_BRIDGE = '01:80:c2:00:00:0e'
+LLDP_NEAREST_NON_TPMR_BRIDGE = '01:80:c2:00:00:03'
+LLDP_NEAREST_CUSTOMER_BRIDGE = '01:80:c2:00:00:00'
+CDP = '01:00:0c:cc:cc:cc'
+
+BLOCK_RE = re.compile(r'received block of (\d+) packets')
+NEIGHBOR_RE = re.compile(r'^(LLDP|CDP): .* remote_system=(\S+) ')
+
+
+def mac(addr):
+    return binascii.unhexlify(addr.replace(':', ''))
+
+
+def eth_header(dst, ethertype, vlan=None):
+    hdr = mac(dst) + mac(SRC_MAC)
+    if vlan is not None:
+        hdr += struct.pack('!HH', ETHERTYPE_VLAN, vlan)
+    return hdr + struct.pack('!H', ethertype)
+
+
+def lldp_tlv(tlv_type, value):
+    return struct.pack('!H', (tlv_type << 9) | len(value)) + value
+
+
+def lldp_frame(name, dst=LLDP_NEAREST_BRIDGE, vlan=None):
+    name = name.encode('ascii')
+    pdu = (lldp_tlv(1, b'\x07' + name) +             # chassis ID, local
+           lldp_tlv(2, b'\x05' + b'eth0') +          # port ID, ifname
+           lldp_tlv(3, struct.pack('!H', 120)) +     # TTL
+           lldp_tlv(5, name) +                       # system name
+           lldp_tlv(0, b''))                         # end
+    return eth_header(dst, ETHERTYPE_LLDP, vlan) + pdu
+
+
+def cdp_tlv(tlv_type, value):
+    return struct.pack('!HH', tlv_type, len(value) + 4) + value
+
+
+def cdp_frame(name):
+    # CDP comes in 802.3 frames with an LLC/SNAP header.  The parser reads
+    # TLVs up to the end of the frame, so it must not be padded.
+    payload = (b'\xaa\xaa\x03' +                     # LLC, SNAP
+               b'\x00\x00\x0c' + b'\x20\x00' +       # Cisco, CDP
+               struct.pack('!BBH', 2, 180, 0) +      # version, TTL, checksum
+               cdp_tlv(1, name.encode('ascii')) +    # device ID
+               cdp_tlv(3, b'eth0'))                  # port ID
+    return mac(CDP) + mac(SRC_MAC) + struct.pack('!H', len(payload)) + payload
+
+
+def noise_frames():
+    '''Frames the socket filter has to drop'''
+    junk = b'\x00' * 46
+    lldp = lldp_frame('noise')[14:]
+    return [
+        eth_header(BROADCAST, ETHERTYPE_IPV4) + junk,
+        eth_header(BROADCAST, ETHERTYPE_ARP) + junk,
+        eth_header('33:33:00:00:00:01', 0x86dd) + junk,
+        # LLDP, but not to a bridge group address
+        eth_header('01:80:c2:00:00:10', ETHERTYPE_LLDP) + lldp,
+        eth_header('01:80:c2:00:01:0e', ETHERTYPE_LLDP) + lldp,
+        eth_header('02:00:00:00:00:02', ETHERTYPE_LLDP) + lldp,
+        # A bridge group address, but not LLDP
+        eth_header(LLDP_NEAREST_BRIDGE, ETHERTYPE_IPV4) + junk,
+        eth_header(LLDP_NEAREST_BRIDGE, ETHERTYPE_IPV4, vlan=42) + junk,
+        # Close to the CDP address
+        mac('01:00:0c:cc:cc:cd') + mac(SRC_MAC) + struct.pack('!H', 46) + junk,
+        mac('01:00:0c:cd:cc:cc') + mac(SRC_MAC) + struct.pack('!H', 46) + junk,
+    ]
+
+
+def run(cmd):
+    subprocess.check_call(cmd)
+
+
+class VethPair(object):
+    '''A veth pair, with the listening end in its own network namespace'''
+
+    def __init__(self, name):
+        self.netns = name
+        self.listen_if = name + '-l'
+        self.send_if = name + '-s'
+
+    def __enter__(self):
+        run(['ip', 'netns', 'add', self.netns])
+        try:
+            run(['ip', 'link', 'add', self.send_if, 'type', 'veth',
+                 'peer', 'name', self.listen_if])
+            run(['ip', 'link', 'set', self.listen_if, 'netns', self.netns])
+            run(['ip', 'link', 'set', self.send_if, 'up'])
+            run(['ip', 'netns', 'exec', self.netns,
+                 'ip', 'link', 'set', self.listen_if, 'up'])
+        except Exception:
+            self.__exit__(None, None, None)
+            raise
+        return self
+
+    def __exit__(self, exc_type, exc_value, tb):
+        # Deleting either end deletes the pair
+        subprocess.call(['ip', 'link', 'del', self.send_if],
+                        stderr=open(os.devnull, 'w'))
+        subprocess.call(['ip', 'netns', 'del', self.netns])
+
+
+class LldpTool(object):
+    '''lldp_tool listening on the namespaced end of a veth pair'''
+
+    def __init__(self, args, veth, flags):
+        self.args = args
+        self.veth = veth
+        self.flags = flags
+
+    def __enter__(self):
+        self.out = tempfile.TemporaryFile()
+        self.err = tempfile.TemporaryFile()
+        cmd = ['ip', 'netns', 'exec', self.veth.netns, self.args.lldp_tool,
+               '--nobcm', '--if_name=' + self.veth.listen_if,
+               '--logtostderr', '-v=4'] + self.flags
+        self.proc = subprocess.Popen(cmd, stdout=self.out, stderr=self.err)
+        # There is no reliable sign that the socket is bound, since the
+        # "Listening" message is buffered when stdout is a file
+        time.sleep(self.args.startup_delay)
+        if self.proc.poll() is not None:
+            raise Exception('lldp_tool exited early: %s' % self.stderr())
+        return self
+
+    def __exit__(self, exc_type, exc_value, tb):
+        if self.proc.poll() is None:
+            self.proc.terminate()
+        self.proc.wait()
+
+    def stop(self):
+        self.__exit__(None, None, None)
+
+    def _read(self, f):
+        f.seek(0)
+        return f.read().decode('utf-8', 'replace')
+
+    def stdout(self):
+        return self._read(self.out)
+
+    def stderr(self):
+        return self._read(self.err)
+
+    def neighbors(self):
+        '''The (protocol, remote system) of every reported neighbor'''
+        result = []
+        for line in self.stdout().splitlines():
+            m = NEIGHBOR_RE.match(line)
+            if m:
+                result.append((m.group(1), m.group(2)))
+        return result
+
+    def blocks(self):
+        '''The number of packets in each ring block lldp_tool read'''
+        return [int(n) for n in BLOCK_RE.findall(self.stderr())]
+
+
+class Harness(object):
+    def __init__(self, args):
+        self.args = args
+        self.failures = 0
+
+    def check(self, ok, msg):
+        print('%s: %s' % ('ok' if ok else 'FAIL', msg))
+        if not ok:
+            self.failures += 1
+
+    def send(self, veth, frames, interval=0):
+        sock = socket.socket(socket.AF_PACKET, socket.SOCK_RAW,
+                             socket.htons(ETH_P_ALL))
+        try:
+            sock.bind((veth.send_if, 0))
+            for frame in frames:
+                sock.send(frame)
+                if interval:
+                    time.sleep(interval)
+        finally:
+            sock.close()
+
+    def drain(self, timeout_ms):
+        # Give the kernel time to retire the last, partly filled block
+        time.sleep(timeout_ms / 1000.0 + self.args.settle_delay)
+
+    def test_filter(self, veth, ring):
+        mode = 'ring' if ring else 'recvfrom'
+        wanted = [
+            (lldp_frame('lldp-nearest-bridge'), ('LLDP', 'lldp-nearest-bridge')),
+            (lldp_frame('lldp-non-tpmr-bridge',
+                        dst=LLDP_NEAREST_NON_TPMR_BRIDGE),
+             ('LLDP', 'lldp-non-tpmr-bridge')),
+            (lldp_frame('lldp-customer-bridge',
+                        dst=LLDP_NEAREST_CUSTOMER_BRIDGE),
+             ('LLDP', 'lldp-customer-bridge')),
+            (lldp_frame('lldp-tagged', vlan=42), ('LLDP', 'lldp-tagged')),
+            (cdp_frame('cdp-device'), ('CDP', 'cdp-device')),
+        ]
+        noise = noise_frames()
+
+        # Spread the frames we want through the noise
+        rounds = max(self.args.noise_rounds, len(wanted))
+        step = rounds // len(wanted)
+        frames = []
+        for n in range(rounds):
+            frames.extend(noise)
+            if n % step == step // 2 and n // step < len(wanted):
+                frames.append(wanted[n // step][0])
+        num_noise = rounds * len(noise)
+
+        timeout_ms = 50
+        flags = ['--ring_block_timeout_ms=%d' % timeout_ms]
+        if not ring:
+            flags.append('--nopacket_ring')
+        with LldpTool(self.args, veth, flags) as tool:
+            self.send(veth, frames)
+            self.drain(timeout_ms)
+            tool.stop()
+
+            expected = sorted(w[1] for w in wanted)
+            self.check(sorted(tool.neighbors()) == expected,
+                       '%s: %d LLDP and CDP frames out of %d noise frames '
+                       'reported (got %s)' %
+                       (mode, len(wanted), num_noise, tool.neighbors()))
+            if ring:
+                received = sum(tool.blocks())
+                self.check(received == len(wanted),
+                           '%s: only the %d LLDP and CDP frames reached the '
+                           'ring (got %d)' % (mode, len(wanted), received))
+
+    def test_burst(self, veth):
+        count = 200
+        # Long enough that only a full block, or the end of the test, hands
+        # the block over
+        timeout_ms = 2000
+        frames = [lldp_frame('burst-%d' % n) for n in range(count)]
+        with LldpTool(self.args, veth,
+                      ['--ring_block_timeout_ms=%d' % timeout_ms]) as tool:
+            self.send(veth, frames)
+            self.drain(timeout_ms)
+            tool.stop()
+
+            self.check(len(tool.neighbors()) == count,
+                       'burst: %d frames reported (got %d)' %
+                       (count, len(tool.neighbors())))
+            self.check(tool.blocks() == [count],
+                       'burst: %d frames arrived in one block (got %s)' %
+                       (count, tool.blocks()))
+
+    def test_paced(self, veth):
+        count = 1000
+        num_blocks = 4
+        timeout_ms = 5
+        frames = [lldp_frame('paced-%d' % n) for n in range(count)]
+        flags = ['--ring_blocks=%d' % num_blocks,
+                 '--ring_block_size=4096',
+                 '--ring_block_timeout_ms=%d' % timeout_ms]
+        with LldpTool(self.args, veth, flags) as tool:
+            self.send(veth, frames, interval=0.001)
+            self.drain(timeout_ms)
+            tool.stop()
+
+            names = set(n[1] for n in tool.neighbors())
+            self.check(names == set('paced-%d' % n for n in range(count)),
+                       'paced: %d frames reported (got %d)' %
+                       (count, len(names)))
+            blocks = tool.blocks()
+            self.check(len(blocks) > num_blocks,
+                       'paced: the %d block ring wrapped around (%d blocks '
+                       'read)' % (num_blocks, len(blocks)))
+
+    def run(self):
+        with VethPair(self.args.name) as veth:
+            self.test_filter(veth, ring=True)
+            self.test_filter(veth, ring=False)
+            self.test_burst(veth)
+            self.test_paced(veth)
+        return self.failures
+
+
+def main():
+    ap = argparse.ArgumentParser(
+        description='Check lldp_tool\'s socket filter and receive ring on a '
+        'veth pair')
+    ap.add_argument('lldp_tool', help='The lldp_tool binary to test')
+    ap.add_argument('--name', default='lldptest',
+                    help='The network namespace to create, and the prefix '
+                    'of the veth interface names')
+    ap.add_argument('--noise-rounds', type=int, default=250,
+                    help='How many times to send each kind of noise frame')
+    ap.add_argument('--startup-delay', type=float, default=1.0,
+                    help='Seconds to give lldp_tool to start listening')
+    ap.add_argument('--settle-delay', type=float, default=0.5,
+                    help='Extra seconds to wait for lldp_tool to catch up')
+    args = ap.parse_args()
+
+    if os.geteuid() != 0:
+        print('must be run as root', file=sys.stderr)
+        return 1
+
+    failures = Harness(args).run()
+    if failures:
+        print('%d checks failed' % failures)
+        return 1
+    print('all checks passed')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
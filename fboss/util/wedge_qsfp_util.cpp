@@ -94,9 +94,11 @@ void printChannelMonitor(unsigned int index,
 void printPortDetail(TransceiverI2CApi* bus, unsigned int port) {
   uint8_t buf[256];
   try {
-    bus->moduleRead(port, TransceiverI2CApi::ADDR_QSFP, 0, 128, buf);
-    bus->moduleRead(port, TransceiverI2CApi::ADDR_QSFP, 128,
-                    128, buf + 128);
+    typedef TransceiverI2CApi::Op Op;
+    bus->moduleTransaction(port, {
+      Op::read(TransceiverI2CApi::ADDR_QSFP, 0, 128, buf),
+      Op::read(TransceiverI2CApi::ADDR_QSFP, 128, 128, buf + 128),
+    });
   } catch (const UsbError& ex) {
     // This generally means the QSFP module is not present.
     fprintf(stderr, "Port %d: not present\n", port);